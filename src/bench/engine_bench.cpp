@@ -0,0 +1,483 @@
+/**
+ * @file engine_bench.cpp
+ * @brief Microbenchmarks of the storage engine's components
+ * @details Measures the engine without the network server in the way: the MemTable skip list,
+ *          RESP decoding, SSTable writing and point lookups, compaction throughput, and LSMTree
+ *          workloads (sequential and random fills, Zipfian reads and the YCSB core workloads A to F)
+ *          on a configurable number of threads. Progress goes to stderr and the results to stdout
+ *          as one JSON document, so runs of different releases can be compared.
+ *
+ *          Usage: ./engine_bench [threads] [records] [filter]
+ *          `records` sizes every data set (default 200000); `filter` runs only the benchmarks whose
+ *          name contains it. Tables and logs are written under bench_data/, removed afterwards.
+ * @author Gana Jayant Sigadam
+ * @version 1.0
+ * @date March 2025
+ */
+#include "../engine/lsm.hpp"
+#include "../engine/metrics.hpp"
+#include "../resp/resp_decoder.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const std::string BENCH_DIR = "bench_data/";
+constexpr size_t VALUE_SIZE = 100;
+
+/**
+ * @brief Parameters shared by every benchmark
+ */
+struct Config {
+    size_t threads = 4;
+    size_t records = 200000;
+    std::string filter;
+};
+
+/**
+ * @brief Outcome of one benchmark
+ */
+struct Result {
+    std::string name;
+    size_t size = 0;    ///< Records in the data set.
+    size_t threads = 1; ///< Threads issuing operations.
+    uint64_t ops = 0;
+    uint64_t bytes = 0; ///< Bytes processed, for benchmarks that report a bandwidth; 0 otherwise.
+    double seconds = 0;
+    LatencyHistogram latency; ///< Per-operation latency, for benchmarks that time each operation.
+};
+
+std::vector<Result> results;
+
+void report(const Result &result) {
+    std::fprintf(stderr, "%-28s %10.0f ops/s", result.name.c_str(), result.ops / result.seconds);
+    if (result.bytes > 0) {
+        std::fprintf(stderr, " %9.1f MB/s", result.bytes / result.seconds / (1024 * 1024));
+    }
+    if (result.latency.count > 0) {
+        std::fprintf(stderr, "  p50 %llu us  p99 %llu us", static_cast<unsigned long long>(result.latency.percentile(50)),
+                     static_cast<unsigned long long>(result.latency.percentile(99)));
+    }
+    std::fprintf(stderr, "\n");
+    results.push_back(result);
+}
+
+void printJson(const Config &config) {
+    std::printf("{\n  \"config\": {\"threads\": %zu, \"records\": %zu, \"value_size\": %zu, \"compression\": \"%s\"},\n",
+                config.threads, config.records, VALUE_SIZE, Compression::isSupported(BLOCK_COMPRESSION) ? "on" : "off");
+    std::printf("  \"results\": [");
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result &r = results[i];
+        std::printf("%s\n    {\"name\": \"%s\", \"size\": %zu, \"threads\": %zu, \"ops\": %llu, \"seconds\": %.6f, "
+                    "\"ops_per_sec\": %.1f",
+                    i == 0 ? "" : ",", r.name.c_str(), r.size, r.threads, static_cast<unsigned long long>(r.ops), r.seconds,
+                    r.ops / r.seconds);
+        if (r.bytes > 0) {
+            std::printf(", \"mb_per_sec\": %.2f", r.bytes / r.seconds / (1024 * 1024));
+        }
+        if (r.latency.count > 0) {
+            std::printf(", \"latency_us\": {\"p50\": %llu, \"p99\": %llu, \"p999\": %llu, \"max\": %llu, \"mean\": %.2f}",
+                        static_cast<unsigned long long>(r.latency.percentile(50)),
+                        static_cast<unsigned long long>(r.latency.percentile(99)),
+                        static_cast<unsigned long long>(r.latency.percentile(99.9)),
+                        static_cast<unsigned long long>(r.latency.max), r.latency.mean());
+        }
+        std::printf("}");
+    }
+    std::printf("\n  ]\n}\n");
+}
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+std::string makeKey(uint64_t i) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "user%012llu", static_cast<unsigned long long>(i));
+    return buffer;
+}
+
+std::string makeValue(std::mt19937_64 &gen) {
+    std::string value(VALUE_SIZE, '\0');
+    for (char &c : value) {
+        c = static_cast<char>('a' + gen() % 26);
+    }
+    return value;
+}
+
+/**
+ * @brief Scatters record numbers over the key space, as YCSB hashes its keys
+ */
+uint64_t scramble(uint64_t i) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (int b = 0; b < 8; ++b) {
+        hash = (hash ^ ((i >> (b * 8)) & 0xFF)) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+/**
+ * @class Zipfian
+ * @brief Zipfian distribution over [0, n), as generated by YCSB (Gray et al., "Quickly Generating
+ *        Billion-Record Synthetic Databases")
+ */
+class Zipfian {
+    uint64_t n;
+    double theta, alpha, zeta_n, eta;
+
+    static double zeta(uint64_t n, double theta) {
+        double sum = 0;
+        for (uint64_t i = 1; i <= n; ++i) {
+            sum += 1.0 / std::pow(static_cast<double>(i), theta);
+        }
+        return sum;
+    }
+
+public:
+    explicit Zipfian(uint64_t n, double theta = 0.99) : n(n), theta(theta) {
+        alpha = 1.0 / (1.0 - theta);
+        zeta_n = zeta(n, theta);
+        eta = (1.0 - std::pow(2.0 / static_cast<double>(n), 1.0 - theta)) / (1.0 - zeta(2, theta) / zeta_n);
+    }
+
+    /**
+     * @brief Draws a rank; 0 is the most popular.
+     */
+    uint64_t next(std::mt19937_64 &gen) const {
+        double u = std::uniform_real_distribution<double>(0.0, 1.0)(gen);
+        double uz = u * zeta_n;
+        if (uz < 1.0) {
+            return 0;
+        }
+        if (uz < 1.0 + std::pow(0.5, theta)) {
+            return 1;
+        }
+        return std::min<uint64_t>(n - 1, static_cast<uint64_t>(n * std::pow(eta * u - eta + 1.0, alpha)));
+    }
+};
+
+bool selected(const Config &config, const std::string &name) {
+    return config.filter.empty() || name.find(config.filter) != std::string::npos;
+}
+
+/**
+ * @brief Runs op(thread, gen, i) for ops operations split over threads, timing each one.
+ */
+template <typename Op>
+Result runThreads(const std::string &name, size_t size, size_t threads, uint64_t ops, Op op) {
+    std::vector<LatencyHistogram> latencies(threads);
+    std::vector<std::thread> workers;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            std::mt19937_64 gen(t + 1);
+            for (uint64_t i = t; i < ops; i += threads) {
+                auto op_start = std::chrono::steady_clock::now();
+                op(t, gen, i);
+                latencies[t].record(Metrics::microsSince(op_start));
+            }
+        });
+    }
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+    Result result;
+    result.name = name;
+    result.size = size;
+    result.threads = threads;
+    result.ops = ops;
+    result.seconds = secondsSince(start);
+    for (const LatencyHistogram &latency : latencies) {
+        result.latency.merge(latency);
+    }
+    return result;
+}
+
+/**
+ * @brief Waits until no flush or compaction has run for a second and no MemTable awaits a flush.
+ */
+void waitForBackgroundWork(LSMTree &tree) {
+    uint64_t last = ~0ULL;
+    for (;;) {
+        uint64_t done = Metrics::getHistogram(Timer::FLUSH).count + Metrics::getHistogram(Timer::COMPACTION).count;
+        if (done == last && tree.getTreeStats().immutable_memtables == 0) {
+            return;
+        }
+        last = done;
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+    }
+}
+
+void benchSkipList(const Config &config) {
+    for (size_t size : {config.records / 10, config.records, config.records * 5}) {
+        std::vector<uint64_t> order(size);
+        std::iota(order.begin(), order.end(), 0);
+        std::shuffle(order.begin(), order.end(), std::mt19937_64(1));
+        std::vector<std::string> keys;
+        keys.reserve(size);
+        for (uint64_t i : order) {
+            keys.push_back(makeKey(i));
+        }
+        std::mt19937_64 gen(2);
+        std::string value = makeValue(gen);
+
+        ArenaSkipList list;
+        Result put;
+        put.name = "skiplist.put";
+        put.size = size;
+        put.ops = size;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < size; ++i) {
+            list.put(keys[i], value, i + 1);
+        }
+        put.seconds = secondsSince(start);
+        report(put);
+
+        Result get;
+        get.name = "skiplist.get";
+        get.size = size;
+        get.ops = size;
+        size_t found = 0;
+        start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < size; ++i) {
+            found += list.get(keys[gen() % size]).first;
+        }
+        get.seconds = secondsSince(start);
+        if (found != size) {
+            std::cerr << "skiplist.get: " << size - found << " keys missing" << std::endl;
+        }
+        report(get);
+    }
+}
+
+void benchRespDecode(const Config &config) {
+    std::mt19937_64 gen(3);
+    std::string value = makeValue(gen);
+    std::string buffer;
+    size_t commands = config.records;
+    for (size_t i = 0; i < commands; ++i) {
+        std::string key = makeKey(gen() % config.records);
+        if (i % 2 == 0) {
+            buffer += "*3\r\n$3\r\nSET\r\n$" + std::to_string(key.size()) + "\r\n" + key + "\r\n$" +
+                      std::to_string(value.size()) + "\r\n" + value + "\r\n";
+        } else {
+            buffer += "*2\r\n$3\r\nGET\r\n$" + std::to_string(key.size()) + "\r\n" + key + "\r\n";
+        }
+    }
+
+    Result result;
+    result.name = "resp.decode";
+    result.size = commands;
+    result.bytes = buffer.size();
+    auto start = std::chrono::steady_clock::now();
+    size_t offset = 0;
+    while (offset < buffer.size()) {
+        size_t consumed = 0;
+        Resp resp = RespDecoder::decode(buffer.data() + offset, buffer.size() - offset, consumed);
+        if (!resp.success) {
+            std::cerr << "resp.decode: " << resp.error << std::endl;
+            return;
+        }
+        offset += consumed;
+        ++result.ops;
+    }
+    result.seconds = secondsSince(start);
+    report(result);
+}
+
+void benchSSTable(const Config &config) {
+    size_t size = config.records;
+    std::mt19937_64 gen(4);
+    MemTable memtable;
+    for (size_t i = 0; i < size; ++i) {
+        memtable.put(makeKey(i * 2), makeValue(gen), i + 1);
+    }
+
+    std::string filename = BENCH_DIR + "bench_table";
+    Result build;
+    build.name = "sstable.create_from_memtable";
+    build.size = size;
+    build.ops = size;
+    auto start = std::chrono::steady_clock::now();
+    if (!SS_Table::createFromMemTable(filename, &memtable)) {
+        std::cerr << "sstable.create_from_memtable: failed to write the table" << std::endl;
+        return;
+    }
+    build.seconds = secondsSince(start);
+    build.bytes = memtable.getSize();
+    report(build);
+
+    BlockCache cache(BLOCK_CACHE_CAPACITY);
+    SS_Table table(filename, &cache);
+    for (bool hit : {true, false}) {
+        // Misses fall between stored keys, so they get past the key range and reach the Bloom filter
+        report(runThreads(hit ? "sstable.get_hit" : "sstable.get_miss", size, 1, size,
+                          [&](size_t, std::mt19937_64 &rng, uint64_t) {
+                              uint64_t i = rng() % size;
+                              table.getValue(makeKey(hit ? i * 2 : i * 2 + 1));
+                          }));
+    }
+    SS_Table::removeFiles(filename);
+}
+
+void benchCompaction(const Config &config) {
+    std::filesystem::remove_all(BENCH_DIR + "compaction/");
+    LSMTree tree(BENCH_DIR + "compaction/", LSMTree::newBlockCache());
+    std::mt19937_64 gen(5);
+    // Enough flushes to reach L0_COMPACTION_TRIGGER, with keys spread so every table overlaps
+    uint64_t bytes = (L0_COMPACTION_TRIGGER + 1) * MAX_MEMTABLE_SIZE;
+    uint64_t key_space = std::max<uint64_t>(config.records, bytes / (VALUE_SIZE + 16));
+    uint64_t compactions = Metrics::getHistogram(Timer::COMPACTION).count;
+    uint64_t compaction_micros = Metrics::getHistogram(Timer::COMPACTION).sum;
+    uint64_t read = Metrics::getCounter(Counter::COMPACTION_BYTES_READ);
+    for (uint64_t written = 0; written < bytes; written += VALUE_SIZE + 16) {
+        tree.put(makeKey(scramble(gen()) % key_space), makeValue(gen), false);
+    }
+    tree.sync();
+    waitForBackgroundWork(tree);
+
+    LatencyHistogram after = Metrics::getHistogram(Timer::COMPACTION);
+    Result result;
+    result.name = "compaction";
+    result.size = key_space;
+    result.ops = after.count - compactions;
+    result.bytes = Metrics::getCounter(Counter::COMPACTION_BYTES_READ) - read;
+    result.seconds = (after.sum - compaction_micros) / 1e6;
+    if (result.ops == 0 || result.seconds <= 0) {
+        std::cerr << "compaction: no compaction ran" << std::endl;
+        return;
+    }
+    report(result);
+}
+
+/**
+ * @brief Loads records into a fresh tree and runs the LSMTree workloads against it
+ */
+void benchTree(const Config &config) {
+    std::filesystem::remove_all(BENCH_DIR + "tree/");
+    LSMTree tree(BENCH_DIR + "tree/", LSMTree::newBlockCache());
+    size_t records = config.records;
+    size_t threads = config.threads;
+
+    // Writes are not synced one by one, as the server commits once per event-loop iteration
+    if (selected(config, "lsm.fill_seq")) {
+        report(runThreads("lsm.fill_seq", records, 1, records, [&](size_t, std::mt19937_64 &gen, uint64_t i) {
+            tree.put(makeKey(i), makeValue(gen), false);
+        }));
+    }
+    if (selected(config, "lsm.fill_random")) {
+        report(runThreads("lsm.fill_random", records, threads, records, [&](size_t, std::mt19937_64 &gen, uint64_t i) {
+            tree.put(makeKey(scramble(i) % records), makeValue(gen), false);
+        }));
+    }
+    // Every record, so the read workloads find what they look for
+    for (uint64_t i = 0; i < records; ++i) {
+        std::mt19937_64 gen(i);
+        tree.put(makeKey(i), makeValue(gen), false);
+    }
+    tree.sync();
+    waitForBackgroundWork(tree);
+
+    Zipfian zipfian(records);
+    auto zipf_key = [&](std::mt19937_64 &gen) { return makeKey(scramble(zipfian.next(gen)) % records); };
+    if (selected(config, "lsm.read_zipfian")) {
+        report(runThreads("lsm.read_zipfian", records, threads, records,
+                          [&](size_t, std::mt19937_64 &gen, uint64_t) { tree.get(zipf_key(gen)); }));
+    }
+    if (selected(config, "lsm.read_random")) {
+        report(runThreads("lsm.read_random", records, threads, records,
+                          [&](size_t, std::mt19937_64 &gen, uint64_t) { tree.get(makeKey(gen() % records)); }));
+    }
+
+    // YCSB core workloads; D and E insert new records after the loaded ones
+    std::atomic<uint64_t> inserted(records);
+    auto insert = [&](std::mt19937_64 &gen) { tree.put(makeKey(inserted.fetch_add(1)), makeValue(gen), false); };
+    struct Workload {
+        const char *name;
+        int read_percent; ///< The rest of the operations are the workload's write.
+    };
+    for (const Workload &workload : {Workload{"ycsb.a", 50}, Workload{"ycsb.b", 95}, Workload{"ycsb.c", 100},
+                                     Workload{"ycsb.d", 95}, Workload{"ycsb.e", 95}, Workload{"ycsb.f", 50}}) {
+        if (!selected(config, workload.name)) {
+            continue;
+        }
+        char type = workload.name[5];
+        report(runThreads(workload.name, records, threads, records, [&](size_t, std::mt19937_64 &gen, uint64_t) {
+            bool read = static_cast<int>(gen() % 100) < workload.read_percent;
+            if (type == 'd') {
+                // Read the latest records most
+                uint64_t newest = inserted.load(std::memory_order_relaxed);
+                read ? (void)tree.get(makeKey(newest - 1 - std::min(newest - 1, zipfian.next(gen)))) : insert(gen);
+            } else if (type == 'e') {
+                if (!read) {
+                    insert(gen);
+                    return;
+                }
+                LSMTree::Iterator it = tree.iterator();
+                size_t length = 1 + gen() % 100;
+                for (it.seek(zipf_key(gen)); it.isValid() && length > 0; it.next()) {
+                    --length;
+                }
+            } else if (read) {
+                tree.get(zipf_key(gen));
+            } else if (type == 'f') {
+                std::string key = zipf_key(gen);
+                tree.get(key);
+                tree.put(key, makeValue(gen), false);
+            } else {
+                tree.put(zipf_key(gen), makeValue(gen), false);
+            }
+        }));
+    }
+    tree.sync();
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    Config config;
+    try {
+        if (argc > 1) {
+            config.threads = std::max<size_t>(1, std::stoul(argv[1]));
+        }
+        if (argc > 2) {
+            config.records = std::max<size_t>(1000, std::stoul(argv[2]));
+        }
+    } catch (const std::exception &) {
+        std::cerr << "Usage: " << argv[0] << " [threads] [records] [filter]" << std::endl;
+        return 1;
+    }
+    config.filter = argc > 3 ? argv[3] : "";
+
+    std::filesystem::remove_all(BENCH_DIR);
+    std::filesystem::create_directories(BENCH_DIR);
+    if (selected(config, "skiplist")) {
+        benchSkipList(config);
+    }
+    if (selected(config, "resp")) {
+        benchRespDecode(config);
+    }
+    if (selected(config, "sstable")) {
+        benchSSTable(config);
+    }
+    if (selected(config, "compaction")) {
+        benchCompaction(config);
+    }
+    if (selected(config, "lsm") || selected(config, "ycsb")) {
+        benchTree(config);
+    }
+    std::filesystem::remove_all(BENCH_DIR);
+
+    printJson(config);
+    return 0;
+}
@@ -0,0 +1,198 @@
+/**
+ * @file skiplist_bench.cpp
+ * @brief MemTable skip list stress test and benchmark
+ * @details Runs a multi-threaded stress check of the lock-free ArenaSkipList (one writer, many
+ *          readers validating every value they observe and the ordering of full scans), then
+ *          measures read and write throughput against the linked-tower SkipList guarded by a
+ *          mutex, which is how the active MemTable was accessed before.
+ *
+ *          Usage: ./skiplist_bench [reader_threads] [seconds]
+ * @author Gana Jayant Sigadam
+ * @version 1.0
+ * @date March 2025
+ */
+#include "../engine/arena_skiplist.hpp"
+#include "../engine/skiplist.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr size_t KEY_SPACE = 200000;
+constexpr size_t PREFILL = 100000;
+
+std::string makeKey(size_t i) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "key%010zu", i);
+    return buffer;
+}
+
+std::string makeValue(size_t i, unsigned version) {
+    return "value-" + std::to_string(i) + "-" + std::to_string(version);
+}
+
+/**
+ * @brief Check that a value read for key i is one the writer could have stored.
+ */
+bool validValue(size_t i, const std::string &value) {
+    std::string prefix = "value-" + std::to_string(i) + "-";
+    return value.compare(0, prefix.size(), prefix) == 0;
+}
+
+/**
+ * @brief One writer inserts and overwrites keys while readers validate gets and scans.
+ * @return bool True if no reader observed a torn value or an out-of-order scan.
+ */
+bool stress(size_t readers, int seconds) {
+    ArenaSkipList list;
+    std::atomic<bool> done(false);
+    std::atomic<size_t> errors(0);
+    std::atomic<size_t> reads(0);
+
+    std::thread writer([&] {
+        std::mt19937_64 gen(1);
+        unsigned version = 0;
+        while (!done.load(std::memory_order_relaxed)) {
+            size_t i = gen() % KEY_SPACE;
+            list.put(makeKey(i), makeValue(i, version), version + 1);
+            version++;
+        }
+    });
+
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < readers; t++) {
+        threads.emplace_back([&, t] {
+            std::mt19937_64 gen(t + 100);
+            size_t local_reads = 0;
+            while (!done.load(std::memory_order_relaxed)) {
+                for (int n = 0; n < 1000; n++) {
+                    size_t i = gen() % KEY_SPACE;
+                    std::pair<bool, std::string> result = list.get(makeKey(i));
+                    if (result.first && !validValue(i, result.second)) {
+                        errors++;
+                    }
+                }
+                local_reads += 1000;
+
+                if (t == 0) {
+                    std::string previous;
+                    bool first = true;
+                    for (ArenaSkipList::Iterator it = list.begin(); it != list.end(); ++it) {
+                        std::string key(it.key());
+                        if (!first && key <= previous) {
+                            errors++;
+                        }
+                        previous = std::move(key);
+                        first = false;
+                    }
+                }
+            }
+            reads += local_reads;
+        });
+    }
+
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    done = true;
+    writer.join();
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+
+    std::cout << "stress: " << readers << " readers, " << reads.load() << " reads, "
+              << errors.load() << " errors" << std::endl;
+    return errors.load() == 0;
+}
+
+/**
+ * @brief Measure reader and writer throughput with one writer and `readers` reader threads.
+ * @param get Lookup function used by readers
+ * @param put Insert function used by the writer
+ */
+template <typename Get, typename Put>
+void throughput(const char *label, size_t readers, int seconds, Get get, Put put) {
+    for (size_t i = 0; i < PREFILL; i++) {
+        put(makeKey(i * 2), makeValue(i * 2, 0));
+    }
+
+    std::atomic<bool> done(false);
+    std::atomic<size_t> reads(0);
+    size_t writes = 0;
+
+    std::thread writer([&] {
+        std::mt19937_64 gen(7);
+        unsigned version = 1;
+        while (!done.load(std::memory_order_relaxed)) {
+            size_t i = gen() % KEY_SPACE;
+            put(makeKey(i), makeValue(i, version++));
+            writes++;
+        }
+    });
+
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < readers; t++) {
+        threads.emplace_back([&, t] {
+            std::mt19937_64 gen(t + 1000);
+            size_t local_reads = 0;
+            while (!done.load(std::memory_order_relaxed)) {
+                get(makeKey(gen() % KEY_SPACE));
+                local_reads++;
+            }
+            reads += local_reads;
+        });
+    }
+
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    done = true;
+    writer.join();
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+
+    std::cout << label << ": " << readers << " readers, "
+              << reads.load() / seconds << " reads/s, "
+              << writes / seconds << " writes/s" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    size_t readers = argc > 1 ? std::stoul(argv[1]) : 4;
+    int seconds = argc > 2 ? std::stoi(argv[2]) : 2;
+
+    if (!stress(readers, seconds)) {
+        return 1;
+    }
+
+    {
+        ArenaSkipList list;
+        uint64_t sequence = 0;
+        throughput(
+            "lock-free ArenaSkipList", readers, seconds,
+            [&](const std::string &key) { return list.get(key); },
+            [&](const std::string &key, const std::string &value) { list.put(key, value, ++sequence); });
+    }
+
+    {
+        SkipList list;
+        std::mutex mtx;
+        throughput(
+            "mutex SkipList", readers, seconds,
+            [&](const std::string &key) {
+                std::lock_guard<std::mutex> lock(mtx);
+                return list.get(key);
+            },
+            [&](const std::string &key, const std::string &value) {
+                std::lock_guard<std::mutex> lock(mtx);
+                list.put(key, value);
+            });
+    }
+    return 0;
+}
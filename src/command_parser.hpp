@@ -10,7 +10,7 @@
 #ifndef COMMAND_PARSER_HPP
 #define COMMAND_PARSER_HPP
 
-#include "engine/lsm.hpp"
+#include "engine/sharded_lsm.hpp"
 #include "resp_encoder.hpp"
 #include <string>
 #include <utility>
@@ -193,7 +193,7 @@ public:
      * This instance is used to interact with the underlying database engine
      * for executing commands.
      */
-    LSMTree db;
+    ShardedLSMTree db;
 
     /**
      * @brief Default constructor for CommandParser.
@@ -0,0 +1,123 @@
+/**
+ * @file arena.hpp
+ * @brief Arena Allocator
+ * @details This file contains a bump allocator used by the MemTable. Memory is carved out of
+ *          large blocks and is only ever released all at once, when the arena is destroyed
+ *          together with its MemTable after the flush.
+ * @author Gana Jayant Sigadam
+ * @date March 2025
+ * @version 1.0
+ */
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @class Arena
+ * @brief Bump allocator with all-at-once release
+ * @details Small requests are served from the remainder of the current block; requests larger
+ *          than a quarter of a block get a dedicated block so the remainder is not wasted.
+ *          Allocation is single-threaded; only memoryUsage() may be read concurrently.
+ */
+class Arena {
+private:
+    static constexpr size_t BLOCK_SIZE = 64 * 1024; ///< Size of a regular arena block.
+
+    char *alloc_ptr;                ///< Next free byte in the current block.
+    size_t alloc_bytes_remaining;   ///< Free bytes left in the current block.
+    std::vector<char *> blocks;     ///< Every block allocated so far.
+    std::atomic<size_t> memory_usage; ///< Total bytes allocated from the system, including block bookkeeping.
+
+    /**
+     * @brief Allocate a new block from the system
+     * @param block_bytes Size of the block
+     * @return char* Start of the block
+     */
+    char *allocateNewBlock(size_t block_bytes) {
+        char *block = new char[block_bytes];
+        blocks.push_back(block);
+        memory_usage.fetch_add(block_bytes + sizeof(char *), std::memory_order_relaxed);
+        return block;
+    }
+
+    /**
+     * @brief Serve a request that does not fit in the current block
+     * @param bytes Number of bytes requested
+     * @return char* Start of the allocation
+     */
+    char *allocateFallback(size_t bytes) {
+        if (bytes > BLOCK_SIZE / 4) {
+            return allocateNewBlock(bytes);
+        }
+
+        alloc_ptr = allocateNewBlock(BLOCK_SIZE);
+        alloc_bytes_remaining = BLOCK_SIZE;
+
+        char *result = alloc_ptr;
+        alloc_ptr += bytes;
+        alloc_bytes_remaining -= bytes;
+        return result;
+    }
+
+public:
+    Arena() : alloc_ptr(nullptr), alloc_bytes_remaining(0), memory_usage(0) {}
+
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    /**
+     * @brief Allocate unaligned memory (for key and value bytes)
+     * @param bytes Number of bytes, must be greater than zero
+     * @return char* Start of the allocation
+     */
+    char *allocate(size_t bytes) {
+        if (bytes <= alloc_bytes_remaining) {
+            char *result = alloc_ptr;
+            alloc_ptr += bytes;
+            alloc_bytes_remaining -= bytes;
+            return result;
+        }
+        return allocateFallback(bytes);
+    }
+
+    /**
+     * @brief Allocate memory aligned for pointers (for skip list nodes)
+     * @param bytes Number of bytes, must be greater than zero
+     * @return char* Start of the allocation
+     */
+    char *allocateAligned(size_t bytes) {
+        constexpr size_t align = sizeof(void *) > 8 ? sizeof(void *) : 8;
+        size_t current_mod = reinterpret_cast<uintptr_t>(alloc_ptr) & (align - 1);
+        size_t slop = current_mod == 0 ? 0 : align - current_mod;
+        size_t needed = bytes + slop;
+        if (needed <= alloc_bytes_remaining) {
+            char *result = alloc_ptr + slop;
+            alloc_ptr += needed;
+            alloc_bytes_remaining -= needed;
+            return result;
+        }
+        // Blocks from operator new[] are always suitably aligned
+        return allocateFallback(bytes);
+    }
+
+    /**
+     * @brief Get the memory held by the arena
+     * @details Safe to call from any thread while the owner keeps allocating.
+     * @return size_t Bytes allocated from the system
+     */
+    size_t memoryUsage() const {
+        return memory_usage.load(std::memory_order_relaxed);
+    }
+
+    ~Arena() {
+        for (char *block : blocks) {
+            delete[] block;
+        }
+    }
+};
+
+#endif
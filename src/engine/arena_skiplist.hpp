@@ -0,0 +1,373 @@
+/**
+ * @file arena_skiplist.hpp
+ * @brief Arena-backed Skip List Implementation
+ * @details This file contains the skip list used as the MemTable representation. Unlike the
+ *          linked-tower SkipList in skiplist.hpp, every key is a single node holding a
+ *          variable-height array of next pointers, and nodes, keys and values are all carved
+ *          out of one Arena that is released in one shot when the MemTable is dropped.
+ *          Nodes are never unlinked, so readers can walk the list without any lock while a
+ *          single writer inserts.
+ * @author Gana Jayant Sigadam
+ * @date March 2025
+ * @version 1.0
+ */
+#ifndef ARENA_SKIP_LIST
+#define ARENA_SKIP_LIST
+
+#include "arena.hpp"
+#include "engine_policy.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <random>
+#include <string>
+#include <string_view>
+#include <utility>
+
+/**
+ * @class BasicArenaSkipList
+ * @brief Skip list with compact, arena-allocated nodes
+ * @details Node layout: key pointer and size, value pointer, and `height` next pointers.
+ *          Values are stored as `[uint64_t sequence][older record][uint32_t size][bytes]`
+ *          records; overwriting a key allocates a new record that links to the old one and
+ *          repoints the node, so every version of a key stays readable until the flush.
+ *          Reads at a sequence number follow that chain to the newest record written at or
+ *          before it, which is how snapshots ignore writes made after they were taken.
+ *
+ *          Thread safety: put() must be externally serialized (one writer at a time), while
+ *          get(), find(), seek() and iteration may run concurrently with it from any number of
+ *          threads. A node is fully built before it is published with a release store into its
+ *          predecessors' next pointers, and readers follow those pointers with acquire loads, so
+ *          a reader either misses a new node entirely or sees its key and value in full.
+ *
+ *          Keys are ordered by Comparator, whose less() and equal() are inlined into every search.
+ *
+ * @tparam Comparator Key comparator; see engine_policy.hpp.
+ * @tparam MaxHeight Maximum tower height.
+ * @tparam Branching 1 in Branching nodes grows one level taller.
+ */
+template <typename Comparator = BytewiseComparator, int MaxHeight = 12, unsigned Branching = 4>
+class BasicArenaSkipList {
+    static_assert(MaxHeight >= 1 && Branching >= 2, "a skip list needs towers and a branching factor");
+
+public:
+    using KeyComparator = Comparator;
+
+private:
+    static constexpr int MAX_HEIGHT = MaxHeight;       ///< Maximum tower height.
+    static constexpr unsigned BRANCHING = Branching;   ///< 1 in BRANCHING nodes grows one level taller.
+
+    static constexpr size_t SEQUENCE_OFFSET = 0;
+    static constexpr size_t OLDER_OFFSET = sizeof(uint64_t);
+    static constexpr size_t SIZE_OFFSET = OLDER_OFFSET + sizeof(const char *);
+    static constexpr size_t VALUE_OFFSET = SIZE_OFFSET + sizeof(uint32_t);
+
+    static uint64_t recordSequence(const char *record) {
+        uint64_t sequence;
+        std::memcpy(&sequence, record + SEQUENCE_OFFSET, sizeof(sequence));
+        return sequence;
+    }
+
+    static const char *olderRecord(const char *record) {
+        const char *older;
+        std::memcpy(&older, record + OLDER_OFFSET, sizeof(older));
+        return older;
+    }
+
+    static std::string_view recordValue(const char *record) {
+        uint32_t size;
+        std::memcpy(&size, record + SIZE_OFFSET, sizeof(size));
+        return std::string_view(record + VALUE_OFFSET, size);
+    }
+
+    struct Node {
+        const char *key_data;
+        uint32_t key_size;
+        std::atomic<const char *> value_record;
+        std::atomic<Node *> next_[1]; ///< First of `height` next pointers, the rest follow the struct.
+
+        std::string_view key() const {
+            return std::string_view(key_data, key_size);
+        }
+
+        /**
+         * @brief Newest value record written at or before a sequence number, null if none is.
+         */
+        const char *visibleRecord(uint64_t sequence) const {
+            const char *record = value_record.load(std::memory_order_acquire);
+            while (record != nullptr && recordSequence(record) > sequence) {
+                record = olderRecord(record);
+            }
+            return record;
+        }
+
+        Node *next(int level) const {
+            return next_[level].load(std::memory_order_acquire);
+        }
+
+        void setNext(int level, Node *node) {
+            next_[level].store(node, std::memory_order_release);
+        }
+
+        /**
+         * @brief Set a next pointer without ordering; only for a node not yet published.
+         */
+        void setNextRelaxed(int level, Node *node) {
+            next_[level].store(node, std::memory_order_relaxed);
+        }
+    };
+
+    Arena arena;
+    Node *head;
+    std::atomic<int> max_height; ///< Height of the tallest tower; only grows.
+    std::mt19937 gen;
+
+    /**
+     * @brief Copy a value into the arena as a versioned, length-prefixed record
+     * @param value The value bytes
+     * @param sequence The sequence number of the write
+     * @param older The record it replaces, null for a new key
+     * @return const char* The record
+     */
+    const char *newValueRecord(std::string_view value, uint64_t sequence, const char *older) {
+        uint32_t size = static_cast<uint32_t>(value.size());
+        char *record = arena.allocate(VALUE_OFFSET + value.size());
+        std::memcpy(record + SEQUENCE_OFFSET, &sequence, sizeof(sequence));
+        std::memcpy(record + OLDER_OFFSET, &older, sizeof(older));
+        std::memcpy(record + SIZE_OFFSET, &size, sizeof(size));
+        if (!value.empty()) {
+            std::memcpy(record + VALUE_OFFSET, value.data(), value.size());
+        }
+        return record;
+    }
+
+    /**
+     * @brief Allocate a node with room for `height` next pointers
+     * @param key The key, copied into the arena
+     * @param value_record The value record for the node
+     * @param height Tower height of the node
+     * @return Node* The new node with all next pointers null
+     */
+    Node *newNode(std::string_view key, const char *value_record, int height) {
+        char *memory = arena.allocateAligned(sizeof(Node) + sizeof(Node *) * (height - 1));
+        Node *node = new (memory) Node();
+        for (int i = 1; i < height; i++) {
+            new (&node->next_[i]) std::atomic<Node *>(nullptr);
+        }
+        char *key_data = nullptr;
+        if (!key.empty()) {
+            key_data = arena.allocate(key.size());
+            std::memcpy(key_data, key.data(), key.size());
+        }
+        node->key_data = key_data;
+        node->key_size = static_cast<uint32_t>(key.size());
+        node->value_record.store(value_record, std::memory_order_relaxed);
+        node->setNextRelaxed(0, nullptr);
+        return node;
+    }
+
+    /**
+     * @brief Pick a tower height with P(height > h) = (1 / BRANCHING)^h
+     * @return int Height between 1 and MAX_HEIGHT
+     */
+    int randomHeight() {
+        int height = 1;
+        while (height < MAX_HEIGHT && gen() % BRANCHING == 0) {
+            height++;
+        }
+        return height;
+    }
+
+    /**
+     * @brief Find the first node whose key is >= key
+     * @param key The key to search for
+     * @param prev If not null, filled with the last node before the result on every level
+     * @return Node* The node found, or nullptr if every key is smaller
+     */
+    Node *findGreaterOrEqual(std::string_view key, Node **prev) const {
+        Node *cur = head;
+        int level = max_height.load(std::memory_order_relaxed) - 1;
+        while (true) {
+            Node *next = cur->next(level);
+            if (next != nullptr && Comparator::less(next->key(), key)) {
+                cur = next;
+            } else {
+                if (prev != nullptr) {
+                    prev[level] = cur;
+                }
+                if (level == 0) {
+                    return next;
+                }
+                level--;
+            }
+        }
+    }
+
+public:
+    /**
+     * @brief Sequence number that reads at see every write.
+     */
+    static constexpr uint64_t MAX_SEQUENCE = UINT64_MAX;
+
+    BasicArenaSkipList() : max_height(1), gen(std::random_device()()) {
+        head = newNode(std::string_view(), nullptr, MAX_HEIGHT);
+    }
+
+    BasicArenaSkipList(const BasicArenaSkipList &) = delete;
+    BasicArenaSkipList &operator=(const BasicArenaSkipList &) = delete;
+
+    /**
+     * @brief Insert a key-value pair, adding a newer version if the key exists.
+     * @details Callers must serialize put() calls and give them increasing sequence numbers;
+     *          concurrent readers are safe.
+     * @param key The key to insert.
+     * @param value The value to associate with the key.
+     * @param sequence The sequence number of the write.
+     */
+    void put(std::string_view key, std::string_view value, uint64_t sequence) {
+        Node *prev[MAX_HEIGHT];
+        Node *node = findGreaterOrEqual(key, prev);
+        if (node != nullptr && Comparator::equal(node->key(), key)) {
+            const char *older = node->value_record.load(std::memory_order_relaxed);
+            node->value_record.store(newValueRecord(value, sequence, older), std::memory_order_release);
+            return;
+        }
+
+        int height = randomHeight();
+        int current_height = max_height.load(std::memory_order_relaxed);
+        if (height > current_height) {
+            for (int i = current_height; i < height; i++) {
+                prev[i] = head;
+            }
+            // A reader that sees the new height before the node is linked just finds null
+            // pointers in head's upper levels and drops down, so relaxed is enough here.
+            max_height.store(height, std::memory_order_relaxed);
+        }
+
+        node = newNode(key, newValueRecord(value, sequence, nullptr), height);
+        for (int i = 0; i < height; i++) {
+            node->setNextRelaxed(i, prev[i]->next_[i].load(std::memory_order_relaxed));
+            prev[i]->setNext(i, node);
+        }
+    }
+
+    /**
+     * @brief This method retrieves the value associated with a given key in the skip list.
+     *
+     * @param key The key to search for.
+     * @param sequence Only writes with a sequence number up to this one are seen.
+     * @param found_sequence If not null, set to the sequence number of the write found, left alone if none is.
+     * @return std::pair<bool, std::string> A pair containing a boolean indicating whether the key was found
+     *         and the corresponding value if found, or an empty string if not found.
+     */
+    std::pair<bool, std::string> get(std::string_view key, uint64_t sequence = MAX_SEQUENCE, uint64_t *found_sequence = nullptr) const {
+        Node *node = findGreaterOrEqual(key, nullptr);
+        if (node != nullptr && Comparator::equal(node->key(), key)) {
+            const char *record = node->visibleRecord(sequence);
+            if (record != nullptr) {
+                if (found_sequence != nullptr) {
+                    *found_sequence = recordSequence(record);
+                }
+                return {true, std::string(recordValue(record))};
+            }
+        }
+        return {false, ""};
+    }
+
+    /**
+     * @brief Get the size of the skip list.
+     *
+     * @return size_t The bytes held by the arena backing the skip list.
+     */
+    size_t getSize() const {
+        return arena.memoryUsage();
+    }
+
+    /**
+     * @class Iterator
+     * @brief A forward iterator over the skip list in key order, as of a sequence number.
+     * @details Keys first written after that sequence number are skipped, and value() returns
+     *          the version that was current at it.
+     */
+    class Iterator {
+    private:
+        const Node *current;
+        const char *record; ///< Visible value record of the current node.
+        uint64_t sequence;
+
+        void skipInvisible() {
+            while (current != nullptr && (record = current->visibleRecord(sequence)) == nullptr) {
+                current = current->next(0);
+            }
+        }
+
+    public:
+        Iterator(const Node *node = nullptr, uint64_t sequence = MAX_SEQUENCE) : current(node), record(nullptr), sequence(sequence) {
+            skipInvisible();
+        }
+
+        std::string_view key() const {
+            return current->key();
+        }
+
+        std::string_view value() const {
+            return recordValue(record);
+        }
+
+        /**
+         * @brief Sequence number of the write that set value()
+         */
+        uint64_t writeSequence() const {
+            return recordSequence(record);
+        }
+
+        Iterator &operator++() {
+            current = current->next(0);
+            skipInvisible();
+            return *this;
+        }
+
+        bool operator==(const Iterator &other) const {
+            return current == other.current;
+        }
+
+        bool operator!=(const Iterator &other) const {
+            return !(*this == other);
+        }
+    };
+
+    Iterator begin(uint64_t sequence = MAX_SEQUENCE) const {
+        return Iterator(head->next(0), sequence);
+    }
+
+    Iterator end() const {
+        return Iterator(nullptr);
+    }
+
+    /**
+     * @brief Position an iterator at the first key >= key.
+     * @param key The key to seek to.
+     * @param sequence Only writes with a sequence number up to this one are seen.
+     * @return Iterator The iterator, or end() if every key is smaller.
+     */
+    Iterator seek(std::string_view key, uint64_t sequence = MAX_SEQUENCE) const {
+        return Iterator(findGreaterOrEqual(key, nullptr), sequence);
+    }
+
+    Iterator find(std::string_view key) const {
+        Node *node = findGreaterOrEqual(key, nullptr);
+        if (node != nullptr && Comparator::equal(node->key(), key)) {
+            return Iterator(node);
+        }
+        return end();
+    }
+};
+
+/**
+ * @brief The MemTable representation of the default EnginePolicy, ordering keys bytewise.
+ */
+using ArenaSkipList = BasicArenaSkipList<>;
+
+#endif
@@ -0,0 +1,264 @@
+/**
+ * @file block_cache.hpp
+ * @brief Shared LRU cache of decoded SSTable blocks
+ * @details This file contains the block cache shared by every SS_Table of an LSMTree. A block is
+ *          a data block of a block-based table, or the span of records between two sparse index
+ *          entries of a legacy table. Blocks are cached verified and searchable, so a hit costs a
+ *          hash lookup and a binary search instead of a read and a record-by-record scan.
+ * @author Gana Jayant Sigadam
+ * @date March 2025
+ * @version 1.0
+ */
+#ifndef BLOCK_CACHE_HPP
+#define BLOCK_CACHE_HPP
+
+#include "constants.hpp"
+#include "table_format.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * @class CachedBlock
+ * @brief A block of SSTable records ready to be searched
+ * @details Legacy blocks are decoded into a sorted array of key/value views. Block-based blocks
+ *          are kept as they are and searched through their restart points, since their keys are
+ *          prefix-compressed and cannot be viewed in place.
+ */
+class CachedBlock {
+private:
+    std::string data;                                               ///< Raw block bytes.
+    TableFormat format;                                             ///< Layout of the block.
+    std::vector<std::pair<std::string_view, std::string_view>> entries; ///< LEGACY: views into data, in key order.
+
+public:
+    /**
+     * @brief Take over a block
+     * @param bytes The raw block contents, after checksum verification for block-based tables
+     * @param format LEGACY for `[Key Size] [Key] [Value Size] [Value]` records, BLOCK_BASED for a BlockBuilder block
+     */
+    CachedBlock(std::string &&bytes, TableFormat format) : data(std::move(bytes)), format(format) {
+        if (format == TableFormat::BLOCK_BASED) {
+            return;
+        }
+        const char *block = data.data();
+        size_t length = data.size();
+        size_t pos = 0;
+        while (pos + sizeof(uint32_t) <= length) {
+            uint32_t key_size;
+            std::memcpy(&key_size, block + pos, sizeof(key_size));
+            pos += sizeof(key_size);
+            if (pos + key_size + sizeof(uint32_t) > length) {
+                break;
+            }
+            std::string_view key(block + pos, key_size);
+            pos += key_size;
+
+            uint32_t value_size;
+            std::memcpy(&value_size, block + pos, sizeof(value_size));
+            pos += sizeof(value_size);
+            if (pos + value_size > length) {
+                break;
+            }
+            entries.emplace_back(key, std::string_view(block + pos, value_size));
+            pos += value_size;
+        }
+    }
+
+    /**
+     * @brief Look up a key in the block
+     * @param key The key to look up
+     * @return std::pair<bool, std::string> Found flag and value; {false, TOMBSTONE} for deleted keys
+     */
+    std::pair<bool, std::string> get(std::string_view key) const {
+        if (format == TableFormat::BLOCK_BASED) {
+            return BlockIterator::find(data, key);
+        }
+        auto it = std::lower_bound(entries.begin(), entries.end(), key,
+                                   [](const std::pair<std::string_view, std::string_view> &entry, std::string_view k) {
+                                       return entry.first < k;
+                                   });
+        if (it == entries.end() || it->first != key) {
+            return {false, ""};
+        }
+        if (it->second == TOMBSTONE) {
+            return {false, std::string(it->second)};
+        }
+        return {true, std::string(it->second)};
+    }
+
+    /**
+     * @brief Memory charged to the cache for this block
+     * @return size_t Approximate bytes held
+     */
+    size_t charge() const {
+        return sizeof(CachedBlock) + data.size() + entries.size() * sizeof(entries[0]);
+    }
+};
+
+/**
+ * @struct BlockCacheStats
+ * @brief Snapshot of block cache counters
+ */
+struct BlockCacheStats {
+    uint64_t hits = 0;      ///< Lookups served from the cache.
+    uint64_t misses = 0;    ///< Lookups that had to read the block from disk.
+    uint64_t inserts = 0;   ///< Blocks added to the cache.
+    uint64_t evictions = 0; ///< Blocks dropped to stay within the capacity.
+    size_t usage = 0;       ///< Bytes currently charged to the cache.
+    size_t capacity = 0;    ///< Configured memory budget in bytes.
+};
+
+/**
+ * @class BlockCache
+ * @brief Sharded LRU cache keyed by (table id, block offset)
+ * @details The capacity is split evenly between shards, each with its own mutex and LRU list, so
+ *          concurrent readers hitting different blocks rarely contend. Blocks are handed out as
+ *          shared pointers and stay valid for the reader even if they are evicted meanwhile.
+ */
+class BlockCache {
+private:
+    static constexpr size_t SHARD_COUNT = 16;
+
+    struct CacheKey {
+        uint64_t table_id;
+        uint64_t offset;
+
+        bool operator==(const CacheKey &other) const {
+            return table_id == other.table_id && offset == other.offset;
+        }
+    };
+
+    struct CacheKeyHash {
+        size_t operator()(const CacheKey &key) const {
+            uint64_t h = key.table_id * 0x9e3779b97f4a7c15ULL ^ key.offset;
+            h ^= h >> 33;
+            h *= 0xff51afd7ed558ccdULL;
+            h ^= h >> 33;
+            return static_cast<size_t>(h);
+        }
+    };
+
+    struct Entry {
+        CacheKey key;
+        std::shared_ptr<const CachedBlock> block;
+        size_t charge;
+    };
+
+    struct Shard {
+        std::mutex mtx;
+        std::list<Entry> lru; ///< Most recently used at the front.
+        std::unordered_map<CacheKey, std::list<Entry>::iterator, CacheKeyHash> table;
+        size_t usage = 0;
+    };
+
+    Shard shards[SHARD_COUNT];
+    size_t capacity;
+    size_t shard_capacity;
+
+    std::atomic<uint64_t> hits;
+    std::atomic<uint64_t> misses;
+    std::atomic<uint64_t> inserts;
+    std::atomic<uint64_t> evictions;
+
+    Shard &shardFor(const CacheKey &key) {
+        return shards[CacheKeyHash()(key) % SHARD_COUNT];
+    }
+
+public:
+    /**
+     * @brief Construct a block cache
+     * @param capacity Memory budget in bytes, shared by all shards
+     */
+    explicit BlockCache(size_t capacity = BLOCK_CACHE_CAPACITY)
+        : capacity(capacity), shard_capacity((capacity + SHARD_COUNT - 1) / SHARD_COUNT),
+          hits(0), misses(0), inserts(0), evictions(0) {}
+
+    BlockCache(const BlockCache &) = delete;
+    BlockCache &operator=(const BlockCache &) = delete;
+
+    /**
+     * @brief Look up a block and mark it most recently used
+     * @param table_id Id of the owning SS_Table
+     * @param offset Data file offset of the block
+     * @return std::shared_ptr<const CachedBlock> The block, or nullptr on a miss
+     */
+    std::shared_ptr<const CachedBlock> lookup(uint64_t table_id, uint64_t offset) {
+        CacheKey key{table_id, offset};
+        Shard &shard = shardFor(key);
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        auto it = shard.table.find(key);
+        if (it == shard.table.end()) {
+            misses.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+        hits.fetch_add(1, std::memory_order_relaxed);
+        return it->second->block;
+    }
+
+    /**
+     * @brief Insert a block, evicting least recently used blocks past the shard's budget
+     * @param table_id Id of the owning SS_Table
+     * @param offset Data file offset of the block
+     * @param block The decoded block
+     */
+    void insert(uint64_t table_id, uint64_t offset, std::shared_ptr<const CachedBlock> block) {
+        CacheKey key{table_id, offset};
+        size_t charge = block->charge();
+        Shard &shard = shardFor(key);
+        std::lock_guard<std::mutex> lock(shard.mtx);
+
+        auto existing = shard.table.find(key);
+        if (existing != shard.table.end()) {
+            shard.usage -= existing->second->charge;
+            shard.lru.erase(existing->second);
+            shard.table.erase(existing);
+        }
+
+        shard.lru.push_front(Entry{key, std::move(block), charge});
+        shard.table[key] = shard.lru.begin();
+        shard.usage += charge;
+        inserts.fetch_add(1, std::memory_order_relaxed);
+
+        // The block just inserted is kept even if it alone exceeds the budget
+        while (shard.usage > shard_capacity && shard.lru.size() > 1) {
+            Entry &victim = shard.lru.back();
+            shard.usage -= victim.charge;
+            shard.table.erase(victim.key);
+            shard.lru.pop_back();
+            evictions.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief Get the cache counters
+     * @return BlockCacheStats Hits, misses, inserts, evictions and memory usage
+     */
+    BlockCacheStats getStats() {
+        BlockCacheStats stats;
+        stats.hits = hits.load(std::memory_order_relaxed);
+        stats.misses = misses.load(std::memory_order_relaxed);
+        stats.inserts = inserts.load(std::memory_order_relaxed);
+        stats.evictions = evictions.load(std::memory_order_relaxed);
+        stats.capacity = capacity;
+        for (Shard &shard : shards) {
+            std::lock_guard<std::mutex> lock(shard.mtx);
+            stats.usage += shard.usage;
+        }
+        return stats;
+    }
+};
+
+#endif
@@ -0,0 +1,134 @@
+/**
+ * @file coding.hpp
+ * @brief Binary encoding helpers
+ * @details This file contains the fixed-width and varint integer encodings and the CRC-32 used by
+ *          the on-disk formats (write-ahead log records, block-based SSTables and the manifest).
+ *          Fixed-width integers are stored in host byte order, like every other integer the engine
+ *          writes.
+ * @author Gana Jayant Sigadam
+ * @date March 2025
+ * @version 1.0
+ */
+#ifndef CODING_HPP
+#define CODING_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @class Coding
+ * @brief Static helpers to append integers to a buffer and read them back
+ */
+class Coding {
+public:
+    static void putFixed32(std::string &dst, uint32_t value) {
+        dst.append(reinterpret_cast<const char *>(&value), sizeof(value));
+    }
+
+    static void putFixed64(std::string &dst, uint64_t value) {
+        dst.append(reinterpret_cast<const char *>(&value), sizeof(value));
+    }
+
+    static uint32_t decodeFixed32(const char *ptr) {
+        uint32_t value;
+        std::memcpy(&value, ptr, sizeof(value));
+        return value;
+    }
+
+    static uint64_t decodeFixed64(const char *ptr) {
+        uint64_t value;
+        std::memcpy(&value, ptr, sizeof(value));
+        return value;
+    }
+
+    /**
+     * @brief Append a little-endian base-128 varint (1 byte for values below 128)
+     */
+    static void putVarint64(std::string &dst, uint64_t value) {
+        while (value >= 0x80) {
+            dst.push_back(static_cast<char>(value | 0x80));
+            value >>= 7;
+        }
+        dst.push_back(static_cast<char>(value));
+    }
+
+    static void putVarint32(std::string &dst, uint32_t value) {
+        putVarint64(dst, value);
+    }
+
+    /**
+     * @brief Decode a varint from the front of `input` and advance past it
+     * @return bool False if the input ends inside the varint or it is longer than 10 bytes
+     */
+    static bool getVarint64(std::string_view &input, uint64_t &value) {
+        value = 0;
+        for (size_t i = 0, shift = 0; i < input.size() && shift <= 63; ++i, shift += 7) {
+            uint64_t byte = static_cast<uint8_t>(input[i]);
+            value |= (byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) {
+                input.remove_prefix(i + 1);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static bool getVarint32(std::string_view &input, uint32_t &value) {
+        uint64_t wide;
+        if (!getVarint64(input, wide) || wide > UINT32_MAX) {
+            return false;
+        }
+        value = static_cast<uint32_t>(wide);
+        return true;
+    }
+
+    /**
+     * @brief Append a string prefixed by its length as a varint
+     */
+    static void putLengthPrefixed(std::string &dst, std::string_view value) {
+        putVarint64(dst, value.size());
+        dst.append(value.data(), value.size());
+    }
+
+    /**
+     * @brief Decode a length-prefixed string from the front of `input` and advance past it
+     * @return bool False if the input ends before the string does
+     */
+    static bool getLengthPrefixed(std::string_view &input, std::string_view &value) {
+        uint64_t length;
+        if (!getVarint64(input, length) || length > input.size()) {
+            return false;
+        }
+        value = input.substr(0, static_cast<size_t>(length));
+        input.remove_prefix(static_cast<size_t>(length));
+        return true;
+    }
+
+    /**
+     * @brief CRC-32 (IEEE) of a byte range, continuing from a previous value
+     */
+    static uint32_t crc32(const char *data, size_t length, uint32_t crc = 0) {
+        static const std::vector<uint32_t> table = [] {
+            std::vector<uint32_t> t(256);
+            for (uint32_t i = 0; i < 256; i++) {
+                uint32_t c = i;
+                for (int k = 0; k < 8; k++) {
+                    c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                }
+                t[i] = c;
+            }
+            return t;
+        }();
+        crc = ~crc;
+        for (size_t i = 0; i < length; i++) {
+            crc = table[(crc ^ static_cast<uint8_t>(data[i])) & 0xFF] ^ (crc >> 8);
+        }
+        return ~crc;
+    }
+};
+
+#endif
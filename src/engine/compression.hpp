@@ -0,0 +1,227 @@
+/**
+ * @file compression.hpp
+ * @brief Block compression codecs
+ * @details This file contains the codecs applied to SSTable data blocks and the process-wide
+ *          compression counters. LZ4 and Zstd are used when their headers are installed (the
+ *          Makefile then links -llz4 and -lzstd); a table asking for a codec this build lacks is
+ *          written uncompressed. A compressed block is stored as [uncompressed size (varint)]
+ *          [codec output], and is kept uncompressed when that does not save at least an eighth.
+ * @author Gana Jayant Sigadam
+ * @date March 2025
+ * @version 1.0
+ */
+#ifndef COMPRESSION_HPP
+#define COMPRESSION_HPP
+
+#include "coding.hpp"
+#include "constants.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+#if __has_include(<lz4.h>)
+#include <lz4.h>
+#define BLINK_HAS_LZ4 1
+#endif
+
+#if __has_include(<zstd.h>)
+#include <zstd.h>
+#define BLINK_HAS_ZSTD 1
+#endif
+
+/**
+ * @struct CompressionStats
+ * @brief Snapshot of block compression counters
+ */
+struct CompressionStats {
+    uint64_t blocks_written = 0;       ///< Data blocks written.
+    uint64_t blocks_compressed = 0;    ///< Data blocks written compressed.
+    uint64_t raw_bytes = 0;            ///< Data block bytes before compression.
+    uint64_t stored_bytes = 0;         ///< Data block bytes as written.
+    uint64_t blocks_decompressed = 0;  ///< Compressed blocks read and decompressed.
+    uint64_t decompressed_bytes = 0;   ///< Bytes produced by decompression.
+    uint64_t decompress_micros = 0;    ///< Time spent decompressing.
+
+    /**
+     * @brief Raw bytes per stored byte of the data blocks written, 1 if nothing was written
+     */
+    double ratio() const {
+        return stored_bytes == 0 ? 1.0 : static_cast<double>(raw_bytes) / static_cast<double>(stored_bytes);
+    }
+};
+
+/**
+ * @class Compression
+ * @brief Static helpers to compress and decompress SSTable blocks
+ */
+class Compression {
+private:
+    struct Counters {
+        std::atomic<uint64_t> blocks_written{0};
+        std::atomic<uint64_t> blocks_compressed{0};
+        std::atomic<uint64_t> raw_bytes{0};
+        std::atomic<uint64_t> stored_bytes{0};
+        std::atomic<uint64_t> blocks_decompressed{0};
+        std::atomic<uint64_t> decompressed_bytes{0};
+        std::atomic<uint64_t> decompress_nanos{0};
+    };
+
+    static Counters &counters() {
+        static Counters instance;
+        return instance;
+    }
+
+public:
+    /**
+     * @brief Check whether this build can write and read a codec
+     */
+    static bool isSupported(CompressionType type) {
+        switch (type) {
+        case CompressionType::NONE:
+            return true;
+#if defined(BLINK_HAS_LZ4)
+        case CompressionType::LZ4:
+            return true;
+#endif
+#if defined(BLINK_HAS_ZSTD)
+        case CompressionType::ZSTD:
+            return true;
+#endif
+        default:
+            return false;
+        }
+    }
+
+    /**
+     * @brief Get the codec a table requesting `type` is actually written with
+     * @details Warns once per codec the build lacks and falls back to no compression.
+     */
+    static CompressionType effective(CompressionType type) {
+        if (isSupported(type)) {
+            return type;
+        }
+        static std::atomic<bool> warned[3] = {};
+        if (!warned[static_cast<size_t>(type) % 3].exchange(true)) {
+            std::cerr << "Compression codec " << static_cast<int>(type)
+                      << " is not available in this build, writing uncompressed blocks" << std::endl;
+        }
+        return CompressionType::NONE;
+    }
+
+    /**
+     * @brief Compress a data block
+     * @param type Codec to use, as returned by effective()
+     * @param input The block contents
+     * @param output Receives the compressed block if compression paid off
+     * @return bool True if `output` should be stored, false to store the block uncompressed
+     */
+    static bool compress(CompressionType type, std::string_view input, std::string &output) {
+        output.clear();
+        bool compressed = false;
+        switch (type) {
+#if defined(BLINK_HAS_LZ4)
+        case CompressionType::LZ4: {
+            Coding::putVarint32(output, static_cast<uint32_t>(input.size()));
+            size_t header = output.size();
+            output.resize(header + static_cast<size_t>(LZ4_compressBound(static_cast<int>(input.size()))));
+            int n = LZ4_compress_default(input.data(), &output[header], static_cast<int>(input.size()),
+                                         static_cast<int>(output.size() - header));
+            compressed = n > 0;
+            output.resize(compressed ? header + static_cast<size_t>(n) : 0);
+            break;
+        }
+#endif
+#if defined(BLINK_HAS_ZSTD)
+        case CompressionType::ZSTD: {
+            Coding::putVarint32(output, static_cast<uint32_t>(input.size()));
+            size_t header = output.size();
+            output.resize(header + ZSTD_compressBound(input.size()));
+            size_t n = ZSTD_compress(&output[header], output.size() - header, input.data(), input.size(), ZSTD_COMPRESSION_LEVEL);
+            compressed = !ZSTD_isError(n);
+            output.resize(compressed ? header + n : 0);
+            break;
+        }
+#endif
+        default:
+            break;
+        }
+        // Not worth a decompression on every read unless it saves at least 12.5%
+        compressed = compressed && output.size() < input.size() - input.size() / 8;
+
+        Counters &c = counters();
+        c.blocks_written.fetch_add(1, std::memory_order_relaxed);
+        c.raw_bytes.fetch_add(input.size(), std::memory_order_relaxed);
+        c.stored_bytes.fetch_add(compressed ? output.size() : input.size(), std::memory_order_relaxed);
+        if (compressed) {
+            c.blocks_compressed.fetch_add(1, std::memory_order_relaxed);
+        }
+        return compressed;
+    }
+
+    /**
+     * @brief Decompress a block read from disk
+     * @param type The block's type byte
+     * @param input The stored block contents
+     * @param output Receives the uncompressed block
+     * @return bool False if the codec is unknown or unavailable, or the block is malformed
+     */
+    static bool uncompress(char type, std::string_view input, std::string &output) {
+        uint32_t size;
+        if (!Coding::getVarint32(input, size)) {
+            return false;
+        }
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        output.resize(size);
+        bool ok = false;
+        switch (static_cast<CompressionType>(type)) {
+#if defined(BLINK_HAS_LZ4)
+        case CompressionType::LZ4:
+            ok = LZ4_decompress_safe(input.data(), &output[0], static_cast<int>(input.size()), static_cast<int>(size)) ==
+                 static_cast<int>(size);
+            break;
+#endif
+#if defined(BLINK_HAS_ZSTD)
+        case CompressionType::ZSTD:
+            ok = ZSTD_decompress(&output[0], size, input.data(), input.size()) == size;
+            break;
+#endif
+        default:
+            break;
+        }
+        if (!ok) {
+            return false;
+        }
+
+        Counters &c = counters();
+        c.blocks_decompressed.fetch_add(1, std::memory_order_relaxed);
+        c.decompressed_bytes.fetch_add(size, std::memory_order_relaxed);
+        c.decompress_nanos.fetch_add(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                                               std::chrono::steady_clock::now() - start)
+                                                               .count()),
+                                     std::memory_order_relaxed);
+        return true;
+    }
+
+    /**
+     * @brief Get the compression counters of every table written or read by this process
+     */
+    static CompressionStats getStats() {
+        Counters &c = counters();
+        CompressionStats stats;
+        stats.blocks_written = c.blocks_written.load(std::memory_order_relaxed);
+        stats.blocks_compressed = c.blocks_compressed.load(std::memory_order_relaxed);
+        stats.raw_bytes = c.raw_bytes.load(std::memory_order_relaxed);
+        stats.stored_bytes = c.stored_bytes.load(std::memory_order_relaxed);
+        stats.blocks_decompressed = c.blocks_decompressed.load(std::memory_order_relaxed);
+        stats.decompressed_bytes = c.decompressed_bytes.load(std::memory_order_relaxed);
+        stats.decompress_micros = c.decompress_nanos.load(std::memory_order_relaxed) / 1000;
+        return stats;
+    }
+};
+
+#endif
@@ -10,6 +10,8 @@
 #ifndef CONSTANTS_HPP
 #define CONSTANTS_HPP
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
 
 /**
@@ -21,6 +23,13 @@
  */
 #define TOMBSTONE "\xFF\xFF\xFF\xFF"
 
+/**
+ * @brief Expiry marker constant.
+ * @details Stored values that start with these 4 bytes carry an expiry header (see expiry.hpp). A value
+ *          a client sets that starts with them, or equals TOMBSTONE, is stored behind an empty header.
+ */
+#define EXPIRY_MARKER "\xFF\xFF\xFF\xFE"
+
 /**
  * @brief Index Extenstion Constant.
  * @details This constant is used to define the file extension for index files
@@ -36,12 +45,64 @@ const std::string INDEX_EXTENSION = ".index";
  */
 const std::string DATA_EXTENSION = ".data";
 
+/**
+ * @brief Filter Extension Constant.
+ * @details This constant is used to define the file extension for filter files
+ *           in the database. It is set to ".filter", this filter file stores the Bloom filter over the table's keys
+ */
+const std::string FILTER_EXTENSION = ".filter";
+
+/**
+ * @brief Table Extension Constant.
+ * @details This constant is used to define the file extension for block-based sstables. It is set to ".sst",
+ *          a single file holding the data blocks, the filter block, the index block and the footer
+ */
+const std::string SST_EXTENSION = ".sst";
+
+/**
+ * @brief Write-ahead log file name constants.
+ * @details Log files are named wal_<number>.log inside the data directory; higher numbers are newer.
+ */
+const std::string WAL_PREFIX = "wal_";
+const std::string WAL_EXTENSION = ".log";
+
+/**
+ * @brief Manifest file name constants.
+ * @details The table catalog is logged to MANIFEST-<number> inside the data directory; the CURRENT
+ *          file names the manifest in use.
+ */
+const std::string MANIFEST_PREFIX = "MANIFEST-";
+const std::string CURRENT_FILE = "CURRENT";
+
+/**
+ * @brief Size at which the manifest is rewritten as a fresh snapshot. (Default: 4MB)
+ * @details Every flush and compaction appends an edit; once the log passes this size the live
+ *          tables are written to a new manifest and the old one is deleted.
+ */
+const size_t MAX_MANIFEST_SIZE = 4 * 1024 * 1024;
+
 /**
  * @brief Data Directory Constant.
  * @details This constant is used to define the directory where sstable files are stored
  */
 const std::string DATA_DIR = "data/";
 
+/**
+ * @brief Number of independent LSM trees the sharded engine splits keys between. (Default: 4)
+ * @details Each shard has its own MemTables, write-ahead log, SSTables and background threads, so writes to
+ *          different shards never contend. Memtable limits apply per shard, while the block cache is shared.
+ *          Only used when a data directory is created: an existing one keeps the count recorded in it.
+ */
+const size_t NUM_SHARDS = 4;
+
+/**
+ * @brief Shard layout file and shard directory prefix.
+ * @details The SHARDS file in the data directory records the number of shards, whose trees live in
+ *          shard_0/, shard_1/, ... next to it.
+ */
+const std::string SHARDS_FILE = "SHARDS";
+const std::string SHARD_DIR_PREFIX = "shard_";
+
 /**
  * @brief Constants for memory limit in bytes. (Default: 32MB)
  * @details If the memtable size exceeds this limit, the memtable will be flushed to disk.
@@ -49,10 +110,195 @@ const std::string DATA_DIR = "data/";
 const size_t MAX_MEMTABLE_SIZE = 32 * 1024 * 1024;
 
 /**
- * @brief Constants for the maximum number of sstables.
- * @details This constant is used as threshold for sstable count after which compaction is triggered.
- *          The default value is set to 100, which means that if the number of sstable files exceeds this limit,
- *          a compaction process will be initiated to merge and reduce the number of sstable files.
+ * @brief Compaction strategies.
+ * @details LEVELED keeps flushed tables in L0 and merges them down into levels L1 and above, where tables
+ *          never overlap and each level is LEVEL_SIZE_MULTIPLIER times larger than the one above; a read
+ *          probes every L0 table but at most one table per deeper level.
+ *          TIERED keeps every table in L0 and merges runs of similarly sized neighbours into one larger
+ *          table, rewriting each key fewer times at the cost of more tables per read.
+ */
+enum class CompactionStyle {
+    LEVELED,
+    TIERED
+};
+
+/**
+ * @brief Compaction strategy. (Default: LEVELED)
+ */
+const CompactionStyle COMPACTION_STYLE = CompactionStyle::LEVELED;
+
+/**
+ * @brief Number of levels in the leveled layout, including L0. (Default: 7)
+ */
+const size_t NUM_LEVELS = 7;
+
+/**
+ * @brief Number of L0 tables that triggers a compaction into L1. (Default: 4)
+ */
+const size_t L0_COMPACTION_TRIGGER = 4;
+
+/**
+ * @brief Target total data size of L1 in bytes. (Default: 256MB)
+ * @details Every deeper level targets LEVEL_SIZE_MULTIPLIER times the size of the level above it.
+ */
+const uint64_t MAX_BYTES_FOR_LEVEL_BASE = 256ULL * 1024 * 1024;
+
+/**
+ * @brief Size ratio between consecutive levels. (Default: 10)
+ */
+const uint64_t LEVEL_SIZE_MULTIPLIER = 10;
+
+/**
+ * @brief Minimum number of similarly sized tables merged by one tiered compaction. (Default: 4)
+ */
+const size_t TIERED_MIN_MERGE_WIDTH = 4;
+
+/**
+ * @brief Largest size ratio between tables merged together by tiered compaction. (Default: 2)
+ */
+const uint64_t TIERED_SIZE_RATIO = 2;
+
+/**
+ * @brief Number of background threads writing immutable memtables to disk. (Default: 1)
+ * @details Flushes run on their own threads so they never wait behind a compaction.
+ */
+const size_t FLUSH_THREADS = 1;
+
+/**
+ * @brief Number of compactions that may run at the same time. (Default: 2)
+ * @details Concurrent compactions always work on disjoint sets of tables.
+ */
+const size_t COMPACTION_THREADS = 2;
+
+/**
+ * @brief Maximum number of key ranges one leveled compaction is split into. (Default: 4)
+ * @details Each range is merged into its own output tables, the first on the compaction's thread and the
+ *          others on a pool of MAX_SUBCOMPACTIONS - 1 threads shared by all compactions. A compaction is only
+ *          split when its inputs add up to at least two TARGET_SSTABLE_SIZE files; 1 disables splitting.
+ */
+const size_t MAX_SUBCOMPACTIONS = 4;
+
+/**
+ * @brief Number of immutable memtables awaiting flush at which writes stop. (Default: 4)
+ * @details Writes are slowed down once one fewer than this many are pending, and wait until a flush
+ *          completes once this many are. Bounds memory at roughly (this + 1) * MAX_MEMTABLE_SIZE.
+ */
+const size_t MAX_IMMUTABLE_MEMTABLES = 4;
+
+/**
+ * @brief Number of L0 tables at which writes are slowed down. (Default: 8)
+ * @details Only applies to leveled compaction, where L0 is normally drained into L1.
+ */
+const size_t L0_SLOWDOWN_WRITES_TRIGGER = 8;
+
+/**
+ * @brief Number of L0 tables at which writes stop until compaction catches up. (Default: 12)
+ * @details Only applies to leveled compaction, where L0 is normally drained into L1.
+ */
+const size_t L0_STOP_WRITES_TRIGGER = 12;
+
+/**
+ * @brief Combined rate of all writes to one tree while its writes are slowed down, in bytes per second. (Default: 16MB)
+ */
+const uint64_t DELAYED_WRITE_RATE = 16 * 1024 * 1024;
+
+/**
+ * @brief Target size of an sstable data file written by compaction, in bytes. (Default: 64MB)
+ * @details Compaction output is split into files of roughly this size.
+ */
+const size_t TARGET_SSTABLE_SIZE = 64 * 1024 * 1024;
+
+/**
+ * @brief Target size of an sstable data block before its trailer, in bytes. (Default: 4KB)
+ * @details A block is the unit of disk reads, checksums and block cache entries; a point lookup reads one block.
+ */
+const size_t BLOCK_SIZE = 4 * 1024;
+
+/**
+ * @brief Number of keys between restart points in a data block. (Default: 16)
+ * @details Keys are stored as the suffix they do not share with the previous key, except at restart points,
+ *          which store the full key and are binary-searched by lookups. Larger values save space, smaller
+ *          values shorten the linear scan after the binary search.
+ */
+const size_t BLOCK_RESTART_INTERVAL = 16;
+
+/**
+ * @brief Block compression codecs.
+ * @details The value is stored in the type byte of every block trailer and in the sstable footer, so it must
+ *          not change. NONE stores blocks as they are, LZ4 favours decompression speed and ZSTD compresses
+ *          harder at a higher CPU cost.
+ */
+enum class CompressionType : uint8_t {
+    NONE = 0,
+    LZ4 = 1,
+    ZSTD = 2
+};
+
+/**
+ * @brief Codec for sstable data blocks. (Default: LZ4)
+ * @details Builds without the LZ4 headers write uncompressed blocks instead.
+ */
+const CompressionType BLOCK_COMPRESSION = CompressionType::LZ4;
+
+/**
+ * @brief Codec for data blocks of compaction output with no older data below it. (Default: ZSTD)
+ * @details The bottom of the tree holds most of the data and is rewritten least often, so it gets the
+ *          stronger codec. Builds without the Zstd headers write uncompressed blocks instead.
+ */
+const CompressionType BOTTOMMOST_COMPRESSION = CompressionType::ZSTD;
+
+/**
+ * @brief Zstd compression level for ZSTD blocks. (Default: 3)
+ */
+const int ZSTD_COMPRESSION_LEVEL = 3;
+
+/**
+ * @brief Bloom filter bits per key. (Default: 10)
+ * @details Number of filter bits spent on each key of an sstable. 10 bits per key gives roughly a 1%
+ *          false positive rate; 0 disables filters for newly written sstables.
+ */
+const size_t BLOOM_BITS_PER_KEY = 10;
+
+/**
+ * @brief Block cache memory budget in bytes. (Default: 128MB)
+ * @details Decoded sstable blocks are kept in a shared LRU cache up to this many bytes; 0 disables the cache.
+ */
+const size_t BLOCK_CACHE_CAPACITY = 128 * 1024 * 1024;
+
+/**
+ * @brief SSTable read modes.
+ * @details PREAD reads the block between two sparse index entries with one positioned read.
+ *          MMAP maps the whole data file once and compares keys in place, allocating only for the result.
+ */
+enum class SSTableReadMode {
+    PREAD,
+    MMAP
+};
+
+/**
+ * @brief Read mode used for sstable data files. (Default: PREAD)
+ */
+const SSTableReadMode SSTABLE_READ_MODE = SSTableReadMode::PREAD;
+
+/**
+ * @brief Write-ahead log sync modes.
+ * @details ALWAYS fdatasyncs before a write is acknowledged (shared by every write in the group commit),
+ *          PERIODIC fdatasyncs from a background thread every WAL_SYNC_INTERVAL_MS,
+ *          NONE only writes to the log and leaves flushing to the OS.
+ */
+enum class WalSyncMode {
+    ALWAYS,
+    PERIODIC,
+    NONE
+};
+
+/**
+ * @brief Sync mode of the write-ahead log. (Default: ALWAYS)
+ */
+const WalSyncMode WAL_SYNC_MODE = WalSyncMode::ALWAYS;
+
+/**
+ * @brief Interval between background fdatasyncs in WalSyncMode::PERIODIC, in milliseconds. (Default: 100)
  */
-const size_t MAX_SSTABLE_COUNT = 100;
+const int WAL_SYNC_INTERVAL_MS = 100;
 #endif
\ No newline at end of file
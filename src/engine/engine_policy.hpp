@@ -0,0 +1,101 @@
+/**
+ * @file engine_policy.hpp
+ * @brief Compile-time policies of the engine
+ * @details This file contains the key comparators and the EnginePolicy that picks a comparator and a
+ *          MemTable representation for a tree at compile time, so the comparisons on the MemTable's
+ *          hot paths are inlined rather than called through a pointer. Everything outside the MemTable
+ *          (SSTables, merging iterators, range deletions, scans) orders keys bytewise, so a comparator
+ *          must order keys exactly as bytewise comparison does; a comparator only makes that order
+ *          cheaper to compute for the keys it knows about.
+ * @author Gana Jayant Sigadam
+ * @date March 2025
+ * @version 1.0
+ */
+#ifndef ENGINE_POLICY_HPP
+#define ENGINE_POLICY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+/**
+ * @struct BytewiseComparator
+ * @brief Orders keys as unsigned byte strings, the order of std::string_view comparison
+ */
+struct BytewiseComparator {
+    static bool less(std::string_view a, std::string_view b) {
+        return a < b;
+    }
+
+    static bool equal(std::string_view a, std::string_view b) {
+        return a == b;
+    }
+};
+
+/**
+ * @struct FixedWidthKeyComparator
+ * @brief Bytewise order, computed word by word for keys of exactly WIDTH bytes
+ * @details Meant for trees whose keys are fixed-width integers stored big-endian, such as ids or
+ *          timestamps, where bytewise order is numeric order. Two keys of WIDTH bytes are compared as
+ *          WIDTH / 8 big-endian 64-bit words, with no call to memcmp and no length checks, and tested
+ *          for equality with a memcmp of constant size, which compiles to a few loads. Keys of any
+ *          other length fall back to bytewise comparison, so the order always matches it.
+ * @tparam WIDTH Key width in bytes, a multiple of 8.
+ */
+template <size_t WIDTH>
+struct FixedWidthKeyComparator {
+    static_assert(WIDTH > 0 && WIDTH % sizeof(uint64_t) == 0, "fixed-width keys are compared in 8-byte words");
+
+    static uint64_t loadBigEndian(const char *data) {
+        uint64_t word;
+        std::memcpy(&word, data, sizeof(word));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        word = __builtin_bswap64(word);
+#endif
+        return word;
+    }
+
+    static bool less(std::string_view a, std::string_view b) {
+        if (a.size() != WIDTH || b.size() != WIDTH) {
+            return a < b;
+        }
+        for (size_t offset = 0; offset < WIDTH; offset += sizeof(uint64_t)) {
+            uint64_t left = loadBigEndian(a.data() + offset);
+            uint64_t right = loadBigEndian(b.data() + offset);
+            if (left != right) {
+                return left < right;
+            }
+        }
+        return false;
+    }
+
+    static bool equal(std::string_view a, std::string_view b) {
+        if (a.size() != WIDTH || b.size() != WIDTH) {
+            return a == b;
+        }
+        return std::memcmp(a.data(), b.data(), WIDTH) == 0;
+    }
+};
+
+template <typename Comparator, int MaxHeight, unsigned Branching>
+class BasicArenaSkipList;
+
+/**
+ * @struct EnginePolicy
+ * @brief Compile-time choices of a tree: its key comparator and MemTable representation
+ * @details A representation must offer the interface of BasicArenaSkipList: versioned put(), get()
+ *          and seek() at a sequence number, find(), begin(), end(), getSize() and a forward Iterator,
+ *          with single-writer, lock-free-reader thread safety. The default tree is
+ *          BasicLSMTree<EnginePolicy<>>; `EnginePolicy<FixedWidthKeyComparator<8>>` gives a tree
+ *          tuned for 8-byte integer keys.
+ * @tparam Comparator Key comparator, ordering keys as BytewiseComparator does.
+ * @tparam Rep MemTable representation, ordered by Comparator.
+ */
+template <typename Comparator = BytewiseComparator, typename Rep = BasicArenaSkipList<Comparator, 12, 4>>
+struct EnginePolicy {
+    using KeyComparator = Comparator;
+    using MemTableRep = Rep;
+};
+
+#endif
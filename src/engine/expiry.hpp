@@ -0,0 +1,127 @@
+/**
+ * @file expiry.hpp
+ * @brief Per-key expiry stored with the value
+ * @details This file contains the encoding of values that carry an expiry time. Like TOMBSTONE, the
+ *          expiry travels inside the stored value, so the write-ahead log, MemTable, SSTable and block
+ *          cache formats carry it unchanged, and only the places that interpret values look at it.
+ *          Reads treat an expired value as deleted, flushes and compactions write a tombstone in its place,
+ *          and compactions with nothing older below their output drop it altogether.
+ * @author Gana Jayant Sigadam
+ * @date March 2025
+ * @version 1.0
+ */
+#ifndef EXPIRY_HPP
+#define EXPIRY_HPP
+
+#include "coding.hpp"
+#include "constants.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <utility>
+
+/**
+ * @class Expiry
+ * @brief Static helpers to wrap a value with its expiry time and read it back
+ * @details Encoding: [EXPIRY_MARKER (4 bytes)] [expiry time (8 bytes)] [value]. The expiry time is in
+ *          milliseconds since the Unix epoch, 0 meaning the value never expires. Stored values that
+ *          would otherwise be mistaken for a tombstone or a header get a header with expiry time 0, so
+ *          any value a client sets reads back unchanged.
+ */
+class Expiry {
+public:
+    static constexpr size_t HEADER_SIZE = 12;
+    static constexpr uint64_t NEVER = 0; ///< Expiry time of a value that never expires.
+
+    /**
+     * @brief Gets the current time in milliseconds since the Unix epoch.
+     */
+    static uint64_t nowMillis() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                                         std::chrono::system_clock::now().time_since_epoch())
+                                         .count());
+    }
+
+    static bool hasHeader(std::string_view stored) {
+        return stored.size() >= HEADER_SIZE && std::memcmp(stored.data(), EXPIRY_MARKER, 4) == 0;
+    }
+
+    /**
+     * @brief Checks whether a value must be stored with a header.
+     * @param value The value a client set.
+     * @param expire_at Expiry time in ms since the Unix epoch, or NEVER.
+     */
+    static bool needsHeader(std::string_view value, uint64_t expire_at = NEVER) {
+        return expire_at != NEVER || value == TOMBSTONE || hasHeader(value);
+    }
+
+    /**
+     * @brief Encodes a value as it is stored.
+     * @param value The value a client set.
+     * @param expire_at Expiry time in ms since the Unix epoch, or NEVER.
+     * @return std::string The value itself when it needs no header, otherwise the header and the value.
+     */
+    static std::string encode(std::string_view value, uint64_t expire_at = NEVER) {
+        std::string stored;
+        if (!needsHeader(value, expire_at)) {
+            stored.assign(value);
+            return stored;
+        }
+        stored.reserve(HEADER_SIZE + value.size());
+        stored.append(EXPIRY_MARKER, 4);
+        Coding::putFixed64(stored, expire_at);
+        stored.append(value);
+        return stored;
+    }
+
+    /**
+     * @brief Gets the expiry time of a stored value, NEVER if it has none.
+     */
+    static uint64_t expireAt(std::string_view stored) {
+        return hasHeader(stored) ? Coding::decodeFixed64(stored.data() + 4) : NEVER;
+    }
+
+    /**
+     * @brief Checks whether a stored value has expired.
+     * @param stored The stored value.
+     * @param now The current time, from nowMillis().
+     */
+    static bool isExpired(std::string_view stored, uint64_t now) {
+        uint64_t expire_at = expireAt(stored);
+        return expire_at != NEVER && expire_at <= now;
+    }
+
+    /**
+     * @brief Gets the value a client set from a stored value.
+     */
+    static std::string_view value(std::string_view stored) {
+        return hasHeader(stored) ? stored.substr(HEADER_SIZE) : stored;
+    }
+
+    /**
+     * @brief Turns a stored value found by a lookup into the answer a reader sees.
+     * @details Expired values read as deleted: {false, TOMBSTONE}, which also stops the lookup from
+     *          reaching older versions of the key.
+     * @param result A found value, as {true, stored}; other results are left alone.
+     * @param now The current time, from nowMillis().
+     */
+    static void check(std::pair<bool, std::string> &result, uint64_t now) {
+        if (result.first && isExpired(result.second, now)) {
+            result = {false, TOMBSTONE};
+        }
+    }
+
+    /**
+     * @brief Removes the header from a found value, leaving the value a client set.
+     */
+    static void strip(std::pair<bool, std::string> &result) {
+        if (result.first && hasHeader(result.second)) {
+            result.second.erase(0, HEADER_SIZE);
+        }
+    }
+};
+
+#endif
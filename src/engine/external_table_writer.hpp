@@ -0,0 +1,205 @@
+/**
+ * @file external_table_writer.hpp
+ * @brief Writer of SSTables for bulk ingestion
+ * @details This file contains the writer used to build SSTables outside the engine, for example from
+ *          a sorted dump, so that they can be linked into a tree with LSMTree::ingestFiles() without
+ *          going through the write-ahead log and the MemTables.
+ * @author Gana Jayant Sigadam
+ * @date March 2025
+ * @version 1.0
+ */
+#ifndef EXTERNAL_TABLE_WRITER
+#define EXTERNAL_TABLE_WRITER
+
+#include "constants.hpp"
+#include "expiry.hpp"
+#include "range_deletion.hpp"
+#include "sstable_builder.hpp"
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @class ExternalTableWriter
+ * @brief Writes one block-based SSTable from keys given in increasing order
+ * @details Unlike SSTableBuilder, which trusts the engine, the writer checks its input: keys must be
+ *          strictly increasing, and a call breaking the order is rejected and leaves the table as it
+ *          was. Values are stored as put() would store them, behind an expiry header where needed.
+ *
+ *          Range deletions delete keys of the tree the table is ingested into, never keys of the table
+ *          itself, so a range must start after the last key added and no key may be added inside a
+ *          range added before.
+ */
+class ExternalTableWriter {
+private:
+    std::string filename;                         ///< Base filename (without extensions).
+    SSTableBuilder builder;
+    std::string last_key;                         ///< Last key added.
+    bool has_keys = false;                        ///< True once a record was added.
+    std::vector<RangeTombstone> range_tombstones; ///< Range deletions added so far, normalized.
+    bool finished = false;
+
+    /**
+     * @brief Checks that a key may be added next, reporting why not.
+     */
+    bool accepts(std::string_view key) const {
+        if (finished) {
+            std::cerr << "Cannot add to " << filename << " after finish()" << std::endl;
+            return false;
+        }
+        if (has_keys && key <= last_key) {
+            std::cerr << "Keys added to " << filename << " must be strictly increasing" << std::endl;
+            return false;
+        }
+        if (RangeDeletion::covers(range_tombstones, key)) {
+            std::cerr << "Key added to " << filename << " falls inside one of its range deletions" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+public:
+    /**
+     * @brief Creates the file of a new SSTable.
+     * @param filename Base filename for the new SSTable (without extensions); the table is written to
+     *                 filename + SST_EXTENSION.
+     */
+    explicit ExternalTableWriter(const std::string &filename) : filename(filename), builder(filename) {
+    }
+
+    ExternalTableWriter(const ExternalTableWriter &) = delete;
+    ExternalTableWriter &operator=(const ExternalTableWriter &) = delete;
+
+    /**
+     * @brief Deletes the file unless finish() was called.
+     */
+    ~ExternalTableWriter() {
+        abandon();
+    }
+
+    /**
+     * @brief Checks whether the file was created and every write so far succeeded.
+     */
+    bool ok() const {
+        return builder.ok();
+    }
+
+    /**
+     * @brief Adds a key-value pair.
+     * @param key The key, greater than every key added before.
+     * @param value The value.
+     * @return True if the record was added, false if the key is out of order.
+     */
+    bool put(std::string_view key, std::string_view value) {
+        return Expiry::needsHeader(value) ? addStored(key, Expiry::encode(value)) : addStored(key, value);
+    }
+
+    /**
+     * @brief Adds a key-value pair that reads as deleted from an expiry time on.
+     * @param key The key, greater than every key added before.
+     * @param value The value.
+     * @param expire_at Expiry time in milliseconds since the Unix epoch.
+     * @return True if the record was added, false if the key is out of order.
+     */
+    bool putWithExpiry(std::string_view key, std::string_view value, uint64_t expire_at) {
+        return addStored(key, Expiry::encode(value, expire_at));
+    }
+
+    /**
+     * @brief Adds a tombstone, deleting the key in the tree the table is ingested into.
+     * @param key The key, greater than every key added before.
+     * @return True if the tombstone was added, false if the key is out of order.
+     */
+    bool remove(std::string_view key) {
+        return addStored(key, TOMBSTONE);
+    }
+
+    /**
+     * @brief Adds a record whose value is already in the engine's stored form.
+     * @details Used to copy records between tables: the value keeps its expiry header, and TOMBSTONE
+     *          is kept as a deletion.
+     * @param key The key, greater than every key added before.
+     * @param stored The value as stored.
+     * @return True if the record was added, false if the key is out of order.
+     */
+    bool addStored(std::string_view key, std::string_view stored) {
+        if (!accepts(key)) {
+            return false;
+        }
+        builder.add(key, stored);
+        last_key.assign(key.data(), key.size());
+        has_keys = true;
+        return true;
+    }
+
+    /**
+     * @brief Deletes every key in [start, end) in the tree the table is ingested into.
+     * @param start First key deleted, greater than every key added before.
+     * @param end Key the deletion stops before; nothing is added unless start < end.
+     * @return True if the range was added or is empty, false if it covers a key already added.
+     */
+    bool deleteRange(std::string_view start, std::string_view end) {
+        if (start >= end) {
+            return true;
+        }
+        if (finished || (has_keys && start <= last_key)) {
+            std::cerr << "Range deletion in " << filename << " must start after the last key added" << std::endl;
+            return false;
+        }
+        builder.addRangeTombstone(start, end);
+        range_tombstones.push_back({std::string(start), std::string(end), 0});
+        RangeDeletion::normalize(range_tombstones);
+        return true;
+    }
+
+    /**
+     * @brief Gets the number of records added so far.
+     */
+    uint64_t entries() const {
+        return builder.entries();
+    }
+
+    /**
+     * @brief Gets the size of the data written so far.
+     */
+    uint64_t fileSize() const {
+        return builder.fileSize();
+    }
+
+    /**
+     * @brief Completes and syncs the table; an empty table is not written.
+     * @return True if the table was written and can be ingested, otherwise false, with the file removed.
+     */
+    bool finish() {
+        if (finished) {
+            return false;
+        }
+        finished = true;
+        if (!has_keys && range_tombstones.empty()) {
+            std::cerr << "Nothing was added to " << filename << std::endl;
+            builder.abandon();
+            return false;
+        }
+        if (!builder.finish()) {
+            std::cerr << "Failed to write " << filename << SST_EXTENSION << std::endl;
+            builder.abandon();
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Gives up on the table and deletes its file.
+     */
+    void abandon() {
+        if (!finished) {
+            finished = true;
+            builder.abandon();
+        }
+    }
+};
+
+#endif
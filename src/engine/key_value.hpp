@@ -10,6 +10,7 @@
 #define KEY_VALUE_HPP
 
 #include <string>
+#include <string_view>
 
 /**
  * @brief  Key-Value Pair Class
@@ -31,6 +32,15 @@ public:
     KeyValuePair(const std::string &key, const std::string &value)
         : key(key), value(value) {}
 
+    /**
+     * @brief Construct a new Key Value Pair object taking ownership of the strings
+     *
+     * @param key key string
+     * @param value value string
+     */
+    KeyValuePair(std::string &&key, std::string &&value)
+        : key(std::move(key)), value(std::move(value)) {}
+
     KeyValuePair(const std::string &keyBytes)
         : key(keyBytes) {}
     KeyValuePair()
@@ -41,7 +51,7 @@ public:
      *
      * @param newValue
      */
-    void setValue(const std::string &newValue) { value = newValue; }
+    void setValue(std::string_view newValue) { value.assign(newValue.data(), newValue.size()); }
 
     /**
      * @brief Get the Key object
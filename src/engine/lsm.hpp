@@ -10,343 +10,2477 @@
 #define LSM
 
 #include "constants.hpp"
+#include "expiry.hpp"
+#include "manifest.hpp"
 #include "memtable.hpp"
+#include "merging_iterator.hpp"
+#include "metrics.hpp"
+#include "options.hpp"
 #include "sstable.hpp"
+#include "thread_pool.hpp"
+#include "wal.hpp"
+#include "write_batch.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
 #include <deque>
+#include <fcntl.h>
 #include <filesystem>
+#include <functional>
+#include <future>
 #include <fstream>
+#include <iostream>
 #include <iterator>
-#include <map>
 #include <memory>
+#include <numeric>
+#include <mutex>
+#include <stdexcept>
 #include <string>
+#include <string_view>
 #include <thread>
+#include <unistd.h>
+#include <unordered_set>
 #include <vector>
 
 /**
- * @class LSMTree
+ * @struct WriteStallStats
+ * @brief Snapshot of write stall counters
+ */
+struct WriteStallStats {
+    uint64_t slowdowns = 0;         ///< Writes delayed to DELAYED_WRITE_RATE.
+    uint64_t stops = 0;             ///< Writes that waited for a flush or compaction to finish.
+    uint64_t stall_micros = 0;      ///< Total time writers spent delayed or stopped, in microseconds.
+    size_t immutable_memtables = 0; ///< MemTables currently awaiting flush.
+    size_t l0_tables = 0;           ///< Tables currently in L0.
+};
+
+/**
+ * @struct TreeStats
+ * @brief Snapshot of the shape of a tree
+ */
+struct TreeStats {
+    size_t memtable_bytes = 0;                ///< Bytes held by the active MemTable.
+    size_t immutable_memtables = 0;           ///< MemTables awaiting flush.
+    size_t immutable_bytes = 0;               ///< Bytes held by the MemTables awaiting flush.
+    std::vector<size_t> tables_per_level;     ///< SSTables in each level.
+    std::vector<uint64_t> bytes_per_level;    ///< Bytes of the SSTables in each level.
+};
+
+/**
+ * @class BasicLSMTree
  * @brief LSM Tree implementation
  *  @details This class implements a Log-Structured Merge Tree (LSM Tree) for efficient key-value storage.
  *  @details The LSM Tree uses a combination of in-memory and on-disk data structures to provide fast
  *  @details read and write operations. The in-memory structure is a MemTable, which is periodically flushed
  *  @details to disk as an SSTable. The on-disk structure is a collection of SSTables, which are compacted
  *  @details periodically to reduce the number of files and improve read performance.
+ *  @details With leveled compaction, flushed tables land in L0 and are merged into L1 and deeper levels,
+ *  @details whose tables never overlap, so a read probes every L0 table and at most one table per deeper level.
+ *  @details Sizes, thresholds and thread counts come from the Options the tree is opened with, and the
+ *  @details Policy fixes the MemTable representation and its key comparator at compile time.
+ *  @details Every change to the set of tables is logged to the manifest before it is applied, and startup
+ *  @details rebuilds the levels from the manifest without opening the table files.
+ *  @details Readers work from an immutable, reference-counted version of the MemTables and levels, taken
+ *  @details under a lock held only to copy a pointer, so no engine lock is held while they read from disk.
  */
 
-class LSMTree {
+template <typename Policy = EnginePolicy<>>
+class BasicLSMTree {
 private:
-    std::string SS_TABLE_PATH;                       /**< Path to the directory storing SSTables. */
-    std::unique_ptr<MemTable> activeMemTable;        /**< The active MemTable for write operations. */
-    std::deque<std::unique_ptr<MemTable>> memTables; /**< Immutable MemTables awaiting flush to disk. */
-    std::deque<std::unique_ptr<SS_Table>> sstables;  /**< Collection of SSTables on disk. */
+    using MemTable = BasicMemTable<Policy>;
+
+    /**
+     * @struct ImmutableMemTable
+     * @brief A rotated MemTable and the state of its flush.
+     */
+    struct ImmutableMemTable {
+        std::shared_ptr<MemTable> memtable; /**< The MemTable, readable until its SSTable is in L0. */
+        std::string filename;               /**< Name of the SSTable it is flushed to, assigned in rotation order. */
+        bool flushed = false;               /**< True once the SSTable is written and synced; a failed flush is retried. */
+        std::shared_ptr<SS_Table> sstable;  /**< The written SSTable, waiting for older flushes to be published. */
+    };
+
+    /**
+     * @struct Compaction
+     * @brief A set of input tables picked for one compaction and where their output goes.
+     */
+    struct Compaction {
+        size_t level = 0;               /**< Level the compaction was triggered for. */
+        size_t output_level = 0;        /**< Level the output tables are added to. */
+        std::vector<SS_Table *> inputs; /**< Input tables, oldest data first. */
+        bool drop_tombstones = false;   /**< True if no older version of an input key exists below the output. */
+    };
+
+    /**
+     * @struct Version
+     * @brief An immutable view of the MemTables and SSTables.
+     * @details Rotations, flushes and compactions install a new version instead of changing the
+     *          current one, and readers keep a reference to the version they started with. A
+     *          version keeps everything it lists alive: a MemTable is freed, and the files of a
+     *          table replaced by compaction are deleted, only once the last version listing it is released.
+     */
+    struct Version {
+        std::shared_ptr<MemTable> active;                           /**< The active MemTable when the version was installed. */
+        std::vector<std::shared_ptr<MemTable>> immutables;          /**< MemTables awaiting flush, oldest first. */
+        std::vector<std::vector<std::shared_ptr<SS_Table>>> levels; /**< SSTables per level, ordered as in levels. */
+    };
+
+    const Options options;                                     /**< Settings the tree was opened with. */
+    std::string SS_TABLE_PATH;                                 /**< Path to the directory storing SSTables. */
+    std::atomic<MemTable *> activeMemTable;                    /**< The active MemTable for write operations, owned by the current version. */
+    std::deque<std::unique_ptr<ImmutableMemTable>> memTables; /**< Immutable MemTables awaiting flush to disk, oldest first. */
+    /** SSTables per level: L0 oldest first and overlapping, deeper levels sorted by key and disjoint. */
+    std::vector<std::deque<std::shared_ptr<SS_Table>>> levels;
+    std::vector<std::string> compact_pointers;       /**< Per level, the largest key of the last table compacted from it. */
+    std::unordered_set<const SS_Table *> compacting; /**< Tables that are inputs of a scheduled compaction. */
+    size_t scheduled_compactions;                    /**< Compactions queued or running. */
+    std::shared_ptr<BlockCache> block_cache;         /**< Decoded block cache shared by all SSTables, null if disabled. */
+    std::unique_ptr<WriteAheadLog> wal;              /**< Write-ahead log of the active MemTable. */
+    std::unique_ptr<Manifest> manifest;              /**< Log of table additions and removals. */
+    uint64_t last_sequence;                          /**< Sequence number of the newest table; guarded by manifest_mtx. */
+    uint64_t write_sequence;                         /**< Sequence number of the newest write; guarded by active_memtable_mtx. */
+    std::shared_ptr<const Version> current;          /**< The version new reads start from; guarded by version_mtx. */
 
-    std::mutex active_memtable_mtx; /**< Mutex for synchronizing access to the active MemTable. */
+    std::mutex active_memtable_mtx; /**< Mutex serializing writers of the active MemTable; readers do not take it. */
     std::mutex memtables_mtx;       /**< Mutex for synchronizing access to the memTables queue. */
-    std::mutex sstables_mtx;        /**< Mutex for synchronizing access to the SSTables. */
-    std::mutex compaction_mtx;      /**< Mutex for synchronizing the compaction process. */
+    std::mutex sstables_mtx;        /**< Mutex for the SSTable levels and the compaction bookkeeping. */
+    std::mutex grace_mtx;           /**< Mutex serializing waits for lock-free readers. */
+    std::mutex compaction_mtx;      /**< Mutex paired with compaction_cv. */
+    /** Mutex serializing manifest edits with the level changes they describe; taken before memtables_mtx and sstables_mtx. */
+    std::mutex manifest_mtx;
+    std::mutex version_mtx; /**< Mutex held only to copy or replace the current version; taken last. */
+
+    std::condition_variable compaction_cv; /**< Wakes a flush or compaction pausing after a failure at shutdown. */
+
+    std::atomic<bool> running;                  /**< Flag to indicate whether the LSMTree service is running. */
+    std::unique_ptr<ThreadPool> flush_pool;      /**< High-priority threads flushing MemTables to SSTables. */
+    std::unique_ptr<ThreadPool> compaction_pool; /**< Low-priority threads running compactions. */
+    /** Threads merging the key ranges of split compactions beyond the first, which the compaction's own thread merges. */
+    std::unique_ptr<ThreadPool> subcompaction_pool;
+    std::atomic<uint64_t> last_file_number;      /**< Number in the name of the newest SSTable. */
 
-    std::condition_variable cv;            /**< Condition variable for MemTable flushing. */
-    std::condition_variable compaction_cv; /**< Condition variable for compaction events. */
+    std::atomic<uint64_t> read_epoch;        /**< Selects which reader counter new lock-free readers use. */
+    std::atomic<uint64_t> active_readers[2]; /**< Lock-free readers currently inside an active MemTable. */
 
-    std::atomic<bool> running;     /**< Flag to indicate whether the LSMTree service is running. */
-    std::thread flush_thread;      /**< Background thread for flushing MemTables to SSTables. */
-    std::thread compaction_thread; /**< Background thread for periodic SSTable compaction. */
+    std::atomic<uint64_t> filter_checked;        /**< SSTable lookups that consulted a Bloom filter. */
+    std::atomic<uint64_t> filter_useful;         /**< Lookups a Bloom filter ruled out without reading the data file. */
+    std::atomic<uint64_t> filter_false_positive; /**< Lookups a Bloom filter let through that found nothing. */
+
+    std::mutex stall_mtx;                     /**< Mutex for stall_cv and the delayed write schedule. */
+    std::condition_variable stall_cv;         /**< Wakes stopped writers when a flush or compaction finishes. */
+    std::chrono::steady_clock::time_point next_delayed_write; /**< Earliest start of the next delayed write. */
+    std::atomic<size_t> immutable_memtables;  /**< Size of memTables, readable without its lock. */
+    std::atomic<size_t> l0_tables;            /**< Size of levels[0], readable without its lock. */
+    std::atomic<uint64_t> stall_slowdowns;    /**< Writes delayed by a slowdown. */
+    std::atomic<uint64_t> stall_stops;        /**< Writes stopped until background work caught up. */
+    std::atomic<uint64_t> stall_micros;       /**< Time writers spent stalled, in microseconds. */
 
     /**
-     * @brief Rotates the active MemTable when it reaches its maximum size.
-     * @details The current MemTable becomes immutable and is added to the flush queue.
-     *          A new active MemTable is created for future writes.
+     * @brief Write stall conditions, mildest first.
      */
-    void rotate_memtable() {
-        std::unique_ptr<MemTable> new_memtable = std::make_unique<MemTable>();
-        memTables.push_back(std::move(activeMemTable));
-        activeMemTable = std::move(new_memtable);
-        cv.notify_one();
+    enum class WriteStall {
+        NONE,
+        SLOWDOWN,
+        STOP
+    };
+
+    /**
+     * @brief Checks whether writes must be slowed down or stopped.
+     * @details Writes stop when max_immutable_memtables are awaiting flush, or, with leveled compaction,
+     *          when L0 reaches l0_stop_writes_trigger tables. They slow down one MemTable or
+     *          l0_slowdown_writes_trigger tables earlier.
+     */
+    WriteStall write_stall_condition() const {
+        size_t immutable = immutable_memtables.load(std::memory_order_relaxed);
+        size_t l0 = options.compaction_style == CompactionStyle::LEVELED ? l0_tables.load(std::memory_order_relaxed) : 0;
+        if (immutable >= options.max_immutable_memtables || l0 >= options.l0_stop_writes_trigger) {
+            return WriteStall::STOP;
+        }
+        if ((options.max_immutable_memtables > 1 && immutable >= options.max_immutable_memtables - 1) ||
+            l0 >= options.l0_slowdown_writes_trigger) {
+            return WriteStall::SLOWDOWN;
+        }
+        return WriteStall::NONE;
     }
 
     /**
-     * @brief Background worker thread that flushes MemTables to SSTables.
-     * @details The worker waits until there is a MemTable to flush, then processes it.
+     * @brief Applies backpressure to a write before it enters the write-ahead log.
+     * @details A stopped writer waits on stall_cv until flushes or compactions bring the counts back
+     *          under the stop limits. A slowed writer reserves a slot in a schedule shared by all
+     *          writers, so together they proceed at delayed_write_rate, and sleeps until it.
+     *          Called without any lock held; the common case is two relaxed loads.
+     * @param bytes Size of the write.
      */
-    void flush_worker() {
-        while (running) {
-            std::unique_ptr<MemTable> memtable_to_flush;
+    void delay_write(size_t bytes) {
+        WriteStall stall = write_stall_condition();
+        if (stall == WriteStall::NONE) {
+            return;
+        }
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        if (stall == WriteStall::STOP) {
+            stall_stops.fetch_add(1, std::memory_order_relaxed);
+            std::unique_lock<std::mutex> lock(stall_mtx);
+            stall_cv.wait(lock, [this] { return !running || write_stall_condition() != WriteStall::STOP; });
+            stall = write_stall_condition();
+        }
+        if (stall == WriteStall::SLOWDOWN && running) {
+            stall_slowdowns.fetch_add(1, std::memory_order_relaxed);
+            std::chrono::steady_clock::time_point until;
             {
-                std::unique_lock<std::mutex> lock(memtables_mtx);
-                cv.wait(lock, [this] { return !running || !memTables.empty(); });
+                std::lock_guard<std::mutex> lock(stall_mtx);
+                std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+                until = std::max(next_delayed_write, now);
+                next_delayed_write = until + std::chrono::microseconds(bytes * 1000000 / options.delayed_write_rate);
+            }
+            std::this_thread::sleep_until(until);
+        }
+        stall_micros.fetch_add(std::chrono::duration_cast<std::chrono::microseconds>(
+                                   std::chrono::steady_clock::now() - start)
+                                   .count(),
+                               std::memory_order_relaxed);
+    }
 
-                if (!running && memTables.empty()) {
-                    break;
-                }
+    /**
+     * @brief Wakes stopped writers to re-check the stall condition.
+     * @details Taking stall_mtx orders the wake-up after a concurrent check, so it cannot be lost.
+     */
+    void signal_write_stall_change() {
+        { std::lock_guard<std::mutex> lock(stall_mtx); }
+        stall_cv.notify_all();
+    }
 
-                if (!memTables.empty()) {
-                    memtable_to_flush = std::move(memTables.front());
-                    memTables.erase(memTables.begin());
-                }
-            }
+    /**
+     * @brief Waits until no lock-free reader can still hold a retired active MemTable.
+     * @details Readers register in active_readers[read_epoch & 1] before loading activeMemTable.
+     *          Flipping the epoch steers new readers to the other counter, so the old one drains
+     *          even under constant load. Any reader that registers after the drain check loads
+     *          activeMemTable after the rotation and sees the replacement, never the retired table.
+     *          Waits are serialized, so a second flip cannot send new readers to the draining counter.
+     */
+    void wait_for_readers() {
+        std::lock_guard<std::mutex> lock(grace_mtx);
+        uint64_t epoch = read_epoch.fetch_add(1);
+        while (active_readers[epoch & 1].load() != 0) {
+            std::this_thread::yield();
+        }
+    }
 
-            if (memtable_to_flush) {
-                flush_memtable(std::move(memtable_to_flush));
-            }
+    /**
+     * @brief Takes a reference to the current version.
+     * @return std::shared_ptr<const Version> The version, readable without any lock.
+     */
+    std::shared_ptr<const Version> current_version() {
+        std::lock_guard<std::mutex> lock(version_mtx);
+        return current;
+    }
+
+    /**
+     * @brief Makes a version of the MemTable queue and the levels the current one.
+     * @details Must be called with memtables_mtx and sstables_mtx held, right after changing
+     *          either. The replaced version is handed back so the caller can release it after
+     *          dropping those locks, since releasing it may free a MemTable or delete table files.
+     * @param active The new active MemTable, or null to keep the current one.
+     * @return std::shared_ptr<const Version> The replaced version.
+     */
+    std::shared_ptr<const Version> install_version(std::shared_ptr<MemTable> active = nullptr) {
+        std::shared_ptr<Version> version = std::make_shared<Version>();
+        for (const std::unique_ptr<ImmutableMemTable> &queued : memTables) {
+            version->immutables.push_back(queued->memtable);
+        }
+        version->levels.resize(levels.size());
+        for (size_t level = 0; level < levels.size(); ++level) {
+            version->levels[level].assign(levels[level].begin(), levels[level].end());
         }
+
+        std::lock_guard<std::mutex> lock(version_mtx);
+        version->active = active != nullptr ? std::move(active) : current->active;
+        std::shared_ptr<const Version> replaced = std::move(current);
+        current = std::move(version);
+        return replaced;
     }
 
     /**
-     * @brief Writes an immutable MemTable to disk as an SSTable.
-     * @param memtable The MemTable to flush to disk.
+     * @brief Rotates the active MemTable when it reaches its maximum size.
+     * @details The current MemTable becomes immutable, is added to the flush queue and its flush
+     *          is scheduled. A new active MemTable is created for future writes. The old table is
+     *          queued before the new one is published, so a reader that misses in the new table
+     *          always finds the old one in memTables. The write-ahead log switches to a new
+     *          file, and the finished file stays with the old MemTable until it is flushed.
+     *          Must be called with active_memtable_mtx held.
      */
-    void flush_memtable(std::unique_ptr<MemTable> memtable) {
-        long long timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
-                                  std::chrono::system_clock::now().time_since_epoch())
-                                  .count();
-        std::string filename = SS_TABLE_PATH + "sstable_" + std::to_string(timestamp);
-        bool success = SS_Table::createFromMemTable(filename, memtable.get());
-        if (success) {
-            std::lock_guard<std::mutex> lock(sstables_mtx);
-            std::unique_ptr<SS_Table> sstable = std::make_unique<SS_Table>(filename);
-            sstables.push_back(std::move(sstable));
+    void rotate_memtable() {
+        std::shared_ptr<MemTable> new_memtable = std::make_shared<MemTable>(options);
+        wal->rotate();
+        new_memtable->addLogFile(wal->getFilename());
 
-            if (sstables.size() >= MAX_SSTABLE_COUNT) {
-                compaction_cv.notify_one();
-            }
+        std::unique_ptr<ImmutableMemTable> immutable = std::make_unique<ImmutableMemTable>();
+        immutable->memtable = current_version()->active;
+        // Numbers are taken in rotation order, so even a directory scan can sort L0 by age
+        immutable->filename = new_table_name(0);
+        ImmutableMemTable *job = immutable.get();
+        std::shared_ptr<const Version> replaced;
+        {
+            std::lock_guard<std::mutex> lock(memtables_mtx);
+            memTables.push_back(std::move(immutable));
+            immutable_memtables.store(memTables.size(), std::memory_order_relaxed);
+            std::lock_guard<std::mutex> sstables_lock(sstables_mtx);
+            replaced = install_version(new_memtable);
         }
+        activeMemTable.store(new_memtable.get());
+        flush_pool->schedule([this, job] { flush_memtable(job); });
     }
 
     /**
-     * @brief Background worker thread for periodic SSTable compaction.
-     * @details Monitors the number of SSTables and triggers compaction when necessary.
+     * @brief Generates a name for a new SSTable.
+     * @details Names carry a file number from a counter that the manifest persists, so no two
+     *          tables ever share a name. The manifest decides which tables are live and in what
+     *          order; the numbers and the level suffix of tables below L0 only matter when a
+     *          directory without a manifest is scanned.
+     * @param level The level the table belongs to.
+     * @return std::string Base filename for the table (without extensions).
      */
-    void compaction_worker() {
-        while (running) {
-            {
-                std::unique_lock<std::mutex> lock(compaction_mtx);
-                compaction_cv.wait(lock, [this] {
-                    std::lock_guard<std::mutex> sstables_lock(sstables_mtx);
-                    return !running || sstables.size() >= MAX_SSTABLE_COUNT;
-                });
+    std::string new_table_name(size_t level) {
+        uint64_t number = last_file_number.fetch_add(1) + 1;
+        std::string filename = SS_TABLE_PATH + "sstable_" + std::to_string(number);
+        if (level > 0) {
+            filename += "_L" + std::to_string(level);
+        }
+        return filename;
+    }
 
-                if (!running) {
-                    break;
-                }
-                perform_compaction();
-                std::this_thread::sleep_for(std::chrono::seconds(2));
+    /**
+     * @brief Gets the lowest number among the write-ahead log files of a MemTable.
+     * @return uint64_t The number, or UINT64_MAX if it has none.
+     */
+    static uint64_t first_log_number(const MemTable &memtable) {
+        uint64_t first = UINT64_MAX;
+        for (const std::string &log_file : memtable.getLogFiles()) {
+            uint64_t number;
+            if (WriteAheadLog::parseLogNumber(log_file, number)) {
+                first = std::min(first, number);
             }
         }
+        return first;
     }
 
     /**
-     * @brief Performs SSTable compaction to optimize storage and query performance.
-     * @details Merges multiple SSTables, removes deleted keys, and writes a new compacted SSTable.
+     * @brief Writes an immutable MemTable to disk as an SSTable, on a flush pool thread.
+     * @details Several MemTables may be written at once, but they are published strictly oldest
+     *          first: whichever flush finishes moves every flushed table at the front of the
+     *          queue into L0. A MemTable stays in the queue, visible to readers, until its SSTable
+     *          is in L0, so a concurrent get never misses the keys in flight, and never sees an
+     *          older MemTable's value ahead of a newer SSTable's. A failed flush, or a failure to
+     *          record it in the manifest, is retried after a pause, and keeps every newer MemTable
+     *          queued behind it. Publishing installs a version with the SSTable in place of the
+     *          MemTable; the MemTable is kept until no lock-free reader can still be using it as
+     *          the active table, and freed with the last version holding it.
+     *
+     *          The manifest edit publishing the tables records the lowest log number still in use
+     *          by a queued or active MemTable, and the published MemTables' log files are deleted
+     *          under manifest_mtx right after it, so logs go strictly in number order and a restart
+     *          never replays a log whose writes are older than a table in the manifest.
+     * @param immutable The queued MemTable to flush.
      */
-    void perform_compaction() {
-        std::vector<std::unique_ptr<SS_Table>> tables_to_compact;
+    void flush_memtable(ImmutableMemTable *immutable) {
+        auto flush_start = std::chrono::steady_clock::now();
+        std::shared_ptr<SS_Table> sstable;
+        bool written = SS_Table::createFromMemTable(immutable->filename, immutable->memtable.get(), options);
+        if (written) {
+            sstable = std::make_shared<SS_Table>(immutable->filename, block_cache.get(), options);
+            written = sstable->isLoaded();
+            if (!written) {
+                sstable.reset();
+            } else {
+                Metrics::add(Counter::FLUSH_BYTES, sstable->getFileSize());
+            }
+        }
+        Metrics::record(Timer::FLUSH, Metrics::microsSince(flush_start));
+
+        std::vector<ImmutableMemTable *> retry;
+        std::vector<std::unique_ptr<ImmutableMemTable>> published;
+        std::shared_ptr<const Version> replaced;
         {
-            std::lock_guard<std::mutex> lock(sstables_mtx);
+            std::lock_guard<std::mutex> manifest_lock(manifest_mtx);
+            std::vector<ImmutableMemTable *> ready;
+            VersionEdit edit;
+            {
+                std::lock_guard<std::mutex> lock(memtables_mtx);
+                if (written) {
+                    immutable->sstable = std::move(sstable);
+                    immutable->flushed = true;
+                } else {
+                    std::cerr << "Failed to flush MemTable to " << immutable->filename << ", retrying" << std::endl;
+                    SS_Table::removeFiles(immutable->filename);
+                    retry.push_back(immutable);
+                }
+                for (const std::unique_ptr<ImmutableMemTable> &queued : memTables) {
+                    if (!queued->flushed) {
+                        break;
+                    }
+                    ready.push_back(queued.get());
+                }
+                if (!ready.empty()) {
+                    // Rotations only append newer MemTables, so this stays a lower bound of the live logs
+                    edit.log_number = ready.size() < memTables.size()
+                                          ? first_log_number(*memTables[ready.size()]->memtable)
+                                          : first_log_number(*current_version()->active);
+                }
+            }
 
-            if (sstables.size() < MAX_SSTABLE_COUNT) {
-                return;
+            // Publishing holds manifest_mtx, so nothing else removes these entries from the queue meanwhile
+            for (ImmutableMemTable *job : ready) {
+                job->sstable->setSequence(++last_sequence);
+                edit.added.push_back(describe_table(*job->sstable, 0));
+            }
+            if (!ready.empty() && !log_edit(edit)) {
+                std::cerr << "Failed to record flushed tables in the manifest, retrying" << std::endl;
+                std::lock_guard<std::mutex> lock(memtables_mtx);
+                for (ImmutableMemTable *job : ready) {
+                    std::string base_name = job->sstable->getBaseName();
+                    job->sstable.reset();
+                    SS_Table::removeFiles(base_name);
+                    job->flushed = false;
+                    retry.push_back(job);
+                }
+                ready.clear();
             }
 
-            size_t tables_to_take = MAX_SSTABLE_COUNT;
+            if (!ready.empty()) {
+                std::lock_guard<std::mutex> lock(memtables_mtx);
+                std::lock_guard<std::mutex> sstables_lock(sstables_mtx);
+                for (size_t i = 0; i < ready.size(); ++i) {
+                    levels[0].push_back(std::move(memTables.front()->sstable));
+                    published.push_back(std::move(memTables.front()));
+                    memTables.pop_front();
+                }
+                immutable_memtables.store(memTables.size(), std::memory_order_relaxed);
+                l0_tables.store(levels[0].size(), std::memory_order_relaxed);
+                replaced = install_version();
+            }
 
-            for (size_t i = 0; i < tables_to_take && !sstables.empty(); ++i) {
-                tables_to_compact.push_back(std::move(sstables.front()));
-                sstables.erase(sstables.begin());
+            // Deleted under manifest_mtx, so logs go in number order however flushes interleave
+            for (const std::unique_ptr<ImmutableMemTable> &flushed : published) {
+                for (const std::string &log_file : flushed->memtable->getLogFiles()) {
+                    std::filesystem::remove(log_file);
+                }
             }
         }
 
-        if (tables_to_compact.empty()) {
+        if (!retry.empty()) {
+            {
+                std::unique_lock<std::mutex> lock(compaction_mtx);
+                compaction_cv.wait_for(lock, std::chrono::seconds(1), [this] { return !running; });
+            }
+            // At shutdown the MemTables stay queued, and their logs are replayed on the next start
+            if (running) {
+                for (ImmutableMemTable *job : retry) {
+                    flush_pool->schedule([this, job] { flush_memtable(job); });
+                }
+            }
+        }
+        if (published.empty()) {
             return;
         }
+        replaced.reset();
+        signal_write_stall_change();
+        wait_for_readers();
+        maybe_schedule_compaction();
+    }
 
-        std::sort(tables_to_compact.begin(), tables_to_compact.end(),
-                  [](const std::unique_ptr<SS_Table> &a, const std::unique_ptr<SS_Table> &b) {
-                      return a->getIndexFile() < b->getIndexFile();
-                  });
-        std::unique_ptr<MemTable> merged_memtable = std::make_unique<MemTable>();
-
-        std::map<std::string, std::string> merged_data;
-        for (std::unique_ptr<SS_Table> &sstable : tables_to_compact) {
-            std::ifstream data_file(sstable->getDataFilename(), std::ios::binary);
-            if (!data_file.is_open()) {
-                continue;
+    /**
+     * @brief Schedules compactions on the compaction pool while there is work and a free thread.
+     * @details Each compaction marks its inputs as compacting, and later picks skip those tables,
+     *          so compactions running at the same time never share a table or an overlapping range
+     *          of the level they write to.
+     */
+    void maybe_schedule_compaction() {
+        std::lock_guard<std::mutex> lock(sstables_mtx);
+        while (running && scheduled_compactions < compaction_pool->size()) {
+            Compaction compaction;
+            if (!pick_compaction(compaction)) {
+                break;
             }
-            while (!data_file.eof()) {
-                uint32_t key_size;
-                data_file.read(reinterpret_cast<char *>(&key_size), sizeof(key_size));
-                if (data_file.eof()) {
-                    break;
+            for (const SS_Table *sstable : compaction.inputs) {
+                compacting.insert(sstable);
+            }
+            scheduled_compactions++;
+            if (!compaction_pool->schedule([this, compaction] { run_compaction(compaction); })) {
+                for (const SS_Table *sstable : compaction.inputs) {
+                    compacting.erase(sstable);
                 }
+                scheduled_compactions--;
+                break;
+            }
+        }
+    }
 
-                std::string key(key_size, '\0');
-                data_file.read(&key[0], key_size);
+    /**
+     * @brief Runs a scheduled compaction on a compaction pool thread and schedules the next ones.
+     * @details A successful compaction releases its inputs as it replaces them. After a failure
+     *          the thread pauses for a second before releasing them, so a persistent error such as
+     *          a full disk does not turn into a busy loop.
+     * @param compaction The compaction picked by maybe_schedule_compaction().
+     */
+    void run_compaction(const Compaction &compaction) {
+        bool success = perform_compaction(compaction);
+        if (!success) {
+            std::unique_lock<std::mutex> lock(compaction_mtx);
+            compaction_cv.wait_for(lock, std::chrono::seconds(1), [this] { return !running; });
+        }
+        {
+            std::lock_guard<std::mutex> lock(sstables_mtx);
+            if (!success) {
+                for (const SS_Table *sstable : compaction.inputs) {
+                    compacting.erase(sstable);
+                }
+            }
+            scheduled_compactions--;
+        }
+        maybe_schedule_compaction();
+    }
 
-                uint32_t value_size;
-                data_file.read(reinterpret_cast<char *>(&value_size), sizeof(value_size));
+    /**
+     * @brief Target total data size of a level below L0.
+     * @param level The level, at least 1.
+     * @return double Target size in bytes.
+     */
+    double max_bytes_for_level(size_t level) const {
+        double bytes = static_cast<double>(options.max_bytes_for_level_base);
+        for (size_t i = 1; i < level; ++i) {
+            bytes *= options.level_size_multiplier;
+        }
+        return bytes;
+    }
 
-                std::string value(value_size, '\0');
-                data_file.read(&value[0], value_size);
-                if (merged_data.find(key) == merged_data.end()) {
-                    merged_data[key] = value;
+    /**
+     * @brief Checks whether any table below a level holds keys in [smallest, largest].
+     * @details Must be called with sstables_mtx held.
+     * @return True if the range is not present below the level, so tombstones for it can be dropped.
+     */
+    bool is_bottommost(size_t level, const std::string &smallest, const std::string &largest) const {
+        for (size_t deeper = level + 1; deeper < levels.size(); ++deeper) {
+            for (const std::shared_ptr<SS_Table> &sstable : levels[deeper]) {
+                if (sstable->overlaps(smallest, largest)) {
+                    return false;
                 }
             }
         }
+        return true;
+    }
 
-        for (std::pair<std::string, std::string> x : merged_data) {
-            if (x.second != TOMBSTONE) {
-                merged_memtable->put(x.first, x.second);
-            }
+    /**
+     * @brief Computes the key range covered by a set of tables.
+     */
+    static void key_range(const std::vector<SS_Table *> &tables, std::string &smallest, std::string &largest) {
+        smallest = tables.front()->getSmallestKey();
+        largest = tables.front()->getLargestKey();
+        for (const SS_Table *sstable : tables) {
+            smallest = std::min(smallest, sstable->getSmallestKey());
+            largest = std::max(largest, sstable->getLargestKey());
         }
+    }
 
-        std::chrono::system_clock::time_point now = std::chrono::system_clock::now();
-        long long timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
-                                  now.time_since_epoch())
-                                  .count();
-        std::string filename = SS_TABLE_PATH + "sstable_" + std::to_string(timestamp);
-        bool success = SS_Table::createFromMemTable(filename, merged_memtable.get());
+    /**
+     * @brief Completes a leveled compaction from the tables picked in its source level.
+     * @details Adds the tables of the next level that overlap them. Must be called with
+     *          sstables_mtx held.
+     * @return False if one of those tables is already being compacted.
+     */
+    bool add_overlapping_inputs(Compaction &compaction, const std::vector<SS_Table *> &upper) {
+        std::string smallest, largest;
+        key_range(upper, smallest, largest);
+        compaction.inputs.clear();
+        for (const std::shared_ptr<SS_Table> &sstable : levels[compaction.output_level]) {
+            if (sstable->overlaps(smallest, largest)) {
+                if (compacting.count(sstable.get()) != 0) {
+                    return false;
+                }
+                compaction.inputs.push_back(sstable.get());
+            }
+        }
+        compaction.inputs.insert(compaction.inputs.end(), upper.begin(), upper.end());
+        key_range(compaction.inputs, smallest, largest);
+        compaction.drop_tombstones = is_bottommost(compaction.output_level, smallest, largest);
+        return true;
+    }
 
-        if (success) {
-            for (auto &sstable : tables_to_compact) {
-                std::string index_file = sstable->getIndexFile();
-                std::string data_file = sstable->getDataFilename();
+    /**
+     * @brief Picks the next leveled compaction by score.
+     * @details L0 scores its table count against l0_compaction_trigger, and every other level the
+     *          size of its tables not already being compacted against its target. Levels with a
+     *          score of at least 1 are tried highest first. A level is compacted into the next one:
+     *          all of L0, or one table of a deeper level chosen round-robin by key, together with
+     *          just the tables of the next level that overlap it. Candidates that share a table
+     *          with a scheduled compaction are skipped. Must be called with sstables_mtx held.
+     * @param compaction Filled in with the inputs if a compaction is due.
+     * @return True if a compaction is due, otherwise false.
+     */
+    bool pick_leveled_compaction(Compaction &compaction) {
+        std::vector<std::pair<double, size_t>> scores;
+        for (size_t level = 0; level + 1 < levels.size(); ++level) {
+            double score;
+            if (level == 0) {
+                score = static_cast<double>(levels[0].size()) / options.l0_compaction_trigger;
+            } else {
+                uint64_t bytes = 0;
+                for (const std::shared_ptr<SS_Table> &sstable : levels[level]) {
+                    if (compacting.count(sstable.get()) == 0) {
+                        bytes += sstable->getFileSize();
+                    }
+                }
+                score = static_cast<double>(bytes) / max_bytes_for_level(level);
+            }
+            if (score >= 1) {
+                scores.push_back({score, level});
+            }
+        }
+        std::sort(scores.begin(), scores.end(), std::greater<std::pair<double, size_t>>());
 
-                sstable.reset();
+        for (const std::pair<double, size_t> &candidate : scores) {
+            size_t level = candidate.second;
+            compaction.level = level;
+            compaction.output_level = level + 1;
+            std::deque<std::shared_ptr<SS_Table>> &tables = levels[level];
 
-                std::filesystem::remove(index_file);
-                std::filesystem::remove(data_file);
+            if (level == 0) {
+                // L0 tables overlap each other, so they all move down together, one compaction at a time
+                std::vector<SS_Table *> upper;
+                bool busy = false;
+                for (const std::shared_ptr<SS_Table> &sstable : tables) {
+                    busy = busy || compacting.count(sstable.get()) != 0;
+                    upper.push_back(sstable.get());
+                }
+                if (!busy && add_overlapping_inputs(compaction, upper)) {
+                    return true;
+                }
+                continue;
             }
 
-            std::lock_guard<std::mutex> lock(sstables_mtx);
-            std::unique_ptr<SS_Table> new_sstable = std::make_unique<SS_Table>(filename);
-            sstables.push_back(std::move(new_sstable));
+            // Start after the last table compacted from this level and wrap around
+            const std::string &pointer = compact_pointers[level];
+            size_t start = 0;
+            while (start < tables.size() && tables[start]->getSmallestKey() <= pointer) {
+                ++start;
+            }
+            for (size_t i = 0; i < tables.size(); ++i) {
+                SS_Table *sstable = tables[(start + i) % tables.size()].get();
+                if (compacting.count(sstable) == 0 && add_overlapping_inputs(compaction, {sstable})) {
+                    return true;
+                }
+            }
         }
+        return false;
     }
 
     /**
-     * @brief Loads existing SSTables from disk at startup.
-     * @details Reads the directory containing SSTables, reconstructs indexes, and prepares the system.
+     * @brief Picks the next tiered compaction.
+     * @details Looks for tiered_min_merge_width or more adjacent L0 tables whose sizes are within
+     *          tiered_size_ratio of each other and that are not being compacted, preferring the
+     *          newest run. Only adjacent tables are merged, so the output can take their place
+     *          without reordering versions. Must be called with sstables_mtx held.
+     * @param compaction Filled in with the inputs if a compaction is due.
+     * @return True if a compaction is due, otherwise false.
      */
-    void load_existing_sstables() {
-        std::vector<std::string> files;
-        for (const std::filesystem::directory_entry &entry : std::filesystem::directory_iterator(SS_TABLE_PATH)) {
-            files.push_back(entry.path().string());
-        }
-        for (std::string const &file : files) {
-            if (file.find(INDEX_EXTENSION) != std::string::npos) {
-                std::string data_file = file.substr(0, file.find(INDEX_EXTENSION));
-                std::unique_ptr<SS_Table> sstable = std::make_unique<SS_Table>(file, data_file + DATA_EXTENSION);
-                if (sstable->loadIndex()) {
-                    sstables.push_back(std::move(sstable));
+    bool pick_tiered_compaction(Compaction &compaction) {
+        const std::deque<std::shared_ptr<SS_Table>> &tables = levels[0];
+        for (size_t end = tables.size(); end >= options.tiered_min_merge_width; --end) {
+            uint64_t smallest_size = UINT64_MAX;
+            uint64_t largest_size = 0;
+            size_t begin = end;
+            while (begin > 0 && compacting.count(tables[begin - 1].get()) == 0) {
+                uint64_t size = tables[begin - 1]->getFileSize();
+                if (std::max(largest_size, size) > std::min(smallest_size, size) * options.tiered_size_ratio) {
+                    break;
                 }
+                smallest_size = std::min(smallest_size, size);
+                largest_size = std::max(largest_size, size);
+                --begin;
+            }
+            if (end - begin < options.tiered_min_merge_width) {
+                continue;
+            }
+
+            compaction.level = 0;
+            compaction.output_level = 0;
+            compaction.inputs.clear();
+            for (size_t i = begin; i < end; ++i) {
+                compaction.inputs.push_back(tables[i].get());
             }
+            std::string smallest, largest;
+            key_range(compaction.inputs, smallest, largest);
+            compaction.drop_tombstones = begin == 0 && is_bottommost(0, smallest, largest);
+            return true;
         }
-        // sort sstables by filename based on the creation time the filenames are in the format data/sstable_timestamp.index and data/sstable_timestamp.data
-        std::sort(sstables.begin(), sstables.end(), [](const std::unique_ptr<SS_Table> &a, const std::unique_ptr<SS_Table> &b) {
-            return a->getIndexFile() < b->getIndexFile();
-        });
-        if (sstables.size() >= MAX_SSTABLE_COUNT) {
-            compaction_cv.notify_one();
+        return false;
+    }
+
+    /**
+     * @brief Picks the next compaction with the configured strategy.
+     * @details Must be called with sstables_mtx held.
+     * @param compaction Filled in with the inputs if a compaction is due.
+     * @return True if a compaction is due, otherwise false.
+     */
+    bool pick_compaction(Compaction &compaction) {
+        if (options.compaction_style == CompactionStyle::TIERED) {
+            return pick_tiered_compaction(compaction);
         }
+        return pick_leveled_compaction(compaction);
     }
 
-public:
     /**
-     * @brief Constructs an LSMTree instance and initializes background worker threads.
+     * @brief Chooses the keys at which a leveled compaction is split into subcompactions.
+     * @details Samples keys from every input's sparse index, more from larger inputs, and takes
+     *          evenly spaced ones, so each range holds about the same amount of data.
+     * @return std::vector<std::string> Sorted split keys; empty if the compaction is not split.
      */
-    LSMTree()
-        : SS_TABLE_PATH(DATA_DIR),
-          running(true) {
-        std::filesystem::create_directories(SS_TABLE_PATH);
+    std::vector<std::string> subcompaction_boundaries(const Compaction &compaction) const {
+        uint64_t total_bytes = 0;
+        for (const SS_Table *sstable : compaction.inputs) {
+            total_bytes += sstable->getFileSize();
+        }
+        size_t ranges = static_cast<size_t>(std::min<uint64_t>(options.max_subcompactions, total_bytes / options.target_sstable_size));
+        if (compaction.output_level == 0 || ranges < 2) {
+            return {};
+        }
 
-        flush_thread = std::thread(&LSMTree::flush_worker, this);
-        compaction_thread = std::thread(&LSMTree::compaction_worker, this);
-        activeMemTable = std::make_unique<MemTable>();
+        const size_t SAMPLES = 64 * ranges;
+        std::vector<std::string> samples;
+        for (const SS_Table *sstable : compaction.inputs) {
+            std::vector<std::string> keys = sstable->sampleKeys(1 + SAMPLES * sstable->getFileSize() / total_bytes);
+            std::move(keys.begin(), keys.end(), std::back_inserter(samples));
+        }
+        std::sort(samples.begin(), samples.end());
+        samples.erase(std::unique(samples.begin(), samples.end()), samples.end());
+        if (samples.size() < ranges) {
+            return {};
+        }
 
-        load_existing_sstables();
+        // Splitting just after a sampled key keeps the outputs' key ranges exact where range tombstones are cut
+        std::vector<std::string> boundaries;
+        for (size_t i = 1; i < ranges; ++i) {
+            std::string key = samples[i * samples.size() / ranges] + '\0';
+            if (boundaries.empty() || boundaries.back() < key) {
+                boundaries.push_back(std::move(key));
+            }
+        }
+        return boundaries;
     }
 
     /**
-     * @brief Destructor that gracefully shuts down the LSMTree, ensuring all background tasks complete.
+     * @brief Merges the inputs' records in [start, end) into new output tables.
+     * @details A heap-based k-way merge over sequential table iterators that streams the result
+     *          into new tables. Leveled outputs are split at target_sstable_size so that later
+     *          compactions rewrite only the overlapping part of a level; a tiered compaction
+     *          writes one table. Memory use is one read buffer per input plus the output's Bloom
+     *          filter hashes, independent of the size of the data.
+     *
+     *          Inputs are ranked oldest first, newest highest; for a key present in several inputs
+     *          the version from the highest-ranked input wins. Tombstones, and expired values, are
+     *          dropped only when no table below the output can still hold an older version of the key;
+     *          otherwise expired values are written as tombstones.
+     *
+     *          A record covered by a range tombstone of a higher-ranked input is dropped. The inputs'
+     *          range tombstones are written, clipped to the range, to the output tables unless tombstones
+     *          are dropped; a leveled output is cut just after its last key, so its key range stays exact
+     *          and disjoint from the next one's.
+     * @param compaction The compaction to run.
+     * @param start First key of the range, or nullptr to start at the smallest key.
+     * @param end Key the range stops before, or nullptr to run to the largest key.
+     * @param outputs Receives the base filenames of the finished output tables.
+     * @return True if every output was written, otherwise false.
      */
-    ~LSMTree() {
-        running = false;
-        cv.notify_all();
-        compaction_cv.notify_all();
+    bool merge_range(const Compaction &compaction, const std::string *start, const std::string *end,
+                     std::vector<std::string> &outputs) {
+        const std::vector<SS_Table *> &inputs = compaction.inputs;
+        bool leveled = compaction.output_level > 0;
+
+        struct MergeEntry {
+            SS_Table::Iterator *iterator;
+            size_t rank;
+        };
+        auto later = [](const MergeEntry &a, const MergeEntry &b) {
+            int cmp = a.iterator->key().compare(b.iterator->key());
+            if (cmp != 0) {
+                return cmp > 0;
+            }
+            return a.rank < b.rank;
+        };
+
+        std::vector<SS_Table::Iterator> iterators;
+        iterators.reserve(inputs.size());
+        std::vector<MergeEntry> heap;
+        for (size_t rank = 0; rank < inputs.size(); ++rank) {
+            iterators.push_back(start != nullptr ? inputs[rank]->iterator(*start) : inputs[rank]->iterator());
+        }
+        for (size_t rank = 0; rank < inputs.size(); ++rank) {
+            if (iterators[rank].isValid()) {
+                heap.push_back({&iterators[rank], rank});
+            }
+        }
+        std::make_heap(heap.begin(), heap.end(), later);
+
+        bool range_deleted = false;
+        std::vector<RangeTombstone> range_tombstones;
+        for (const SS_Table *sstable : inputs) {
+            const std::vector<RangeTombstone> &tombstones = sstable->getRangeTombstones();
+            range_deleted = range_deleted || !tombstones.empty();
+            if (!compaction.drop_tombstones) {
+                range_tombstones.insert(range_tombstones.end(), tombstones.begin(), tombstones.end());
+            }
+        }
+        RangeDeletion::normalize(range_tombstones);
+        range_tombstones = RangeDeletion::clip(range_tombstones, start, end);
+        size_t next_tombstone = 0;
+        std::string lower = start != nullptr ? *start : std::string();
+
+        // A tiered output sorts between the newest input and every newer table, so load order stays correct
+        const std::string &output_base = inputs.back()->getBaseName();
+        std::unique_ptr<SSTableBuilder> builder;
+        bool success = true;
+
+        auto open_output = [&]() {
+            if (leveled) {
+                outputs.push_back(new_table_name(compaction.output_level));
+            } else {
+                char suffix[16];
+                std::snprintf(suffix, sizeof(suffix), "_%05zu", outputs.size());
+                outputs.push_back(output_base + suffix);
+            }
+            // Output with nothing older below it holds the bulk of the data, so it gets the stronger codec
+            builder = std::make_unique<SSTableBuilder>(outputs.back(), options,
+                                                       compaction.drop_tombstones ? options.bottommost_compression : options.compression);
+        };
+        // Gives the open output the unwritten range tombstones below upper, and the rest to the next output
+        auto add_range_tombstones = [&](const std::string *upper) {
+            while (next_tombstone < range_tombstones.size() &&
+                   (upper == nullptr || range_tombstones[next_tombstone].start < *upper)) {
+                const RangeTombstone &tombstone = range_tombstones[next_tombstone];
+                std::string part_start = std::max(tombstone.start, lower);
+                if (upper != nullptr && tombstone.end > *upper) {
+                    if (part_start < *upper) {
+                        builder->addRangeTombstone(part_start, *upper);
+                    }
+                    break;
+                }
+                if (part_start < tombstone.end) {
+                    builder->addRangeTombstone(part_start, tombstone.end);
+                }
+                ++next_tombstone;
+            }
+            if (upper != nullptr) {
+                lower = *upper;
+            }
+        };
+
+        std::string key;
+        uint64_t now = Expiry::nowMillis();
+        while (!heap.empty() && success && running) {
+            std::pop_heap(heap.begin(), heap.end(), later);
+            MergeEntry newest = heap.back();
+            if (end != nullptr && newest.iterator->key() >= *end) {
+                break;
+            }
+            key.assign(newest.iterator->key());
+
+            // An expired value is written as a tombstone, or dropped where tombstones are
+            std::string_view value = newest.iterator->value();
+            if (Expiry::isExpired(value, now)) {
+                value = TOMBSTONE;
+            }
+            bool covered = false;
+            for (size_t rank = newest.rank + 1; range_deleted && !covered && rank < inputs.size(); ++rank) {
+                covered = inputs[rank]->deletesKey(key);
+            }
+            if (!covered && (!compaction.drop_tombstones || value != TOMBSTONE)) {
+                if (builder == nullptr) {
+                    open_output();
+                }
+                builder->add(key, value);
+                if (!builder->ok()) {
+                    success = false;
+                } else if (leveled && builder->fileSize() >= options.target_sstable_size) {
+                    std::string cut = key + '\0';
+                    add_range_tombstones(&cut);
+                    success = builder->finish();
+                    builder.reset();
+                }
+            }
 
-        if (flush_thread.joinable()) {
-            flush_thread.join();
+            // Advance the winner and every older version of the same key
+            heap.pop_back();
+            newest.iterator->next();
+            if (newest.iterator->isValid()) {
+                heap.push_back(newest);
+                std::push_heap(heap.begin(), heap.end(), later);
+            }
+            while (!heap.empty() && heap.front().iterator->key() == key) {
+                std::pop_heap(heap.begin(), heap.end(), later);
+                MergeEntry older = heap.back();
+                heap.pop_back();
+                older.iterator->next();
+                if (older.iterator->isValid()) {
+                    heap.push_back(older);
+                    std::push_heap(heap.begin(), heap.end(), later);
+                }
+            }
         }
-        if (compaction_thread.joinable()) {
-            compaction_thread.join();
+        if (!running) {
+            // Shutting down: the inputs are intact, so the partial output is simply discarded
+            success = false;
+        } else if (success) {
+            if (builder == nullptr && next_tombstone < range_tombstones.size()) {
+                open_output();
+            }
+            if (builder != nullptr) {
+                add_range_tombstones(nullptr);
+                success = builder->finish();
+            }
         }
+        return success;
     }
 
     /**
-     * @brief Inserts a key-value pair into the LSM Tree.
-     * @param key The key to insert.
-     * @param value The associated value.
+     * @brief Performs one SSTable compaction.
+     * @details A leveled compaction with enough input is split by key into up to
+     *          max_subcompactions ranges, merged in parallel into disjoint output tables: the
+     *          first on the compaction's thread, the others on the subcompaction pool.
+     *          The inputs stay readable until the outputs replace them.
+     *
+     *          The outputs replace the inputs in one manifest edit, logged before the levels change,
+     *          so a crash at any point leaves exactly one of the two sets live; the files of the
+     *          other are deleted on the next start. The inputs' files are deleted once no reader
+     *          still holds a version listing them.
+     * @param compaction The compaction to run; its inputs are marked as compacting.
+     * @return True if the compaction succeeded, otherwise false.
      */
-    void put(const std::string &key, const std::string &value) {
+    bool perform_compaction(const Compaction &compaction) {
+        auto compaction_start = std::chrono::steady_clock::now();
+        const std::vector<SS_Table *> &inputs = compaction.inputs;
+        bool leveled = compaction.output_level > 0;
+
+        std::vector<std::string> boundaries = subcompaction_boundaries(compaction);
+        size_t ranges = boundaries.size() + 1;
+        std::vector<std::vector<std::string>> range_outputs(ranges);
+        std::vector<char> range_success(ranges, 0);
+        auto run_range = [&](size_t i) {
+            const std::string *start = i > 0 ? &boundaries[i - 1] : nullptr;
+            const std::string *end = i + 1 < ranges ? &boundaries[i] : nullptr;
+            try {
+                range_success[i] = merge_range(compaction, start, end, range_outputs[i]);
+            } catch (const std::exception &e) {
+                std::cerr << "Subcompaction failed: " << e.what() << std::endl;
+            }
+        };
+        std::vector<std::future<void>> subcompactions;
+        for (size_t i = 1; i < ranges; ++i) {
+            subcompactions.push_back(subcompaction_pool->submit([&run_range, i] { run_range(i); }));
+        }
+        run_range(0);
+        // Every range must finish before its outputs are read or run_range goes out of scope
+        for (std::future<void> &subcompaction : subcompactions) {
+            subcompaction.wait();
+        }
+
+        std::vector<std::string> outputs;
+        bool success = true;
+        for (size_t i = 0; i < ranges; ++i) {
+            success = success && range_success[i];
+            outputs.insert(outputs.end(), range_outputs[i].begin(), range_outputs[i].end());
+        }
+
+        std::vector<std::shared_ptr<SS_Table>> output_tables;
+        uint64_t bytes_written = 0;
+        for (const std::string &output : outputs) {
+            if (!success) {
+                break;
+            }
+            output_tables.push_back(std::make_shared<SS_Table>(output, block_cache.get(), options));
+            success = output_tables.back()->isLoaded();
+            bytes_written += output_tables.back()->getFileSize();
+        }
+
+        if (!success) {
+            if (running) {
+                std::cerr << "Compaction failed, keeping the input tables" << std::endl;
+            }
+            output_tables.clear();
+            for (const std::string &output : outputs) {
+                SS_Table::removeFiles(output);
+            }
+            return false;
+        }
+
+        std::vector<std::shared_ptr<SS_Table>> compacted;
+        std::shared_ptr<const Version> replaced;
         {
-            std::lock_guard<std::mutex> lock(active_memtable_mtx);
-            activeMemTable->put(key, value);
-            if (activeMemTable->getSize() >= MAX_MEMTABLE_SIZE) {
-                rotate_memtable();
+            std::lock_guard<std::mutex> manifest_lock(manifest_mtx);
+            // A tiered output takes the place of its inputs in L0, so it takes the newest input's position in write order
+            uint64_t sequence = inputs.back()->getSequence();
+            VersionEdit edit;
+            for (const SS_Table *sstable : inputs) {
+                sequence = leveled ? std::max(sequence, sstable->getSequence()) : sequence;
+                edit.removed.push_back(std::filesystem::path(sstable->getBaseName()).filename().string());
+            }
+            for (std::shared_ptr<SS_Table> &sstable : output_tables) {
+                sstable->setSequence(sequence);
+                edit.added.push_back(describe_table(*sstable, compaction.output_level));
+            }
+            if (!log_edit(edit)) {
+                std::cerr << "Failed to record compaction in the manifest, keeping the input tables" << std::endl;
+                output_tables.clear();
+                for (const std::string &output : outputs) {
+                    SS_Table::removeFiles(output);
+                }
+                return false;
+            }
+
+            std::lock_guard<std::mutex> memtables_lock(memtables_mtx);
+            std::lock_guard<std::mutex> lock(sstables_mtx);
+            // Flushes only append and compactions only touch their own tables, so the inputs are still in place
+            std::deque<std::shared_ptr<SS_Table>> &output_level = levels[compaction.output_level];
+            size_t position = 0;
+            if (!leveled) {
+                while (output_level[position].get() != inputs.front()) {
+                    ++position;
+                }
+            }
+            for (size_t level : {compaction.level, compaction.output_level}) {
+                std::deque<std::shared_ptr<SS_Table>> &tables = levels[level];
+                for (auto it = tables.begin(); it != tables.end();) {
+                    if (std::find(inputs.begin(), inputs.end(), it->get()) != inputs.end()) {
+                        compacting.erase(it->get());
+                        (*it)->markObsolete();
+                        compacted.push_back(std::move(*it));
+                        it = tables.erase(it);
+                    } else {
+                        ++it;
+                    }
+                }
+            }
+
+            if (leveled) {
+                for (std::shared_ptr<SS_Table> &sstable : output_tables) {
+                    output_level.push_back(std::move(sstable));
+                }
+                std::sort(output_level.begin(), output_level.end(),
+                          [](const std::shared_ptr<SS_Table> &a, const std::shared_ptr<SS_Table> &b) {
+                              return a->getSmallestKey() < b->getSmallestKey();
+                          });
+                if (compaction.level > 0) {
+                    compact_pointers[compaction.level] = inputs.back()->getLargestKey();
+                }
+            } else {
+                output_level.insert(output_level.begin() + position,
+                                    std::make_move_iterator(output_tables.begin()),
+                                    std::make_move_iterator(output_tables.end()));
             }
+            l0_tables.store(levels[0].size(), std::memory_order_relaxed);
+            replaced = install_version();
+        }
+        signal_write_stall_change();
+
+        uint64_t bytes_read = 0;
+        for (const std::shared_ptr<SS_Table> &sstable : compacted) {
+            bytes_read += sstable->getFileSize();
         }
+        Metrics::add(Counter::COMPACTION_BYTES_READ, bytes_read);
+        Metrics::add(Counter::COMPACTION_BYTES_WRITTEN, bytes_written);
+        Metrics::record(Timer::COMPACTION, Metrics::microsSince(compaction_start));
+        return true;
     }
 
     /**
-     * @brief Retrieves the value associated with a given key.
-     * @param key The key to search for.
-     * @return A pair containing a boolean indicating success and the associated value.
+     * @brief Looks a key up in one SSTable, consulting its Bloom filter first.
+     * @param sstable The table to search.
+     * @param key The key to look up.
+     * @param fill_cache Whether a block read from disk should be added to the block cache.
+     * @param result Set to the table's answer when it settles the lookup.
+     * @return True if the table holds the key or a tombstone for it, or one of its range tombstones
+     *         covers it, so older tables need not be searched.
      */
-    std::pair<bool, std::string> get(const std::string &key) {
-        {
-            std::lock_guard<std::mutex> lock(active_memtable_mtx);
-            std::pair<bool, std::string> result = activeMemTable->get(key);
-            if (result.first) {
-                return result;
-            } else if (!result.first && result.second == TOMBSTONE) {
-                return {false, result.second};
+    bool probe_sstable(const SS_Table &sstable, std::string_view key, bool fill_cache, std::pair<bool, std::string> &result) {
+        bool filtered = sstable.hasFilter();
+        if (filtered) {
+            filter_checked.fetch_add(1, std::memory_order_relaxed);
+            if (!sstable.mayContain(key)) {
+                filter_useful.fetch_add(1, std::memory_order_relaxed);
+                if (sstable.deletesKey(key)) {
+                    result = {false, TOMBSTONE};
+                    return true;
+                }
+                return false;
             }
         }
+        result = sstable.getValue(key, fill_cache);
+        if (result.first || result.second == TOMBSTONE) {
+            return true;
+        }
+        if (filtered) {
+            filter_false_positive.fetch_add(1, std::memory_order_relaxed);
+        }
+        return false;
+    }
 
-        {
-            std::lock_guard<std::mutex> lock(memtables_mtx);
-            for (std::reverse_iterator it = memTables.rbegin(); it != memTables.rend(); ++it) {
-                std::pair<bool, std::string> result = (*it)->get(key);
-                if (result.first) {
-                    return result;
-                } else if (!result.first && result.second == TOMBSTONE) {
-                    return {false, result.second};
+    /**
+     * @brief Looks several keys up in one SSTable, consulting its Bloom filter for each first.
+     * @details The keys the filter lets through are read together, so keys sharing a block cost
+     *          one read. Keys the table settles are removed from pending.
+     * @param sstable The table to search.
+     * @param keys All keys of the lookup, in ascending order.
+     * @param pending Positions in keys still unsettled that may be in the table, in ascending order.
+     * @param fill_cache Whether blocks read from disk should be added to the block cache.
+     * @param results Receives the table's answer for each key it settles.
+     */
+    void probe_sstable_batch(const SS_Table &sstable, const std::vector<std::string_view> &keys, std::vector<size_t> &pending,
+                             bool fill_cache, std::vector<std::pair<bool, std::string>> &results) {
+        bool filtered = sstable.hasFilter();
+        std::vector<size_t> candidates;
+        std::vector<std::string_view> candidate_keys;
+        std::vector<size_t> settled;
+        for (size_t position : pending) {
+            if (filtered) {
+                filter_checked.fetch_add(1, std::memory_order_relaxed);
+                if (!sstable.mayContain(keys[position])) {
+                    filter_useful.fetch_add(1, std::memory_order_relaxed);
+                    if (sstable.deletesKey(keys[position])) {
+                        results[position] = {false, TOMBSTONE};
+                        settled.push_back(position);
+                    }
+                    continue;
                 }
             }
+            candidates.push_back(position);
+            candidate_keys.push_back(keys[position]);
         }
 
-        {
-            std::lock_guard<std::mutex> lock(sstables_mtx);
-            for (std::reverse_iterator it = sstables.rbegin(); it != sstables.rend(); ++it) {
-                std::pair<bool, std::string> result = (*it)->getValue(key);
-                if (result.first) {
-                    return result;
-                } else if (!result.first && result.second == TOMBSTONE) {
-                    return {false, result.second};
-                }
+        std::vector<std::pair<bool, std::string>> found(candidates.size());
+        if (!candidates.empty()) {
+            sstable.getValues(candidate_keys.data(), found.data(), found.size(), fill_cache);
+        }
+        size_t filtered_out = settled.size();
+        for (size_t i = 0; i < candidates.size(); ++i) {
+            if (found[i].first || found[i].second == TOMBSTONE) {
+                results[candidates[i]] = std::move(found[i]);
+                settled.push_back(candidates[i]);
+            } else if (filtered) {
+                filter_false_positive.fetch_add(1, std::memory_order_relaxed);
             }
         }
-        return {false, ""};
+        if (!settled.empty()) {
+            std::inplace_merge(settled.begin(), settled.begin() + filtered_out, settled.end());
+            std::vector<size_t> remaining;
+            std::set_difference(pending.begin(), pending.end(), settled.begin(), settled.end(), std::back_inserter(remaining));
+            pending.swap(remaining);
+        }
     }
 
     /**
-     * @brief Marks a key as deleted by inserting a tombstone value.
-     * @param key The key to remove.
+     * @brief Replays the write-ahead logs left by the previous run and opens a new one.
+     * @details Logs numbered below the manifest's log number were flushed before a crash cut
+     *          their deletion short, and are deleted unread. Every other log belongs to a MemTable
+     *          that never reached disk. They are replayed oldest first into the active MemTable,
+     *          which takes ownership of them and deletes them together with its own log once it
+     *          is flushed. Must run after the manifest is recovered.
      */
-    void remove(const std::string &key) {
-        std::lock_guard<std::mutex> lock(active_memtable_mtx);
-        activeMemTable->put(key, TOMBSTONE);
+    void recover_from_wal() {
+        uint64_t max_number = 0;
+        std::vector<std::string> logs = WriteAheadLog::listLogs(SS_TABLE_PATH, max_number);
+        MemTable *memtable = activeMemTable.load();
+        for (const std::string &log_file : logs) {
+            uint64_t number = 0;
+            if (WriteAheadLog::parseLogNumber(log_file, number) && number < manifest->getLogNumber()) {
+                std::filesystem::remove(log_file);
+                continue;
+            }
+            WriteAheadLog::replay(
+                log_file,
+                [this, memtable](std::string_view key, std::string_view value) {
+                    memtable->put(key, value, ++write_sequence);
+                },
+                [this, memtable](std::string_view start, std::string_view end) {
+                    memtable->removeRange(start, end, ++write_sequence);
+                });
+            memtable->addLogFile(log_file);
+        }
+
+        wal = std::make_unique<WriteAheadLog>(SS_TABLE_PATH, max_number + 1, options.wal_sync_mode, options.wal_sync_interval_ms);
+        memtable->addLogFile(wal->getFilename());
+    }
+
+    /**
+     * @brief Describes a table as the manifest records it.
+     * @param sstable The table.
+     * @param level The level it belongs to.
+     */
+    static TableMeta describe_table(const SS_Table &sstable, size_t level) {
+        TableMeta meta;
+        meta.level = static_cast<uint32_t>(level);
+        meta.sequence = sstable.getSequence();
+        meta.name = std::filesystem::path(sstable.getBaseName()).filename().string();
+        meta.smallest = sstable.getSmallestKey();
+        meta.largest = sstable.getLargestKey();
+        meta.file_size = sstable.getFileSize();
+        return meta;
+    }
+
+    /**
+     * @brief Describes every table in the levels.
+     * @details Must be called with manifest_mtx held, so the levels match the manifest.
+     */
+    std::vector<TableMeta> live_tables() {
+        std::lock_guard<std::mutex> lock(sstables_mtx);
+        std::vector<TableMeta> tables;
+        for (size_t level = 0; level < levels.size(); ++level) {
+            for (const std::shared_ptr<SS_Table> &sstable : levels[level]) {
+                tables.push_back(describe_table(*sstable, level));
+            }
+        }
+        return tables;
+    }
+
+    /**
+     * @brief Makes an edit durable in the manifest.
+     * @details Starts a new manifest from a snapshot of the current levels first when the log has
+     *          grown too large or a previous write failed. The edit must be applied to the levels
+     *          only if this succeeds. Must be called with manifest_mtx held.
+     * @param edit The tables added and removed; the file and sequence counters are filled in.
+     * @return True if the edit was logged, otherwise false.
+     */
+    bool log_edit(VersionEdit &edit) {
+        edit.next_file_number = last_file_number.load() + 1;
+        edit.last_sequence = last_sequence;
+        if (manifest->needsSnapshot() && !manifest->writeSnapshot(live_tables(), last_file_number.load() + 1, last_sequence)) {
+            return false;
+        }
+        return manifest->logEdit(edit);
+    }
+
+    /**
+     * @brief Rebuilds the levels from the manifest at startup.
+     * @details Tables are opened lazily: their key ranges and sizes come from the manifest, and
+     *          their files are read when a lookup or compaction first reaches them. Table files
+     *          the manifest does not list are left over from a flush or compaction interrupted
+     *          before its edit was logged, or from compaction inputs not yet deleted, and are removed.
+     * @return True if a manifest was replayed, false if there is none or it cannot be read.
+     */
+    bool load_manifest() {
+        std::vector<TableMeta> tables;
+        uint64_t next_file_number = 0;
+        if (!manifest->exists()) {
+            return false;
+        }
+        if (!manifest->recover(tables, next_file_number, last_sequence)) {
+            std::cerr << "Rebuilding the table catalog from the files in " << SS_TABLE_PATH << std::endl;
+            return false;
+        }
+
+        std::unordered_set<std::string> live;
+        for (const TableMeta &meta : tables) {
+            live.insert(meta.name);
+            std::shared_ptr<SS_Table> sstable = std::make_shared<SS_Table>(SS_TABLE_PATH + meta.name, meta.smallest, meta.largest,
+                                                                           meta.file_size, block_cache.get(), options);
+            sstable->setSequence(meta.sequence);
+            levels[std::min<size_t>(meta.level, options.num_levels - 1)].push_back(std::move(sstable));
+        }
+        if (next_file_number > 0) {
+            last_file_number = std::max(last_file_number.load(), next_file_number - 1);
+        }
+
+        for (const std::filesystem::directory_entry &entry : std::filesystem::directory_iterator(SS_TABLE_PATH)) {
+            std::string name = entry.path().filename().string();
+            std::string extension = entry.path().extension().string();
+            if (name.compare(0, 8, "sstable_") != 0 ||
+                (extension != SST_EXTENSION && extension != INDEX_EXTENSION && extension != DATA_EXTENSION && extension != FILTER_EXTENSION)) {
+                continue;
+            }
+            std::string base_name = name.substr(0, name.size() - extension.size());
+            if (live.count(base_name) == 0) {
+                std::filesystem::remove(entry.path());
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Loads the SSTables found in the data directory, for a directory without a usable manifest.
+     * @details Used once to adopt data written before the manifest existed. Each table goes back to
+     *          the level in its filename and gets a sequence number in file number order, which
+     *          is creation order.
+     */
+    void load_existing_sstables() {
+        std::vector<std::shared_ptr<SS_Table>> found;
+        std::vector<size_t> found_levels;
+        std::vector<uint64_t> found_numbers;
+        for (const std::filesystem::directory_entry &entry : std::filesystem::directory_iterator(SS_TABLE_PATH)) {
+            // Block-based tables are single .sst files; legacy tables are found by their index file
+            std::string file = entry.path().string();
+            std::string extension = entry.path().extension().string();
+            if (extension == SST_EXTENSION || extension == INDEX_EXTENSION) {
+                std::string base_name = file.substr(0, file.size() - extension.size());
+                if (extension == INDEX_EXTENSION && std::filesystem::exists(base_name + SST_EXTENSION)) {
+                    continue;
+                }
+                std::string name = std::filesystem::path(base_name).filename().string();
+                size_t level = 0;
+                size_t level_pos = name.rfind("_L");
+                if (level_pos != std::string::npos) {
+                    level = std::min<size_t>(std::strtoull(name.c_str() + level_pos + 2, nullptr, 10), options.num_levels - 1);
+                }
+                uint64_t number = 0;
+                size_t number_pos = name.find('_');
+                if (number_pos != std::string::npos) {
+                    number = std::strtoull(name.c_str() + number_pos + 1, nullptr, 10);
+                    last_file_number = std::max<uint64_t>(last_file_number.load(), number);
+                }
+
+                std::shared_ptr<SS_Table> sstable = std::make_shared<SS_Table>(base_name, block_cache.get(), options);
+                if (sstable->isLoaded()) {
+                    found.push_back(std::move(sstable));
+                    found_levels.push_back(level);
+                    found_numbers.push_back(number);
+                }
+            }
+        }
+
+        std::vector<size_t> order(found.size());
+        for (size_t i = 0; i < order.size(); ++i) {
+            order[i] = i;
+        }
+        // Numbers are not padded, so sorting by name would put sstable_10 ahead of sstable_9
+        std::sort(order.begin(), order.end(), [&found, &found_numbers](size_t a, size_t b) {
+            if (found_numbers[a] != found_numbers[b]) {
+                return found_numbers[a] < found_numbers[b];
+            }
+            return found[a]->getBaseName() < found[b]->getBaseName();
+        });
+        for (size_t i : order) {
+            found[i]->setSequence(++last_sequence);
+            levels[found_levels[i]].push_back(std::move(found[i]));
+        }
+    }
+
+    /**
+     * @brief Sorts the levels after loading and repairs any overlap below L0.
+     * @details L0 is ordered by sequence number and deeper levels by key. Overlapping tables in a
+     *          level can come from a directory scan after a crash part way through a compaction, or
+     *          from reducing NUM_LEVELS. That level and every level above it are then moved into L0,
+     *          below the flushed tables and deepest level first, which keeps newer versions in front
+     *          of older ones until compaction rewrites them.
+     */
+    void arrange_levels() {
+        auto by_sequence = [](const std::shared_ptr<SS_Table> &a, const std::shared_ptr<SS_Table> &b) {
+            return a->getSequence() < b->getSequence();
+        };
+        auto by_key = [](const std::shared_ptr<SS_Table> &a, const std::shared_ptr<SS_Table> &b) {
+            return a->getSmallestKey() < b->getSmallestKey();
+        };
+        std::sort(levels[0].begin(), levels[0].end(), by_sequence);
+        size_t overlapping = 0;
+        for (size_t level = 1; level < levels.size(); ++level) {
+            std::sort(levels[level].begin(), levels[level].end(), by_key);
+            for (size_t i = 1; i < levels[level].size(); ++i) {
+                if (levels[level][i - 1]->getLargestKey() >= levels[level][i]->getSmallestKey()) {
+                    overlapping = level;
+                }
+            }
+        }
+
+        if (overlapping > 0) {
+            std::cerr << "Found overlapping tables in L" << overlapping << ", moving L1-L" << overlapping << " back to L0" << std::endl;
+            std::deque<std::shared_ptr<SS_Table>> level0;
+            for (size_t level = overlapping; level >= 1; --level) {
+                std::sort(levels[level].begin(), levels[level].end(), by_sequence);
+                std::move(levels[level].begin(), levels[level].end(), std::back_inserter(level0));
+                levels[level].clear();
+            }
+            std::move(levels[0].begin(), levels[0].end(), std::back_inserter(level0));
+            levels[0] = std::move(level0);
+        }
+        l0_tables.store(levels[0].size(), std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Restores the levels at startup and starts a fresh manifest describing them.
+     * @details A failure to write the manifest is fatal: no flush could be published without it.
+     */
+    void recover_tables() {
+        manifest = std::make_unique<Manifest>(SS_TABLE_PATH);
+        if (!load_manifest()) {
+            load_existing_sstables();
+        }
+        arrange_levels();
+
+        std::lock_guard<std::mutex> lock(manifest_mtx);
+        if (!manifest->writeSnapshot(live_tables(), last_file_number.load() + 1, last_sequence)) {
+            throw std::runtime_error("Failed to write the manifest in " + SS_TABLE_PATH);
+        }
+    }
+
+    /**
+     * @brief Checks settings before the tree is built from them.
+     * @throws std::invalid_argument if the options are out of range.
+     */
+    static const Options &validated(const Options &options) {
+        options.validate();
+        return options;
+    }
+
+    /**
+     * @brief Gets default settings with the data directory replaced.
+     */
+    static Options with_directory(const std::string &directory) {
+        Options options;
+        options.data_dir = directory;
+        return options;
+    }
+
+public:
+    /**
+     * @brief Creates the block cache a tree uses when none is passed to its constructor.
+     * @param options Settings giving the cache's capacity.
+     * @return std::shared_ptr<BlockCache> A cache of block_cache_capacity bytes, or null if the cache is disabled.
+     */
+    static std::shared_ptr<BlockCache> newBlockCache(const Options &options = Options()) {
+        return options.block_cache_capacity > 0 ? std::make_shared<BlockCache>(options.block_cache_capacity) : nullptr;
+    }
+
+    /**
+     * @brief Constructs an LSMTree instance in DATA_DIR and initializes background worker threads.
+     */
+    BasicLSMTree() : BasicLSMTree(Options(), newBlockCache()) {}
+
+    /**
+     * @brief Constructs an LSMTree instance in a directory and initializes background worker threads.
+     * @param directory Directory holding the tree's files, ending in '/'; created if missing.
+     * @param block_cache Block cache for the tree's SSTables, or null to disable caching. Trees may share
+     *                    one cache, since blocks are keyed by process-wide table ids.
+     */
+    BasicLSMTree(const std::string &directory, std::shared_ptr<BlockCache> block_cache)
+        : BasicLSMTree(with_directory(directory), std::move(block_cache)) {}
+
+    /**
+     * @brief Constructs an LSMTree instance with the given settings and initializes background worker threads.
+     * @param options Settings of the tree; its files live in options.data_dir, created if missing.
+     * @param block_cache Block cache for the tree's SSTables, or null to disable caching. Trees may share
+     *                    one cache, since blocks are keyed by process-wide table ids.
+     * @throws std::invalid_argument if the options are out of range.
+     */
+    BasicLSMTree(const Options &options, std::shared_ptr<BlockCache> block_cache)
+        : options(validated(options)),
+          SS_TABLE_PATH(options.data_dir),
+          activeMemTable(nullptr),
+          levels(options.num_levels),
+          compact_pointers(options.num_levels),
+          scheduled_compactions(0),
+          block_cache(std::move(block_cache)),
+          last_sequence(0),
+          write_sequence(0),
+          running(true),
+          last_file_number(0),
+          read_epoch(0),
+          active_readers{0, 0},
+          filter_checked(0),
+          filter_useful(0),
+          filter_false_positive(0),
+          immutable_memtables(0),
+          l0_tables(0),
+          stall_slowdowns(0),
+          stall_stops(0),
+          stall_micros(0) {
+        std::filesystem::create_directories(SS_TABLE_PATH);
+        std::shared_ptr<Version> initial = std::make_shared<Version>();
+        initial->active = std::make_shared<MemTable>(options);
+        activeMemTable.store(initial->active.get());
+        current = std::move(initial);
+        // Tables must be loaded into their levels before any compaction can look at them, and the
+        // manifest read before the logs, since it says which of them are already flushed
+        recover_tables();
+        recover_from_wal();
+        {
+            std::lock_guard<std::mutex> memtables_lock(memtables_mtx);
+            std::lock_guard<std::mutex> lock(sstables_mtx);
+            install_version();
+        }
+
+        flush_pool = std::make_unique<ThreadPool>(options.flush_threads);
+        compaction_pool = std::make_unique<ThreadPool>(options.compaction_threads);
+        if (options.max_subcompactions > 1) {
+            subcompaction_pool = std::make_unique<ThreadPool>(options.max_subcompactions - 1);
+        }
+        maybe_schedule_compaction();
+    }
+
+    /**
+     * @brief Destructor that gracefully shuts down the LSMTree, ensuring all background tasks complete.
+     */
+    ~BasicLSMTree() {
+        running = false;
+        {
+            std::lock_guard<std::mutex> lock(compaction_mtx);
+            compaction_cv.notify_all();
+        }
+        signal_write_stall_change();
+
+        // Pending flushes still run; compactions in progress stop early and keep their inputs
+        flush_pool->shutdown();
+        compaction_pool->shutdown();
+        if (subcompaction_pool) {
+            subcompaction_pool->shutdown();
+        }
+    }
+
+private:
+    /**
+     * @brief Logs a value encoded for storage and adds it to the active MemTable.
+     * @details The caller holds active_memtable_mtx.
+     * @return uint64_t The write-ahead log sequence number to commit.
+     */
+    uint64_t put_locked(std::string_view key, std::string_view stored) {
+        uint64_t sequence = wal->append(key, stored);
+        MemTable *memtable = activeMemTable.load(std::memory_order_relaxed);
+        memtable->put(key, stored, ++write_sequence);
+        if (memtable->isFull()) {
+            rotate_memtable();
+        }
+        return sequence;
+    }
+
+    bool put_stored(std::string_view key, std::string_view stored, bool sync) {
+        auto start = std::chrono::steady_clock::now();
+        delay_write(key.size() + stored.size());
+        uint64_t sequence;
+        {
+            std::lock_guard<std::mutex> lock(active_memtable_mtx);
+            if (wal->hasFailed()) {
+                return false;
+            }
+            sequence = put_locked(key, stored);
+        }
+        bool ok = !sync || wal->commit(sequence);
+        Metrics::record(Timer::PUT, Metrics::microsSince(start));
+        return ok;
+    }
+
+public:
+    /**
+     * @brief Inserts a key-value pair into the LSM Tree.
+     * @details Blocks or slows down first while flushes or compactions are too far behind.
+     * @param key The key to insert.
+     * @param value The associated value.
+     * @param sync Whether to commit the write-ahead log before returning. Callers batching
+     *             several writes pass false and call sync() once before acknowledging them.
+     * @return bool True if the write was applied and, with sync, committed. False if the write-ahead
+     *         log has failed: the write is refused, or, if the log failed while committing it,
+     *         applied but possibly lost in a crash. Either way it must not be acknowledged.
+     */
+    bool put(std::string_view key, std::string_view value, bool sync = true) {
+        if (Expiry::needsHeader(value)) {
+            return put_stored(key, Expiry::encode(value), sync);
+        }
+        return put_stored(key, value, sync);
+    }
+
+    /**
+     * @brief Inserts a key-value pair that reads as deleted from an expiry time on.
+     * @param key The key to insert.
+     * @param value The associated value.
+     * @param expire_at Expiry time in milliseconds since the Unix epoch.
+     * @param sync Whether to commit the write-ahead log before returning, as for put().
+     * @return bool False if the write-ahead log has failed, as for put().
+     */
+    bool putWithExpiry(std::string_view key, std::string_view value, uint64_t expire_at, bool sync = true) {
+        return put_stored(key, Expiry::encode(value, expire_at), sync);
+    }
+
+    /**
+     * @brief Sets the expiry time of a key's current value.
+     * @details Atomic with respect to other writes of the key: the value is read without any lock,
+     *          then rewritten with the new expiry time under the writer lock, unless a newer write of
+     *          the key reached the active MemTable meanwhile, in which case that one is used.
+     * @param key The key.
+     * @param expire_at Expiry time in milliseconds since the Unix epoch; a past time deletes the key.
+     * @param found Set to true if the key holds a value, false (and nothing is written) if it does not.
+     * @param sync Whether to commit the write-ahead log before returning, as for put().
+     * @return bool False if the write-ahead log has failed, as for put().
+     */
+    bool expire(std::string_view key, uint64_t expire_at, bool &found, bool sync = true) {
+        found = false;
+        delay_write(key.size());
+        for (;;) {
+            MemTable *read_from = activeMemTable.load();
+            std::pair<bool, std::string> current = lookup(key, true);
+            uint64_t sequence;
+            {
+                std::lock_guard<std::mutex> lock(active_memtable_mtx);
+                if (wal->hasFailed()) {
+                    return false;
+                }
+                MemTable *memtable = activeMemTable.load(std::memory_order_relaxed);
+                std::pair<bool, std::string> latest = memtable->get(key);
+                if (!latest.first && latest.second != TOMBSTONE) {
+                    // Writes since the lookup all went to the active MemTable, unless it has been rotated
+                    if (memtable != read_from) {
+                        continue;
+                    }
+                    latest = std::move(current);
+                }
+                if (!latest.first) {
+                    return true;
+                }
+                found = true;
+                sequence = put_locked(key, Expiry::encode(Expiry::value(latest.second), expire_at));
+            }
+            return !sync || wal->commit(sequence);
+        }
+    }
+
+    /**
+     * @brief Applies a batch of puts and removes.
+     * @details The batch is logged as one write-ahead log record and applied to the active MemTable
+     *          under one lock acquisition, so after a crash either every write in it is replayed or
+     *          none is, and no snapshot sees only part of it. Blocks or slows down first like put().
+     * @param batch The writes, applied in order.
+     * @param sync Whether to commit the write-ahead log before returning, as for put().
+     * @return bool False if the write-ahead log has failed, as for put().
+     */
+    bool write(const WriteBatch &batch, bool sync = true) {
+        if (batch.empty()) {
+            return true;
+        }
+        delay_write(batch.byteSize());
+        uint64_t sequence;
+        {
+            std::lock_guard<std::mutex> lock(active_memtable_mtx);
+            if (wal->hasFailed()) {
+                return false;
+            }
+            sequence = wal->appendBatch(batch);
+            MemTable *memtable = activeMemTable.load(std::memory_order_relaxed);
+            batch.forEach([this, memtable](std::string_view key, std::string_view value) {
+                memtable->put(key, value, ++write_sequence);
+            });
+            if (memtable->isFull()) {
+                rotate_memtable();
+            }
+        }
+        return !sync || wal->commit(sequence);
+    }
+
+    /**
+     * @brief Commits every write made so far to the write-ahead log.
+     * @details Concurrent callers share one write and one fdatasync.
+     * @return True if successful, otherwise false; once the log has failed, writes not committed
+     *         before the failure never will be.
+     */
+    bool sync() {
+        return wal->commitAll();
+    }
+
+private:
+    /**
+     * @brief Places a table in the tree's directory under a new L0 name, without copying it if possible.
+     * @details The file is hard-linked, or copied where links are not possible, such as across file
+     *          systems; either way the new name and the directory entry are synced.
+     * @param source The table's file.
+     * @param base_name The new base filename (without extensions).
+     * @return True if the file is in place, otherwise false.
+     */
+    static bool link_table(const std::string &source, const std::string &base_name) {
+        std::string target = base_name + SST_EXTENSION;
+        std::error_code error;
+        std::filesystem::create_hard_link(source, target, error);
+        if (error) {
+            error.clear();
+            std::filesystem::copy_file(source, target, error);
+            if (error) {
+                std::cerr << "Failed to link or copy " << source << " into the tree: " << error.message() << std::endl;
+                std::filesystem::remove(target, error);
+                return false;
+            }
+        }
+        int fd = open(target.c_str(), O_RDONLY | O_CLOEXEC);
+        bool synced = fd != -1 && fsync(fd) == 0;
+        if (fd != -1) {
+            close(fd);
+        }
+        std::string directory = std::filesystem::path(base_name).parent_path().string();
+        fd = open(directory.empty() ? "." : directory.c_str(), O_RDONLY | O_CLOEXEC);
+        synced = synced && fd != -1 && fsync(fd) == 0;
+        if (fd != -1) {
+            close(fd);
+        }
+        if (!synced) {
+            std::cerr << "Failed to sync " << target << std::endl;
+            std::filesystem::remove(target, error);
+        }
+        return synced;
+    }
+
+    /**
+     * @brief Picks the level an ingested table goes to.
+     * @details The table must hold newer data than every table it overlaps, so it goes to the deepest
+     *          level such that no table at or above it overlaps its range. With leveled compaction,
+     *          a compaction in progress may write a table anywhere within the range of its inputs, so
+     *          the range spanned by the inputs compacting into a level counts as taken in that level.
+     *          A table overlapping L0, or any table with tiered compaction, goes to the end of L0, as
+     *          a flush would. Must be called with sstables_mtx held.
+     * @param sstable The table.
+     * @return size_t The level.
+     */
+    size_t ingest_level(const SS_Table &sstable) {
+        if (options.compaction_style != CompactionStyle::LEVELED) {
+            return 0;
+        }
+        const std::string &smallest = sstable.getSmallestKey();
+        const std::string &largest = sstable.getLargestKey();
+        for (size_t level = 0; level < levels.size(); ++level) {
+            std::vector<SS_Table *> in_flight;
+            for (size_t compacted = level > 0 ? level - 1 : 0; compacted <= level; ++compacted) {
+                for (const std::shared_ptr<SS_Table> &table : levels[compacted]) {
+                    if (compacting.count(table.get()) != 0) {
+                        in_flight.push_back(table.get());
+                    }
+                }
+            }
+            bool taken = false;
+            if (!in_flight.empty()) {
+                std::string compacting_smallest, compacting_largest;
+                key_range(in_flight, compacting_smallest, compacting_largest);
+                taken = !(compacting_largest < smallest || compacting_smallest > largest);
+            }
+            for (const std::shared_ptr<SS_Table> &table : levels[level]) {
+                taken = taken || table->overlaps(smallest, largest);
+            }
+            if (taken) {
+                return level > 0 ? level - 1 : 0;
+            }
+        }
+        return levels.size() - 1;
+    }
+
+public:
+    /**
+     * @brief Adds SSTables built outside the tree, such as by ExternalTableWriter, without writing their records again.
+     * @details Each file is hard-linked (or copied) into the tree's directory and added to a level in
+     *          one manifest edit per file, skipping the write-ahead log, the MemTables and the flushes
+     *          a bulk load through put() would cost. The ingested records are newer than every write
+     *          made before the call: an active MemTable overlapping the files is rotated first, and the
+     *          call waits until the MemTables overlapping them are flushed, so each table can go below
+     *          them, as deep as ingest_level() allows. Writes to the same keys made while the call runs
+     *          may land on either side. Files must be block-based tables with disjoint key ranges, and
+     *          must not be modified afterwards; the caller may delete them once the call returns.
+     * @param files Base filenames of the tables (without extensions), in any order.
+     * @return True if every table was added. On failure the tables added so far stay in the tree.
+     */
+    bool ingestFiles(const std::vector<std::string> &files) {
+        std::vector<std::shared_ptr<SS_Table>> inputs;
+        for (const std::string &file : files) {
+            std::shared_ptr<SS_Table> input = std::make_shared<SS_Table>(file);
+            if (!input->isLoaded() || input->getFormat() != TableFormat::BLOCK_BASED) {
+                std::cerr << "Cannot ingest " << file << SST_EXTENSION << ": not a readable block-based table" << std::endl;
+                return false;
+            }
+            inputs.push_back(std::move(input));
+        }
+        if (inputs.empty()) {
+            return true;
+        }
+        std::sort(inputs.begin(), inputs.end(), [](const std::shared_ptr<SS_Table> &a, const std::shared_ptr<SS_Table> &b) {
+            return a->getSmallestKey() < b->getSmallestKey();
+        });
+        for (size_t i = 1; i < inputs.size(); ++i) {
+            if (inputs[i - 1]->getLargestKey() >= inputs[i]->getSmallestKey()) {
+                std::cerr << "Cannot ingest " << inputs[i - 1]->getBaseName() << " and " << inputs[i]->getBaseName()
+                          << " together: their key ranges overlap" << std::endl;
+                return false;
+            }
+        }
+        std::string smallest = inputs.front()->getSmallestKey();
+        std::string largest = inputs.back()->getLargestKey();
+
+        {
+            std::lock_guard<std::mutex> lock(active_memtable_mtx);
+            if (activeMemTable.load(std::memory_order_relaxed)->overlaps(smallest, largest)) {
+                rotate_memtable();
+            }
+        }
+        {
+            std::unique_lock<std::mutex> lock(stall_mtx);
+            stall_cv.wait(lock, [&] {
+                std::shared_ptr<const Version> version = current_version();
+                for (const std::shared_ptr<MemTable> &immutable : version->immutables) {
+                    if (immutable->overlaps(smallest, largest)) {
+                        return !running;
+                    }
+                }
+                return true;
+            });
+        }
+        if (!running) {
+            return false;
+        }
+
+        for (const std::shared_ptr<SS_Table> &input : inputs) {
+            std::string base_name = new_table_name(0);
+            if (!link_table(input->getBaseName() + SST_EXTENSION, base_name)) {
+                return false;
+            }
+
+            std::shared_ptr<const Version> replaced;
+            {
+                std::lock_guard<std::mutex> manifest_lock(manifest_mtx);
+                std::lock_guard<std::mutex> memtables_lock(memtables_mtx);
+                std::lock_guard<std::mutex> lock(sstables_mtx);
+                size_t level = ingest_level(*input);
+                if (level > 0) {
+                    std::string level_name = new_table_name(level);
+                    std::error_code error;
+                    std::filesystem::rename(base_name + SST_EXTENSION, level_name + SST_EXTENSION, error);
+                    if (error) {
+                        std::cerr << "Failed to rename " << base_name << SST_EXTENSION << ": " << error.message() << std::endl;
+                        SS_Table::removeFiles(base_name);
+                        return false;
+                    }
+                    base_name = level_name;
+                }
+                std::shared_ptr<SS_Table> sstable = std::make_shared<SS_Table>(base_name, block_cache.get(), options);
+                if (!sstable->isLoaded()) {
+                    sstable.reset();
+                    SS_Table::removeFiles(base_name);
+                    return false;
+                }
+                sstable->setSequence(++last_sequence);
+                VersionEdit edit;
+                edit.added.push_back(describe_table(*sstable, level));
+                if (!log_edit(edit)) {
+                    std::cerr << "Failed to record ingested table " << input->getBaseName() << " in the manifest" << std::endl;
+                    sstable.reset();
+                    SS_Table::removeFiles(base_name);
+                    return false;
+                }
+
+                std::deque<std::shared_ptr<SS_Table>> &tables = levels[level];
+                if (level == 0) {
+                    tables.push_back(std::move(sstable));
+                } else {
+                    auto position = std::lower_bound(tables.begin(), tables.end(), sstable->getSmallestKey(),
+                                                     [](const std::shared_ptr<SS_Table> &table, const std::string &key) {
+                                                         return table->getSmallestKey() < key;
+                                                     });
+                    tables.insert(position, std::move(sstable));
+                }
+                l0_tables.store(levels[0].size(), std::memory_order_relaxed);
+                replaced = install_version();
+            }
+            replaced.reset();
+            signal_write_stall_change();
+        }
+        maybe_schedule_compaction();
+        return true;
+    }
+
+    /**
+     * @brief Sets the function that receives every write-ahead log record from now on.
+     * @details Records reach the listener in the order they were applied, encoded as
+     *          WriteAheadLog::decode() reads them, which is how a primary streams its writes to replicas.
+     *          The listener runs on the writing thread with the log locked, so it must be quick.
+     * @param listener Called with each record; empty to remove the listener.
+     */
+    void setLogListener(std::function<void(std::string_view)> listener) {
+        wal->setTap(std::move(listener));
+    }
+
+    /**
+     * @brief Hard-links a consistent set of the tree's SSTables into a directory.
+     * @details on_cut runs at the cut, with writers held off: every write applied before it is in the
+     *          tables linked, and every write after it reaches the log listener. The active MemTable is
+     *          rotated at the cut and the call waits for it and the older MemTables to be flushed, so
+     *          the tables may also hold writes made after the cut, which replaying them again
+     *          overwrites with the same result. The links keep the tables' data even after compaction
+     *          deletes them from the tree; the caller removes the directory when done.
+     * @param directory Directory to link the tables into, ending in '/'; created if missing.
+     * @param on_cut Called once at the cut.
+     * @param tables Set to the tables linked, deepest level last, L0 oldest first; names are relative
+     *               to directory.
+     * @return True if every table was linked, otherwise false.
+     */
+    bool checkpoint(const std::string &directory, const std::function<void()> &on_cut, std::vector<TableMeta> &tables) {
+        tables.clear();
+        std::vector<std::shared_ptr<MemTable>> unflushed;
+        {
+            std::lock_guard<std::mutex> lock(active_memtable_mtx);
+            on_cut();
+            MemTable *active = activeMemTable.load(std::memory_order_relaxed);
+            if (active->begin() != active->end() || active->hasRangeDeletions()) {
+                rotate_memtable();
+            }
+            unflushed = current_version()->immutables;
+        }
+        {
+            std::unique_lock<std::mutex> lock(stall_mtx);
+            stall_cv.wait(lock, [&] {
+                std::shared_ptr<const Version> version = current_version();
+                for (const std::shared_ptr<MemTable> &immutable : version->immutables) {
+                    if (std::find(unflushed.begin(), unflushed.end(), immutable) != unflushed.end()) {
+                        return !running;
+                    }
+                }
+                return true;
+            });
+        }
+        if (!running) {
+            return false;
+        }
+
+        std::error_code error;
+        std::filesystem::create_directories(directory, error);
+        std::shared_ptr<const Version> version = current_version();
+        for (size_t level = 0; level < version->levels.size(); ++level) {
+            for (const std::shared_ptr<SS_Table> &sstable : version->levels[level]) {
+                TableMeta meta = describe_table(*sstable, level);
+                if (sstable->getFormat() != TableFormat::BLOCK_BASED) {
+                    std::cerr << "Cannot checkpoint " << sstable->getBaseName() << ": not a block-based table" << std::endl;
+                    return false;
+                }
+                if (!link_table(sstable->getBaseName() + SST_EXTENSION, directory + meta.name)) {
+                    return false;
+                }
+                tables.push_back(std::move(meta));
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Applies write-ahead log records received from another tree, such as a primary's.
+     * @details Each write goes through this tree's own log and MemTable, in order, with the value as
+     *          the other tree stored it. A batch record is applied as one WriteBatch, so it stays atomic.
+     * @param records Encoded records, as passed to a log listener.
+     * @return True if every record was applied and committed, false if the records are corrupt or the log has failed.
+     */
+    bool applyLogRecords(std::string_view records) {
+        size_t applied = 0;
+        bool written = true;
+        bool intact = WriteAheadLog::decode(
+            records, "Replicated log",
+            [this, &written](std::string_view key, std::string_view stored) { written = put_stored(key, stored, false) && written; },
+            [this, &written](std::string_view start, std::string_view end) { written = removeRange(start, end, false) && written; },
+            applied,
+            [this, &written](std::string_view encoded) {
+                WriteBatch batch;
+                if (!WriteBatch::forEach(encoded, [&batch](std::string_view key, std::string_view stored) { batch.append(key, stored); })) {
+                    return false;
+                }
+                written = write(batch, false) && written;
+                return true;
+            });
+        return sync() && written && intact;
+    }
+
+    /**
+     * @class Snapshot
+     * @brief A consistent, read-only view of the tree at one point in the write order.
+     * @details Reads through a snapshot see every write made before it was taken and none made
+     *          after, however long it is held and whatever flushes and compactions run meanwhile,
+     *          which is what a backup or any other multi-key read needs. It pins what it reads:
+     *          while it is held, the MemTables it covers stay in memory and the SSTables it lists
+     *          stay on disk even after compaction replaces them, so it should be released once
+     *          done, and always before the tree is destroyed. Copies share the same view.
+     */
+    class Snapshot {
+    private:
+        friend class BasicLSMTree;
+        std::shared_ptr<const Version> version;
+        uint64_t sequence = 0;
+
+    public:
+        /**
+         * @brief Gets the sequence number of the newest write the snapshot sees.
+         */
+        uint64_t getSequence() const {
+            return sequence;
+        }
+    };
+
+private:
+    /**
+     * @brief Looks a key up in a version's immutable MemTables, newest first.
+     * @param version The version to search.
+     * @param key The key to look up.
+     * @param sequence Only writes with a sequence number up to this one are seen.
+     * @param result Set to the answer when a MemTable settles the lookup.
+     * @return True if a MemTable holds the key or deletes it, so the SSTables need not be searched.
+     */
+    static bool search_immutables(const Version &version, std::string_view key, uint64_t sequence, std::pair<bool, std::string> &result) {
+        for (std::reverse_iterator it = version.immutables.rbegin(); it != version.immutables.rend(); ++it) {
+            result = (*it)->get(key, sequence);
+            if (result.first || result.second == TOMBSTONE) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief Looks a key up in the active MemTable, without any lock.
+     * @param key The key to look up.
+     * @param result Set to the answer when the MemTable settles the lookup.
+     * @return True if the active MemTable holds the key or deletes it.
+     */
+    bool search_active(std::string_view key, std::pair<bool, std::string> &result) {
+        std::atomic<uint64_t> &readers = active_readers[read_epoch.load() & 1];
+        readers.fetch_add(1);
+        result = activeMemTable.load()->get(key);
+        readers.fetch_sub(1);
+        return result.first || result.second == TOMBSTONE;
+    }
+
+    /**
+     * @brief Looks a key up in a version's immutable MemTables and SSTables, newest first.
+     * @param version The version to search; its active MemTable is left to the caller.
+     * @param key The key to look up.
+     * @param sequence Only writes with a sequence number up to this one are seen.
+     * @param fill_cache Whether SSTable blocks read for this lookup should be added to the block cache.
+     * @return A pair containing a boolean indicating success and the associated value.
+     */
+    std::pair<bool, std::string> search_version(const Version &version, std::string_view key, uint64_t sequence, bool fill_cache) {
+        std::pair<bool, std::string> result;
+        if (search_immutables(version, key, sequence, result)) {
+            return result;
+        }
+
+        const std::vector<std::shared_ptr<SS_Table>> &level0 = version.levels[0];
+        for (std::reverse_iterator it = level0.rbegin(); it != level0.rend(); ++it) {
+            if (probe_sstable(**it, key, fill_cache, result)) {
+                return result;
+            }
+        }
+
+        // Deeper levels are disjoint and sorted, so only the table whose range covers the key is read
+        for (size_t level = 1; level < version.levels.size(); ++level) {
+            const std::vector<std::shared_ptr<SS_Table>> &tables = version.levels[level];
+            auto it = std::lower_bound(tables.begin(), tables.end(), key,
+                                       [](const std::shared_ptr<SS_Table> &sstable, std::string_view k) {
+                                           return sstable->getLargestKey() < k;
+                                       });
+            if (it != tables.end() && (*it)->getSmallestKey() <= key && probe_sstable(**it, key, fill_cache, result)) {
+                return result;
+            }
+        }
+        return {false, ""};
+    }
+
+    /**
+     * @brief Looks a key up in the whole tree, returning the value as stored.
+     * @details The active MemTable is read without any lock, concurrently with writers, and the
+     *          rest of the tree through a reference to the current version, so no lock is held
+     *          while SSTables are read from disk.
+     * @param key The key to search for.
+     * @param fill_cache Whether SSTable blocks read for this lookup should be added to the block cache.
+     * @return A pair containing a boolean indicating success and the value, with its expiry header if any.
+     */
+    std::pair<bool, std::string> lookup(std::string_view key, bool fill_cache) {
+        std::pair<bool, std::string> result;
+        if (search_active(key, result)) {
+            return result;
+        }
+
+        // Rotation installs the version holding the old active MemTable before publishing the
+        // new one, so this version includes every MemTable the lookup above could have missed
+        std::shared_ptr<const Version> version = current_version();
+        return search_version(*version, key, MemTable::MAX_SEQUENCE, fill_cache);
+    }
+
+public:
+    /**
+     * @brief Retrieves the value associated with a given key.
+     * @details See lookup() for the locking; keys whose value has expired read as missing.
+     * @param key The key to search for.
+     * @param fill_cache Whether SSTable blocks read for this lookup should be added to the block cache.
+     * @return A pair containing a boolean indicating success and the associated value.
+     */
+    std::pair<bool, std::string> get(std::string_view key, bool fill_cache = true) {
+        auto start = std::chrono::steady_clock::now();
+        std::pair<bool, std::string> result = lookup(key, fill_cache);
+        Expiry::strip(result);
+        Metrics::record(Timer::GET, Metrics::microsSince(start));
+        return result;
+    }
+
+    /**
+     * @brief Retrieves a key's value if the MemTables settle the lookup, without reading any SSTable.
+     * @details For callers that must not wait for disk, such as an event loop: lookups the MemTables
+     *          answer are served at once, and the others can be handed to a thread that calls get().
+     * @param key The key to search for.
+     * @param result Set as get() would set it, if the lookup is settled.
+     * @return True if a MemTable holds the key or deletes it; false if the SSTables must be searched.
+     */
+    bool getFromMemory(std::string_view key, std::pair<bool, std::string> &result) {
+        auto start = std::chrono::steady_clock::now();
+        if (!search_active(key, result) && !search_immutables(*current_version(), key, MemTable::MAX_SEQUENCE, result)) {
+            return false;
+        }
+        Expiry::strip(result);
+        Metrics::record(Timer::GET, Metrics::microsSince(start));
+        return true;
+    }
+
+    /**
+     * @brief Retrieves the expiry time of a key.
+     * @param key The key to search for.
+     * @return std::pair<bool, uint64_t> Whether the key holds a value, and its expiry time in
+     *         milliseconds since the Unix epoch, or Expiry::NEVER.
+     */
+    std::pair<bool, uint64_t> getExpiry(std::string_view key) {
+        std::pair<bool, std::string> result = lookup(key, true);
+        return {result.first, result.first ? Expiry::expireAt(result.second) : Expiry::NEVER};
+    }
+
+    /**
+     * @brief Retrieves the value a key had when a snapshot was taken.
+     * @param key The key to search for.
+     * @param snapshot The snapshot to read, from getSnapshot().
+     * @param fill_cache Whether SSTable blocks read for this lookup should be added to the block cache.
+     * @return A pair containing a boolean indicating success and the associated value.
+     */
+    std::pair<bool, std::string> get(std::string_view key, const Snapshot &snapshot, bool fill_cache = true) {
+        std::pair<bool, std::string> result = snapshot.version->active->get(key, snapshot.sequence);
+        if (!result.first && result.second != TOMBSTONE) {
+            result = search_version(*snapshot.version, key, snapshot.sequence, fill_cache);
+        }
+        Expiry::strip(result);
+        return result;
+    }
+
+    /**
+     * @brief Retrieves the values of several keys in one pass over the tree.
+     * @details The keys are sorted and looked up against one version, layer by layer: each
+     *          MemTable and SSTable is visited once for all the keys still unsettled, and keys in
+     *          the same SSTable block share one read. A key stops being looked up once a layer
+     *          holds a value or a tombstone for it.
+     * @param keys The keys to look up, in any order and possibly repeated.
+     * @param fill_cache Whether SSTable blocks read for this lookup should be added to the block cache.
+     * @return std::vector<std::pair<bool, std::string>> A result per key, in the order of keys, as get() returns it.
+     */
+    std::vector<std::pair<bool, std::string>> multiGet(const std::vector<std::string_view> &keys, bool fill_cache = true) {
+        std::vector<size_t> order(keys.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&keys](size_t a, size_t b) { return keys[a] < keys[b]; });
+        std::vector<std::string_view> sorted;
+        std::vector<size_t> slot(keys.size()); // Position in sorted of each requested key
+        for (size_t index : order) {
+            if (sorted.empty() || sorted.back() != keys[index]) {
+                sorted.push_back(keys[index]);
+            }
+            slot[index] = sorted.size() - 1;
+        }
+
+        std::vector<std::pair<bool, std::string>> found(sorted.size(), {false, ""});
+        std::vector<size_t> pending(sorted.size());
+        std::iota(pending.begin(), pending.end(), 0);
+        auto probe_memtable = [&](MemTable &memtable) {
+            size_t kept = 0;
+            for (size_t position : pending) {
+                std::pair<bool, std::string> result = memtable.get(sorted[position]);
+                if (result.first || result.second == TOMBSTONE) {
+                    found[position] = std::move(result);
+                } else {
+                    pending[kept++] = position;
+                }
+            }
+            pending.resize(kept);
+        };
+
+        std::shared_ptr<const Version> version = current_version();
+        probe_memtable(*version->active);
+        for (std::reverse_iterator it = version->immutables.rbegin(); it != version->immutables.rend() && !pending.empty(); ++it) {
+            probe_memtable(**it);
+        }
+        const std::vector<std::shared_ptr<SS_Table>> &level0 = version->levels[0];
+        for (std::reverse_iterator it = level0.rbegin(); it != level0.rend() && !pending.empty(); ++it) {
+            probe_sstable_batch(**it, sorted, pending, fill_cache, found);
+        }
+
+        // Deeper levels are disjoint and sorted, so the pending keys split into one run per table
+        for (size_t level = 1; level < version->levels.size() && !pending.empty(); ++level) {
+            const std::vector<std::shared_ptr<SS_Table>> &tables = version->levels[level];
+            std::vector<size_t> unsettled;
+            size_t next = 0;
+            for (const std::shared_ptr<SS_Table> &sstable : tables) {
+                while (next < pending.size() && sorted[pending[next]] < sstable->getSmallestKey()) {
+                    unsettled.push_back(pending[next++]);
+                }
+                std::vector<size_t> run;
+                while (next < pending.size() && sorted[pending[next]] <= sstable->getLargestKey()) {
+                    run.push_back(pending[next++]);
+                }
+                if (!run.empty()) {
+                    probe_sstable_batch(*sstable, sorted, run, fill_cache, found);
+                    unsettled.insert(unsettled.end(), run.begin(), run.end());
+                }
+            }
+            unsettled.insert(unsettled.end(), pending.begin() + next, pending.end());
+            pending.swap(unsettled);
+        }
+
+        std::vector<std::pair<bool, std::string>> results;
+        results.reserve(keys.size());
+        for (size_t index = 0; index < keys.size(); ++index) {
+            results.push_back(found[slot[index]]);
+            Expiry::strip(results.back());
+        }
+        return results;
+    }
+
+    /**
+     * @brief Takes a snapshot of the tree as of the newest write.
+     * @details Briefly excludes writers, so the snapshot's sequence number and version agree:
+     *          every table in the version holds only writes up to that number.
+     * @return Snapshot The snapshot; see LSMTree::Snapshot for what holding it keeps alive.
+     */
+    Snapshot getSnapshot() {
+        Snapshot snapshot;
+        std::lock_guard<std::mutex> lock(active_memtable_mtx);
+        snapshot.version = current_version();
+        snapshot.sequence = write_sequence;
+        return snapshot;
+    }
+
+    /**
+     * @class Iterator
+     * @brief Sorted iterator over the live keys of a snapshot of the whole tree.
+     * @details Merges the active MemTable, the immutable MemTables and every SSTable, returning
+     *          the newest value of each key as of the snapshot and skipping deleted and expired keys. Deeper
+     *          levels are read one table at a time, and the data is streamed block by block, so
+     *          memory use does not depend on the size of the range.
+     *
+     *          The iterator holds no lock: flushes, compactions and writes proceed while it is
+     *          open, and none of them change what it returns. It keeps its snapshot, and so the
+     *          tables it reads, alive until it is destroyed.
+     */
+    class Iterator {
+    private:
+        Snapshot snapshot;
+        std::unique_ptr<MergingIterator> merged;
+        uint64_t now = Expiry::nowMillis(); ///< Values that expired by the time the iterator was created are skipped.
+
+        void skipDeleted() {
+            while (merged->isValid() && (merged->value() == TOMBSTONE || Expiry::isExpired(merged->value(), now) ||
+                                         merged->isRangeDeleted())) {
+                merged->next();
+            }
+        }
+
+    public:
+        /**
+         * @brief Creates an unpositioned iterator; call seekToFirst() or seek() before reading it.
+         * @param snapshot The snapshot to read.
+         */
+        explicit Iterator(Snapshot snapshot) : snapshot(std::move(snapshot)) {
+            const Version &version = *this->snapshot.version;
+            uint64_t sequence = this->snapshot.sequence;
+            std::vector<std::unique_ptr<InternalIterator>> children;
+            children.push_back(std::make_unique<BasicMemTableIterator<MemTable>>(version.active.get(), sequence));
+            for (std::reverse_iterator it = version.immutables.rbegin(); it != version.immutables.rend(); ++it) {
+                children.push_back(std::make_unique<BasicMemTableIterator<MemTable>>(it->get(), sequence));
+            }
+            const std::vector<std::shared_ptr<SS_Table>> &level0 = version.levels[0];
+            for (std::reverse_iterator it = level0.rbegin(); it != level0.rend(); ++it) {
+                children.push_back(std::make_unique<TableIterator>(it->get()));
+            }
+            for (size_t level = 1; level < version.levels.size(); ++level) {
+                if (!version.levels[level].empty()) {
+                    children.push_back(std::make_unique<LevelIterator>(&version.levels[level]));
+                }
+            }
+            merged = std::make_unique<MergingIterator>(std::move(children));
+        }
+
+        bool isValid() const {
+            return merged->isValid();
+        }
+
+        std::string_view key() const {
+            return merged->key();
+        }
+
+        std::string_view value() const {
+            return Expiry::value(merged->value());
+        }
+
+        void seekToFirst() {
+            merged->seekToFirst();
+            skipDeleted();
+        }
+
+        /**
+         * @brief Positions the iterator at the first live key not less than target.
+         */
+        void seek(std::string_view target) {
+            merged->seek(target);
+            skipDeleted();
+        }
+
+        void next() {
+            merged->next();
+            skipDeleted();
+        }
+    };
+
+    /**
+     * @brief Creates a sorted iterator over the live keys as of now.
+     * @return Iterator Unpositioned, reading a snapshot taken by this call.
+     */
+    Iterator iterator() {
+        return Iterator(getSnapshot());
+    }
+
+    /**
+     * @brief Creates a sorted iterator over the live keys of a snapshot.
+     * @param snapshot The snapshot to read, from getSnapshot().
+     * @return Iterator Unpositioned.
+     */
+    Iterator iterator(const Snapshot &snapshot) {
+        return Iterator(snapshot);
+    }
+
+    /**
+     * @brief Gets the number of levels, including L0.
+     */
+    size_t levelCount() const {
+        return options.num_levels;
+    }
+
+    /**
+     * @brief Returns the Bloom filter counters accumulated since startup.
+     * @return FilterStats Checked, useful and false positive lookup counts.
+     */
+    FilterStats getFilterStats() const {
+        FilterStats stats;
+        stats.checked = filter_checked.load(std::memory_order_relaxed);
+        stats.useful = filter_useful.load(std::memory_order_relaxed);
+        stats.false_positive = filter_false_positive.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+    /**
+     * @brief Returns the block cache counters.
+     * @return BlockCacheStats Hits, misses, inserts, evictions and memory usage; all zero if the cache is disabled.
+     */
+    BlockCacheStats getBlockCacheStats() const {
+        if (block_cache == nullptr) {
+            return BlockCacheStats();
+        }
+        return block_cache->getStats();
+    }
+
+    /**
+     * @brief Returns the write stall counters accumulated since startup.
+     * @return WriteStallStats Slowdown and stop counts, total stall time and the current backlog.
+     */
+    WriteStallStats getWriteStallStats() const {
+        WriteStallStats stats;
+        stats.slowdowns = stall_slowdowns.load(std::memory_order_relaxed);
+        stats.stops = stall_stops.load(std::memory_order_relaxed);
+        stats.stall_micros = stall_micros.load(std::memory_order_relaxed);
+        stats.immutable_memtables = immutable_memtables.load(std::memory_order_relaxed);
+        stats.l0_tables = l0_tables.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+    /**
+     * @brief Returns the current size of the MemTables and of every level.
+     * @return TreeStats Read from the current version, without blocking writers.
+     */
+    TreeStats getTreeStats() {
+        std::shared_ptr<const Version> version = current_version();
+        TreeStats stats;
+        stats.memtable_bytes = version->active->getSize();
+        stats.immutable_memtables = version->immutables.size();
+        for (const std::shared_ptr<MemTable> &memtable : version->immutables) {
+            stats.immutable_bytes += memtable->getSize();
+        }
+        for (const std::vector<std::shared_ptr<SS_Table>> &level : version->levels) {
+            uint64_t bytes = 0;
+            for (const std::shared_ptr<SS_Table> &sstable : level) {
+                bytes += sstable->getFileSize();
+            }
+            stats.tables_per_level.push_back(level.size());
+            stats.bytes_per_level.push_back(bytes);
+        }
+        return stats;
+    }
+
+    /**
+     * @brief Returns the block compression counters of this process.
+     * @return CompressionStats Bytes written before and after compression, and decompression work on reads.
+     */
+    CompressionStats getCompressionStats() const {
+        return Compression::getStats();
+    }
+
+    /**
+     * @brief Deletes every key in [start, end) with one range tombstone.
+     * @details The tombstone hides the older versions of the keys it covers in the MemTables and
+     *          SSTables; keys written afterwards are not affected. Compaction drops the covered records,
+     *          and the tombstone itself once it reaches the bottom of the tree.
+     * @param start First key to delete.
+     * @param end Key the deletion stops before; nothing is deleted unless start < end.
+     * @param sync Whether to commit the write-ahead log before returning, as for put().
+     * @return bool False if the write-ahead log has failed, as for put().
+     */
+    bool removeRange(std::string_view start, std::string_view end, bool sync = true) {
+        if (start >= end) {
+            return true;
+        }
+        delay_write(start.size() + end.size());
+        uint64_t sequence;
+        {
+            std::lock_guard<std::mutex> lock(active_memtable_mtx);
+            if (wal->hasFailed()) {
+                return false;
+            }
+            sequence = wal->appendRangeDeletion(start, end);
+            MemTable *memtable = activeMemTable.load(std::memory_order_relaxed);
+            memtable->removeRange(start, end, ++write_sequence);
+            if (memtable->isFull()) {
+                rotate_memtable();
+            }
+        }
+        return !sync || wal->commit(sequence);
+    }
+
+    /**
+     * @brief Marks a key as deleted by inserting a tombstone value.
+     * @param key The key to remove.
+     * @param sync Whether to commit the write-ahead log before returning, as for put().
+     * @return bool False if the write-ahead log has failed, as for put().
+     */
+    bool remove(std::string_view key, bool sync = true) {
+        delay_write(key.size());
+        uint64_t sequence;
+        {
+            std::lock_guard<std::mutex> lock(active_memtable_mtx);
+            if (wal->hasFailed()) {
+                return false;
+            }
+            sequence = wal->append(key, TOMBSTONE);
+            MemTable *memtable = activeMemTable.load(std::memory_order_relaxed);
+            memtable->remove(key, ++write_sequence);
+            if (memtable->isFull()) {
+                rotate_memtable();
+            }
+        }
+        return !sync || wal->commit(sequence);
     }
 };
 
+using LSMTree = BasicLSMTree<>;
+
 #endif
\ No newline at end of file
@@ -0,0 +1,427 @@
+/**
+ * @file manifest.hpp
+ * @brief Table catalog log
+ * @details This file contains the manifest, the log of version edits that records which SSTables
+ *          make up the tree. Every flush appends the tables it adds and every compaction appends
+ *          one edit that adds its outputs and removes its inputs, so after a crash the tree is
+ *          exactly the state of the last edit that reached the disk: a table written but never
+ *          logged, or a compaction input logged as removed, is garbage. Startup replays the log
+ *          instead of opening every table file.
+ * @author Gana Jayant Sigadam
+ * @date March 2025
+ * @version 1.0
+ */
+#ifndef MANIFEST_HPP
+#define MANIFEST_HPP
+
+#include "coding.hpp"
+#include "constants.hpp"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * @struct TableMeta
+ * @brief What the manifest records about one live SSTable
+ */
+struct TableMeta {
+    uint32_t level = 0;     ///< Level the table belongs to.
+    uint64_t sequence = 0;  ///< Order of the table's data; among L0 tables the highest is the newest.
+    std::string name;       ///< Base filename of the table, relative to the data directory.
+    std::string smallest;   ///< First key stored in the table.
+    std::string largest;    ///< Last key stored in the table.
+    uint64_t file_size = 0; ///< Size of the table's data file in bytes.
+};
+
+/**
+ * @struct VersionEdit
+ * @brief One atomic change to the set of live tables
+ * @details Encoded as a sequence of [tag (varint)] [fields] entries, so fields can be added later
+ *          without breaking old manifests' layout.
+ */
+struct VersionEdit {
+    std::optional<uint64_t> next_file_number; ///< Lowest table file number not yet handed out.
+    std::optional<uint64_t> last_sequence;    ///< Highest table sequence number handed out.
+    std::optional<uint64_t> log_number;       ///< Write-ahead logs numbered below it are flushed and obsolete.
+    std::vector<TableMeta> added;             ///< Tables that become live.
+    std::vector<std::string> removed;         ///< Base names of tables that stop being live.
+
+    static constexpr uint32_t TAG_NEXT_FILE_NUMBER = 1;
+    static constexpr uint32_t TAG_LAST_SEQUENCE = 2;
+    static constexpr uint32_t TAG_ADD_TABLE = 3;
+    static constexpr uint32_t TAG_REMOVE_TABLE = 4;
+    static constexpr uint32_t TAG_LOG_NUMBER = 5;
+
+    void encodeTo(std::string &dst) const {
+        if (next_file_number.has_value()) {
+            Coding::putVarint32(dst, TAG_NEXT_FILE_NUMBER);
+            Coding::putVarint64(dst, next_file_number.value());
+        }
+        if (last_sequence.has_value()) {
+            Coding::putVarint32(dst, TAG_LAST_SEQUENCE);
+            Coding::putVarint64(dst, last_sequence.value());
+        }
+        if (log_number.has_value()) {
+            Coding::putVarint32(dst, TAG_LOG_NUMBER);
+            Coding::putVarint64(dst, log_number.value());
+        }
+        for (const std::string &name : removed) {
+            Coding::putVarint32(dst, TAG_REMOVE_TABLE);
+            Coding::putLengthPrefixed(dst, name);
+        }
+        for (const TableMeta &table : added) {
+            Coding::putVarint32(dst, TAG_ADD_TABLE);
+            Coding::putVarint32(dst, table.level);
+            Coding::putVarint64(dst, table.sequence);
+            Coding::putLengthPrefixed(dst, table.name);
+            Coding::putLengthPrefixed(dst, table.smallest);
+            Coding::putLengthPrefixed(dst, table.largest);
+            Coding::putVarint64(dst, table.file_size);
+        }
+    }
+
+    /**
+     * @brief Decodes an edit written by encodeTo()
+     * @return bool False if the input is malformed or has an unknown tag
+     */
+    bool decodeFrom(std::string_view input) {
+        while (!input.empty()) {
+            uint32_t tag;
+            if (!Coding::getVarint32(input, tag)) {
+                return false;
+            }
+            uint64_t number;
+            std::string_view name, smallest, largest;
+            switch (tag) {
+            case TAG_NEXT_FILE_NUMBER:
+                if (!Coding::getVarint64(input, number)) {
+                    return false;
+                }
+                next_file_number = number;
+                break;
+            case TAG_LAST_SEQUENCE:
+                if (!Coding::getVarint64(input, number)) {
+                    return false;
+                }
+                last_sequence = number;
+                break;
+            case TAG_LOG_NUMBER:
+                if (!Coding::getVarint64(input, number)) {
+                    return false;
+                }
+                log_number = number;
+                break;
+            case TAG_REMOVE_TABLE:
+                if (!Coding::getLengthPrefixed(input, name)) {
+                    return false;
+                }
+                removed.emplace_back(name);
+                break;
+            case TAG_ADD_TABLE: {
+                TableMeta table;
+                if (!Coding::getVarint32(input, table.level) || !Coding::getVarint64(input, table.sequence) ||
+                    !Coding::getLengthPrefixed(input, name) || !Coding::getLengthPrefixed(input, smallest) ||
+                    !Coding::getLengthPrefixed(input, largest) || !Coding::getVarint64(input, table.file_size)) {
+                    return false;
+                }
+                table.name.assign(name);
+                table.smallest.assign(smallest);
+                table.largest.assign(largest);
+                added.push_back(std::move(table));
+                break;
+            }
+            default:
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+/**
+ * @class Manifest
+ * @brief Append-only log of version edits, named by the CURRENT file
+ * @details Record format: [CRC32 (4 bytes)] [Length (4 bytes)] [Encoded VersionEdit]. The checksum
+ *          covers the length and the edit; every record is fdatasync'ed before logEdit() returns,
+ *          so an edit is either wholly in the log or, as a torn last record, ignored on replay.
+ *          A new manifest always starts with a snapshot edit listing every live table, and CURRENT
+ *          is only switched to it (by an atomic rename) once that snapshot is durable.
+ *
+ *          Not thread-safe: the LSM tree serializes every call.
+ */
+class Manifest {
+private:
+    std::string directory;    ///< Directory holding the manifest and CURRENT, ending in '/'.
+    uint64_t file_number = 0; ///< Number of the manifest in use, 0 before the first snapshot.
+    int fd = -1;              ///< Descriptor of the manifest in use.
+    uint64_t size = 0;        ///< Bytes written to the manifest in use.
+    bool failed = false;      ///< A write failed part way, so the log may end in a torn record.
+    uint64_t log_number = 0;  ///< Last recorded log number: write-ahead logs below it are obsolete.
+
+    static std::string manifestName(uint64_t number) {
+        return MANIFEST_PREFIX + std::to_string(number);
+    }
+
+    /**
+     * @brief Write a whole buffer to a file.
+     * @return bool True if every byte was written.
+     */
+    static bool writeAll(int fd, const std::string &data) {
+        const char *ptr = data.data();
+        size_t left = data.size();
+        while (left > 0) {
+            ssize_t n = write(fd, ptr, left);
+            if (n == -1 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                return false;
+            }
+            ptr += n;
+            left -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    static bool syncDirectory(const std::string &path) {
+        int dir_fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (dir_fd == -1) {
+            return false;
+        }
+        bool ok = fsync(dir_fd) == 0;
+        close(dir_fd);
+        return ok;
+    }
+
+    static std::string encodeRecord(const VersionEdit &edit) {
+        std::string payload;
+        edit.encodeTo(payload);
+        std::string record;
+        uint32_t length = static_cast<uint32_t>(payload.size());
+        std::string length_bytes;
+        Coding::putFixed32(length_bytes, length);
+        uint32_t crc = Coding::crc32(length_bytes.data(), length_bytes.size());
+        crc = Coding::crc32(payload.data(), payload.size(), crc);
+        Coding::putFixed32(record, crc);
+        record += length_bytes;
+        record += payload;
+        return record;
+    }
+
+public:
+    /**
+     * @brief Prepares a manifest in a directory; nothing is read or written until recover() or writeSnapshot().
+     * @param directory Directory for the manifest files, ending in '/'.
+     */
+    explicit Manifest(const std::string &directory) : directory(directory) {}
+
+    Manifest(const Manifest &) = delete;
+    Manifest &operator=(const Manifest &) = delete;
+
+    /**
+     * @brief Checks whether the directory has a manifest to recover from.
+     */
+    bool exists() const {
+        return std::filesystem::exists(directory + CURRENT_FILE);
+    }
+
+    /**
+     * @brief Replays the manifest named by CURRENT.
+     * @param tables Receives the live tables, in no particular order.
+     * @param next_file_number Receives the recorded next table file number, 0 if none.
+     * @param last_sequence Receives the recorded last table sequence number, 0 if none.
+     * @return bool False if CURRENT or the manifest it names cannot be read. The recorded log
+     *         number is then available from getLogNumber(), 0 if none.
+     */
+    bool recover(std::vector<TableMeta> &tables, uint64_t &next_file_number, uint64_t &last_sequence) {
+        std::ifstream current(directory + CURRENT_FILE);
+        std::string name;
+        if (!current.is_open() || !std::getline(current, name) || name.compare(0, MANIFEST_PREFIX.size(), MANIFEST_PREFIX) != 0) {
+            std::cerr << "Failed to read " << directory << CURRENT_FILE << std::endl;
+            return false;
+        }
+        std::string digits = name.substr(MANIFEST_PREFIX.size());
+        if (digits.empty() || digits.find_first_not_of("0123456789") != std::string::npos) {
+            std::cerr << directory << CURRENT_FILE << " names an invalid manifest " << name << std::endl;
+            return false;
+        }
+
+        std::ifstream log(directory + name, std::ios::binary);
+        if (!log.is_open()) {
+            std::cerr << "Failed to open manifest " << directory << name << std::endl;
+            return false;
+        }
+        std::string contents((std::istreambuf_iterator<char>(log)), std::istreambuf_iterator<char>());
+
+        std::map<std::string, TableMeta> live;
+        next_file_number = 0;
+        last_sequence = 0;
+        uint64_t recovered_log_number = 0;
+        size_t records = 0;
+        size_t pos = 0;
+        const size_t header_size = 2 * sizeof(uint32_t);
+        while (pos + header_size <= contents.size()) {
+            uint32_t crc = Coding::decodeFixed32(contents.data() + pos);
+            uint32_t length = Coding::decodeFixed32(contents.data() + pos + sizeof(uint32_t));
+            VersionEdit edit;
+            if (pos + header_size + length > contents.size() ||
+                Coding::crc32(contents.data() + pos + sizeof(uint32_t), sizeof(uint32_t) + length) != crc ||
+                !edit.decodeFrom(std::string_view(contents.data() + pos + header_size, length))) {
+                break;
+            }
+            for (const std::string &removed : edit.removed) {
+                live.erase(removed);
+            }
+            for (TableMeta &added : edit.added) {
+                std::string key = added.name;
+                live[key] = std::move(added);
+            }
+            next_file_number = edit.next_file_number.value_or(next_file_number);
+            last_sequence = edit.last_sequence.value_or(last_sequence);
+            recovered_log_number = edit.log_number.value_or(recovered_log_number);
+            records++;
+            pos += header_size + length;
+        }
+        if (records == 0) {
+            std::cerr << "Manifest " << directory << name << " has no intact records" << std::endl;
+            return false;
+        }
+        if (pos != contents.size()) {
+            std::cerr << "Manifest " << directory << name << " has a torn or corrupt record at offset " << pos
+                      << ", ignoring the rest of the file" << std::endl;
+        }
+
+        file_number = std::stoull(digits);
+        log_number = recovered_log_number;
+        tables.clear();
+        for (std::pair<const std::string, TableMeta> &entry : live) {
+            tables.push_back(std::move(entry.second));
+        }
+        return true;
+    }
+
+    /**
+     * @brief Starts a new manifest holding one edit that lists every live table, and switches CURRENT to it.
+     * @details The snapshot carries the last recorded log number. The previous manifest, and any
+     *          left behind by an earlier crash, are deleted once CURRENT names the new one.
+     * @param tables Every live table.
+     * @param next_file_number Lowest table file number not yet handed out.
+     * @param last_sequence Highest table sequence number handed out.
+     * @return bool False if the new manifest could not be made durable; the old one stays in use.
+     */
+    bool writeSnapshot(const std::vector<TableMeta> &tables, uint64_t next_file_number, uint64_t last_sequence) {
+        VersionEdit snapshot;
+        snapshot.next_file_number = next_file_number;
+        snapshot.last_sequence = last_sequence;
+        snapshot.log_number = log_number;
+        snapshot.added = tables;
+        std::string record = encodeRecord(snapshot);
+
+        uint64_t new_number = file_number + 1;
+        std::string new_name = manifestName(new_number);
+        int new_fd = open((directory + new_name).c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+        if (new_fd == -1 || !writeAll(new_fd, record) || fdatasync(new_fd) != 0) {
+            std::cerr << "Failed to write manifest " << directory << new_name << ": " << strerror(errno) << std::endl;
+            if (new_fd != -1) {
+                close(new_fd);
+            }
+            std::filesystem::remove(directory + new_name);
+            return false;
+        }
+
+        std::string temp = directory + CURRENT_FILE + ".tmp";
+        int current_fd = open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        bool ok = current_fd != -1 && writeAll(current_fd, new_name + "\n") && fsync(current_fd) == 0;
+        if (current_fd != -1) {
+            close(current_fd);
+        }
+        ok = ok && std::rename(temp.c_str(), (directory + CURRENT_FILE).c_str()) == 0 && syncDirectory(directory);
+        if (!ok) {
+            std::cerr << "Failed to update " << directory << CURRENT_FILE << ": " << strerror(errno) << std::endl;
+            close(new_fd);
+            std::filesystem::remove(temp);
+            std::filesystem::remove(directory + new_name);
+            return false;
+        }
+
+        if (fd != -1) {
+            close(fd);
+        }
+        fd = new_fd;
+        file_number = new_number;
+        size = record.size();
+        failed = false;
+
+        for (const std::filesystem::directory_entry &entry : std::filesystem::directory_iterator(directory)) {
+            std::string name = entry.path().filename().string();
+            if (name.compare(0, MANIFEST_PREFIX.size(), MANIFEST_PREFIX) == 0 && name != new_name) {
+                std::filesystem::remove(entry.path());
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Appends an edit and makes it durable.
+     * @return bool False if the edit could not be written; it must then be treated as never applied.
+     */
+    bool logEdit(const VersionEdit &edit) {
+        if (fd == -1) {
+            std::cerr << "Manifest is not open" << std::endl;
+            return false;
+        }
+        std::string record = encodeRecord(edit);
+        if (!writeAll(fd, record) || fdatasync(fd) != 0) {
+            std::cerr << "Failed to write manifest " << directory << manifestName(file_number) << ": "
+                      << strerror(errno) << std::endl;
+            failed = true;
+            return false;
+        }
+        size += record.size();
+        log_number = edit.log_number.value_or(log_number);
+        return true;
+    }
+
+    /**
+     * @brief Gets the last recorded log number; write-ahead logs numbered below it are obsolete.
+     */
+    uint64_t getLogNumber() const {
+        return log_number;
+    }
+
+    /**
+     * @brief Checks whether the next edit should go to a fresh snapshot instead of this log.
+     * @details True before the first snapshot, after a failed write (replay would stop at the torn
+     *          record and miss every later edit), and once the log has grown past MAX_MANIFEST_SIZE.
+     */
+    bool needsSnapshot() const {
+        return fd == -1 || failed || size >= MAX_MANIFEST_SIZE;
+    }
+
+    /**
+     * @brief Gets the size of the manifest in use in bytes.
+     */
+    uint64_t getSize() const {
+        return size;
+    }
+
+    ~Manifest() {
+        if (fd != -1) {
+            close(fd);
+        }
+    }
+};
+
+#endif
@@ -2,7 +2,7 @@
  * @file memtable.hpp
  * @author Gana Jayant Sigadam
  * @brief MemTable Class
- * @details This class implements a MemTable using a skip list as In-Memory storage for LSM-Tree.
+ * @details This class implements a MemTable using an arena-backed skip list as In-Memory storage for LSM-Tree.
  * @version 1.0
  * @date March 2025
  */
@@ -10,51 +10,103 @@
 #define MEM_TABLE
 
 #include "constants.hpp"
-#include "skiplist.hpp"
+#include "arena_skiplist.hpp"
+#include "engine_policy.hpp"
+#include "expiry.hpp"
+#include "options.hpp"
+#include "range_deletion.hpp"
 
+#include <atomic>
 #include <cstddef>
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 /**
- * @class MemTable
+ * @class BasicMemTable
  * @brief MemTable Class
  *  @details This class implements a MemTable using a skip list as In-Memory storage for LSM-Tree.
+ *  @details Every write carries a sequence number, and reads can be made as of one, so a MemTable
+ *  @details that keeps taking writes still gives a snapshot the contents it had when it was taken.
+ *  @details Range deletions are kept in a list of their own, newest first, and hide the versions of the
+ *  @details keys they cover with a lower sequence number, here and in every older table.
+ *  @details The skip list is the representation picked by the Policy (see EnginePolicy), and the size
+ *  @details at which the table counts as full comes from the tree's Options.
  */
-class MemTable {
-    SkipList *list;
+template <typename Policy = EnginePolicy<>>
+class BasicMemTable {
+    using Rep = typename Policy::MemTableRep;
+    static_assert(std::is_same<typename Rep::KeyComparator, typename Policy::KeyComparator>::value,
+                  "the MemTable representation must order keys with the policy's comparator");
+
+    /**
+     * @struct RangeDeletionNode
+     * @brief A range tombstone in the list, published like a skip list node and never unlinked.
+     */
+    struct RangeDeletionNode {
+        RangeTombstone tombstone;
+        RangeDeletionNode *next;
+    };
+
+    Rep *list;
+    std::atomic<RangeDeletionNode *> range_deletions; ///< Newest range tombstone, null if there are none.
+    std::atomic<size_t> range_deletion_bytes;        ///< Memory held by the range tombstones.
+    std::vector<std::string> log_files; ///< Write-ahead log files whose records all live in this MemTable.
+    size_t capacity;                    ///< Size at which the MemTable is full.
 
 public:
-    using Iterator = SkipList::Iterator;
+    using Iterator = typename Rep::Iterator;
 
-    MemTable() : list(new SkipList()) {
+    static constexpr uint64_t MAX_SEQUENCE = Rep::MAX_SEQUENCE; ///< Reads at this sequence see every write.
+
+    /**
+     * @brief Create an empty MemTable.
+     * @param options Settings of the tree the MemTable belongs to; memtable_size is its capacity.
+     */
+    explicit BasicMemTable(const Options &options = Options())
+        : list(new Rep()), range_deletions(nullptr), range_deletion_bytes(0), capacity(options.memtable_size) {
     }
 
+    BasicMemTable(const BasicMemTable &) = delete;
+    BasicMemTable &operator=(const BasicMemTable &) = delete;
+
     /**
      * @brief Put a key-value pair into the MemTable.
      *
      * @param key The key to be inserted.
      * @param value The value associated with the key.
+     * @param sequence The sequence number of the write, larger than any before it.
      */
-    void put(const std::string &key, const std::string &value) {
-        list->put(key, value);
+    void put(std::string_view key, std::string_view value, uint64_t sequence) {
+        list->put(key, value, sequence);
     }
     /**
      * @brief Get the value associated with a key.
      *
      * @param key
+     * @param sequence Only writes with a sequence number up to this one are seen.
      * @return std::pair<bool, std::string>
      *         A pair where the first element indicates if the key was found,
      *         and the second element is the value associated with the key.
      *         If the key was not found, the first element will be false and the second element will be an empty string.
-     *         If the key was found but marked as TOMBSTONE, the first element will be false and the second element will be TOMBSTONE.
+     *         If the key was found but marked as TOMBSTONE, or its value has expired, or a newer range deletion
+     *         covers it, the first element will be false and the second element will be TOMBSTONE. Found values
+     *         keep their expiry header, if any.
      */
-    std::pair<bool, std::string> get(const std::string &key) {
-        std::pair<bool, std::string> result = list->get(key);
+    std::pair<bool, std::string> get(std::string_view key, uint64_t sequence = MAX_SEQUENCE) {
+        uint64_t found_sequence = 0;
+        std::pair<bool, std::string> result = list->get(key, sequence, &found_sequence);
+        if (rangeDeletedAt(key, sequence) > found_sequence) {
+            return {false, TOMBSTONE};
+        }
         if (!result.first) {
             return {false, ""};
         }
-        if (result.second == TOMBSTONE) {
-            return {false, result.second};
+        if (result.second == TOMBSTONE || Expiry::isExpired(result.second, Expiry::nowMillis())) {
+            return {false, TOMBSTONE};
         }
         return {true, result.second};
     }
@@ -63,36 +115,158 @@ public:
      * @brief Remove a key from the MemTable.
      *
      * @param key The key to be removed.
+     * @param sequence The sequence number of the write, larger than any before it.
      */
-    void remove(const std::string &key) {
-        list->put(key, TOMBSTONE);
+    void remove(std::string_view key, uint64_t sequence) {
+        list->put(key, TOMBSTONE, sequence);
         return;
     }
 
+    /**
+     * @brief Delete every key in [start, end).
+     * @details Like put(), calls must be serialized; readers are safe, since a range tombstone is
+     *          fully built before it is published with a release store.
+     * @param start First key deleted.
+     * @param end Key the deletion stops before.
+     * @param sequence The sequence number of the write, larger than any before it.
+     */
+    void removeRange(std::string_view start, std::string_view end, uint64_t sequence) {
+        RangeDeletionNode *node = new RangeDeletionNode{{std::string(start), std::string(end), sequence},
+                                                        range_deletions.load(std::memory_order_relaxed)};
+        range_deletion_bytes.fetch_add(sizeof(RangeDeletionNode) + start.size() + end.size(), std::memory_order_relaxed);
+        range_deletions.store(node, std::memory_order_release);
+    }
+
+    /**
+     * @brief Get the sequence number of the newest range deletion covering a key.
+     * @param key The key.
+     * @param sequence Only writes with a sequence number up to this one are seen.
+     * @return uint64_t The sequence number, 0 if no range deletion covers the key.
+     */
+    uint64_t rangeDeletedAt(std::string_view key, uint64_t sequence = MAX_SEQUENCE) const {
+        for (const RangeDeletionNode *node = range_deletions.load(std::memory_order_acquire); node != nullptr; node = node->next) {
+            // Newest first, so the first match is the newest
+            if (node->tombstone.sequence <= sequence && node->tombstone.covers(key)) {
+                return node->tombstone.sequence;
+            }
+        }
+        return 0;
+    }
+
+    /**
+     * @brief Check whether the MemTable holds any range deletion.
+     */
+    bool hasRangeDeletions() const {
+        return range_deletions.load(std::memory_order_acquire) != nullptr;
+    }
+
+    /**
+     * @brief Get the range tombstones, newest first.
+     * @param sequence Only writes with a sequence number up to this one are seen.
+     */
+    std::vector<RangeTombstone> getRangeTombstones(uint64_t sequence = MAX_SEQUENCE) const {
+        std::vector<RangeTombstone> tombstones;
+        for (const RangeDeletionNode *node = range_deletions.load(std::memory_order_acquire); node != nullptr; node = node->next) {
+            if (node->tombstone.sequence <= sequence) {
+                tombstones.push_back(node->tombstone);
+            }
+        }
+        return tombstones;
+    }
+
     /**
      * @brief Get the size of the MemTable.
      *
-     * @return size_t The size of the MemTable in bytes.
+     * @return size_t The memory held by the MemTable in bytes, including node overhead and range tombstones.
      */
     size_t getSize() {
-        return list->getSize();
+        return list->getSize() + range_deletion_bytes.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Check whether the MemTable has reached its capacity and should be rotated.
+     */
+    bool isFull() {
+        return getSize() >= capacity;
+    }
+
+    /**
+     * @brief Record a write-ahead log file covered by this MemTable.
+     * @details The file may be deleted once this MemTable has been flushed to an SSTable.
+     * @param log_file Path of the log file.
+     */
+    void addLogFile(const std::string &log_file) {
+        log_files.push_back(log_file);
     }
 
-    Iterator begin() {
-        return list->begin();
+    /**
+     * @brief Get the write-ahead log files covered by this MemTable.
+     *
+     * @return const std::vector<std::string>& Paths of the log files.
+     */
+    const std::vector<std::string> &getLogFiles() const {
+        return log_files;
+    }
+
+    /**
+     * @brief Get an iterator at the first key.
+     * @param sequence Only writes with a sequence number up to this one are seen.
+     */
+    Iterator begin(uint64_t sequence = MAX_SEQUENCE) {
+        return list->begin(sequence);
     }
 
     Iterator end() {
         return list->end();
     }
 
-    Iterator find(const std::string &key) {
+    /**
+     * @brief Position an iterator at the first key not less than key.
+     * @param key The key to seek to.
+     * @param sequence Only writes with a sequence number up to this one are seen.
+     * @return Iterator The iterator, or end() if every key is smaller.
+     */
+    Iterator seek(std::string_view key, uint64_t sequence = MAX_SEQUENCE) {
+        return list->seek(key, sequence);
+    }
+
+    /**
+     * @brief Check whether any write or range deletion touches a key range.
+     * @param smallest Lower bound of the range, inclusive.
+     * @param largest Upper bound of the range, inclusive.
+     * @return bool True if a key in [smallest, largest] was written or a range deletion intersects the range.
+     */
+    bool overlaps(std::string_view smallest, std::string_view largest) {
+        Iterator it = list->seek(smallest);
+        if (it != list->end() && it.key() <= largest) {
+            return true;
+        }
+        for (const RangeDeletionNode *node = range_deletions.load(std::memory_order_acquire); node != nullptr; node = node->next) {
+            if (node->tombstone.start <= largest && smallest < node->tombstone.end) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    Iterator find(std::string_view key) {
         return list->find(key);
     }
 
-    ~MemTable() {
+    ~BasicMemTable() {
+        RangeDeletionNode *node = range_deletions.load(std::memory_order_relaxed);
+        while (node != nullptr) {
+            RangeDeletionNode *next = node->next;
+            delete node;
+            node = next;
+        }
         delete list;
     }
 };
 
+/**
+ * @brief The MemTable of the default EnginePolicy.
+ */
+using MemTable = BasicMemTable<>;
+
 #endif
\ No newline at end of file
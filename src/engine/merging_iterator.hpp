@@ -0,0 +1,344 @@
+/**
+ * @file merging_iterator.hpp
+ * @brief Sorted iterators over the layers of the LSM tree
+ * @details This file contains a common iterator interface for MemTables, single SSTables and
+ *          whole levels of disjoint SSTables, and the merging iterator that combines them into
+ *          one sorted stream. Every layer is already sorted, so merging needs only one entry per
+ *          source in a heap; nothing is copied into memory beyond the current record of each.
+ * @author Gana Jayant Sigadam
+ * @date March 2025
+ * @version 1.0
+ */
+#ifndef MERGING_ITERATOR_HPP
+#define MERGING_ITERATOR_HPP
+
+#include "memtable.hpp"
+#include "sstable.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/**
+ * @class InternalIterator
+ * @brief Sorted iterator over one source of records, tombstones included
+ * @details The views returned by key() and value() are valid until the iterator next moves.
+ *          A new iterator is unpositioned: call seekToFirst() or seek() before reading it.
+ */
+class InternalIterator {
+public:
+    virtual ~InternalIterator() = default;
+
+    /**
+     * @brief Check whether the iterator is positioned at a record
+     */
+    virtual bool isValid() const = 0;
+
+    virtual std::string_view key() const = 0;
+
+    /**
+     * @brief Get the value of the current record, TOMBSTONE for a deleted key
+     */
+    virtual std::string_view value() const = 0;
+
+    virtual void seekToFirst() = 0;
+
+    /**
+     * @brief Position the iterator at the first record with a key not less than target
+     */
+    virtual void seek(std::string_view target) = 0;
+
+    virtual void next() = 0;
+
+    /**
+     * @brief Check whether a range tombstone of this source deletes a key in older sources
+     */
+    virtual bool deletesKey(std::string_view) const {
+        return false;
+    }
+
+    /**
+     * @brief Check whether the current record is hidden by a newer range tombstone of the same source
+     */
+    virtual bool isRangeDeleted() const {
+        return false;
+    }
+};
+
+/**
+ * @class BasicMemTableIterator
+ * @brief Iterator over a MemTable as of a sequence number, safe to use while a writer inserts
+ * @tparam Table The MemTable type, a BasicMemTable of the tree's policy.
+ */
+template <typename Table = MemTable>
+class BasicMemTableIterator : public InternalIterator {
+private:
+    Table *memtable;
+    uint64_t sequence; ///< Writes after this one are not seen.
+    typename Table::Iterator current;
+
+public:
+    explicit BasicMemTableIterator(Table *memtable, uint64_t sequence = Table::MAX_SEQUENCE)
+        : memtable(memtable), sequence(sequence), current(memtable->end()) {}
+
+    bool isValid() const override {
+        return current != memtable->end();
+    }
+
+    std::string_view key() const override {
+        return current.key();
+    }
+
+    std::string_view value() const override {
+        return current.value();
+    }
+
+    void seekToFirst() override {
+        current = memtable->begin(sequence);
+    }
+
+    void seek(std::string_view target) override {
+        current = memtable->seek(target, sequence);
+    }
+
+    void next() override {
+        ++current;
+    }
+
+    bool deletesKey(std::string_view key) const override {
+        return memtable->hasRangeDeletions() && memtable->rangeDeletedAt(key, sequence) > 0;
+    }
+
+    bool isRangeDeleted() const override {
+        return memtable->hasRangeDeletions() && memtable->rangeDeletedAt(current.key(), sequence) > current.writeSequence();
+    }
+};
+
+using MemTableIterator = BasicMemTableIterator<>;
+
+/**
+ * @class TableIterator
+ * @brief Iterator over one SSTable, such as an L0 table whose range overlaps its neighbours
+ */
+class TableIterator : public InternalIterator {
+private:
+    const SS_Table *table;
+    std::optional<SS_Table::Iterator> current;
+
+public:
+    explicit TableIterator(const SS_Table *table) : table(table) {}
+
+    bool isValid() const override {
+        return current.has_value() && current->isValid();
+    }
+
+    std::string_view key() const override {
+        return current->key();
+    }
+
+    std::string_view value() const override {
+        return current->value();
+    }
+
+    void seekToFirst() override {
+        current.emplace(table->iterator());
+    }
+
+    void seek(std::string_view target) override {
+        current.emplace(table->iterator(target));
+    }
+
+    void next() override {
+        current->next();
+    }
+
+    bool deletesKey(std::string_view key) const override {
+        return table->deletesKey(key);
+    }
+};
+
+/**
+ * @class LevelIterator
+ * @brief Iterator over a level of disjoint SSTables sorted by key
+ * @details Only one table of the level is open for reading at a time; a seek picks the table
+ *          by its key range, so the other tables of the level are not touched. A table that
+ *          cannot be read is skipped, as it would be by a point lookup.
+ */
+class LevelIterator : public InternalIterator {
+private:
+    const std::vector<std::shared_ptr<SS_Table>> *tables;
+    size_t index = 0; ///< Table the current iterator reads.
+    std::optional<SS_Table::Iterator> current;
+
+    /**
+     * @brief Moves on to the next tables of the level while the current one is exhausted
+     */
+    void skipExhausted() {
+        while (!isValid() && index + 1 < tables->size()) {
+            ++index;
+            current.emplace((*tables)[index]->iterator());
+        }
+    }
+
+public:
+    explicit LevelIterator(const std::vector<std::shared_ptr<SS_Table>> *tables) : tables(tables) {}
+
+    bool isValid() const override {
+        return current.has_value() && current->isValid();
+    }
+
+    std::string_view key() const override {
+        return current->key();
+    }
+
+    std::string_view value() const override {
+        return current->value();
+    }
+
+    void seekToFirst() override {
+        index = 0;
+        current.reset();
+        if (!tables->empty()) {
+            current.emplace(tables->front()->iterator());
+            skipExhausted();
+        }
+    }
+
+    void seek(std::string_view target) override {
+        // The first table whose last key is not less than the target
+        auto it = std::lower_bound(tables->begin(), tables->end(), target,
+                                   [](const std::shared_ptr<SS_Table> &sstable, std::string_view k) {
+                                       return sstable->getLargestKey() < k;
+                                   });
+        index = static_cast<size_t>(it - tables->begin());
+        current.reset();
+        if (it != tables->end()) {
+            current.emplace((*it)->iterator(target));
+            skipExhausted();
+        }
+    }
+
+    void next() override {
+        current->next();
+        skipExhausted();
+    }
+
+    bool deletesKey(std::string_view key) const override {
+        // Only the table whose range holds the key can cover it
+        auto it = std::lower_bound(tables->begin(), tables->end(), key,
+                                   [](const std::shared_ptr<SS_Table> &sstable, std::string_view k) {
+                                       return sstable->getLargestKey() < k;
+                                   });
+        return it != tables->end() && (*it)->getSmallestKey() <= key && (*it)->deletesKey(key);
+    }
+};
+
+/**
+ * @class MergingIterator
+ * @brief Merges sorted sources into one stream holding the newest version of each key
+ * @details Sources are ranked newest first. When several hold the same key, only the record
+ *          of the newest one is returned and the others are skipped, so shadowed versions never
+ *          surface; tombstones are returned like any other record and left to the caller, and so
+ *          are records hidden by range tombstones, which isRangeDeleted() reports.
+ */
+class MergingIterator : public InternalIterator {
+private:
+    std::vector<std::unique_ptr<InternalIterator>> children; ///< Sources, newest first.
+    std::vector<size_t> heap;                                ///< Positioned sources, smallest key (then newest) on top.
+    std::string current_key;                                 ///< Copy of the key being skipped past by next().
+
+    /**
+     * @brief Heap order: true if source a's record comes after source b's
+     */
+    bool later(size_t a, size_t b) const {
+        int cmp = children[a]->key().compare(children[b]->key());
+        if (cmp != 0) {
+            return cmp > 0;
+        }
+        return a > b;
+    }
+
+    void rebuildHeap() {
+        heap.clear();
+        for (size_t i = 0; i < children.size(); ++i) {
+            if (children[i]->isValid()) {
+                heap.push_back(i);
+            }
+        }
+        std::make_heap(heap.begin(), heap.end(), [this](size_t a, size_t b) { return later(a, b); });
+    }
+
+public:
+    /**
+     * @brief Creates a merging iterator over sources ranked newest first
+     * @param children The sources; unpositioned.
+     */
+    explicit MergingIterator(std::vector<std::unique_ptr<InternalIterator>> children) : children(std::move(children)) {}
+
+    bool isValid() const override {
+        return !heap.empty();
+    }
+
+    std::string_view key() const override {
+        return children[heap.front()]->key();
+    }
+
+    std::string_view value() const override {
+        return children[heap.front()]->value();
+    }
+
+    void seekToFirst() override {
+        for (std::unique_ptr<InternalIterator> &child : children) {
+            child->seekToFirst();
+        }
+        rebuildHeap();
+    }
+
+    void seek(std::string_view target) override {
+        for (std::unique_ptr<InternalIterator> &child : children) {
+            child->seek(target);
+        }
+        rebuildHeap();
+    }
+
+    /**
+     * @brief Check whether the current record is hidden by a range tombstone of its own or a newer source
+     */
+    bool isRangeDeleted() const override {
+        size_t source = heap.front();
+        if (children[source]->isRangeDeleted()) {
+            return true;
+        }
+        std::string_view current = key();
+        for (size_t newer = 0; newer < source; ++newer) {
+            if (children[newer]->deletesKey(current)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void next() override {
+        auto order = [this](size_t a, size_t b) { return later(a, b); };
+        current_key.assign(key());
+        // Advance the newest record and every older version of the same key
+        while (!heap.empty() && children[heap.front()]->key() == current_key) {
+            std::pop_heap(heap.begin(), heap.end(), order);
+            size_t child = heap.back();
+            heap.pop_back();
+            children[child]->next();
+            if (children[child]->isValid()) {
+                heap.push_back(child);
+                std::push_heap(heap.begin(), heap.end(), order);
+            }
+        }
+    }
+};
+
+#endif
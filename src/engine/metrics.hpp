@@ -0,0 +1,312 @@
+/**
+ * @file metrics.hpp
+ * @brief Process-wide latency histograms and counters
+ * @details This file contains the instrumentation behind the INFO command: log-linear latency
+ *          histograms for server commands and for the engine's reads, writes, flushes and
+ *          compactions, and counters of the work done by flushes and compactions. Every thread
+ *          records into a block of its own, so a recording touches no cache line another thread
+ *          writes to and needs no atomic read-modify-write; a reader sums the blocks of every thread.
+ * @author Gana Jayant Sigadam
+ * @date March 2025
+ * @version 1.0
+ */
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief Engine operations timed by Metrics
+ */
+enum class Timer : size_t {
+    GET,        ///< LSMTree::get().
+    PUT,        ///< LSMTree::put() and putWithExpiry().
+    FLUSH,      ///< Writing one immutable MemTable to an SSTable.
+    COMPACTION, ///< One compaction, from merge to manifest edit.
+    COUNT
+};
+
+/**
+ * @brief Engine counters kept by Metrics
+ */
+enum class Counter : size_t {
+    FLUSH_BYTES,              ///< Bytes of the SSTables written by flushes.
+    COMPACTION_BYTES_READ,    ///< Bytes of the input tables of finished compactions.
+    COMPACTION_BYTES_WRITTEN, ///< Bytes of the output tables of finished compactions.
+    COUNT
+};
+
+/**
+ * @class LatencyHistogram
+ * @brief Log-linear histogram of latencies in microseconds
+ * @details Values below SUB_BUCKETS get a bucket each; above, every power of two is split into
+ *          SUB_BUCKETS equal buckets, so a recorded value is known to within 1/SUB_BUCKETS of itself,
+ *          as in an HDR histogram with one significant digit. Latencies of up to about 12 days fit.
+ */
+class LatencyHistogram {
+public:
+    static constexpr size_t SUB_BUCKET_BITS = 3;
+    static constexpr size_t SUB_BUCKETS = size_t(1) << SUB_BUCKET_BITS;
+    static constexpr size_t MAX_BIT = 39;
+    static constexpr size_t BUCKETS = (MAX_BIT - SUB_BUCKET_BITS + 2) * SUB_BUCKETS;
+
+    std::array<uint64_t, BUCKETS> buckets{}; ///< Number of values recorded in each bucket.
+    uint64_t count = 0;                      ///< Number of values recorded.
+    uint64_t sum = 0;                        ///< Sum of the values recorded.
+    uint64_t max = 0;                        ///< Largest value recorded.
+
+    /**
+     * @brief Gets the bucket a value falls in.
+     */
+    static size_t bucketOf(uint64_t micros) {
+        if (micros < SUB_BUCKETS) {
+            return static_cast<size_t>(micros);
+        }
+        size_t bit = 63 - static_cast<size_t>(__builtin_clzll(micros));
+        if (bit > MAX_BIT) {
+            return BUCKETS - 1;
+        }
+        size_t shift = bit - SUB_BUCKET_BITS;
+        return (bit - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + static_cast<size_t>((micros >> shift) & (SUB_BUCKETS - 1));
+    }
+
+    /**
+     * @brief Gets the largest value that falls in a bucket.
+     */
+    static uint64_t bucketUpperBound(size_t bucket) {
+        if (bucket < SUB_BUCKETS) {
+            return bucket;
+        }
+        size_t shift = bucket / SUB_BUCKETS - 1;
+        uint64_t lower = (SUB_BUCKETS + bucket % SUB_BUCKETS) << shift;
+        return lower + (uint64_t(1) << shift) - 1;
+    }
+
+    /**
+     * @brief Records a value; not thread-safe, see Metrics for concurrent recording.
+     */
+    void record(uint64_t micros) {
+        ++buckets[bucketOf(micros)];
+        ++count;
+        sum += micros;
+        max = std::max(max, micros);
+    }
+
+    /**
+     * @brief Adds the values recorded by another histogram.
+     */
+    void merge(const LatencyHistogram &other) {
+        for (size_t bucket = 0; bucket < BUCKETS; ++bucket) {
+            buckets[bucket] += other.buckets[bucket];
+        }
+        count += other.count;
+        sum += other.sum;
+        max = std::max(max, other.max);
+    }
+
+    /**
+     * @brief Gets a percentile of the recorded values.
+     * @param percentile The percentile, from 0 to 100.
+     * @return uint64_t The upper bound of the bucket holding the percentile, capped at the largest
+     *         value recorded; 0 if nothing was recorded.
+     */
+    uint64_t percentile(double percentile) const {
+        if (count == 0) {
+            return 0;
+        }
+        uint64_t rank = static_cast<uint64_t>(percentile / 100.0 * static_cast<double>(count) + 0.5);
+        rank = std::clamp<uint64_t>(rank, 1, count);
+        uint64_t seen = 0;
+        for (size_t bucket = 0; bucket < BUCKETS; ++bucket) {
+            seen += buckets[bucket];
+            if (seen >= rank) {
+                return std::min(bucketUpperBound(bucket), max);
+            }
+        }
+        return max;
+    }
+
+    /**
+     * @brief Gets the mean of the recorded values, 0 if nothing was recorded.
+     */
+    double mean() const {
+        return count == 0 ? 0.0 : static_cast<double>(sum) / static_cast<double>(count);
+    }
+};
+
+/**
+ * @class Metrics
+ * @brief Static entry points for recording and reading the process's metrics
+ * @details Each recording thread is given a ThreadMetrics block the first time it records. Only that
+ *          thread writes to it, with relaxed loads and stores rather than atomic increments, and the
+ *          block is aligned to its own cache lines. When the thread exits its block is handed to the
+ *          next new thread with its counts intact, so threads started per subcompaction do not grow
+ *          the set of blocks. Reading sums every block and may miss recordings in flight.
+ *
+ *          Server commands are timed by slot: callers give each command a slot below COMMAND_SLOTS and
+ *          keep its name themselves.
+ */
+class Metrics {
+public:
+    static constexpr size_t COMMAND_SLOTS = 16;
+
+    /**
+     * @brief Records the latency of an engine operation.
+     */
+    static void record(Timer timer, uint64_t micros) {
+        local().timers[static_cast<size_t>(timer)].record(micros);
+    }
+
+    /**
+     * @brief Records the latency of a server command.
+     * @param command The command's slot; slots at or above COMMAND_SLOTS are ignored.
+     */
+    static void recordCommand(size_t command, uint64_t micros) {
+        if (command < COMMAND_SLOTS) {
+            local().commands[command].record(micros);
+        }
+    }
+
+    /**
+     * @brief Adds to an engine counter.
+     */
+    static void add(Counter counter, uint64_t amount) {
+        bump(local().counters[static_cast<size_t>(counter)], amount);
+    }
+
+    static LatencyHistogram getHistogram(Timer timer) {
+        return collect([timer](const ThreadMetrics &block) -> const AtomicHistogram & {
+            return block.timers[static_cast<size_t>(timer)];
+        });
+    }
+
+    static LatencyHistogram getCommandHistogram(size_t command) {
+        if (command >= COMMAND_SLOTS) {
+            return LatencyHistogram();
+        }
+        return collect([command](const ThreadMetrics &block) -> const AtomicHistogram & { return block.commands[command]; });
+    }
+
+    static uint64_t getCounter(Counter counter) {
+        Registry &registry = registry_instance();
+        std::lock_guard<std::mutex> lock(registry.mtx);
+        uint64_t total = 0;
+        for (const std::unique_ptr<ThreadMetrics> &block : registry.blocks) {
+            total += block->counters[static_cast<size_t>(counter)].load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    /**
+     * @brief Gets the microseconds elapsed since a start time, for passing to record().
+     */
+    static uint64_t microsSince(std::chrono::steady_clock::time_point start) {
+        return static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+    }
+
+private:
+    /**
+     * @brief Increments a value only the calling thread writes, without a locked instruction.
+     */
+    static void bump(std::atomic<uint64_t> &value, uint64_t amount) {
+        value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+
+    struct AtomicHistogram {
+        std::array<std::atomic<uint64_t>, LatencyHistogram::BUCKETS> buckets{};
+        std::atomic<uint64_t> count{0};
+        std::atomic<uint64_t> sum{0};
+        std::atomic<uint64_t> max{0};
+
+        void record(uint64_t micros) {
+            bump(buckets[LatencyHistogram::bucketOf(micros)], 1);
+            bump(count, 1);
+            bump(sum, micros);
+            if (micros > max.load(std::memory_order_relaxed)) {
+                max.store(micros, std::memory_order_relaxed);
+            }
+        }
+
+        void addTo(LatencyHistogram &histogram) const {
+            for (size_t bucket = 0; bucket < LatencyHistogram::BUCKETS; ++bucket) {
+                histogram.buckets[bucket] += buckets[bucket].load(std::memory_order_relaxed);
+            }
+            histogram.count += count.load(std::memory_order_relaxed);
+            histogram.sum += sum.load(std::memory_order_relaxed);
+            histogram.max = std::max(histogram.max, max.load(std::memory_order_relaxed));
+        }
+    };
+
+    /**
+     * @brief The metrics recorded by one thread
+     */
+    struct alignas(64) ThreadMetrics {
+        std::array<AtomicHistogram, static_cast<size_t>(Timer::COUNT)> timers;
+        std::array<AtomicHistogram, COMMAND_SLOTS> commands;
+        std::array<std::atomic<uint64_t>, static_cast<size_t>(Counter::COUNT)> counters{};
+    };
+
+    struct Registry {
+        std::mutex mtx;
+        std::vector<std::unique_ptr<ThreadMetrics>> blocks; ///< Every block ever handed out.
+        std::vector<ThreadMetrics *> free_blocks;           ///< Blocks of threads that have exited.
+    };
+
+    /**
+     * @brief Owns the calling thread's block, and returns it to the registry when the thread exits
+     */
+    struct LocalBlock {
+        ThreadMetrics *block;
+
+        LocalBlock() {
+            Registry &registry = registry_instance();
+            std::lock_guard<std::mutex> lock(registry.mtx);
+            if (!registry.free_blocks.empty()) {
+                block = registry.free_blocks.back();
+                registry.free_blocks.pop_back();
+            } else {
+                registry.blocks.push_back(std::make_unique<ThreadMetrics>());
+                block = registry.blocks.back().get();
+            }
+        }
+
+        ~LocalBlock() {
+            Registry &registry = registry_instance();
+            std::lock_guard<std::mutex> lock(registry.mtx);
+            registry.free_blocks.push_back(block);
+        }
+    };
+
+    static Registry &registry_instance() {
+        // Never destroyed, so threads exiting after main() returns can still hand back their blocks
+        static Registry *registry = new Registry();
+        return *registry;
+    }
+
+    static ThreadMetrics &local() {
+        thread_local LocalBlock local_block;
+        return *local_block.block;
+    }
+
+    template <typename Select>
+    static LatencyHistogram collect(Select select) {
+        Registry &registry = registry_instance();
+        std::lock_guard<std::mutex> lock(registry.mtx);
+        LatencyHistogram histogram;
+        for (const std::unique_ptr<ThreadMetrics> &block : registry.blocks) {
+            select(*block).addTo(histogram);
+        }
+        return histogram;
+    }
+};
+
+#endif
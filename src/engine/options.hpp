@@ -0,0 +1,101 @@
+/**
+ * @file options.hpp
+ * @brief Per-tree engine settings
+ * @details This file contains the Options a tree is opened with. Every field defaults to the
+ *          matching constant in constants.hpp, so `Options()` opens a tree configured as before, and
+ *          trees with different settings, such as a small-value cache tier and a large-value archive
+ *          tier, can live in one process.
+ * @author Gana Jayant Sigadam
+ * @date March 2025
+ * @version 1.0
+ */
+#ifndef OPTIONS_HPP
+#define OPTIONS_HPP
+
+#include "constants.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+/**
+ * @struct Options
+ * @brief Settings of one LSMTree and of the MemTables and SSTables it creates
+ * @details A tree copies its Options when it is opened and never changes them. Fields that shape the
+ *          files already written, such as the block size or the Bloom filter bits, apply to new
+ *          tables only; every table keeps the format it was written with.
+ */
+struct Options {
+    std::string data_dir = DATA_DIR; ///< Directory of the tree's files, ending in '/'.
+
+    // MemTables
+    size_t memtable_size = MAX_MEMTABLE_SIZE;                 ///< Size at which the active MemTable is rotated.
+    size_t max_immutable_memtables = MAX_IMMUTABLE_MEMTABLES; ///< MemTables awaiting flush at which writes stop.
+
+    // SSTables
+    size_t block_size = BLOCK_SIZE;                         ///< Target size of a data block.
+    size_t block_restart_interval = BLOCK_RESTART_INTERVAL; ///< Keys between restart points, the density of the in-block index.
+    size_t bloom_bits_per_key = BLOOM_BITS_PER_KEY;         ///< Bloom filter bits per key, 0 for no filter.
+    CompressionType compression = BLOCK_COMPRESSION;        ///< Codec of flushed and compacted tables.
+    CompressionType bottommost_compression = BOTTOMMOST_COMPRESSION; ///< Codec of compaction output at the bottom of the tree.
+    SSTableReadMode read_mode = SSTABLE_READ_MODE;          ///< How data files are read.
+    size_t target_sstable_size = TARGET_SSTABLE_SIZE;       ///< Size at which compaction output is split.
+    size_t block_cache_capacity = BLOCK_CACHE_CAPACITY;     ///< Budget of a cache made by newBlockCache(), 0 for none.
+
+    // Compaction
+    CompactionStyle compaction_style = COMPACTION_STYLE;
+    size_t num_levels = NUM_LEVELS;                           ///< Levels of the leveled layout, including L0.
+    size_t l0_compaction_trigger = L0_COMPACTION_TRIGGER;     ///< L0 tables that trigger a compaction into L1.
+    uint64_t max_bytes_for_level_base = MAX_BYTES_FOR_LEVEL_BASE; ///< Target size of L1.
+    uint64_t level_size_multiplier = LEVEL_SIZE_MULTIPLIER;   ///< Size ratio between consecutive levels.
+    size_t tiered_min_merge_width = TIERED_MIN_MERGE_WIDTH;   ///< Fewest tables one tiered compaction merges.
+    uint64_t tiered_size_ratio = TIERED_SIZE_RATIO;           ///< Largest size ratio between tables merged by tiered compaction.
+    size_t max_subcompactions = MAX_SUBCOMPACTIONS;           ///< Key ranges one leveled compaction is split into; also sizes the subcompaction pool.
+
+    // Write stalls
+    size_t l0_slowdown_writes_trigger = L0_SLOWDOWN_WRITES_TRIGGER; ///< L0 tables at which writes slow down.
+    size_t l0_stop_writes_trigger = L0_STOP_WRITES_TRIGGER;         ///< L0 tables at which writes stop.
+    uint64_t delayed_write_rate = DELAYED_WRITE_RATE;               ///< Bytes per second of slowed-down writes.
+
+    // Threads
+    size_t flush_threads = FLUSH_THREADS;
+    size_t compaction_threads = COMPACTION_THREADS;
+
+    // Write-ahead log
+    WalSyncMode wal_sync_mode = WAL_SYNC_MODE;
+    int wal_sync_interval_ms = WAL_SYNC_INTERVAL_MS;
+
+    // Sharding
+    size_t num_shards = NUM_SHARDS; ///< Shards of a new ShardedLSMTree data directory.
+
+    /**
+     * @brief Checks that the settings can run a tree.
+     * @throws std::invalid_argument naming the first setting out of range.
+     */
+    void validate() const {
+        auto require = [](bool ok, const char *message) {
+            if (!ok) {
+                throw std::invalid_argument(std::string("Invalid options: ") + message);
+            }
+        };
+        require(!data_dir.empty() && data_dir.back() == '/', "data_dir must end in '/'");
+        require(memtable_size > 0, "memtable_size must be positive");
+        require(max_immutable_memtables > 0, "max_immutable_memtables must be positive");
+        require(block_size > 0, "block_size must be positive");
+        require(block_restart_interval > 0, "block_restart_interval must be positive");
+        require(target_sstable_size > 0, "target_sstable_size must be positive");
+        require(num_levels >= 2, "num_levels must be at least 2");
+        require(l0_compaction_trigger > 0, "l0_compaction_trigger must be positive");
+        require(level_size_multiplier >= 2, "level_size_multiplier must be at least 2");
+        require(tiered_min_merge_width >= 2, "tiered_min_merge_width must be at least 2");
+        require(tiered_size_ratio >= 1, "tiered_size_ratio must be at least 1");
+        require(max_subcompactions > 0, "max_subcompactions must be positive");
+        require(delayed_write_rate > 0, "delayed_write_rate must be positive");
+        require(flush_threads > 0 && compaction_threads > 0, "flush_threads and compaction_threads must be positive");
+        require(wal_sync_interval_ms > 0, "wal_sync_interval_ms must be positive");
+        require(num_shards > 0, "num_shards must be positive");
+    }
+};
+
+#endif
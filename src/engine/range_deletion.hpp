@@ -0,0 +1,161 @@
+/**
+ * @file range_deletion.hpp
+ * @brief Range tombstones
+ * @details This file contains the range tombstone, one record that deletes every key in [start, end),
+ *          and the helpers shared by the places that store or apply them. A range deletion costs one
+ *          write whatever the number of keys it covers. MemTables keep their range tombstones next to the
+ *          skip list, and SSTables in a range deletion block of their own, so neither is carried through
+ *          the data blocks. A range tombstone hides older versions of the keys it covers, in older
+ *          MemTables and SSTables, while newer writes of those keys stay visible.
+ * @author Gana Jayant Sigadam
+ * @date March 2025
+ * @version 1.0
+ */
+#ifndef RANGE_DELETION_HPP
+#define RANGE_DELETION_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @struct RangeTombstone
+ * @brief Deletion of every key in [start, end)
+ */
+struct RangeTombstone {
+    std::string start;     ///< First key deleted.
+    std::string end;       ///< Key the deletion stops before.
+    uint64_t sequence = 0; ///< Sequence number of the write in a MemTable; unused in SSTables.
+
+    bool covers(std::string_view key) const {
+        return start <= key && key < end;
+    }
+};
+
+/**
+ * @class RangeDeletion
+ * @brief Static helpers for lists of range tombstones
+ * @details Within one SSTable every record is newer than every range tombstone of the same table, as
+ *          the flush or compaction that wrote it already dropped the records they cover. A table's
+ *          tombstones therefore only apply to older tables, whatever their order, and are stored as
+ *          sorted, disjoint ranges that a lookup binary-searches.
+ */
+class RangeDeletion {
+public:
+    /**
+     * @brief Sorts range tombstones and merges the ones that overlap or touch.
+     * @details Empty ranges are dropped and sequence numbers are cleared.
+     * @param tombstones The tombstones, replaced by sorted, disjoint ranges covering the same keys.
+     */
+    static void normalize(std::vector<RangeTombstone> &tombstones) {
+        tombstones.erase(std::remove_if(tombstones.begin(), tombstones.end(),
+                                        [](const RangeTombstone &t) { return t.start >= t.end; }),
+                         tombstones.end());
+        std::sort(tombstones.begin(), tombstones.end(),
+                  [](const RangeTombstone &a, const RangeTombstone &b) { return a.start < b.start; });
+        size_t merged = 0;
+        for (size_t i = 0; i < tombstones.size(); ++i) {
+            if (merged > 0 && tombstones[i].start <= tombstones[merged - 1].end) {
+                tombstones[merged - 1].end = std::max(tombstones[merged - 1].end, tombstones[i].end);
+                continue;
+            }
+            if (merged != i) {
+                tombstones[merged] = std::move(tombstones[i]);
+            }
+            tombstones[merged].sequence = 0;
+            ++merged;
+        }
+        tombstones.resize(merged);
+    }
+
+    /**
+     * @brief Checks whether sorted, disjoint ranges cover a key.
+     * @param tombstones Ranges as left by normalize().
+     * @param key The key.
+     */
+    static bool covers(const std::vector<RangeTombstone> &tombstones, std::string_view key) {
+        // The last range starting at or before the key is the only one that can cover it
+        auto it = std::upper_bound(tombstones.begin(), tombstones.end(), key,
+                                   [](std::string_view k, const RangeTombstone &t) { return k < t.start; });
+        return it != tombstones.begin() && key < std::prev(it)->end;
+    }
+
+    /**
+     * @brief Gets the largest key a range ending at end may cover, as a table's largest key.
+     * @details The keys below `key + '\0'` are exactly the keys up to `key`, so for such an end the
+     *          answer is exact. Any other end is returned as it is: one key more than the range
+     *          covers, which only makes the table claim a key it does not hold.
+     */
+    static std::string largestCovered(const std::string &end) {
+        if (!end.empty() && end.back() == '\0') {
+            return end.substr(0, end.size() - 1);
+        }
+        return end;
+    }
+
+    /**
+     * @brief Widens a table's key range to include its range tombstones.
+     * @param tombstones Sorted, disjoint ranges as left by normalize().
+     * @param smallest The smallest key stored in the table, updated.
+     * @param largest The largest key stored in the table, updated.
+     * @param has_keys False if the table holds no records, so only the tombstones give its range.
+     */
+    static void widen(const std::vector<RangeTombstone> &tombstones, std::string &smallest, std::string &largest, bool has_keys) {
+        if (tombstones.empty()) {
+            return;
+        }
+        std::string last = largestCovered(tombstones.back().end);
+        if (!has_keys) {
+            smallest = tombstones.front().start;
+            largest = std::move(last);
+            return;
+        }
+        smallest = std::min(smallest, tombstones.front().start);
+        largest = std::max(largest, last);
+    }
+
+    /**
+     * @brief Clips sorted, disjoint ranges to [lower, upper).
+     * @param tombstones Ranges as left by normalize().
+     * @param lower First key kept, or nullptr for no lower bound.
+     * @param upper Key the result stops before, or nullptr for no upper bound.
+     * @return std::vector<RangeTombstone> The non-empty parts of the ranges within the bounds.
+     */
+    static std::vector<RangeTombstone> clip(const std::vector<RangeTombstone> &tombstones, const std::string *lower,
+                                            const std::string *upper) {
+        std::vector<RangeTombstone> clipped;
+        for (const RangeTombstone &tombstone : tombstones) {
+            RangeTombstone part = tombstone;
+            if (lower != nullptr && part.start < *lower) {
+                part.start = *lower;
+            }
+            if (upper != nullptr && part.end > *upper) {
+                part.end = *upper;
+            }
+            if (part.start < part.end) {
+                clipped.push_back(std::move(part));
+            }
+        }
+        return clipped;
+    }
+
+    /**
+     * @brief Gets the end of the range holding every key that starts with a prefix.
+     * @return std::string The smallest key greater than every key with the prefix, or an empty string if
+     *         there is none (the prefix is empty or all 0xFF bytes).
+     */
+    static std::string prefixEnd(std::string_view prefix) {
+        std::string end(prefix);
+        while (!end.empty() && static_cast<unsigned char>(end.back()) == 0xFF) {
+            end.pop_back();
+        }
+        if (!end.empty()) {
+            end.back() = static_cast<char>(static_cast<unsigned char>(end.back()) + 1);
+        }
+        return end;
+    }
+};
+
+#endif
@@ -0,0 +1,666 @@
+/**
+ * @file sharded_lsm.hpp
+ * @brief Hash-sharded LSM Tree
+ * @details This file contains the ShardedLSMTree, which splits the key space by hash between several
+ *          independent LSMTree instances, each in its own subdirectory of the data directory with its
+ *          own MemTables, write-ahead log and background threads. Writes to different shards share no
+ *          lock, so write throughput scales with the number of shards instead of funnelling into one
+ *          active MemTable. It offers the same interface as LSMTree.
+ * @author Gana Jayant Sigadam
+ * @version 1.0
+ * @date March 2025
+ */
+#ifndef SHARDED_LSM_HPP
+#define SHARDED_LSM_HPP
+
+#include "constants.hpp"
+#include "external_table_writer.hpp"
+#include "lsm.hpp"
+#include "write_batch.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+/**
+ * @class BasicShardedLSMTree
+ * @brief LSM Tree split into independent shards by key hash
+ * @details A key always lives in the shard picked by a fixed 64-bit hash of it, so the number of shards
+ *          is part of the on-disk layout: it is recorded in the SHARDS file when the data directory is
+ *          created, and reopening uses the recorded count whatever is requested. A data directory
+ *          written before sharding, with the tree's files directly inside it, is opened as one shard.
+ *
+ *          Single-key operations touch only their shard. Multi-key operations are split by shard:
+ *          a batch is applied atomically within each shard but not across shards, and a snapshot's
+ *          per-shard views are taken one after another, so a batch spanning shards that races with
+ *          getSnapshot() may be seen in some shards and not others.
+ *
+ *          Every shard is opened with the tree's Options and Policy, in its own subdirectory of
+ *          options.data_dir.
+ */
+template <typename Policy = EnginePolicy<>>
+class BasicShardedLSMTree {
+private:
+    using LSMTree = BasicLSMTree<Policy>;
+
+    std::shared_ptr<BlockCache> block_cache;     /**< Block cache shared by every shard, null if disabled. */
+    std::vector<std::unique_ptr<LSMTree>> shards; /**< The trees, indexed by shard number. */
+    std::vector<std::string> directories;         /**< Directory of each shard, ending in '/'. */
+    std::atomic<uint64_t> ingest_number{0};       /**< Number in the names of the tables split by ingestFiles(). */
+
+    /**
+     * @brief 64-bit FNV-1a hash of a key, with a final mix so every bit depends on every byte.
+     * @details Must never change, as it decides where existing keys are stored. It is deliberately
+     *          unrelated to the Bloom filter hash, whose bits would otherwise be skewed within a shard.
+     */
+    static uint64_t hash(std::string_view key) {
+        uint64_t h = 14695981039346656037ULL;
+        for (char c : key) {
+            h ^= static_cast<unsigned char>(c);
+            h *= 1099511628211ULL;
+        }
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+    size_t shard_for(std::string_view key) const {
+        return shards.size() == 1 ? 0 : hash(key) % shards.size();
+    }
+
+    static bool syncDirectory(const std::string &path) {
+        int dir_fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (dir_fd == -1) {
+            return false;
+        }
+        bool ok = fsync(dir_fd) == 0;
+        close(dir_fd);
+        return ok;
+    }
+
+    /**
+     * @brief Records the number of shards in a new data directory.
+     * @details Written to a temporary file, synced and renamed into place, so the layout file is
+     *          either absent or complete.
+     * @return bool True if successful, otherwise false.
+     */
+    static bool write_shard_count(const std::string &directory, size_t count) {
+        std::string temp = directory + SHARDS_FILE + ".tmp";
+        {
+            std::ofstream file(temp, std::ios::trunc);
+            file << count << "\n";
+            if (!file.flush()) {
+                return false;
+            }
+        }
+        int fd = open(temp.c_str(), O_RDONLY | O_CLOEXEC);
+        bool ok = fd != -1 && fsync(fd) == 0;
+        if (fd != -1) {
+            close(fd);
+        }
+        return ok && std::rename(temp.c_str(), (directory + SHARDS_FILE).c_str()) == 0 && syncDirectory(directory);
+    }
+
+    /**
+     * @brief Works out the directory of every shard, creating the layout of a new data directory.
+     * @param directory The data directory, ending in '/'.
+     * @param requested Number of shards to create if the directory holds no data yet.
+     * @return std::vector<std::string> Directory of each shard, ending in '/'.
+     */
+    static std::vector<std::string> shard_directories(const std::string &directory, size_t requested) {
+        std::filesystem::create_directories(directory);
+        size_t count = requested;
+        if (std::filesystem::exists(directory + SHARDS_FILE)) {
+            std::ifstream file(directory + SHARDS_FILE);
+            if (!(file >> count) || count == 0) {
+                throw std::runtime_error("Invalid shard count in " + directory + SHARDS_FILE);
+            }
+            if (count != requested) {
+                std::cerr << directory << " was created with " << count << " shards, using them instead of " << requested << std::endl;
+            }
+        } else {
+            for (const std::filesystem::directory_entry &entry : std::filesystem::directory_iterator(directory)) {
+                if (entry.is_regular_file()) {
+                    std::cerr << "Opening the unsharded tree in " << directory << " as a single shard" << std::endl;
+                    return {directory};
+                }
+            }
+            if (count == 0 || !write_shard_count(directory, count)) {
+                throw std::runtime_error("Failed to create the shard layout in " + directory + ": " + strerror(errno));
+            }
+        }
+
+        std::vector<std::string> directories;
+        for (size_t i = 0; i < count; ++i) {
+            directories.push_back(directory + SHARD_DIR_PREFIX + std::to_string(i) + "/");
+        }
+        return directories;
+    }
+
+    /**
+     * @brief Checks settings before the data directory is laid out from them.
+     * @throws std::invalid_argument if the options are out of range.
+     */
+    static const Options &validated(const Options &options) {
+        options.validate();
+        return options;
+    }
+
+    /**
+     * @brief Gets default settings with the shard count and data directory replaced.
+     */
+    static Options with_layout(size_t num_shards, const std::string &directory) {
+        Options options;
+        options.num_shards = num_shards;
+        options.data_dir = directory;
+        return options;
+    }
+
+public:
+    /**
+     * @brief Opens or creates the shards in a data directory and starts their background threads.
+     * @param num_shards Number of shards for a new data directory; see the class description.
+     * @param directory The data directory, ending in '/'.
+     */
+    explicit BasicShardedLSMTree(size_t num_shards = NUM_SHARDS, const std::string &directory = DATA_DIR)
+        : BasicShardedLSMTree(with_layout(num_shards, directory)) {}
+
+    /**
+     * @brief Opens or creates the shards in options.data_dir and starts their background threads.
+     * @param options Settings of every shard; options.num_shards is the number of shards for a new
+     *                data directory, and one block cache of options.block_cache_capacity is shared by all.
+     * @throws std::invalid_argument if the options are out of range.
+     */
+    explicit BasicShardedLSMTree(const Options &options)
+        : block_cache(LSMTree::newBlockCache(validated(options))),
+          directories(shard_directories(options.data_dir, options.num_shards)) {
+        for (const std::string &shard_directory : directories) {
+            Options shard_options = options;
+            shard_options.data_dir = shard_directory;
+            shards.push_back(std::make_unique<LSMTree>(shard_options, block_cache));
+        }
+    }
+
+    /**
+     * @brief Gets the number of shards.
+     */
+    size_t shardCount() const {
+        return shards.size();
+    }
+
+    /**
+     * @brief Gets the number of levels of every shard, including L0.
+     */
+    size_t levelCount() const {
+        return shards.front()->levelCount();
+    }
+
+    /**
+     * @brief Inserts a key-value pair; see LSMTree::put().
+     */
+    bool put(std::string_view key, std::string_view value, bool sync = true) {
+        return shards[shard_for(key)]->put(key, value, sync);
+    }
+
+    /**
+     * @brief Inserts a key-value pair that expires; see LSMTree::putWithExpiry().
+     */
+    bool putWithExpiry(std::string_view key, std::string_view value, uint64_t expire_at, bool sync = true) {
+        return shards[shard_for(key)]->putWithExpiry(key, value, expire_at, sync);
+    }
+
+    /**
+     * @brief Sets the expiry time of a key's current value; see LSMTree::expire().
+     */
+    bool expire(std::string_view key, uint64_t expire_at, bool &found, bool sync = true) {
+        return shards[shard_for(key)]->expire(key, expire_at, found, sync);
+    }
+
+    /**
+     * @brief Retrieves the expiry time of a key; see LSMTree::getExpiry().
+     */
+    std::pair<bool, uint64_t> getExpiry(std::string_view key) {
+        return shards[shard_for(key)]->getExpiry(key);
+    }
+
+    /**
+     * @brief Marks a key as deleted; see LSMTree::remove().
+     */
+    bool remove(std::string_view key, bool sync = true) {
+        return shards[shard_for(key)]->remove(key, sync);
+    }
+
+    /**
+     * @brief Deletes every key in [start, end); see LSMTree::removeRange().
+     * @details Keys are spread over the shards by hash, so every shard records the range tombstone.
+     * @return bool False if any shard's write-ahead log has failed.
+     */
+    bool removeRange(std::string_view start, std::string_view end, bool sync = true) {
+        bool ok = true;
+        for (std::unique_ptr<LSMTree> &shard : shards) {
+            ok = shard->removeRange(start, end, sync) && ok;
+        }
+        return ok;
+    }
+
+    /**
+     * @brief Applies a batch of puts and removes, split into one batch per shard.
+     * @details Each shard's part is applied atomically as by LSMTree::write(); the parts are applied
+     *          one after another, so a crash part way may keep the writes of some shards only.
+     * @param batch The writes, applied in order within each shard.
+     * @param sync Whether to commit the write-ahead logs before returning, as for put().
+     * @return bool False if any shard's write-ahead log has failed.
+     */
+    bool write(const WriteBatch &batch, bool sync = true) {
+        if (shards.size() == 1) {
+            return shards[0]->write(batch, sync);
+        }
+        std::vector<WriteBatch> parts(shards.size());
+        batch.forEach([this, &parts](std::string_view key, std::string_view value) {
+            parts[shard_for(key)].append(key, value);
+        });
+        bool ok = true;
+        for (size_t i = 0; i < shards.size(); ++i) {
+            ok = shards[i]->write(parts[i], sync) && ok;
+        }
+        return ok;
+    }
+
+    /**
+     * @brief Commits every write made so far to the write-ahead log of every shard.
+     * @details Shards with nothing to commit return at once.
+     * @return True if successful, otherwise false.
+     */
+    bool sync() {
+        bool ok = true;
+        for (std::unique_ptr<LSMTree> &shard : shards) {
+            ok = shard->sync() && ok;
+        }
+        return ok;
+    }
+
+    /**
+     * @brief Adds SSTables built outside the tree; see LSMTree::ingestFiles().
+     * @details With one shard the files are ingested as they are. Otherwise their records are split by
+     *          shard into one new table per shard, written next to the shard's files and removed once
+     *          ingested, and every shard receives the range deletions. The shards ingest their parts one
+     *          after another, so a failure part way may leave the records of some shards only.
+     * @param files Base filenames of the tables (without extensions), in any order, with disjoint key ranges.
+     * @return True if every record was added, otherwise false.
+     */
+    bool ingestFiles(const std::vector<std::string> &files) {
+        if (shards.size() == 1) {
+            return shards[0]->ingestFiles(files);
+        }
+        std::vector<std::unique_ptr<SS_Table>> inputs;
+        for (const std::string &file : files) {
+            std::unique_ptr<SS_Table> input = std::make_unique<SS_Table>(file);
+            if (!input->isLoaded() || input->getFormat() != TableFormat::BLOCK_BASED) {
+                std::cerr << "Cannot ingest " << file << SST_EXTENSION << ": not a readable block-based table" << std::endl;
+                return false;
+            }
+            inputs.push_back(std::move(input));
+        }
+        std::sort(inputs.begin(), inputs.end(), [](const std::unique_ptr<SS_Table> &a, const std::unique_ptr<SS_Table> &b) {
+            return a->getSmallestKey() < b->getSmallestKey();
+        });
+        for (size_t i = 1; i < inputs.size(); ++i) {
+            if (inputs[i - 1]->getLargestKey() >= inputs[i]->getSmallestKey()) {
+                std::cerr << "Cannot ingest " << inputs[i - 1]->getBaseName() << " and " << inputs[i]->getBaseName()
+                          << " together: their key ranges overlap" << std::endl;
+                return false;
+            }
+        }
+
+        uint64_t number = ingest_number.fetch_add(1);
+        std::vector<std::string> parts;
+        std::vector<std::unique_ptr<ExternalTableWriter>> writers;
+        for (const std::string &shard_directory : directories) {
+            parts.push_back(shard_directory + "ingest_" + std::to_string(number));
+            writers.push_back(std::make_unique<ExternalTableWriter>(parts.back()));
+        }
+        std::vector<bool> used(shards.size(), false);
+
+        bool ok = true;
+        for (const std::unique_ptr<SS_Table> &input : inputs) {
+            // A table's range deletions never cover its own keys, so each one goes in before the first key after it
+            const std::vector<RangeTombstone> &tombstones = input->getRangeTombstones();
+            size_t next_tombstone = 0;
+            auto add_tombstones_before = [&](const std::string *key) {
+                for (; ok && next_tombstone < tombstones.size() && (key == nullptr || tombstones[next_tombstone].start < *key);
+                     ++next_tombstone) {
+                    for (size_t shard = 0; shard < shards.size(); ++shard) {
+                        ok = ok && writers[shard]->deleteRange(tombstones[next_tombstone].start, tombstones[next_tombstone].end);
+                        used[shard] = true;
+                    }
+                }
+            };
+            std::string key;
+            for (SS_Table::Iterator it = input->iterator(); ok && it.isValid(); it.next()) {
+                key.assign(it.key());
+                add_tombstones_before(&key);
+                size_t shard = shard_for(key);
+                ok = ok && writers[shard]->addStored(key, it.value());
+                used[shard] = true;
+            }
+            add_tombstones_before(nullptr);
+        }
+
+        for (size_t shard = 0; shard < shards.size(); ++shard) {
+            if (!ok || !used[shard]) {
+                writers[shard]->abandon();
+                used[shard] = false;
+            } else if (!writers[shard]->finish()) {
+                ok = false;
+                used[shard] = false;
+            }
+        }
+        for (size_t shard = 0; shard < shards.size(); ++shard) {
+            if (used[shard]) {
+                ok = ok && shards[shard]->ingestFiles({parts[shard]});
+                std::filesystem::remove(parts[shard] + SST_EXTENSION);
+            }
+        }
+        return ok;
+    }
+
+    /**
+     * @brief Gets the directory of a shard, ending in '/'.
+     */
+    const std::string &shardDirectory(size_t shard) const {
+        return directories[shard];
+    }
+
+    /**
+     * @brief Adds SSTables to one shard as they are; see LSMTree::ingestFiles().
+     * @details Used to load tables taken from the same shard of a tree with as many shards, whose keys
+     *          all belong to the shard.
+     */
+    bool ingestShardFiles(size_t shard, const std::vector<std::string> &files) {
+        return shards[shard]->ingestFiles(files);
+    }
+
+    /**
+     * @brief Sets the function that receives every shard's write-ahead log records; see LSMTree::setLogListener().
+     * @param listener Called with the shard and each record; empty to remove the listener.
+     */
+    void setLogListener(const std::function<void(size_t, std::string_view)> &listener) {
+        for (size_t shard = 0; shard < shards.size(); ++shard) {
+            if (listener) {
+                shards[shard]->setLogListener([listener, shard](std::string_view record) { listener(shard, record); });
+            } else {
+                shards[shard]->setLogListener(nullptr);
+            }
+        }
+    }
+
+    /**
+     * @brief Hard-links a consistent set of every shard's SSTables; see LSMTree::checkpoint().
+     * @details Each shard is cut on its own, one after another, into a subdirectory of its directory.
+     * @param name Name of the subdirectory; each shard's is shardDirectory(shard) + name + "/".
+     * @param on_cut Called with each shard at its cut.
+     * @param tables Set to the tables linked, one list per shard.
+     * @return True if every shard's tables were linked, otherwise false.
+     */
+    bool checkpoint(const std::string &name, const std::function<void(size_t)> &on_cut,
+                    std::vector<std::vector<TableMeta>> &tables) {
+        tables.assign(shards.size(), {});
+        for (size_t shard = 0; shard < shards.size(); ++shard) {
+            if (!shards[shard]->checkpoint(directories[shard] + name + "/", [&on_cut, shard] { on_cut(shard); }, tables[shard])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Applies another tree's write-ahead log records to one shard; see LSMTree::applyLogRecords().
+     */
+    bool applyLogRecords(size_t shard, std::string_view records) {
+        return shards[shard]->applyLogRecords(records);
+    }
+
+    /**
+     * @brief Retrieves the value associated with a key; see LSMTree::get().
+     */
+    std::pair<bool, std::string> get(std::string_view key, bool fill_cache = true) {
+        return shards[shard_for(key)]->get(key, fill_cache);
+    }
+
+    /**
+     * @brief Retrieves a key's value if its shard's MemTables settle the lookup; see LSMTree::getFromMemory().
+     */
+    bool getFromMemory(std::string_view key, std::pair<bool, std::string> &result) {
+        return shards[shard_for(key)]->getFromMemory(key, result);
+    }
+
+    /**
+     * @brief Retrieves the values of several keys, looking up each shard's keys together.
+     * @return std::vector<std::pair<bool, std::string>> One result per key, in the order given, as from get().
+     */
+    std::vector<std::pair<bool, std::string>> multiGet(const std::vector<std::string_view> &keys, bool fill_cache = true) {
+        if (shards.size() == 1) {
+            return shards[0]->multiGet(keys, fill_cache);
+        }
+        std::vector<std::vector<std::string_view>> shard_keys(shards.size());
+        std::vector<std::vector<size_t>> positions(shards.size());
+        for (size_t i = 0; i < keys.size(); ++i) {
+            size_t shard = shard_for(keys[i]);
+            shard_keys[shard].push_back(keys[i]);
+            positions[shard].push_back(i);
+        }
+
+        std::vector<std::pair<bool, std::string>> results(keys.size());
+        for (size_t shard = 0; shard < shards.size(); ++shard) {
+            if (shard_keys[shard].empty()) {
+                continue;
+            }
+            std::vector<std::pair<bool, std::string>> found = shards[shard]->multiGet(shard_keys[shard], fill_cache);
+            for (size_t i = 0; i < found.size(); ++i) {
+                results[positions[shard][i]] = std::move(found[i]);
+            }
+        }
+        return results;
+    }
+
+    /**
+     * @class Snapshot
+     * @brief A read-only view of every shard, each as of one point in its write order.
+     * @details Holds one LSMTree::Snapshot per shard, with the same lifetime rules.
+     */
+    class Snapshot {
+    private:
+        friend class BasicShardedLSMTree;
+        std::vector<typename LSMTree::Snapshot> snapshots;
+    };
+
+    /**
+     * @brief Takes a snapshot of every shard; see the class description for batches spanning shards.
+     */
+    Snapshot getSnapshot() {
+        Snapshot snapshot;
+        for (std::unique_ptr<LSMTree> &shard : shards) {
+            snapshot.snapshots.push_back(shard->getSnapshot());
+        }
+        return snapshot;
+    }
+
+    /**
+     * @brief Retrieves the value associated with a key as of a snapshot; see LSMTree::get().
+     */
+    std::pair<bool, std::string> get(std::string_view key, const Snapshot &snapshot, bool fill_cache = true) {
+        size_t shard = shard_for(key);
+        return shards[shard]->get(key, snapshot.snapshots[shard], fill_cache);
+    }
+
+    /**
+     * @class Iterator
+     * @brief Sorted iterator over the live keys of every shard.
+     * @details Shards hold disjoint keys, so it only has to return the smallest key among one
+     *          LSMTree::Iterator per shard.
+     */
+    class Iterator {
+    private:
+        std::vector<typename LSMTree::Iterator> iterators;
+        size_t current = 0; ///< Index of the iterator holding the smallest key, iterators.size() if none is valid.
+
+        void findSmallest() {
+            current = iterators.size();
+            for (size_t i = 0; i < iterators.size(); ++i) {
+                if (iterators[i].isValid() && (current == iterators.size() || iterators[i].key() < iterators[current].key())) {
+                    current = i;
+                }
+            }
+        }
+
+    public:
+        /**
+         * @brief Creates an unpositioned iterator; call seekToFirst() or seek() before reading it.
+         */
+        explicit Iterator(std::vector<typename LSMTree::Iterator> iterators) : iterators(std::move(iterators)) {
+            current = this->iterators.size();
+        }
+
+        bool isValid() const {
+            return current < iterators.size();
+        }
+
+        std::string_view key() const {
+            return iterators[current].key();
+        }
+
+        std::string_view value() const {
+            return iterators[current].value();
+        }
+
+        void seekToFirst() {
+            for (typename LSMTree::Iterator &it : iterators) {
+                it.seekToFirst();
+            }
+            findSmallest();
+        }
+
+        /**
+         * @brief Positions the iterator at the first live key not less than target.
+         */
+        void seek(std::string_view target) {
+            for (typename LSMTree::Iterator &it : iterators) {
+                it.seek(target);
+            }
+            findSmallest();
+        }
+
+        void next() {
+            iterators[current].next();
+            findSmallest();
+        }
+    };
+
+    /**
+     * @brief Creates a sorted iterator over the live keys as of now.
+     * @return Iterator Unpositioned, reading a snapshot taken by this call.
+     */
+    Iterator iterator() {
+        return iterator(getSnapshot());
+    }
+
+    /**
+     * @brief Creates a sorted iterator over the live keys of a snapshot.
+     * @param snapshot The snapshot to read, from getSnapshot().
+     * @return Iterator Unpositioned.
+     */
+    Iterator iterator(const Snapshot &snapshot) {
+        std::vector<typename LSMTree::Iterator> iterators;
+        for (size_t i = 0; i < shards.size(); ++i) {
+            iterators.push_back(shards[i]->iterator(snapshot.snapshots[i]));
+        }
+        return Iterator(std::move(iterators));
+    }
+
+    /**
+     * @brief Returns the Bloom filter counters of every shard added together.
+     */
+    FilterStats getFilterStats() const {
+        FilterStats stats;
+        for (const std::unique_ptr<LSMTree> &shard : shards) {
+            FilterStats shard_stats = shard->getFilterStats();
+            stats.checked += shard_stats.checked;
+            stats.useful += shard_stats.useful;
+            stats.false_positive += shard_stats.false_positive;
+        }
+        return stats;
+    }
+
+    /**
+     * @brief Returns the counters of the shared block cache; all zero if the cache is disabled.
+     */
+    BlockCacheStats getBlockCacheStats() const {
+        if (block_cache == nullptr) {
+            return BlockCacheStats();
+        }
+        return block_cache->getStats();
+    }
+
+    /**
+     * @brief Returns the write stall counters and backlog of every shard added together.
+     */
+    WriteStallStats getWriteStallStats() const {
+        WriteStallStats stats;
+        for (const std::unique_ptr<LSMTree> &shard : shards) {
+            WriteStallStats shard_stats = shard->getWriteStallStats();
+            stats.slowdowns += shard_stats.slowdowns;
+            stats.stops += shard_stats.stops;
+            stats.stall_micros += shard_stats.stall_micros;
+            stats.immutable_memtables += shard_stats.immutable_memtables;
+            stats.l0_tables += shard_stats.l0_tables;
+        }
+        return stats;
+    }
+
+    /**
+     * @brief Returns the MemTable and level sizes of every shard added together.
+     */
+    TreeStats getTreeStats() {
+        TreeStats stats;
+        for (std::unique_ptr<LSMTree> &shard : shards) {
+            TreeStats shard_stats = shard->getTreeStats();
+            stats.memtable_bytes += shard_stats.memtable_bytes;
+            stats.immutable_memtables += shard_stats.immutable_memtables;
+            stats.immutable_bytes += shard_stats.immutable_bytes;
+            stats.tables_per_level.resize(shard_stats.tables_per_level.size());
+            stats.bytes_per_level.resize(shard_stats.bytes_per_level.size());
+            for (size_t level = 0; level < shard_stats.tables_per_level.size(); ++level) {
+                stats.tables_per_level[level] += shard_stats.tables_per_level[level];
+                stats.bytes_per_level[level] += shard_stats.bytes_per_level[level];
+            }
+        }
+        return stats;
+    }
+
+    /**
+     * @brief Returns the block compression counters of this process.
+     */
+    CompressionStats getCompressionStats() const {
+        return Compression::getStats();
+    }
+};
+
+using ShardedLSMTree = BasicShardedLSMTree<>;
+
+#endif
@@ -11,7 +11,9 @@
 #define SKIP_LIST
 
 #include "key_value.hpp"
+#include <iterator>
 #include <random>
+#include <string_view>
 
 /**
  * @brief To represent the type of node in the skip list.
@@ -45,6 +47,9 @@ public:
 
     Node(SentinelType type, const KeyValuePair &data)
         : type(type), data(data), prev(nullptr), next(nullptr), up(nullptr), down(nullptr) {}
+
+    Node(SentinelType type, KeyValuePair &&data)
+        : type(type), data(std::move(data)), prev(nullptr), next(nullptr), up(nullptr), down(nullptr) {}
 };
 
 /**
@@ -80,7 +85,7 @@ public:
      * @param key The key to search for.
      * @return Node* A pointer to the node containing the key or the node where the key should be inserted.
      */
-    Node *search(const std::string &key) {
+    Node *search(std::string_view key) {
         Node *cur = head;
         while (true) {
             while (cur->next->type != SentinelType::POSITIVE_INFINITY &&
@@ -103,7 +108,7 @@ public:
      * @return std::pair<bool, std::string> A pair containing a boolean indicating whether the key was found
      *         and the corresponding value if found, or an empty string if not found.
      */
-    std::pair<bool, std::string> get(const std::string &key) {
+    std::pair<bool, std::string> get(std::string_view key) {
         Node *cur = search(key);
         if (cur->data.getKey() == key) {
             return {true, cur->data.getValue()};
@@ -120,15 +125,15 @@ public:
      * @param key The key to insert.
      * @param value The value to associate with the key.
      */
-    void put(const std::string &key, const std::string &value) {
+    void put(std::string_view key, std::string_view value) {
         Node *current = search(key);
-        if (current->data.getKey() == key) {
+        if (current->type == SentinelType::NORMAL && current->data.getKey() == key) {
             current->data.setValue(value);
             return;
         }
-        KeyValuePair kv(key, value);
+        KeyValuePair kv{std::string(key), std::string(value)};
         totalSize += kv.size();
-        Node *newNode = new Node(SentinelType::NORMAL, kv);
+        Node *newNode = new Node(SentinelType::NORMAL, std::move(kv));
         newNode->prev = current;
         newNode->next = current->next;
         current->next->prev = newNode;
@@ -153,7 +158,7 @@ public:
                 current = current->prev;
             }
             current = current->up;
-            Node *newNodeUp = new Node(SentinelType::NORMAL, KeyValuePair(key, ""));
+            Node *newNodeUp = new Node(SentinelType::NORMAL, KeyValuePair(std::string(key), std::string()));
             newNodeUp->prev = current;
             newNodeUp->next = current->next;
             current->next->prev = newNodeUp;
@@ -238,7 +243,7 @@ public:
         return Iterator(nullptr);
     }
 
-    Iterator find(const std::string &key) {
+    Iterator find(std::string_view key) {
         Node *node = search(key);
         if (node->data.getKey() == key && node->type == SentinelType::NORMAL) {
             return Iterator(node);
@@ -8,11 +8,36 @@
 #ifndef SS_TABLE
 #define SS_TABLE
 
+#include "block_cache.hpp"
+#include "bloom_filter.hpp"
+#include "compression.hpp"
 #include "constants.hpp"
+#include "expiry.hpp"
 #include "memtable.hpp"
+#include "options.hpp"
+#include "range_deletion.hpp"
+#include "sstable_builder.hpp"
+#include "table_format.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
 #include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
 
 /**
  * @class SS_Table
@@ -20,116 +45,543 @@
  *
  * This class handles persistent storage of key-value pairs by writing data in a structured format.
  * It provides functions for loading indexes, retrieving values, and managing SSTable files.
+ * New tables are block-based `.sst` files; tables in the legacy `.index`/`.data` layout are still read.
+ * A table described by the manifest is opened lazily: its files are not touched until the first
+ * lookup or scan reaches it.
  */
 class SS_Table {
 private:
-    std::string index_filename;                          ///< Filename for the index file.
-    std::string data_filename;                           ///< Filename for the data file.
-    std::vector<std::pair<std::string, uint64_t>> index; ///< In-memory index mapping keys to file offsets.
+    /**
+     * @struct IndexEntry
+     * @brief One block of the table as listed by its index.
+     */
+    struct IndexEntry {
+        std::string key;    ///< LEGACY: first key of the block. BLOCK_BASED: last key of the block.
+        BlockHandle handle; ///< Location of the block; LEGACY tables only record the offset.
+    };
+
+    TableFormat format;                                  ///< On-disk layout of the table.
+    CompressionType compression = CompressionType::NONE; ///< Codec the data blocks were written with.
+    std::string base_name;                               ///< Filename without extensions.
+    std::string index_filename;                          ///< Filename for the index file (the .sst file for block-based tables).
+    std::string data_filename;                           ///< Filename for the data file (the .sst file for block-based tables).
+    std::string filter_filename;                         ///< Filename for the Bloom filter file (the .sst file for block-based tables).
+    std::string filter;                                  ///< Bloom filter over the table's keys, empty if none was found.
+    std::vector<RangeTombstone> range_tombstones;        ///< Sorted, disjoint ranges the table deletes in older tables.
+    std::vector<IndexEntry> index;                       ///< In-memory index of the table's blocks, in key order.
     bool indexLoaded = false;                            ///< Flag indicating if the index is loaded.
+    SSTableReadMode read_mode;                           ///< How lookups read the data file.
+    int data_fd = -1;                                    ///< Data file descriptor, open for the table's lifetime.
+    uint64_t data_size = 0;                              ///< Size of the data file (the whole .sst file) in bytes.
+    const char *mapped_data = nullptr;                   ///< Mapping of the data file in MMAP mode.
+    BlockCache *block_cache;                             ///< Shared cache of decoded blocks, may be null.
+    uint64_t table_id;                                   ///< Process-unique id used in block cache keys.
+    std::string smallest_key;                            ///< First key stored in the table.
+    std::string largest_key;                             ///< Last key stored in the table.
+    uint64_t sequence = 0;                               ///< Position of the table's data in write order, assigned by the LSM tree.
+    bool range_known = false;                            ///< Key range and size were given by the caller, not read from the file.
+    bool obsolete = false;                               ///< The table was replaced, so its files go with the last reference.
+    mutable std::once_flag load_once;                    ///< Guards the one-time opening of the table's files.
 
-    static constexpr size_t KEYS_PER_INDEX_ENTRY = 10; ///< Number of keys per index entry.
+    /**
+     * @brief Hands out a process-unique id for each table opened.
+     * @return uint64_t The next table id.
+     */
+    static uint64_t nextTableId() {
+        static std::atomic<uint64_t> next_id(0);
+        return next_id.fetch_add(1, std::memory_order_relaxed);
+    }
 
     /**
-     * @brief Finds the start offset for a given key in the data file using binary search.
+     * @brief Finds the block that may contain a key using binary search.
      * @param key The key to search for.
-     * @return Optional offset if the key is found, otherwise std::nullopt.
+     * @return Optional index position of the block, std::nullopt if the key is outside the table's range.
      */
-    std::optional<uint64_t> findStartOffset(const std::string &key) {
-        if (index.empty()) {
-            return std::nullopt;
+    std::optional<size_t> findBlock(std::string_view key) const {
+        if (format == TableFormat::BLOCK_BASED) {
+            // The first block whose last key is not less than the key
+            auto it = std::lower_bound(index.begin(), index.end(), key,
+                                       [](const IndexEntry &entry, std::string_view k) { return entry.key < k; });
+            if (it == index.end()) {
+                return std::nullopt;
+            }
+            return static_cast<size_t>(it - index.begin());
         }
 
-        if (key < index[0].first) {
-            return index[0].second;
+        if (index.empty() || key < index[0].key) {
+            return std::nullopt;
         }
 
         size_t left = 0, right = index.size() - 1;
         while (left < right) {
             size_t mid = left + (right - left + 1) / 2;
-            if (index[mid].first <= key) {
+            if (index[mid].key <= key) {
                 left = mid;
             } else {
                 right = mid - 1;
             }
         }
 
-        return index[left].second;
+        return left;
+    }
+
+    /**
+     * @brief Opens the data file and, in MMAP mode, maps it.
+     * @return True if the data file can be read, otherwise false.
+     */
+    bool openDataFile() {
+        data_fd = open(data_filename.c_str(), O_RDONLY | O_CLOEXEC);
+        if (data_fd == -1) {
+            std::cerr << "Failed to open " << data_filename << ": " << strerror(errno) << std::endl;
+            return false;
+        }
+
+        struct stat st;
+        if (fstat(data_fd, &st) == -1) {
+            std::cerr << "Failed to stat " << data_filename << ": " << strerror(errno) << std::endl;
+            return false;
+        }
+        if (!range_known) {
+            data_size = static_cast<uint64_t>(st.st_size);
+        } else if (data_size != static_cast<uint64_t>(st.st_size)) {
+            std::cerr << data_filename << " is " << st.st_size << " bytes, expected " << data_size << std::endl;
+            return false;
+        }
+
+        if (read_mode == SSTableReadMode::MMAP && data_size > 0) {
+            void *mapping = mmap(NULL, data_size, PROT_READ, MAP_SHARED, data_fd, 0);
+            if (mapping == MAP_FAILED) {
+                std::cerr << "Failed to mmap " << data_filename << ", falling back to pread: " << strerror(errno) << std::endl;
+            } else {
+                madvise(mapping, data_size, MADV_RANDOM);
+                mapped_data = static_cast<const char *>(mapping);
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Records the table's key range.
+     * @details The index holds one end of the range and the other is read from the first or last
+     *          block, so opening a table costs one extra block read. The range is widened to take
+     *          in the table's range tombstones, so a lookup of any key they cover reaches the table.
+     * @return True if the range could be determined, otherwise false.
+     */
+    bool loadKeyRange() {
+        if (format == TableFormat::BLOCK_BASED) {
+            if (!index.empty()) {
+                largest_key = index.back().key;
+                std::string block;
+                if (!readBlock(index.front().handle, block)) {
+                    return false;
+                }
+                BlockIterator it(block);
+                it.seekToFirst();
+                if (!it.isValid()) {
+                    std::cerr << "Corrupt block in " << data_filename << std::endl;
+                    return false;
+                }
+                smallest_key.assign(it.key());
+            }
+            RangeDeletion::widen(range_tombstones, smallest_key, largest_key, !index.empty());
+            return true;
+        }
+        if (index.empty()) {
+            return true;
+        }
+        smallest_key = index.front().key;
+
+        uint64_t last_block = index.back().handle.offset;
+        if (last_block >= data_size) {
+            return false;
+        }
+        std::string buffer(static_cast<size_t>(data_size - last_block), '\0');
+        if (!readAt(&buffer[0], buffer.size(), last_block)) {
+            std::cerr << "Failed to read " << data_filename << ": " << strerror(errno) << std::endl;
+            return false;
+        }
+
+        size_t pos = 0;
+        while (pos + sizeof(uint32_t) <= buffer.size()) {
+            uint32_t key_size;
+            std::memcpy(&key_size, buffer.data() + pos, sizeof(key_size));
+            if (pos + sizeof(uint32_t) + key_size + sizeof(uint32_t) > buffer.size()) {
+                break;
+            }
+            uint32_t value_size;
+            std::memcpy(&value_size, buffer.data() + pos + sizeof(uint32_t) + key_size, sizeof(value_size));
+            largest_key.assign(buffer.data() + pos + sizeof(uint32_t), key_size);
+            pos += 2 * sizeof(uint32_t) + static_cast<size_t>(key_size) + value_size;
+        }
+        return !largest_key.empty() || smallest_key.empty();
+    }
+
+    /**
+     * @brief Reads exactly `length` bytes at `offset` from the data file.
+     * @param buffer Destination buffer.
+     * @param length Number of bytes to read.
+     * @param offset File offset to read from.
+     * @return True if all bytes were read, otherwise false.
+     */
+    bool readAt(char *buffer, size_t length, uint64_t offset) const {
+        while (length > 0) {
+            ssize_t n = pread(data_fd, buffer, length, static_cast<off_t>(offset));
+            if (n == -1 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                return false;
+            }
+            buffer += n;
+            length -= static_cast<size_t>(n);
+            offset += static_cast<uint64_t>(n);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Reads a block of a block-based table, verifies its checksum and decompresses it.
+     * @param handle Location of the block.
+     * @param contents Receives the uncompressed block contents, without the trailer.
+     * @return True if the block was read intact, otherwise false.
+     */
+    bool readBlock(const BlockHandle &handle, std::string &contents) const {
+        if (handle.offset + handle.size + BlockTrailer::SIZE > data_size) {
+            std::cerr << "Block out of range in " << data_filename << std::endl;
+            return false;
+        }
+        contents.resize(static_cast<size_t>(handle.size) + BlockTrailer::SIZE);
+        if (!readAt(&contents[0], contents.size(), handle.offset)) {
+            std::cerr << "Failed to read " << data_filename << ": " << strerror(errno) << std::endl;
+            return false;
+        }
+        if (!BlockTrailer::verify(contents.data(), static_cast<size_t>(handle.size))) {
+            std::cerr << "Checksum mismatch in " << data_filename << " at offset " << handle.offset << std::endl;
+            return false;
+        }
+        char type = BlockTrailer::type(contents.data(), static_cast<size_t>(handle.size));
+        contents.resize(static_cast<size_t>(handle.size));
+        if (type != BlockTrailer::NO_COMPRESSION) {
+            std::string uncompressed;
+            if (!Compression::uncompress(type, contents, uncompressed)) {
+                std::cerr << "Failed to decompress block of " << data_filename << " at offset " << handle.offset << std::endl;
+                return false;
+            }
+            contents.swap(uncompressed);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Loads the footer, the index block, the filter block and the range deletion block of a block-based table.
+     * @return True if the table's metadata is intact, otherwise false.
+     */
+    bool loadTable() {
+        TableFooter footer;
+        char encoded_footer[TableFooter::MAX_ENCODED_SIZE];
+        size_t footer_size = static_cast<size_t>(std::min<uint64_t>(data_size, sizeof(encoded_footer)));
+        if (!readAt(encoded_footer, footer_size, data_size - footer_size) || !footer.decode(encoded_footer, footer_size)) {
+            std::cerr << "Bad footer in " << data_filename << std::endl;
+            return false;
+        }
+        compression = footer.compression;
+        if (!Compression::isSupported(compression)) {
+            std::cerr << data_filename << " is compressed with codec " << static_cast<int>(compression)
+                      << ", which this build does not support" << std::endl;
+            return false;
+        }
+
+        std::string index_block;
+        if (!readBlock(footer.index, index_block)) {
+            return false;
+        }
+        index.clear();
+        BlockIterator it(index_block);
+        for (it.seekToFirst(); it.isValid(); it.next()) {
+            IndexEntry entry;
+            entry.key.assign(it.key());
+            std::string_view encoded_handle = it.value();
+            if (!entry.handle.decodeFrom(encoded_handle)) {
+                break;
+            }
+            index.push_back(std::move(entry));
+        }
+        if (it.isCorrupt() || it.isValid()) {
+            std::cerr << "Corrupt index block in " << data_filename << std::endl;
+            return false;
+        }
+
+        // Tables written without a filter are still readable, every lookup just goes to disk
+        filter.clear();
+        if (footer.filter.size > 0 && !readBlock(footer.filter, filter)) {
+            filter.clear();
+        }
+
+        // Unlike the filter, range tombstones cannot be skipped without deleted keys reappearing
+        range_tombstones.clear();
+        if (footer.range_deletions.size > 0) {
+            std::string range_deletion_block;
+            if (!readBlock(footer.range_deletions, range_deletion_block)) {
+                return false;
+            }
+            BlockIterator range_it(range_deletion_block);
+            for (range_it.seekToFirst(); range_it.isValid(); range_it.next()) {
+                range_tombstones.push_back({std::string(range_it.key()), std::string(range_it.value()), 0});
+            }
+            if (range_it.isCorrupt()) {
+                std::cerr << "Corrupt range deletion block in " << data_filename << std::endl;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Detects the table's format and reads its metadata.
+     * @return True if the table can serve lookups, otherwise false.
+     */
+    bool openTable() {
+        if (std::filesystem::exists(base_name + SST_EXTENSION)) {
+            format = TableFormat::BLOCK_BASED;
+            index_filename = data_filename = filter_filename = base_name + SST_EXTENSION;
+            return openDataFile() && loadTable() && (range_known || loadKeyRange());
+        }
+        format = TableFormat::LEGACY;
+        index_filename = base_name + INDEX_EXTENSION;
+        data_filename = base_name + DATA_EXTENSION;
+        filter_filename = base_name + FILTER_EXTENSION;
+        return loadIndex() && openDataFile() && (range_known || loadKeyRange());
+    }
+
+    /**
+     * @brief Opens the table on first use; safe to call from concurrent readers.
+     * @details Every table is owned through a non-const pointer, so casting const away here only
+     *          defers work the constructor would otherwise have done.
+     */
+    void ensureLoaded() const {
+        std::call_once(load_once, [this] {
+            SS_Table *self = const_cast<SS_Table *>(this);
+            self->indexLoaded = self->openTable();
+        });
+    }
+
+    /**
+     * @brief Searches one block of records for a key, comparing keys in place.
+     * @param block Start of the block bytes.
+     * @param length Length of the block in bytes.
+     * @param key The key to look up.
+     * @return A pair containing a boolean (indicating success) and the value.
+     */
+    static std::pair<bool, std::string> searchBlock(const char *block, size_t length, std::string_view key) {
+        size_t pos = 0;
+        while (pos + sizeof(uint32_t) <= length) {
+            uint32_t key_size;
+            std::memcpy(&key_size, block + pos, sizeof(key_size));
+            pos += sizeof(key_size);
+            if (pos + key_size + sizeof(uint32_t) > length) {
+                break;
+            }
+            std::string_view stored_key(block + pos, key_size);
+            pos += key_size;
+            if (stored_key > key) {
+                break;
+            }
+
+            uint32_t value_size;
+            std::memcpy(&value_size, block + pos, sizeof(value_size));
+            pos += sizeof(value_size);
+            if (pos + value_size > length) {
+                break;
+            }
+
+            if (stored_key == key) {
+                std::string value(block + pos, value_size);
+                if (value == TOMBSTONE) {
+                    return {false, value};
+                }
+                return {true, value};
+            }
+            pos += value_size;
+        }
+        return {false, ""};
+    }
+
+    /**
+     * @brief Reads one block and looks up a run of keys in it.
+     * @param block Index position of the block.
+     * @param keys The keys, in ascending order, all of which belong in the block.
+     * @param results Receives a result per key.
+     * @param count The number of keys.
+     * @param fill_cache Whether the block, if read from disk, should be inserted into the block cache.
+     */
+    void searchBlockFor(size_t block, const std::string_view *keys, std::pair<bool, std::string> *results, size_t count,
+                        bool fill_cache) const {
+        uint64_t block_start = index[block].handle.offset;
+        uint64_t block_end;
+        if (format == TableFormat::BLOCK_BASED) {
+            block_end = block_start + index[block].handle.size;
+            if (block_end + BlockTrailer::SIZE > data_size) {
+                return;
+            }
+        } else {
+            block_end = block + 1 < index.size() ? index[block + 1].handle.offset : data_size;
+            if (block_end > data_size || block_start >= block_end) {
+                return;
+            }
+        }
+        size_t block_length = static_cast<size_t>(block_end - block_start);
+
+        // Compressed blocks cannot be searched in place and go through the block cache instead
+        if (mapped_data != nullptr && format == TableFormat::LEGACY) {
+            for (size_t i = 0; i < count; ++i) {
+                results[i] = searchBlock(mapped_data + block_start, block_length, keys[i]);
+            }
+            return;
+        }
+        if (mapped_data != nullptr && BlockTrailer::type(mapped_data + block_start, block_length) == BlockTrailer::NO_COMPRESSION) {
+            for (size_t i = 0; i < count; ++i) {
+                results[i] = BlockIterator::find(std::string_view(mapped_data + block_start, block_length), keys[i]);
+            }
+            return;
+        }
+
+        std::shared_ptr<const CachedBlock> cached;
+        if (block_cache != nullptr) {
+            cached = block_cache->lookup(table_id, block_start);
+        }
+        std::string buffer;
+        if (cached == nullptr) {
+            if (format == TableFormat::BLOCK_BASED) {
+                if (!readBlock(index[block].handle, buffer)) {
+                    return;
+                }
+            } else {
+                buffer.resize(block_length);
+                if (!readAt(&buffer[0], block_length, block_start)) {
+                    std::cerr << "Failed to read " << data_filename << ": " << strerror(errno) << std::endl;
+                    return;
+                }
+            }
+            if (block_cache != nullptr && fill_cache) {
+                cached = std::make_shared<const CachedBlock>(std::move(buffer), format);
+                block_cache->insert(table_id, block_start, cached);
+            }
+        }
+
+        for (size_t i = 0; i < count; ++i) {
+            if (cached != nullptr) {
+                results[i] = cached->get(keys[i]);
+            } else if (format == TableFormat::BLOCK_BASED) {
+                results[i] = BlockIterator::find(buffer, keys[i]);
+            } else {
+                results[i] = searchBlock(buffer.data(), buffer.size(), keys[i]);
+            }
+        }
     }
 
 public:
     /**
      * @brief Constructs an SS_Table from a given filename (excluding extensions).
      * @param filename Base name for the SSTable (without extensions).
+     * @param block_cache Shared block cache, or nullptr to always read from the file.
+     * @param read_mode How lookups read the data file.
      */
-    SS_Table(const std::string &filename) : index_filename(filename + INDEX_EXTENSION), data_filename(filename + DATA_EXTENSION) {
-        indexLoaded = loadIndex();
+    SS_Table(const std::string &filename, BlockCache *block_cache = nullptr, SSTableReadMode read_mode = SSTABLE_READ_MODE)
+        : format(TableFormat::LEGACY), base_name(filename), read_mode(read_mode), block_cache(block_cache),
+          table_id(nextTableId()) {
+        ensureLoaded();
     }
 
     /**
-     * @brief Constructs an SS_Table from existing index and data filenames.
+     * @brief Constructs an SS_Table whose files are opened on first use.
+     * @details The key range and file size come from the caller (the manifest), so the table can
+     *          take part in compaction picking and range checks without any I/O. The file must
+     *          still be exactly file_size bytes when it is opened.
+     * @param filename Base name for the SSTable (without extensions).
+     * @param smallest_key First key stored in the table.
+     * @param largest_key Last key stored in the table.
+     * @param file_size Size of the table's data file in bytes.
+     * @param block_cache Shared block cache, or nullptr to always read from the file.
+     * @param read_mode How lookups read the data file.
+     */
+    SS_Table(const std::string &filename, const std::string &smallest_key, const std::string &largest_key,
+             uint64_t file_size, BlockCache *block_cache = nullptr, SSTableReadMode read_mode = SSTABLE_READ_MODE)
+        : format(TableFormat::LEGACY), base_name(filename), read_mode(read_mode), data_size(file_size),
+          block_cache(block_cache), table_id(nextTableId()), smallest_key(smallest_key), largest_key(largest_key),
+          range_known(true) {}
+
+    /**
+     * @brief Constructs an SS_Table from existing index and data filenames of a legacy table.
      * @param index_filename Path to the index file.
      * @param data_filename Path to the data file.
+     * @param block_cache Shared block cache, or nullptr to always read from the file.
+     * @param read_mode How lookups read the data file.
      */
-    SS_Table(const std::string &index_filename, const std::string &data_filename) : index_filename(index_filename), data_filename(data_filename) {
-        indexLoaded = loadIndex();
+    SS_Table(const std::string &index_filename, const std::string &data_filename, BlockCache *block_cache = nullptr,
+             SSTableReadMode read_mode = SSTABLE_READ_MODE)
+        : format(TableFormat::LEGACY), base_name(index_filename.substr(0, index_filename.rfind(INDEX_EXTENSION))),
+          index_filename(index_filename), data_filename(data_filename), filter_filename(base_name + FILTER_EXTENSION),
+          read_mode(read_mode), block_cache(block_cache), table_id(nextTableId()) {
+        std::call_once(load_once, [this] { indexLoaded = loadIndex() && openDataFile() && loadKeyRange(); });
     }
 
+    /**
+     * @brief Constructs an SS_Table read as a tree's Options ask.
+     * @param filename Base name for the SSTable (without extensions).
+     * @param block_cache Shared block cache, or nullptr to always read from the file.
+     * @param options Settings of the tree; read_mode is how lookups read the data file.
+     */
+    SS_Table(const std::string &filename, BlockCache *block_cache, const Options &options)
+        : SS_Table(filename, block_cache, options.read_mode) {}
+
+    /**
+     * @brief Constructs an SS_Table whose files are opened on first use, read as a tree's Options ask.
+     * @details See the constructor taking a read mode.
+     */
+    SS_Table(const std::string &filename, const std::string &smallest_key, const std::string &largest_key,
+             uint64_t file_size, BlockCache *block_cache, const Options &options)
+        : SS_Table(filename, smallest_key, largest_key, file_size, block_cache, options.read_mode) {}
+
+    SS_Table(const SS_Table &) = delete;
+    SS_Table &operator=(const SS_Table &) = delete;
+
     /**
      * @brief Creates an SSTable from a given MemTable.
+     * @details The MemTable's range tombstones go to the table's range deletion block, and the
+     *          versions they cover in the MemTable itself are left out.
+     * @tparam Table The MemTable type, a BasicMemTable of any EnginePolicy.
      * @param filename Base filename for the new SSTable (without extensions).
      * @param memTable Pointer to the MemTable containing data.
+     * @param options Block size, restart interval, Bloom filter bits and codec of the table.
      * @return True if creation is successful, otherwise false.
      */
-    static bool createFromMemTable(const std::string &filename, MemTable *memTable) {
-        /*
-            data file format: [Key Size] [Key] [Value Size] [Value]
-            [Key Size] [Key] [Value Size] [Value]
-            [4 bytes]  [N bytes] [4 bytes] [M bytes]
-            index file format: [Key Size] [Key] [Offset]
-        */
-        std::ofstream indexFile(filename + INDEX_EXTENSION, std::ios::binary);
-        std::ofstream dataFile(filename + DATA_EXTENSION, std::ios::binary);
-        if (!indexFile.is_open() || !dataFile.is_open()) {
+    template <typename Table>
+    static bool createFromMemTable(const std::string &filename, Table *memTable, const Options &options = Options()) {
+        SSTableBuilder builder(filename, options, options.compression);
+        if (!builder.ok()) {
             return false;
         }
-
-        std::vector<KeyValuePair> entries;
+        // Expired values need not reach disk, but a tombstone must still hide older versions of the key
+        uint64_t now = Expiry::nowMillis();
+        bool range_deleted = memTable->hasRangeDeletions();
         for (auto it = memTable->begin(); it != memTable->end(); ++it) {
-            entries.push_back(*it);
-        }
-
-        uint64_t entries_count = entries.size();
-        uint64_t sparse_index_count = (entries_count + KEYS_PER_INDEX_ENTRY - 1) / KEYS_PER_INDEX_ENTRY;
-        indexFile.write(reinterpret_cast<const char *>(&sparse_index_count), sizeof(sparse_index_count));
-        uint64_t offset = 0;
-
-        for (size_t i = 0; i < entries.size(); i++) {
-            const KeyValuePair &entry = entries[i];
-            uint32_t key_size = entry.getKey().size();
-            uint32_t value_size = entry.getValue().size();
-
-            if (i % KEYS_PER_INDEX_ENTRY == 0) {
-                indexFile.write(reinterpret_cast<const char *>(&key_size), sizeof(key_size));
-                indexFile.write(entry.getKey().c_str(), key_size);
-                indexFile.write(reinterpret_cast<const char *>(&offset), sizeof(offset));
+            if (range_deleted && memTable->rangeDeletedAt(it.key()) > it.writeSequence()) {
+                continue;
             }
-
-            dataFile.write(reinterpret_cast<const char *>(&key_size), sizeof(key_size));
-            dataFile.write(entry.getKey().c_str(), key_size);
-            dataFile.write(reinterpret_cast<const char *>(&value_size), sizeof(value_size));
-            dataFile.write(entry.getValue().c_str(), value_size);
-
-            offset += sizeof(key_size) + key_size + sizeof(value_size) + value_size;
+            builder.add(it.key(), Expiry::isExpired(it.value(), now) ? std::string_view(TOMBSTONE) : it.value());
+        }
+        for (const RangeTombstone &tombstone : memTable->getRangeTombstones()) {
+            builder.addRangeTombstone(tombstone.start, tombstone.end);
+        }
+        if (!builder.ok() || !builder.finish()) {
+            builder.abandon();
+            return false;
         }
-
-        indexFile.close();
-        dataFile.close();
         return true;
     }
 
     /**
-     * @brief Loads the SSTable index from the index file.
+     * @brief Loads the SSTable index from the index file of a legacy table.
      * @return True if the index is successfully loaded, otherwise false.
      */
     bool loadIndex() {
@@ -151,60 +603,478 @@ public:
             indexFile.read(&key[0], key_size);
             uint64_t offset;
             indexFile.read(reinterpret_cast<char *>(&offset), sizeof(offset));
-            index.push_back({std::move(key), offset});
+            IndexEntry entry;
+            entry.key = std::move(key);
+            entry.handle.offset = offset;
+            index.push_back(std::move(entry));
         }
         indexFile.close();
+
+        // Tables written without a filter are still readable, every lookup just goes to disk
+        filter.clear();
+        std::ifstream filterFile(filter_filename, std::ios::binary | std::ios::ate);
+        if (filterFile.is_open()) {
+            std::streamsize filter_size = filterFile.tellg();
+            if (filter_size > 0) {
+                filter.resize(static_cast<size_t>(filter_size));
+                filterFile.seekg(0);
+                if (!filterFile.read(&filter[0], filter_size)) {
+                    filter.clear();
+                }
+            }
+        }
         return true;
     }
 
+    /**
+     * @brief Checks the Bloom filter for a key without touching the data file.
+     * @param key The key to look up.
+     * @return False if the key is definitely not in this SSTable, true if it may be.
+     */
+    bool mayContain(std::string_view key) const {
+        ensureLoaded();
+        if (filter.empty()) {
+            return true;
+        }
+        return BloomFilter::mayContain(filter, key);
+    }
+
+    /**
+     * @brief Checks whether this SSTable has a Bloom filter loaded.
+     * @return True if a filter is loaded.
+     */
+    bool hasFilter() const {
+        ensureLoaded();
+        return !filter.empty();
+    }
+
     /**
      * @brief Retrieves the value associated with a key from the SSTable.
+     * @details Reads only the one block that may hold the key, with a single pread or straight from
+     *          the mapping. In pread mode the block is looked up in, and unless fill_cache is false
+     *          added to, the shared block cache; blocks read from disk have their checksum verified
+     *          and are decompressed before they are searched or cached. Uncompressed mapped blocks
+     *          are searched in place without a checksum. Callers are expected to consult mayContain()
+     *          first.
      * @param key The key to look up.
-     * @return A pair containing a boolean (indicating success) and the value.
+     * @param fill_cache Whether a block read from disk should be inserted into the block cache.
+     * @return A pair containing a boolean (indicating success) and the value, with its expiry header if any;
+     *         {false, TOMBSTONE} if the key is deleted, its value has expired or a range tombstone of the table covers it.
      */
-    std::pair<bool, std::string> getValue(std::string key) {
+    std::pair<bool, std::string> getValue(std::string_view key, bool fill_cache = true) const {
+        std::pair<bool, std::string> result(false, "");
+        getValues(&key, &result, 1, fill_cache);
+        return result;
+    }
+
+    /**
+     * @brief Retrieves the values of several keys, reading each block at most once.
+     * @details Keys that fall in the same block are all searched in it after a single read (or
+     *          cache lookup), as getValue() would search one. Callers are expected to consult
+     *          mayContain() first.
+     * @param keys The keys to look up, in ascending order.
+     * @param results Receives a result per key, like getValue()'s.
+     * @param count The number of keys.
+     * @param fill_cache Whether blocks read from disk should be inserted into the block cache.
+     */
+    void getValues(const std::string_view *keys, std::pair<bool, std::string> *results, size_t count, bool fill_cache = true) const {
+        ensureLoaded();
+        for (size_t i = 0; i < count; ++i) {
+            results[i] = {false, ""};
+        }
         if (!indexLoaded) {
-            return {false, ""};
+            return;
         }
-        std::optional<uint64_t> start_offset = findStartOffset(key);
-        if (!start_offset.has_value()) {
-            return {false, ""};
+        for (size_t first = 0; first < count;) {
+            std::optional<size_t> block = findBlock(keys[first]);
+            if (!block.has_value()) {
+                // Later keys are larger, so they are outside the table's range too
+                if (format == TableFormat::BLOCK_BASED) {
+                    break;
+                }
+                ++first;
+                continue;
+            }
+            size_t last = first + 1;
+            while (last < count && findBlock(keys[last]) == block) {
+                ++last;
+            }
+            searchBlockFor(block.value(), keys + first, results + first, last - first, fill_cache);
+            first = last;
+        }
+        uint64_t now = Expiry::nowMillis();
+        for (size_t i = 0; i < count; ++i) {
+            Expiry::check(results[i], now);
+            if (!results[i].first && results[i].second.empty() && RangeDeletion::covers(range_tombstones, keys[i])) {
+                results[i].second = TOMBSTONE;
+            }
         }
+    }
+
+    /**
+     * @brief Checks whether a range tombstone of the table deletes a key in older tables.
+     * @details Needs no data block, so it also settles keys the Bloom filter rules out.
+     * @param key The key.
+     */
+    bool deletesKey(std::string_view key) const {
+        ensureLoaded();
+        return RangeDeletion::covers(range_tombstones, key);
+    }
 
-        std::ifstream dataFile(data_filename, std::ios::binary);
-        if (!dataFile.is_open()) {
-            return {false, ""};
+    /**
+     * @brief Gets the table's range tombstones.
+     * @return const std::vector<RangeTombstone>& Sorted, disjoint ranges; records of the table itself are never inside them.
+     */
+    const std::vector<RangeTombstone> &getRangeTombstones() const {
+        ensureLoaded();
+        return range_tombstones;
+    }
+
+    /**
+     * @class Iterator
+     * @brief Sequential reader over every record of an SS_Table, in key order.
+     * @details Reads the data file through the table's descriptor in chunks of READ_BUFFER_SIZE,
+     *          so memory use stays bounded no matter how large the table is. Blocks of block-based
+     *          tables are checksummed as they are reached, so compaction never copies a corrupt
+     *          block forward. The views returned by key() and value() are valid until the next call
+     *          to next(). The table must outlive the iterator.
+     */
+    class Iterator {
+    private:
+        static constexpr size_t READ_BUFFER_SIZE = 64 * 1024;
+
+        const SS_Table *table;
+        std::string buffer;   ///< Bytes read from the file; the current record starts at record_pos.
+        size_t buffer_end = 0; ///< Bytes of buffer holding file data.
+        size_t record_pos = 0; ///< Start of the current record in buffer.
+        uint64_t file_pos = 0; ///< File offset of buffer[buffer_end].
+        std::string_view current_key;
+        std::string_view current_value;
+        bool valid = false;
+        size_t block_index = 0;                  ///< Index entry of the current block of a block-based table.
+        std::optional<BlockIterator> block_iter; ///< Records of the current block, viewing into buffer or uncompressed.
+        std::unique_ptr<std::string> uncompressed; ///< The current block if it was compressed; heap-held so moves keep views valid.
+
+        /**
+         * @brief Reads and verifies block `block_index` of a block-based table, unless it is already buffered.
+         * @return True if the block is loaded into block_iter, unpositioned.
+         */
+        bool loadBlock() {
+            valid = false;
+            const BlockHandle &handle = table->index[block_index].handle;
+            size_t needed = static_cast<size_t>(handle.size) + BlockTrailer::SIZE;
+            if (handle.offset + needed > table->data_size) {
+                std::cerr << "Block out of range in " << table->data_filename << std::endl;
+                return false;
+            }
+            uint64_t buffer_start = file_pos - buffer_end;
+            if (handle.offset < buffer_start || handle.offset + needed > file_pos) {
+                // Read ahead, so a scan reads many small blocks with one call
+                size_t want = std::min<uint64_t>(std::max(needed, READ_BUFFER_SIZE), table->data_size - handle.offset);
+                if (buffer.size() < std::max(want, READ_BUFFER_SIZE)) {
+                    buffer.resize(std::max(want, READ_BUFFER_SIZE));
+                }
+                block_iter.reset();
+                buffer_end = 0;
+                file_pos = 0;
+                if (!table->readAt(&buffer[0], want, handle.offset)) {
+                    std::cerr << "Failed to read " << table->data_filename << ": " << strerror(errno) << std::endl;
+                    return false;
+                }
+                buffer_end = want;
+                file_pos = handle.offset + want;
+                buffer_start = handle.offset;
+            }
+
+            const char *contents = buffer.data() + (handle.offset - buffer_start);
+            if (!BlockTrailer::verify(contents, static_cast<size_t>(handle.size))) {
+                std::cerr << "Checksum mismatch in " << table->data_filename << " at offset " << handle.offset << std::endl;
+                return false;
+            }
+            std::string_view stored(contents, static_cast<size_t>(handle.size));
+            char type = BlockTrailer::type(contents, stored.size());
+            if (type == BlockTrailer::NO_COMPRESSION) {
+                block_iter.emplace(stored);
+                return true;
+            }
+            if (uncompressed == nullptr) {
+                uncompressed = std::make_unique<std::string>();
+            }
+            if (!Compression::uncompress(type, stored, *uncompressed)) {
+                std::cerr << "Failed to decompress block of " << table->data_filename << " at offset " << handle.offset << std::endl;
+                return false;
+            }
+            block_iter.emplace(*uncompressed);
+            return true;
         }
-        dataFile.seekg(start_offset.value());
 
-        while (!dataFile.eof()) {
-            uint32_t key_size;
-            dataFile.read(reinterpret_cast<char *>(&key_size), sizeof(key_size));
-            if (dataFile.eof()) {
-                break;
+        /**
+         * @brief Moves past the end of exhausted blocks to the next record, if any.
+         */
+        void settle() {
+            while (!block_iter->isValid()) {
+                if (block_iter->isCorrupt()) {
+                    std::cerr << "Corrupt block in " << table->data_filename << std::endl;
+                    valid = false;
+                    return;
+                }
+                if (++block_index >= table->index.size() || !loadBlock()) {
+                    valid = false;
+                    return;
+                }
+                block_iter->seekToFirst();
             }
+            valid = true;
+        }
 
-            std::string stored_key(key_size, 0);
-            dataFile.read(&stored_key[0], key_size);
-            if (stored_key > key) {
-                return {false, ""};
+        /**
+         * @brief Makes sure `needed` bytes starting at record_pos are in the buffer.
+         * @return True if they are, false at the end of the file or on a read error.
+         */
+        bool ensure(size_t needed) {
+            if (buffer_end - record_pos >= needed) {
+                return true;
+            }
+            // Move the partial record to the front and top the buffer up
+            buffer.erase(0, record_pos);
+            buffer_end -= record_pos;
+            record_pos = 0;
+            if (buffer.size() < std::max(needed, READ_BUFFER_SIZE)) {
+                buffer.resize(std::max(needed, READ_BUFFER_SIZE));
+            }
+            while (buffer_end < needed && file_pos < table->data_size) {
+                size_t want = std::min<uint64_t>(buffer.size() - buffer_end, table->data_size - file_pos);
+                if (!table->readAt(&buffer[buffer_end], want, file_pos)) {
+                    std::cerr << "Failed to read " << table->data_filename << ": " << strerror(errno) << std::endl;
+                    return false;
+                }
+                buffer_end += want;
+                file_pos += want;
             }
+            return buffer_end >= needed;
+        }
 
+        /**
+         * @brief Parses the record at record_pos.
+         */
+        void parse() {
+            valid = false;
+            if (!ensure(sizeof(uint32_t))) {
+                return;
+            }
+            uint32_t key_size;
+            std::memcpy(&key_size, buffer.data() + record_pos, sizeof(key_size));
+            if (!ensure(sizeof(uint32_t) + key_size + sizeof(uint32_t))) {
+                return;
+            }
             uint32_t value_size;
-            dataFile.read(reinterpret_cast<char *>(&value_size), sizeof(value_size));
-            std::string value(value_size, 0);
-            dataFile.read(&value[0], value_size);
+            std::memcpy(&value_size, buffer.data() + record_pos + sizeof(uint32_t) + key_size, sizeof(value_size));
+            size_t record_size = 2 * sizeof(uint32_t) + static_cast<size_t>(key_size) + value_size;
+            if (!ensure(record_size)) {
+                return;
+            }
+            const char *record = buffer.data() + record_pos;
+            current_key = std::string_view(record + sizeof(uint32_t), key_size);
+            current_value = std::string_view(record + 2 * sizeof(uint32_t) + key_size, value_size);
+            valid = true;
+        }
 
-            if (stored_key == key) {
-                dataFile.close();
-                if (value == TOMBSTONE) {
-                    return {false, value};
+    public:
+        explicit Iterator(const SS_Table *table) : table(table) {
+            table->ensureLoaded();
+            if (table->data_fd == -1) {
+                return;
+            }
+            if (table->format == TableFormat::BLOCK_BASED) {
+                if (!table->index.empty() && loadBlock()) {
+                    block_iter->seekToFirst();
+                    settle();
                 }
-                return {true, value};
+                return;
             }
+            parse();
+        }
+
+        /**
+         * @brief Positions the iterator at the first record with a key not less than `start`.
+         * @details Reading begins at the block that may hold `start`, so only the records of that
+         *          block before it are skipped.
+         */
+        Iterator(const SS_Table *table, std::string_view start) : table(table) {
+            table->ensureLoaded();
+            if (table->data_fd == -1) {
+                return;
+            }
+            std::optional<size_t> block = table->findBlock(start);
+            if (table->format == TableFormat::BLOCK_BASED) {
+                if (block.has_value()) {
+                    block_index = block.value();
+                    if (loadBlock()) {
+                        block_iter->seek(start);
+                        settle();
+                    }
+                }
+                return;
+            }
+            file_pos = block.has_value() ? table->index[block.value()].handle.offset : 0;
+            parse();
+            while (valid && current_key < start) {
+                next();
+            }
+        }
+
+        bool isValid() const {
+            return valid;
+        }
+
+        std::string_view key() const {
+            return block_iter.has_value() ? block_iter->key() : current_key;
+        }
+
+        std::string_view value() const {
+            return block_iter.has_value() ? block_iter->value() : current_value;
+        }
+
+        void next() {
+            if (table->format == TableFormat::BLOCK_BASED) {
+                block_iter->next();
+                settle();
+                return;
+            }
+            record_pos += 2 * sizeof(uint32_t) + current_key.size() + current_value.size();
+            parse();
+        }
+    };
+
+    /**
+     * @brief Creates a sequential iterator over the table.
+     * @return Iterator Positioned at the first record.
+     */
+    Iterator iterator() const {
+        return Iterator(this);
+    }
+
+    /**
+     * @brief Creates a sequential iterator starting part way through the table.
+     * @param start Key to start at.
+     * @return Iterator Positioned at the first record with a key not less than start.
+     */
+    Iterator iterator(std::string_view start) const {
+        return Iterator(this, start);
+    }
+
+    /**
+     * @brief Picks keys spread evenly through the table from its index.
+     * @param count Number of keys wanted; fewer are returned if the index is smaller.
+     * @return std::vector<std::string> The keys, in key order.
+     */
+    std::vector<std::string> sampleKeys(size_t count) const {
+        ensureLoaded();
+        std::vector<std::string> keys;
+        count = std::min(count, index.size());
+        for (size_t i = 0; i < count; ++i) {
+            keys.push_back(index[i * index.size() / count].key);
+        }
+        return keys;
+    }
+
+    /**
+     * @brief Checks whether the table's files were opened and read successfully.
+     * @return True if the table can serve lookups.
+     */
+    bool isLoaded() const {
+        ensureLoaded();
+        return indexLoaded;
+    }
+
+    /**
+     * @brief Gets the first key stored in the table, or the start of its first range tombstone if smaller.
+     */
+    const std::string &getSmallestKey() const {
+        return smallest_key;
+    }
+
+    /**
+     * @brief Gets the last key stored in the table, or the last key its range tombstones cover if larger.
+     * @details A range tombstone's end is exclusive, so for ends not of the form `key + '\0'` this
+     *          may be one key beyond what the table covers.
+     */
+    const std::string &getLargestKey() const {
+        return largest_key;
+    }
+
+    /**
+     * @brief Checks whether the table's key range intersects [smallest, largest].
+     * @param smallest Lower bound of the range, inclusive.
+     * @param largest Upper bound of the range, inclusive.
+     * @return True if the ranges overlap.
+     */
+    bool overlaps(std::string_view smallest, std::string_view largest) const {
+        return !(largest_key < smallest || smallest_key > largest);
+    }
+
+    /**
+     * @brief Gets the size of the table's data file (the whole file of a block-based table) in bytes.
+     */
+    uint64_t getFileSize() const {
+        return data_size;
+    }
+
+    /**
+     * @brief Gets the codec the table's data blocks were written with, NONE for legacy tables.
+     */
+    CompressionType getCompression() const {
+        ensureLoaded();
+        return compression;
+    }
+
+    /**
+     * @brief Gets the on-disk layout of the table.
+     */
+    TableFormat getFormat() const {
+        ensureLoaded();
+        return format;
+    }
+
+    /**
+     * @brief Gets the table's sequence number; among L0 tables a higher number holds newer data.
+     */
+    uint64_t getSequence() const {
+        return sequence;
+    }
+
+    /**
+     * @brief Sets the table's sequence number before the table is published.
+     */
+    void setSequence(uint64_t number) {
+        sequence = number;
+    }
+
+    /**
+     * @brief Gets the table's filename without extensions.
+     * @return The base name, as passed to createFromMemTable() or SSTableBuilder.
+     */
+    const std::string &getBaseName() const {
+        return base_name;
+    }
+
+    /**
+     * @brief Marks the table as replaced by a compaction.
+     * @details Readers may still hold the table, so its files are deleted by the destructor, once
+     *          the last of them is done with it.
+     */
+    void markObsolete() {
+        obsolete = true;
+    }
+
+    /**
+     * @brief Deletes every file a table with the given base name may have, in either format.
+     * @param filename Base filename of the table (without extensions).
+     */
+    static void removeFiles(const std::string &filename) {
+        for (const std::string &extension : {SST_EXTENSION, INDEX_EXTENSION, DATA_EXTENSION, FILTER_EXTENSION}) {
+            std::filesystem::remove(filename + extension);
         }
-        dataFile.close();
-        return {false, ""};
     }
 
     /**
@@ -212,6 +1082,7 @@ public:
      * @return The index file's name.
      */
     std::string getIndexFile() const {
+        ensureLoaded();
         return index_filename;
     }
 
@@ -220,8 +1091,30 @@ public:
      * @return The data file's name.
      */
     std::string getDataFilename() const {
+        ensureLoaded();
         return data_filename;
     }
+
+    /**
+     * @brief Gets the filename of the SSTable's Bloom filter file.
+     * @return The filter file's name.
+     */
+    std::string getFilterFilename() const {
+        ensureLoaded();
+        return filter_filename;
+    }
+
+    ~SS_Table() {
+        if (mapped_data != nullptr) {
+            munmap(const_cast<char *>(mapped_data), data_size);
+        }
+        if (data_fd != -1) {
+            close(data_fd);
+        }
+        if (obsolete) {
+            removeFiles(base_name);
+        }
+    }
 };
 
 #endif
\ No newline at end of file
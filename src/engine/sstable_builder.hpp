@@ -0,0 +1,222 @@
+/**
+ * @file sstable_builder.hpp
+ * @brief Incremental SSTable writer
+ * @details This file contains the writer used for every SSTable, whether it comes from a MemTable
+ *          flush or from compaction. Records are streamed to disk one data block at a time, so memory
+ *          use does not depend on the size of the table beyond the index and 4 bytes per key for the
+ *          Bloom filter.
+ * @author Gana Jayant Sigadam
+ * @date March 2025
+ * @version 1.0
+ */
+#ifndef SS_TABLE_BUILDER
+#define SS_TABLE_BUILDER
+
+#include "bloom_filter.hpp"
+#include "compression.hpp"
+#include "constants.hpp"
+#include "options.hpp"
+#include "range_deletion.hpp"
+#include "table_format.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * @class SSTableBuilder
+ * @brief Writes one block-based SSTable (see table_format.hpp)
+ * @details Keys must be added in strictly increasing order. Data blocks are cut once they reach
+ *          the block size (BLOCK_SIZE unless given) and compressed one by one; the filter block,
+ *          the range deletion block, the index block and the footer are written by finish() and
+ *          never compressed. Range tombstones may be added in any order, and must not cover any
+ *          key added to the same table.
+ */
+class SSTableBuilder {
+private:
+    std::string filename;        ///< Base filename (without extensions).
+    size_t bits_per_key;         ///< Bloom filter bits per key, 0 for no filter.
+    CompressionType compression; ///< Codec for data blocks, one this build supports.
+    size_t block_size;           ///< Size at which a data block is cut.
+    std::ofstream file;
+    BlockBuilder data_block;     ///< Records of the data block being built.
+    BlockBuilder index_block;    ///< Last key and handle of every finished data block.
+    std::string last_key;        ///< Last key added, the index key of the pending data block.
+    uint64_t entries_count = 0;  ///< Records added so far.
+    uint64_t offset = 0;         ///< Size of the file so far.
+    std::vector<uint32_t> key_hashes;
+    std::vector<RangeTombstone> range_tombstones; ///< Range tombstones added so far.
+    std::string compressed;      ///< Scratch buffer for the compressed data block.
+
+    /**
+     * @brief Flushes a file's contents to stable storage.
+     * @param path Path of the file (or directory) to sync.
+     * @return True if successful, otherwise false.
+     */
+    static bool syncPath(const std::string &path) {
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd == -1) {
+            return false;
+        }
+        bool ok = fsync(fd) == 0;
+        close(fd);
+        return ok;
+    }
+
+    /**
+     * @brief Appends a block and its trailer to the file.
+     * @param contents The stored block contents.
+     * @param type The CompressionType of the contents.
+     * @return BlockHandle Where the block was written.
+     */
+    BlockHandle writeBlock(std::string_view contents, char type = BlockTrailer::NO_COMPRESSION) {
+        BlockHandle handle;
+        handle.offset = offset;
+        handle.size = contents.size();
+        std::string trailer = BlockTrailer::encode(contents, type);
+        file.write(contents.data(), contents.size());
+        file.write(trailer.data(), trailer.size());
+        offset += contents.size() + trailer.size();
+        return handle;
+    }
+
+    /**
+     * @brief Writes the pending data block and adds it to the index.
+     */
+    void flushDataBlock() {
+        if (data_block.empty()) {
+            return;
+        }
+        const std::string &contents = data_block.finish();
+        BlockHandle handle = Compression::compress(compression, contents, compressed)
+                                 ? writeBlock(compressed, static_cast<char>(compression))
+                                 : writeBlock(contents);
+        data_block.reset();
+
+        std::string encoded_handle;
+        handle.encodeTo(encoded_handle);
+        index_block.add(last_key, encoded_handle);
+    }
+
+public:
+    /**
+     * @brief Creates the file of a new SSTable.
+     * @param filename Base filename for the new SSTable (without extensions).
+     * @param bits_per_key Bloom filter bits per key, 0 to skip writing a filter.
+     * @param compression Codec for the data blocks; NONE is used if this build lacks it.
+     * @param block_size Target size of a data block.
+     * @param restart_interval Number of keys between restart points in a data block.
+     */
+    SSTableBuilder(const std::string &filename, size_t bits_per_key = BLOOM_BITS_PER_KEY,
+                   CompressionType compression = BLOCK_COMPRESSION, size_t block_size = BLOCK_SIZE,
+                   size_t restart_interval = BLOCK_RESTART_INTERVAL)
+        : filename(filename), bits_per_key(bits_per_key), compression(Compression::effective(compression)),
+          block_size(block_size), file(filename + SST_EXTENSION, std::ios::binary),
+          data_block(restart_interval), index_block(1) {}
+
+    /**
+     * @brief Creates the file of a new SSTable laid out as a tree's Options ask.
+     * @param filename Base filename for the new SSTable (without extensions).
+     * @param options Block size, restart interval and Bloom filter bits of the table.
+     * @param compression Codec for the data blocks; NONE is used if this build lacks it.
+     */
+    SSTableBuilder(const std::string &filename, const Options &options, CompressionType compression)
+        : SSTableBuilder(filename, options.bloom_bits_per_key, compression, options.block_size, options.block_restart_interval) {}
+
+    /**
+     * @brief Checks whether the file was created and every write so far succeeded.
+     * @return True if the builder is usable, otherwise false.
+     */
+    bool ok() const {
+        return file.good();
+    }
+
+    /**
+     * @brief Appends a record.
+     * @param key The key, greater than every key added before.
+     * @param value The value, or TOMBSTONE.
+     */
+    void add(std::string_view key, std::string_view value) {
+        data_block.add(key, value);
+        last_key.assign(key.data(), key.size());
+        entries_count++;
+        if (bits_per_key > 0) {
+            key_hashes.push_back(BloomFilter::hash(key));
+        }
+        if (data_block.sizeEstimate() >= block_size) {
+            flushDataBlock();
+        }
+    }
+
+    /**
+     * @brief Adds a range tombstone deleting [start, end) in older tables.
+     */
+    void addRangeTombstone(std::string_view start, std::string_view end) {
+        range_tombstones.push_back({std::string(start), std::string(end), 0});
+    }
+
+    /**
+     * @brief Gets the number of records added so far.
+     */
+    uint64_t entries() const {
+        return entries_count;
+    }
+
+    /**
+     * @brief Gets the size of the data written so far, including the pending block.
+     */
+    uint64_t fileSize() const {
+        return offset + (data_block.empty() ? 0 : data_block.sizeEstimate());
+    }
+
+    /**
+     * @brief Completes the table: writes the last data block, the filter, the range tombstones, the index and the footer, and syncs.
+     * @details The table must be on stable storage before the write-ahead log or the compaction
+     *          inputs covering it are deleted, so the file and the directory are fsynced.
+     * @return True if the table was written successfully, otherwise false.
+     */
+    bool finish() {
+        flushDataBlock();
+
+        TableFooter footer;
+        footer.compression = compression;
+        if (bits_per_key > 0 && !key_hashes.empty()) {
+            footer.filter = writeBlock(BloomFilter::buildFromHashes(key_hashes, bits_per_key));
+        }
+        RangeDeletion::normalize(range_tombstones);
+        if (!range_tombstones.empty()) {
+            BlockBuilder range_deletion_block(1);
+            for (const RangeTombstone &tombstone : range_tombstones) {
+                range_deletion_block.add(tombstone.start, tombstone.end);
+            }
+            footer.range_deletions = writeBlock(range_deletion_block.finish());
+        }
+        footer.index = writeBlock(index_block.finish());
+        std::string encoded_footer = footer.encode();
+        file.write(encoded_footer.data(), encoded_footer.size());
+        offset += encoded_footer.size();
+
+        file.close();
+        if (file.fail()) {
+            return false;
+        }
+        std::string directory = std::filesystem::path(filename).parent_path().string();
+        return syncPath(filename + SST_EXTENSION) && syncPath(directory.empty() ? "." : directory);
+    }
+
+    /**
+     * @brief Deletes the file of an unfinished or failed table.
+     */
+    void abandon() {
+        file.close();
+        std::filesystem::remove(filename + SST_EXTENSION);
+    }
+};
+
+#endif
@@ -0,0 +1,414 @@
+/**
+ * @file table_format.hpp
+ * @brief Building blocks of the block-based SSTable format
+ * @details This file contains the pieces shared by the SSTable writer and reader: the block
+ *          encoding with shared-prefix keys and restart points, block handles, the checksummed
+ *          block trailer and the footer.
+ *
+ *          A block-based table is a single `.sst` file:
+ *
+ *              [data block 1] ... [data block N] [filter block] [range deletion block] [index block] [footer]
+ *
+ *          Every block is followed by a 5-byte trailer, [type (1 byte)] [CRC32 (4 bytes)], where
+ *          the type is the CompressionType of the stored contents and the checksum covers the
+ *          stored contents and the type byte. Data blocks hold the records,
+ *          the index block maps the last key of each data block to its handle, the optional
+ *          filter block holds the Bloom filter over all keys, and the optional range deletion block
+ *          maps the start of each range tombstone to its end. The footer locates the index, filter
+ *          and range deletion blocks and identifies the file.
+ * @author Gana Jayant Sigadam
+ * @date March 2025
+ * @version 1.0
+ */
+#ifndef TABLE_FORMAT_HPP
+#define TABLE_FORMAT_HPP
+
+#include "coding.hpp"
+#include "constants.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief On-disk layouts an SS_Table can be read from.
+ * @details LEGACY tables are split over `.index`, `.data` and `.filter` files with a sparse index of
+ *          every tenth key; BLOCK_BASED tables are single `.sst` files laid out as described above.
+ */
+enum class TableFormat {
+    LEGACY,
+    BLOCK_BASED
+};
+
+/**
+ * @struct BlockHandle
+ * @brief Location of a block in a table file, excluding its trailer
+ */
+struct BlockHandle {
+    uint64_t offset = 0;
+    uint64_t size = 0;
+
+    void encodeTo(std::string &dst) const {
+        Coding::putVarint64(dst, offset);
+        Coding::putVarint64(dst, size);
+    }
+
+    bool decodeFrom(std::string_view &input) {
+        return Coding::getVarint64(input, offset) && Coding::getVarint64(input, size);
+    }
+};
+
+/**
+ * @struct TableFooter
+ * @brief Record at the end of a block-based table
+ * @details Layout: [filter handle (2 x 8 bytes)] [index handle (2 x 8 bytes)] [compression (4 bytes)]
+ *          [range deletion handle (2 x 8 bytes)] [format version (4 bytes)] [CRC32 of the preceding bytes (4 bytes)]
+ *          [magic number (8 bytes)]. Version 2 footers have no range deletion handle and are 52 bytes long,
+ *          version 1 footers no compression field either and are 48 bytes long. The version always
+ *          sits 16 bytes before the end of the file, so a reader finds it before knowing the size.
+ */
+struct TableFooter {
+    static constexpr size_t MAX_ENCODED_SIZE = 68;
+    static constexpr uint64_t MAGIC = 0x424c494e4b535354ULL; ///< "BLINKSST"
+    static constexpr uint32_t FORMAT_VERSION = 3;            ///< Newest version this build writes and reads.
+
+    BlockHandle filter; ///< Filter block, size 0 if the table has no filter.
+    BlockHandle index;  ///< Index block.
+    CompressionType compression = CompressionType::NONE; ///< Codec the table's data blocks were written with.
+    BlockHandle range_deletions; ///< Range deletion block, size 0 if the table has no range tombstones.
+    uint32_t version = FORMAT_VERSION;
+
+    /**
+     * @brief Size of a footer of the given format version, 0 for unknown versions
+     */
+    static size_t encodedSize(uint32_t version) {
+        switch (version) {
+        case 1:
+            return 48;
+        case 2:
+            return 52;
+        case 3:
+            return 68;
+        default:
+            return 0;
+        }
+    }
+
+    std::string encode() const {
+        std::string dst;
+        Coding::putFixed64(dst, filter.offset);
+        Coding::putFixed64(dst, filter.size);
+        Coding::putFixed64(dst, index.offset);
+        Coding::putFixed64(dst, index.size);
+        Coding::putFixed32(dst, static_cast<uint32_t>(compression));
+        Coding::putFixed64(dst, range_deletions.offset);
+        Coding::putFixed64(dst, range_deletions.size);
+        Coding::putFixed32(dst, FORMAT_VERSION);
+        Coding::putFixed32(dst, Coding::crc32(dst.data(), dst.size()));
+        Coding::putFixed64(dst, MAGIC);
+        return dst;
+    }
+
+    /**
+     * @brief Decode a footer, checking its magic number, checksum and version
+     * @param data The last `size` bytes of the file
+     * @param size Number of bytes available, up to MAX_ENCODED_SIZE
+     * @return bool False if the bytes do not end with a footer this build can read
+     */
+    bool decode(const char *data, size_t size) {
+        if (size < 16 || Coding::decodeFixed64(data + size - 8) != MAGIC) {
+            return false;
+        }
+        version = Coding::decodeFixed32(data + size - 16);
+        size_t encoded_size = encodedSize(version);
+        if (encoded_size == 0 || encoded_size > size) {
+            return false;
+        }
+        const char *footer = data + size - encoded_size;
+        if (Coding::decodeFixed32(data + size - 12) != Coding::crc32(footer, encoded_size - 12)) {
+            return false;
+        }
+        filter.offset = Coding::decodeFixed64(footer);
+        filter.size = Coding::decodeFixed64(footer + 8);
+        index.offset = Coding::decodeFixed64(footer + 16);
+        index.size = Coding::decodeFixed64(footer + 24);
+        compression = version >= 2 ? static_cast<CompressionType>(Coding::decodeFixed32(footer + 32)) : CompressionType::NONE;
+        range_deletions = BlockHandle();
+        if (version >= 3) {
+            range_deletions.offset = Coding::decodeFixed64(footer + 36);
+            range_deletions.size = Coding::decodeFixed64(footer + 44);
+        }
+        return true;
+    }
+};
+
+/**
+ * @class BlockTrailer
+ * @brief Type byte and checksum written after every block
+ */
+class BlockTrailer {
+public:
+    static constexpr size_t SIZE = 5;
+    static constexpr char NO_COMPRESSION = static_cast<char>(CompressionType::NONE);
+
+    /**
+     * @brief Encode the trailer of a block
+     * @param contents The block contents
+     * @param type Block type byte
+     * @return std::string The SIZE trailer bytes
+     */
+    static std::string encode(std::string_view contents, char type = NO_COMPRESSION) {
+        std::string trailer(1, type);
+        Coding::putFixed32(trailer, Coding::crc32(&type, 1, Coding::crc32(contents.data(), contents.size())));
+        return trailer;
+    }
+
+    /**
+     * @brief Verify the trailer following a block read from disk
+     * @param data Block contents immediately followed by the trailer
+     * @param contents_size Size of the block contents
+     * @return bool True if the checksum matches
+     */
+    static bool verify(const char *data, size_t contents_size) {
+        return Coding::decodeFixed32(data + contents_size + 1) == Coding::crc32(data, contents_size + 1);
+    }
+
+    /**
+     * @brief Get the type byte of a block, the CompressionType of its stored contents
+     * @param data Block contents immediately followed by the trailer
+     * @param contents_size Size of the block contents
+     */
+    static char type(const char *data, size_t contents_size) {
+        return data[contents_size];
+    }
+};
+
+/**
+ * @class BlockBuilder
+ * @brief Encodes sorted records into a block with shared-prefix keys
+ * @details Record format: [shared (varint)] [unshared (varint)] [value size (varint)] [key suffix] [value],
+ *          where `shared` is the length of the prefix the key has in common with the previous key.
+ *          Every `restart_interval` records the full key is stored (shared = 0) and the record's
+ *          offset is added to the restart array, which follows the records as fixed 32-bit offsets
+ *          and a 32-bit count. Readers binary-search the restart points, then scan at most
+ *          `restart_interval` records.
+ */
+class BlockBuilder {
+private:
+    size_t restart_interval;
+    std::string buffer;
+    std::vector<uint32_t> restarts;
+    size_t counter = 0; ///< Records since the last restart point.
+    std::string last_key;
+
+public:
+    explicit BlockBuilder(size_t restart_interval) : restart_interval(std::max<size_t>(restart_interval, 1)) {
+        restarts.push_back(0);
+    }
+
+    /**
+     * @brief Append a record; keys must be added in increasing order
+     */
+    void add(std::string_view key, std::string_view value) {
+        size_t shared = 0;
+        if (counter < restart_interval) {
+            size_t limit = std::min(last_key.size(), key.size());
+            while (shared < limit && last_key[shared] == key[shared]) {
+                shared++;
+            }
+        } else {
+            restarts.push_back(static_cast<uint32_t>(buffer.size()));
+            counter = 0;
+        }
+        Coding::putVarint32(buffer, static_cast<uint32_t>(shared));
+        Coding::putVarint32(buffer, static_cast<uint32_t>(key.size() - shared));
+        Coding::putVarint32(buffer, static_cast<uint32_t>(value.size()));
+        buffer.append(key.data() + shared, key.size() - shared);
+        buffer.append(value.data(), value.size());
+
+        last_key.assign(key.data(), key.size());
+        counter++;
+    }
+
+    /**
+     * @brief Size the block will have once finished
+     */
+    size_t sizeEstimate() const {
+        return buffer.size() + (restarts.size() + 1) * sizeof(uint32_t);
+    }
+
+    bool empty() const {
+        return buffer.empty();
+    }
+
+    /**
+     * @brief Append the restart array and return the finished block contents
+     */
+    const std::string &finish() {
+        for (uint32_t restart : restarts) {
+            Coding::putFixed32(buffer, restart);
+        }
+        Coding::putFixed32(buffer, static_cast<uint32_t>(restarts.size()));
+        return buffer;
+    }
+
+    /**
+     * @brief Clear the builder to start a new block
+     */
+    void reset() {
+        buffer.clear();
+        restarts.assign(1, 0);
+        counter = 0;
+        last_key.clear();
+    }
+};
+
+/**
+ * @class BlockIterator
+ * @brief Reads the records of one block built by BlockBuilder
+ * @details The block contents must outlive the iterator. value() points into the block; key() is
+ *          rebuilt from the shared prefixes and stays valid until the iterator moves.
+ */
+class BlockIterator {
+private:
+    std::string_view data;     ///< Record area of the block, without the restart array.
+    const char *restart_array; ///< Start of the fixed 32-bit restart offsets.
+    uint32_t num_restarts = 0;
+    size_t next_offset = 0; ///< Offset of the record after the current one.
+    std::string current_key;
+    std::string_view current_value;
+    bool valid = false;
+    bool corrupt = false;
+
+    uint32_t restartPoint(uint32_t index) const {
+        return Coding::decodeFixed32(restart_array + index * sizeof(uint32_t));
+    }
+
+    /**
+     * @brief Decode the record at next_offset into the current position
+     */
+    bool parseNext() {
+        valid = false;
+        if (next_offset >= data.size()) {
+            return false;
+        }
+        std::string_view input = data.substr(next_offset);
+        uint32_t shared, unshared, value_size;
+        if (!Coding::getVarint32(input, shared) || !Coding::getVarint32(input, unshared) ||
+            !Coding::getVarint32(input, value_size) || shared > current_key.size() ||
+            static_cast<uint64_t>(unshared) + value_size > input.size()) {
+            corrupt = true;
+            return false;
+        }
+        current_key.resize(shared);
+        current_key.append(input.data(), unshared);
+        current_value = input.substr(unshared, value_size);
+        next_offset = static_cast<size_t>(current_value.data() + value_size - data.data());
+        valid = true;
+        return true;
+    }
+
+public:
+    /**
+     * @brief Open a block
+     * @param contents The block contents, without the trailer
+     */
+    explicit BlockIterator(std::string_view contents) {
+        if (contents.size() < sizeof(uint32_t)) {
+            corrupt = true;
+            return;
+        }
+        num_restarts = Coding::decodeFixed32(contents.data() + contents.size() - sizeof(uint32_t));
+        size_t restart_bytes = (static_cast<size_t>(num_restarts) + 1) * sizeof(uint32_t);
+        if (num_restarts == 0 || restart_bytes > contents.size()) {
+            corrupt = true;
+            num_restarts = 0;
+            return;
+        }
+        data = contents.substr(0, contents.size() - restart_bytes);
+        restart_array = data.data() + data.size();
+    }
+
+    bool isValid() const {
+        return valid;
+    }
+
+    /**
+     * @brief Whether decoding stopped at a malformed block or record
+     */
+    bool isCorrupt() const {
+        return corrupt;
+    }
+
+    std::string_view key() const {
+        return current_key;
+    }
+
+    std::string_view value() const {
+        return current_value;
+    }
+
+    void seekToFirst() {
+        if (num_restarts == 0) {
+            return;
+        }
+        current_key.clear();
+        next_offset = 0;
+        parseNext();
+    }
+
+    /**
+     * @brief Position at the first record with a key not less than `target`
+     */
+    void seek(std::string_view target) {
+        if (num_restarts == 0) {
+            return;
+        }
+        // Find the last restart point whose key is less than the target
+        uint32_t left = 0, right = num_restarts - 1;
+        while (left < right) {
+            uint32_t mid = left + (right - left + 1) / 2;
+            current_key.clear();
+            next_offset = restartPoint(mid);
+            if (!parseNext()) {
+                return;
+            }
+            if (std::string_view(current_key) < target) {
+                left = mid;
+            } else {
+                right = mid - 1;
+            }
+        }
+
+        current_key.clear();
+        next_offset = restartPoint(left);
+        while (parseNext() && std::string_view(current_key) < target) {
+        }
+    }
+
+    void next() {
+        parseNext();
+    }
+
+    /**
+     * @brief Look up a key in a block
+     * @param contents The block contents, without the trailer
+     * @param key The key to look up
+     * @return std::pair<bool, std::string> Found flag and value; {false, TOMBSTONE} for deleted keys
+     */
+    static std::pair<bool, std::string> find(std::string_view contents, std::string_view key) {
+        BlockIterator it(contents);
+        it.seek(key);
+        if (!it.isValid() || it.key() != key) {
+            return {false, ""};
+        }
+        std::string value(it.value());
+        return {value != TOMBSTONE, value};
+    }
+};
+
+#endif
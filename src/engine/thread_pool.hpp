@@ -0,0 +1,133 @@
+/**
+ * @file thread_pool.hpp
+ * @brief Fixed-size pool of background threads
+ * @details This file contains the thread pool that runs the LSM tree's background work. The tree
+ *          keeps one pool for flushes and another for compactions, so a long compaction can never
+ *          delay a flush queued behind it.
+ * @author Gana Jayant Sigadam
+ * @date March 2025
+ * @version 1.0
+ */
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * @class ThreadPool
+ * @brief Runs scheduled tasks on a fixed number of worker threads, first in first out
+ */
+class ThreadPool {
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks; ///< Tasks waiting for a worker.
+    std::mutex mtx;
+    std::condition_variable cv;
+    bool stopping = false;
+
+    void workerLoop() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                cv.wait(lock, [this] { return stopping || !tasks.empty(); });
+                // Tasks already queued still run during shutdown
+                if (tasks.empty()) {
+                    return;
+                }
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+            task();
+        }
+    }
+
+public:
+    /**
+     * @brief Start the worker threads
+     * @param threads Number of workers, at least one is started
+     */
+    explicit ThreadPool(size_t threads) {
+        if (threads == 0) {
+            threads = 1;
+        }
+        for (size_t i = 0; i < threads; ++i) {
+            workers.emplace_back(&ThreadPool::workerLoop, this);
+        }
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    /**
+     * @brief Queue a task to run on a worker
+     * @param task The task
+     * @return bool False if the pool is shutting down and the task was dropped
+     */
+    bool schedule(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (stopping) {
+                return false;
+            }
+            tasks.push_back(std::move(task));
+        }
+        cv.notify_one();
+        return true;
+    }
+
+    /**
+     * @brief Queue a task whose result the caller waits for
+     * @details The task runs on the calling thread instead if the pool is shutting down, so the
+     *          returned future is always satisfied. An exception thrown by the task is stored in it.
+     * @param task The task
+     * @return std::future The task's result
+     */
+    template <typename Task>
+    auto submit(Task task) -> std::future<decltype(task())> {
+        auto packaged = std::make_shared<std::packaged_task<decltype(task())()>>(std::move(task));
+        std::future<decltype(task())> result = packaged->get_future();
+        if (!schedule([packaged] { (*packaged)(); })) {
+            (*packaged)();
+        }
+        return result;
+    }
+
+    /**
+     * @brief Get the number of worker threads
+     */
+    size_t size() const {
+        return workers.size();
+    }
+
+    /**
+     * @brief Run every queued task, then stop and join the workers
+     */
+    void shutdown() {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stopping = true;
+        }
+        cv.notify_all();
+        for (std::thread &worker : workers) {
+            if (worker.joinable()) {
+                worker.join();
+            }
+        }
+    }
+
+    ~ThreadPool() {
+        shutdown();
+    }
+};
+
+#endif
@@ -0,0 +1,495 @@
+/**
+ * @file wal.hpp
+ * @brief Write-ahead log
+ * @details This file contains the write-ahead log that makes acknowledged writes survive a crash.
+ *          Every put, remove, range deletion and write batch is appended to the log of the active MemTable before it is applied;
+ *          when the MemTable rotates the log rotates with it, and the old log file is deleted once
+ *          the MemTable's SSTable is durably on disk. Records pending from concurrent writers (or a
+ *          whole pipelined batch from the server) are committed together with one write and one
+ *          fdatasync.
+ * @author Gana Jayant Sigadam
+ * @date March 2025
+ * @version 1.0
+ */
+#ifndef WAL_HPP
+#define WAL_HPP
+
+#include "coding.hpp"
+#include "constants.hpp"
+#include "write_batch.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * @class WriteAheadLog
+ * @brief Append-only log with group commit
+ * @details Record format: [CRC32 (4 bytes)] [Key Size (4 bytes)] [Value Size (4 bytes)] [Key] [Value].
+ *          The checksum covers the sizes, key and value; replay stops at the first record that is
+ *          truncated or fails its checksum, which is where a crash interrupted the last write.
+ *          A write batch is one record with BATCH_RECORD as its key size and the encoded batch as
+ *          its value, so it shares the checksum and is replayed whole or not at all. A range deletion
+ *          is one record with RANGE_DELETION_RECORD as its key size and the length-prefixed start and
+ *          end keys as its value.
+ *
+ *          append() only encodes into an in-memory buffer and hands back a sequence number.
+ *          commit(seq) makes every record up to seq durable: the first committer becomes the
+ *          leader and writes the whole buffer, including records appended by other threads while
+ *          it waited, and the others just wait for it. How "durable" is defined depends on the
+ *          WalSyncMode: fdatasync on every commit, fdatasync from a background thread every
+ *          WAL_SYNC_INTERVAL_MS, or just write() and leave it to the OS.
+ *
+ *          A failed write or fdatasync leaves the file in an unknown state: part of the batch may
+ *          be on disk, and a torn record would stop replay before anything written after it. The
+ *          log therefore fails for good: commit() returns false for every record not already
+ *          durable, and hasFailed() tells the tree to stop accepting writes.
+ *
+ *          A tap set with setTap() receives every encoded record as it is appended, in log order,
+ *          which is how replication streams the log to replicas.
+ */
+class WriteAheadLog {
+private:
+    std::string directory;             ///< Directory holding the log files.
+    uint64_t file_number;              ///< Number of the current log file.
+    std::string filename;              ///< Path of the current log file.
+    int fd;                            ///< Descriptor of the current log file.
+    WalSyncMode sync_mode;             ///< When committed records are fdatasync'ed.
+    std::chrono::milliseconds sync_interval; ///< Interval for WalSyncMode::PERIODIC.
+
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::string buffer;         ///< Encoded records not yet handed to write().
+    uint64_t last_sequence;     ///< Sequence number of the last appended record.
+    uint64_t durable_sequence;  ///< Every record up to this one is committed.
+    bool io_in_progress;        ///< A leader (or the sync thread) is writing or syncing.
+    bool stopping;
+    std::atomic<bool> failed;   ///< A write or sync failed; no record past durable_sequence can be committed.
+    std::thread sync_thread;
+    std::function<void(std::string_view)> tap; ///< Receives each encoded record, empty if none.
+
+    static std::string logFilename(const std::string &directory, uint64_t number) {
+        return directory + WAL_PREFIX + std::to_string(number) + WAL_EXTENSION;
+    }
+
+    /**
+     * @brief Key size that marks a record holding a whole WriteBatch.
+     */
+    static constexpr uint32_t BATCH_RECORD = UINT32_MAX;
+
+    /**
+     * @brief Key size that marks a record holding a range deletion.
+     */
+    static constexpr uint32_t RANGE_DELETION_RECORD = UINT32_MAX - 1;
+
+    /**
+     * @brief Encodes a record and adds it to the buffer.
+     * @param key_size The key size field: the key's size, BATCH_RECORD or RANGE_DELETION_RECORD.
+     * @return uint64_t The record's sequence number.
+     */
+    uint64_t appendRecord(uint32_t key_size, std::string_view key, std::string_view value) {
+        char header[3 * sizeof(uint32_t)];
+        uint32_t value_size = static_cast<uint32_t>(value.size());
+        std::memcpy(header + sizeof(uint32_t), &key_size, sizeof(key_size));
+        std::memcpy(header + 2 * sizeof(uint32_t), &value_size, sizeof(value_size));
+        uint32_t crc = Coding::crc32(header + sizeof(uint32_t), 2 * sizeof(uint32_t));
+        crc = Coding::crc32(key.data(), key.size(), crc);
+        crc = Coding::crc32(value.data(), value.size(), crc);
+        std::memcpy(header, &crc, sizeof(crc));
+
+        std::lock_guard<std::mutex> lock(mtx);
+        size_t start = buffer.size();
+        buffer.append(header, sizeof(header));
+        buffer.append(key.data(), key.size());
+        buffer.append(value.data(), value.size());
+        if (tap) {
+            tap(std::string_view(buffer).substr(start));
+        }
+        return ++last_sequence;
+    }
+
+    static int openLog(const std::string &path) {
+        return open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    }
+
+    /**
+     * @brief Write a whole buffer to the log file.
+     * @return bool True if every byte was written.
+     */
+    static bool writeAll(int fd, const std::string &data) {
+        const char *ptr = data.data();
+        size_t left = data.size();
+        while (left > 0) {
+            ssize_t n = write(fd, ptr, left);
+            if (n == -1 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                return false;
+            }
+            ptr += n;
+            left -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Marks the log as failed. Must be called with mtx held.
+     */
+    void fail(const char *action) {
+        std::cerr << "Failed to " << action << " write-ahead log " << filename << ": " << strerror(errno)
+                  << "; writes are refused from now on" << std::endl;
+        failed = true;
+        cv.notify_all();
+    }
+
+    /**
+     * @brief Background loop for WalSyncMode::PERIODIC.
+     */
+    void syncLoop() {
+        std::unique_lock<std::mutex> lock(mtx);
+        while (!stopping) {
+            cv.wait_for(lock, sync_interval, [this] { return stopping; });
+            if (stopping) {
+                break;
+            }
+            cv.wait(lock, [this] { return !io_in_progress; });
+            io_in_progress = true;
+            int sync_fd = fd;
+            lock.unlock();
+            bool ok = fdatasync(sync_fd) == 0;
+            lock.lock();
+            io_in_progress = false;
+            if (!ok && !failed) {
+                fail("sync");
+            }
+            cv.notify_all();
+        }
+    }
+
+public:
+    /**
+     * @brief Opens a new, empty log file in a directory.
+     * @param directory Directory for the log files, ending in '/'.
+     * @param file_number Number of the first log file; must not clash with existing logs.
+     * @param sync_mode When committed records are fdatasync'ed.
+     * @param sync_interval_ms Interval for WalSyncMode::PERIODIC.
+     */
+    WriteAheadLog(const std::string &directory, uint64_t file_number, WalSyncMode sync_mode = WAL_SYNC_MODE,
+                  int sync_interval_ms = WAL_SYNC_INTERVAL_MS)
+        : directory(directory), file_number(file_number), filename(logFilename(directory, file_number)),
+          fd(openLog(filename)), sync_mode(sync_mode), sync_interval(sync_interval_ms),
+          last_sequence(0), durable_sequence(0), io_in_progress(false), stopping(false), failed(false) {
+        if (fd == -1) {
+            throw std::runtime_error("Failed to open write-ahead log " + filename + ": " + strerror(errno));
+        }
+        if (sync_mode == WalSyncMode::PERIODIC) {
+            sync_thread = std::thread(&WriteAheadLog::syncLoop, this);
+        }
+    }
+
+    WriteAheadLog(const WriteAheadLog &) = delete;
+    WriteAheadLog &operator=(const WriteAheadLog &) = delete;
+
+    /**
+     * @brief Buffers a record; it is durable only after commit() returns for its sequence.
+     * @param key The key.
+     * @param value The value, or TOMBSTONE for a remove.
+     * @return uint64_t The record's sequence number.
+     */
+    uint64_t append(std::string_view key, std::string_view value) {
+        return appendRecord(static_cast<uint32_t>(key.size()), key, value);
+    }
+
+    /**
+     * @brief Buffers a write batch as a single record, like append().
+     * @param batch The writes.
+     * @return uint64_t The record's sequence number.
+     */
+    uint64_t appendBatch(const WriteBatch &batch) {
+        return appendRecord(BATCH_RECORD, std::string_view(), batch.encode());
+    }
+
+    /**
+     * @brief Buffers a deletion of every key in [start, end), like append().
+     * @return uint64_t The record's sequence number.
+     */
+    uint64_t appendRangeDeletion(std::string_view start, std::string_view end) {
+        std::string value;
+        Coding::putLengthPrefixed(value, start);
+        Coding::putLengthPrefixed(value, end);
+        return appendRecord(RANGE_DELETION_RECORD, std::string_view(), value);
+    }
+
+    /**
+     * @brief Commits every record up to a sequence number, sharing the I/O with concurrent committers.
+     * @param sequence The sequence number returned by append().
+     * @return bool False if the log could not be written, or failed earlier.
+     */
+    bool commit(uint64_t sequence) {
+        std::unique_lock<std::mutex> lock(mtx);
+        while (durable_sequence < sequence) {
+            if (failed) {
+                return false;
+            }
+            if (io_in_progress) {
+                cv.wait(lock);
+                continue;
+            }
+
+            io_in_progress = true;
+            std::string batch;
+            batch.swap(buffer);
+            uint64_t batch_sequence = last_sequence;
+            lock.unlock();
+
+            bool written = writeAll(fd, batch);
+            bool ok = written && (sync_mode != WalSyncMode::ALWAYS || fdatasync(fd) == 0);
+
+            lock.lock();
+            io_in_progress = false;
+            cv.notify_all();
+            if (!ok) {
+                fail(written ? "sync" : "write");
+                return false;
+            }
+            durable_sequence = batch_sequence;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Commits every record appended so far.
+     * @return bool False if the log could not be written, or failed earlier.
+     */
+    bool commitAll() {
+        uint64_t sequence;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            sequence = last_sequence;
+        }
+        return commit(sequence);
+    }
+
+    /**
+     * @brief Finishes the current log file and starts a new one.
+     * @details Called when the MemTable rotates. Everything appended so far is written and
+     *          synced to the old file, which then belongs to the rotated MemTable. If that fails, or
+     *          the new file cannot be opened, the log fails: the records are still in the rotated
+     *          MemTable, and reach disk if it is flushed, but none of them is acknowledged.
+     * @return std::string Path of the finished log file.
+     */
+    std::string rotate() {
+        std::unique_lock<std::mutex> lock(mtx);
+        cv.wait(lock, [this] { return !io_in_progress; });
+
+        std::string old_filename = filename;
+        if (!failed) {
+            if (!writeAll(fd, buffer)) {
+                fail("write");
+            } else if (sync_mode != WalSyncMode::NONE && fdatasync(fd) != 0) {
+                fail("sync");
+            } else {
+                durable_sequence = last_sequence;
+            }
+        }
+        buffer.clear();
+        if (fd != -1) {
+            close(fd);
+        }
+
+        file_number++;
+        filename = logFilename(directory, file_number);
+        fd = openLog(filename);
+        if (fd == -1 && !failed) {
+            fail("open");
+        }
+        cv.notify_all();
+        return old_filename;
+    }
+
+    /**
+     * @brief Checks whether a write or sync of the log has failed, after which writes must be refused.
+     */
+    bool hasFailed() const {
+        return failed.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Sets the function that receives every record appended from now on.
+     * @details The tap runs under the log's lock, in append order, so it must be quick and must not
+     *          call back into the log.
+     * @param record_tap Called with each encoded record, as decode() reads them; empty to remove the tap.
+     */
+    void setTap(std::function<void(std::string_view)> record_tap) {
+        std::lock_guard<std::mutex> lock(mtx);
+        tap = std::move(record_tap);
+    }
+
+    /**
+     * @brief Gets the path of the log file currently being appended to.
+     */
+    std::string getFilename() {
+        std::lock_guard<std::mutex> lock(mtx);
+        return filename;
+    }
+
+    /**
+     * @brief Parses the number out of a log file name or path.
+     * @param path Path or name of a file.
+     * @param number Set to the log file number.
+     * @return bool False if the file is not named like a log file.
+     */
+    static bool parseLogNumber(const std::string &path, uint64_t &number) {
+        std::string name = std::filesystem::path(path).filename().string();
+        if (name.size() <= WAL_PREFIX.size() + WAL_EXTENSION.size() ||
+            name.compare(0, WAL_PREFIX.size(), WAL_PREFIX) != 0 ||
+            name.compare(name.size() - WAL_EXTENSION.size(), WAL_EXTENSION.size(), WAL_EXTENSION) != 0) {
+            return false;
+        }
+        std::string digits = name.substr(WAL_PREFIX.size(), name.size() - WAL_PREFIX.size() - WAL_EXTENSION.size());
+        if (digits.find_first_not_of("0123456789") != std::string::npos) {
+            return false;
+        }
+        number = std::stoull(digits);
+        return true;
+    }
+
+    /**
+     * @brief Lists the log files in a directory, oldest first.
+     * @param directory Directory to scan.
+     * @param max_number Set to the highest log file number found, or left unchanged if none.
+     * @return std::vector<std::string> Paths of the log files in replay order.
+     */
+    static std::vector<std::string> listLogs(const std::string &directory, uint64_t &max_number) {
+        std::vector<std::pair<uint64_t, std::string>> logs;
+        for (const std::filesystem::directory_entry &entry : std::filesystem::directory_iterator(directory)) {
+            uint64_t number;
+            if (parseLogNumber(entry.path().string(), number)) {
+                logs.push_back({number, entry.path().string()});
+            }
+        }
+        std::sort(logs.begin(), logs.end());
+
+        std::vector<std::string> paths;
+        for (const std::pair<uint64_t, std::string> &log : logs) {
+            max_number = std::max(max_number, log.first);
+            paths.push_back(log.second);
+        }
+        return paths;
+    }
+
+    /**
+     * @brief Decodes encoded records, calling apply for each intact record in order.
+     * @param contents The records, as written to a log file or passed to a tap.
+     * @param source Name of where the records come from, for error messages.
+     * @param apply Called with the key and value (TOMBSTONE for removes) of every record, and of
+     *              every write in a batch record unless apply_batch is given.
+     * @param apply_range_deletion Called with the start and end of every range deletion record.
+     * @param records Set to the number of records decoded.
+     * @param apply_batch If given, called instead of apply with every batch record, as encoded by
+     *                    WriteBatch::encode(); it returns false if the batch is malformed.
+     * @return bool True if every byte of contents was decoded, false if decoding stopped at a torn or
+     *         corrupt record.
+     */
+    static bool decode(std::string_view contents, const std::string &source,
+                       const std::function<void(std::string_view, std::string_view)> &apply,
+                       const std::function<void(std::string_view, std::string_view)> &apply_range_deletion, size_t &records,
+                       const std::function<bool(std::string_view)> &apply_batch = nullptr) {
+        records = 0;
+        size_t pos = 0;
+        const size_t header_size = 3 * sizeof(uint32_t);
+        while (pos + header_size <= contents.size()) {
+            uint32_t crc, key_size, value_size;
+            std::memcpy(&crc, contents.data() + pos, sizeof(crc));
+            std::memcpy(&key_size, contents.data() + pos + sizeof(uint32_t), sizeof(key_size));
+            std::memcpy(&value_size, contents.data() + pos + 2 * sizeof(uint32_t), sizeof(value_size));
+            bool batch = key_size == BATCH_RECORD;
+            bool range_deletion = key_size == RANGE_DELETION_RECORD;
+            size_t stored_key_size = batch || range_deletion ? 0 : key_size;
+            size_t record_size = header_size + stored_key_size + value_size;
+            if (pos + record_size > contents.size() ||
+                Coding::crc32(contents.data() + pos + sizeof(uint32_t), record_size - sizeof(uint32_t)) != crc) {
+                std::cerr << source << " has a torn or corrupt record at offset " << pos << ", ignoring the rest" << std::endl;
+                return false;
+            }
+            std::string_view key(contents.data() + pos + header_size, stored_key_size);
+            std::string_view value(contents.data() + pos + header_size + stored_key_size, value_size);
+            std::string_view start, end;
+            if (range_deletion) {
+                if (!Coding::getLengthPrefixed(value, start) || !Coding::getLengthPrefixed(value, end)) {
+                    std::cerr << source << " has a malformed range deletion at offset " << pos << ", ignoring the rest" << std::endl;
+                    return false;
+                }
+                apply_range_deletion(start, end);
+            } else if (!batch) {
+                apply(key, value);
+            } else if (apply_batch ? !apply_batch(value) : !WriteBatch::forEach(value, apply)) {
+                std::cerr << source << " has a malformed batch at offset " << pos << ", ignoring the rest" << std::endl;
+                return false;
+            }
+            records++;
+            pos += record_size;
+        }
+        return pos == contents.size();
+    }
+
+    /**
+     * @brief Replays a log file, calling apply for each intact record in order.
+     * @details Replay stops at the first torn or corrupt record, where a crash interrupted the last write.
+     * @param path Path of the log file.
+     * @param apply Called with the key and value (TOMBSTONE for removes) of every record, and of
+     *              every write in a batch record.
+     * @param apply_range_deletion Called with the start and end of every range deletion record.
+     * @return size_t Number of records replayed.
+     */
+    static size_t replay(const std::string &path, const std::function<void(std::string_view, std::string_view)> &apply,
+                         const std::function<void(std::string_view, std::string_view)> &apply_range_deletion) {
+        std::ifstream log(path, std::ios::binary);
+        if (!log.is_open()) {
+            std::cerr << "Failed to open write-ahead log " << path << std::endl;
+            return 0;
+        }
+        std::string contents((std::istreambuf_iterator<char>(log)), std::istreambuf_iterator<char>());
+
+        size_t records = 0;
+        decode(contents, "Write-ahead log " + path, apply, apply_range_deletion, records);
+        return records;
+    }
+
+    ~WriteAheadLog() {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stopping = true;
+        }
+        cv.notify_all();
+        if (sync_thread.joinable()) {
+            sync_thread.join();
+        }
+        commitAll();
+        if (fd != -1) {
+            if (sync_mode != WalSyncMode::NONE) {
+                fdatasync(fd);
+            }
+            close(fd);
+        }
+    }
+};
+
+#endif
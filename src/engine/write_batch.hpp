@@ -0,0 +1,152 @@
+/**
+ * @file write_batch.hpp
+ * @brief Batch of writes applied together
+ * @details This file contains the WriteBatch, a list of puts and removes that LSMTree::write()
+ *          applies under one lock acquisition and logs as a single write-ahead log record, so a
+ *          crash replays either all of the batch or none of it.
+ * @author Gana Jayant Sigadam
+ * @date March 2025
+ * @version 1.0
+ */
+#ifndef WRITE_BATCH_HPP
+#define WRITE_BATCH_HPP
+
+#include "coding.hpp"
+#include "constants.hpp"
+#include "expiry.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/**
+ * @class WriteBatch
+ * @brief Puts and removes encoded into one buffer, in the order they were added
+ * @details Encoding: [Count (varint)] then, per write, [Key (length-prefixed)] [Value (length-prefixed)],
+ *          with values encoded for storage (TOMBSTONE for a remove), as in single-record log entries. Later writes
+ *          to a key in the same batch override earlier ones.
+ */
+class WriteBatch {
+private:
+    std::string rep;   ///< Encoded writes, without the count.
+    size_t count = 0;  ///< Number of writes in rep.
+
+public:
+    /**
+     * @brief Add a put of a key-value pair
+     */
+    void put(std::string_view key, std::string_view value) {
+        if (Expiry::needsHeader(value)) {
+            append(key, Expiry::encode(value));
+        } else {
+            append(key, value);
+        }
+    }
+
+    /**
+     * @brief Add a put of a key-value pair that expires
+     * @param expire_at Expiry time in milliseconds since the Unix epoch.
+     */
+    void putWithExpiry(std::string_view key, std::string_view value, uint64_t expire_at) {
+        append(key, Expiry::encode(value, expire_at));
+    }
+
+    /**
+     * @brief Add a remove of a key
+     */
+    void remove(std::string_view key) {
+        append(key, TOMBSTONE);
+    }
+
+    /**
+     * @brief Add a write of a value already encoded for storage, as forEach() passes it
+     */
+    void append(std::string_view key, std::string_view stored) {
+        Coding::putLengthPrefixed(rep, key);
+        Coding::putLengthPrefixed(rep, stored);
+        count++;
+    }
+
+    void clear() {
+        rep.clear();
+        count = 0;
+    }
+
+    /**
+     * @brief Get the number of writes in the batch
+     */
+    size_t size() const {
+        return count;
+    }
+
+    bool empty() const {
+        return count == 0;
+    }
+
+    /**
+     * @brief Get the bytes of keys and values in the batch, with their length prefixes
+     */
+    size_t byteSize() const {
+        return rep.size();
+    }
+
+    /**
+     * @brief Encode the batch as it is stored in the write-ahead log
+     * @return std::string The count followed by the writes
+     */
+    std::string encode() const {
+        std::string encoded;
+        encoded.reserve(rep.size() + 10);
+        Coding::putVarint64(encoded, count);
+        encoded.append(rep);
+        return encoded;
+    }
+
+    /**
+     * @brief Call apply for each write of the batch, in order
+     * @param apply Called with the key and value (TOMBSTONE for removes) of every write.
+     */
+    template <typename Apply>
+    void forEach(Apply &&apply) const {
+        std::string_view input(rep);
+        for (size_t i = 0; i < count; ++i) {
+            std::string_view key, value;
+            Coding::getLengthPrefixed(input, key);
+            Coding::getLengthPrefixed(input, value);
+            apply(key, value);
+        }
+    }
+
+    /**
+     * @brief Call apply for each write of an encoded batch, in order
+     * @param encoded A batch as returned by encode().
+     * @param apply Called with the key and value (TOMBSTONE for removes) of every write.
+     * @return bool False if the encoding is damaged; no write is applied then.
+     */
+    template <typename Apply>
+    static bool forEach(std::string_view encoded, Apply &&apply) {
+        uint64_t count;
+        std::string_view input = encoded;
+        if (!Coding::getVarint64(input, count)) {
+            return false;
+        }
+        // Validate the whole batch first, so a damaged one is not applied in part
+        std::string_view check = input;
+        for (uint64_t i = 0; i < count; ++i) {
+            std::string_view key, value;
+            if (!Coding::getLengthPrefixed(check, key) || !Coding::getLengthPrefixed(check, value)) {
+                return false;
+            }
+        }
+        for (uint64_t i = 0; i < count; ++i) {
+            std::string_view key, value;
+            Coding::getLengthPrefixed(input, key);
+            Coding::getLengthPrefixed(input, value);
+            apply(key, value);
+        }
+        return true;
+    }
+};
+
+#endif
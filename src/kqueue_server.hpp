@@ -1,10 +1,12 @@
 /**
  * @file kqueue_server.hpp
  * @brief KqueueServer Class
- * @details This class implements a Kqueue-based server that handles client connections
- *          and processes RESP commands. It uses the LSMTree engine for data storage
- *          and retrieval. The server listens for incoming connections, decodes RESP commands,
- *          and sends responses back to the clients.
+ * @details This class implements an event-driven server that handles client connections
+ *          and processes RESP commands. It was written against kqueue and keeps that name;
+ *          the I/O primitives now come from a pluggable EventLoop (kqueue, epoll or io_uring).
+ *          It uses the sharded LSMTree engine for data storage and retrieval. The server
+ *          listens for incoming connections, decodes RESP commands, and sends responses back
+ *          to the clients.
  * @author Gana Jayant Sigadam
  * @date 2025-03-28
  * @version 1.0
@@ -13,43 +15,158 @@
 #define KQUEUE_SERVER_HPP
 #include "./resp/resp_decoder.hpp"
 #include "./resp/resp_encoder.hpp"
-#include "engine/lsm.hpp"
+#include "engine/metrics.hpp"
+#include "engine/sharded_lsm.hpp"
+#include "engine/thread_pool.hpp"
+#include "net/event_loop_factory.hpp"
+#include "net/metrics_endpoint.hpp"
+#include "replication.hpp"
 
+#include <algorithm>
 #include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
 #include <fcntl.h>
 #include <iostream>
-#include <sys/event.h>
+#include <cctype>
+#include <climits>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <unordered_map>
+#include <vector>
+#include <sys/uio.h>
 #include <unistd.h>
 
 /**
  * @brief Client Data
  *  @details This struct holds the data for each client connection,
- *          including the buffer for incoming data and the total number of bytes received.
+ *          including the buffer for incoming data and the number of bytes in it that
+ *          have not been decoded yet (a partial command waiting for the rest of its bytes).
+ *          Encoded replies are moved into the output queue and written with `writev`
+ *          once per event-loop iteration; `output_offset` tracks a partially written front reply.
+ *          While a GET is being read on the read pool, its reply and every reply after it wait in
+ *          `waiting`, in command order, and move to the output queue once everything before them
+ *          is ready; `waiting.front()` has id `first_waiting_id`.
  */
 struct ClientData {
     std::vector<char> buffer;
     size_t total_bytes = 0;
+    std::deque<std::string> output;
+    size_t output_offset = 0;
+    bool write_registered = false;
+    bool flush_pending = false;
+    uint64_t connection_id = 0;
+    std::deque<std::pair<bool, std::string>> waiting;
+    uint64_t first_waiting_id = 0;
+    size_t reads_in_flight = 0;
+};
+
+/**
+ * @brief Read Completion
+ * @details The reply to a GET answered on the read pool, on its way back to the reactor that owns
+ *          the connection. The connection id tells a reply for a closed connection apart from one
+ *          for a new connection that reuses its descriptor.
+ */
+struct ReadCompletion {
+    int client_fd;
+    uint64_t connection_id;
+    uint64_t reply_id;
+    std::string reply;
+    std::chrono::steady_clock::time_point start;
+};
+
+/**
+ * @brief Unlogged Reply
+ * @details The reply to a write, queued before the write-ahead log commit that covers it. If the
+ *          commit fails, the reply at that position of the client's output queue becomes an error.
+ */
+struct UnloggedReply {
+    int client_fd;
+    uint64_t connection_id;
+    size_t index; ///< Position in the client's output queue, stable until the queue is next written.
+};
+
+/**
+ * @brief Reactor
+ * @details This struct holds the state owned by one event-loop thread: its EventLoop, the
+ *          clients it serves and the clients waiting for a flush. Reactor 0 also owns the
+ *          listening socket and hands accepted connections out round-robin through each
+ *          reactor's handoff pipe, so a connection is served by exactly one thread. Read pool
+ *          threads queue finished GETs in `completions` and wake the reactor through its
+ *          completion pipe; only they touch the queue from another thread.
+ */
+struct Reactor {
+    std::unique_ptr<EventLoop> loop;
+    int handoff_read = -1;
+    int handoff_write = -1;
+    int completion_read = -1;
+    int completion_write = -1;
+    std::vector<IoEvent> events;
+    std::unordered_map<int, ClientData> client_buffers;
+    std::vector<int> pending_flushes;
+    bool wal_pending = false;
+    std::vector<UnloggedReply> unlogged_replies; ///< Write replies waiting for the next commit.
+    uint64_t next_connection_id = 0;
+    std::mutex completion_mtx;
+    std::vector<ReadCompletion> completions;
 };
 
 /**
  * @class KqueueServer
- * @brief Kqueue-based server class
- * @details This class implements a Kqueue-based server that handles client connections
+ * @brief Event-driven server class
+ * @details This class implements an event-driven server that handles client connections
  *          and processes RESP commands. It uses the LSMTree engine for data storage
  *          and retrieval. The server listens for incoming connections, decodes RESP commands,
- *          and sends responses back to the clients.
+ *          and sends responses back to the clients. It can run several reactors, each an
+ *          event-loop thread with its own EventLoop, all sharing one ShardedLSMTree, so writes
+ *          from different reactors only contend when their keys hash to the same shard.
+ *          A GET the MemTables cannot answer would wait for disk on the event-loop thread, stalling
+ *          every connection of the reactor; with a read pool it is handed to a pool thread instead,
+ *          and the reply is posted back to the reactor and sent in command order.
+ *          Every command is timed into a per-thread latency histogram, reported with the engine's
+ *          metrics by `INFO` and, when a metrics port is given, by a Prometheus endpoint.
+ *          A server is either a primary, which hands connections sending `REPLICATE` to its
+ *          ReplicationPrimary, or a read-only replica of another server, followed by a ReplicationClient.
  */
 class KqueueServer {
 private:
     static constexpr size_t INITIAL_BUFFER_SIZE = 4 * 1024;
-    static constexpr size_t INITIAL_EVENT_LIST_SIZE = 512;
+    static constexpr size_t DEFAULT_READ_THREADS = 4;
+    static constexpr const char *WRITE_FAILED = "IOERR the write-ahead log failed, the write may be lost";
     const size_t CHUNK_SIZE = 4096;
 
     int server_socket;
-    int kq;
-    std::vector<struct kevent> event_list;
-    std::unordered_map<int, ClientData> client_buffers;
-    LSMTree lsm;
+    std::vector<std::unique_ptr<Reactor>> reactors;
+    size_t next_reactor = 0;
+    ShardedLSMTree lsm;
+    std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+    std::atomic<size_t> connected_clients{0};
+    std::unique_ptr<MetricsEndpoint> metrics_endpoint;
+    std::unique_ptr<ThreadPool> read_pool; ///< Threads answering GETs that read SSTables, null to read on the reactors.
+    std::unique_ptr<ReplicationPrimary> replication; ///< Feeds replicas; null on a replica.
+    std::unique_ptr<ReplicationClient> replica_client; ///< Follows the primary; null on a primary.
+
+    /**
+     * @brief Name of each command in the metrics, indexed by Operation
+     */
+    static constexpr const char *COMMAND_NAMES[] = {"set", "get", "del", "scan", "mget", "mset", "expire",
+                                                    "ttl", "delrange", "delprefix", "info", "replicate"};
+    static_assert(sizeof(COMMAND_NAMES) / sizeof(COMMAND_NAMES[0]) == UNKNOWN, "every operation needs a metrics name");
+    static_assert(UNKNOWN <= Metrics::COMMAND_SLOTS, "every operation needs a metrics slot");
+
+    /**
+     * @brief Name of each engine timer in the metrics, indexed by Timer
+     */
+    static constexpr const char *TIMER_NAMES[] = {"get", "put", "flush", "compaction"};
+    static_assert(sizeof(TIMER_NAMES) / sizeof(TIMER_NAMES[0]) == static_cast<size_t>(Timer::COUNT),
+                  "every timer needs a metrics name");
 
     /**
      * @brief Create a Server Socket object
@@ -100,40 +217,126 @@ private:
     }
 
     /**
-     * @brief Create a Kqueue object
-     * @return int File descriptor for the kqueue
+     * @brief Create a Reactor object
+     * @param backend EventLoop backend name (empty for the platform default)
+     * @return std::unique_ptr<Reactor> The reactor, or nullptr on failure
+     * @details Creates the reactor's EventLoop, its handoff pipe and its completion pipe, and
+     *          watches the read ends for connections passed over by the accepting reactor and for
+     *          GETs finished on the read pool. Both ends of the completion pipe are non-blocking, so
+     *          a pool thread never waits for the reactor.
      */
-    int createKqueue() {
-        int kq = kqueue();
-        if (kq == -1) {
-            std::cerr << "Failed to create kqueue" << std::endl;
-            return -1;
+    std::unique_ptr<Reactor> createReactor(const std::string &backend) {
+        std::unique_ptr<Reactor> reactor = std::make_unique<Reactor>();
+        try {
+            reactor->loop = createEventLoop(backend);
+        } catch (const std::exception &e) {
+            std::cerr << "Failed to create event loop: " << e.what() << std::endl;
+            return nullptr;
+        }
+
+        int fds[2];
+        if (pipe(fds) == -1) {
+            std::cerr << "Failed to create handoff pipe" << std::endl;
+            return nullptr;
+        }
+        reactor->handoff_read = fds[0];
+        reactor->handoff_write = fds[1];
+
+        if (fcntl(reactor->handoff_read, F_SETFL, O_NONBLOCK) < 0 ||
+            !reactor->loop->addReadable(reactor->handoff_read)) {
+            destroyReactor(*reactor);
+            return nullptr;
+        }
+
+        if (pipe(fds) == -1) {
+            std::cerr << "Failed to create completion pipe" << std::endl;
+            destroyReactor(*reactor);
+            return nullptr;
+        }
+        reactor->completion_read = fds[0];
+        reactor->completion_write = fds[1];
+
+        if (fcntl(reactor->completion_read, F_SETFL, O_NONBLOCK) < 0 ||
+            fcntl(reactor->completion_write, F_SETFL, O_NONBLOCK) < 0 ||
+            !reactor->loop->addReadable(reactor->completion_read)) {
+            destroyReactor(*reactor);
+            return nullptr;
         }
-        return kq;
+        return reactor;
     }
 
     /**
-     * @brief Add a file descriptor to the kqueue
-     * @param fd File descriptor to add
-     * @param filter Event filter (e.g., EVFILT_READ)
-     * @param flags Event flags (e.g., EV_ADD)
-     * @return bool True if successful, false otherwise
+     * @brief Close every descriptor owned by a reactor
+     * @param reactor The reactor to tear down
      */
-    bool addToKqueue(int fd, int filter, int flags) {
-        struct kevent change_event;
-        EV_SET(&change_event, fd, filter, flags, 0, 0, NULL);
-        if (kevent(kq, &change_event, 1, NULL, 0, NULL) == -1) {
-            std::cerr << "Failed to add to kqueue for fd " << fd << std::endl;
-            return false;
+    void destroyReactor(Reactor &reactor) {
+        for (const auto &client : reactor.client_buffers) {
+            close(client.first);
+        }
+        reactor.client_buffers.clear();
+        if (reactor.handoff_read != -1) {
+            close(reactor.handoff_read);
+        }
+        if (reactor.handoff_write != -1) {
+            close(reactor.handoff_write);
+        }
+        if (reactor.completion_read != -1) {
+            close(reactor.completion_read);
+        }
+        if (reactor.completion_write != -1) {
+            close(reactor.completion_write);
+        }
+        reactor.loop.reset();
+    }
+
+    /**
+     * @brief Start serving a client socket on a reactor
+     * @param reactor The reactor that will own the connection
+     * @param client_socket The accepted, non-blocking client socket
+     */
+    void registerClient(Reactor &reactor, int client_socket) {
+        if (reactor.loop->addClient(client_socket)) {
+            reactor.client_buffers[client_socket] = ClientData();
+            reactor.client_buffers[client_socket].buffer.reserve(INITIAL_BUFFER_SIZE);
+            reactor.client_buffers[client_socket].connection_id = reactor.next_connection_id++;
+            connected_clients.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            close(client_socket);
+        }
+    }
+
+    /**
+     * @brief Assign an accepted client socket to a reactor
+     * @param reactor The accepting reactor
+     * @param client_socket The accepted client socket
+     * @details Connections are assigned to the reactors round-robin. Connections for the
+     *          accepting reactor are registered directly; the others are written to the owning
+     *          reactor's handoff pipe.
+     */
+    void dispatchClient(Reactor &reactor, int client_socket) {
+        if (fcntl(client_socket, F_SETFL, O_NONBLOCK) < 0) {
+            std::cerr << "Failed to set non-blocking on client socket" << std::endl;
+            close(client_socket);
+            return;
+        }
+
+        Reactor &owner = *reactors[next_reactor];
+        next_reactor = (next_reactor + 1) % reactors.size();
+        if (&owner == &reactor) {
+            registerClient(reactor, client_socket);
+        } else if (write(owner.handoff_write, &client_socket, sizeof(client_socket)) != sizeof(client_socket)) {
+            std::cerr << "Failed to hand off client socket " << client_socket << std::endl;
+            close(client_socket);
         }
-        return true;
     }
 
     /**
      * @brief Handle new client connections
-     * @details This function accepts new client connections and adds them to the kqueue for monitoring.
+     * @param reactor The accepting reactor
+     * @details This function accepts every pending connection on a readiness-based backend and
+     *          dispatches it to a reactor.
      */
-    void handleNewConnection() {
+    void handleNewConnection(Reactor &reactor) {
         sockaddr_in client_addr;
         socklen_t client_len = sizeof(client_addr);
 
@@ -147,65 +350,715 @@ private:
                     break;
                 }
             }
+            dispatchClient(reactor, client_socket);
+        }
+    }
+
+    /**
+     * @brief Register the connections handed over by the accepting reactor
+     * @param reactor The reactor whose handoff pipe is readable
+     */
+    void handleHandoff(Reactor &reactor) {
+        int client_socket;
+        while (read(reactor.handoff_read, &client_socket, sizeof(client_socket)) == sizeof(client_socket)) {
+            registerClient(reactor, client_socket);
+        }
+    }
+
+    /**
+     * @brief Queue a reply on the client's output buffer
+     * @param reactor The reactor serving the client
+     * @param client_fd The file descriptor of the client socket
+     * @param client_data The client's connection state
+     * @param reply The encoded reply, moved into the output queue
+     * @details The client is scheduled for a flush at the end of the current event-loop iteration,
+     *          so all replies produced for one read are coalesced into a single `writev`. A reply
+     *          queued behind a GET still on the read pool waits for it.
+     */
+    void queueReply(Reactor &reactor, int client_fd, ClientData &client_data, std::string &&reply) {
+        if (!client_data.waiting.empty()) {
+            client_data.waiting.emplace_back(true, std::move(reply));
+            return;
+        }
+        client_data.output.push_back(std::move(reply));
+        scheduleFlush(reactor, client_fd, client_data);
+    }
+
+    /**
+     * @brief Queue the reply to a write made without committing the write-ahead log
+     * @param reactor The reactor serving the client
+     * @param client_fd The file descriptor of the client socket
+     * @param client_data The client's connection state
+     * @param applied What the write returned; false if the engine refused it
+     * @param reply The reply to send once the write is committed
+     * @details The reply is held to the commit made before the next flush, and becomes an error if
+     *          that commit fails. Writes are only handled with no GET in flight, so the reply goes
+     *          straight to the output queue; should it have to wait, the write is committed at once.
+     */
+    void queueWriteReply(Reactor &reactor, int client_fd, ClientData &client_data, bool applied, std::string &&reply) {
+        if (!applied) {
+            queueReply(reactor, client_fd, client_data, RespEncoder::error(WRITE_FAILED));
+            return;
+        }
+        if (!client_data.waiting.empty()) {
+            queueReply(reactor, client_fd, client_data, lsm.sync() ? std::move(reply) : RespEncoder::error(WRITE_FAILED));
+            return;
+        }
+        reactor.wal_pending = true;
+        reactor.unlogged_replies.push_back({client_fd, client_data.connection_id, client_data.output.size()});
+        queueReply(reactor, client_fd, client_data, std::move(reply));
+    }
+
+    /**
+     * @brief Commit the writes handled since the last commit, in one write-ahead log commit
+     * @param reactor The reactor whose writes are committed
+     * @details If the commit fails, the replies to those writes still queued are replaced with errors.
+     */
+    void commitWrites(Reactor &reactor) {
+        if (!reactor.wal_pending) {
+            return;
+        }
+        reactor.wal_pending = false;
+        if (!lsm.sync()) {
+            for (const UnloggedReply &unlogged : reactor.unlogged_replies) {
+                auto it = reactor.client_buffers.find(unlogged.client_fd);
+                if (it != reactor.client_buffers.end() && it->second.connection_id == unlogged.connection_id &&
+                    unlogged.index < it->second.output.size()) {
+                    it->second.output[unlogged.index] = RespEncoder::error(WRITE_FAILED);
+                }
+            }
+        }
+        reactor.unlogged_replies.clear();
+    }
 
-            if (fcntl(client_socket, F_SETFL, O_NONBLOCK) < 0) {
-                std::cerr << "Failed to set non-blocking on client socket" << std::endl;
-                close(client_socket);
+    /**
+     * @brief Schedule a client for a flush at the end of the current event-loop iteration
+     */
+    void scheduleFlush(Reactor &reactor, int client_fd, ClientData &client_data) {
+        if (!client_data.flush_pending) {
+            client_data.flush_pending = true;
+            reactor.pending_flushes.push_back(client_fd);
+        }
+    }
+
+    /**
+     * @brief Hand a GET to the read pool
+     * @param reactor The reactor serving the client
+     * @param client_fd The file descriptor of the client socket
+     * @param client_data The client's connection state
+     * @param key The key to read
+     * @param start When the command started, for its latency
+     * @return bool False if the pool is shutting down and the GET must be answered inline
+     * @details A slot for the reply is reserved in the client's waiting queue, and the pool thread
+     *          posts the reply to the reactor's completion queue, waking the reactor only when the
+     *          queue was empty.
+     */
+    bool readAsync(Reactor &reactor, int client_fd, ClientData &client_data, std::string_view key,
+                   std::chrono::steady_clock::time_point start) {
+        uint64_t reply_id = client_data.first_waiting_id + client_data.waiting.size();
+        uint64_t connection_id = client_data.connection_id;
+        Reactor *owner = &reactor;
+        bool scheduled = read_pool->schedule([this, owner, client_fd, connection_id, reply_id, key = std::string(key), start] {
+            ReadCompletion completion{client_fd, connection_id, reply_id, std::string(), start};
+            try {
+                std::pair<bool, std::string> result = lsm.get(key);
+                completion.reply = RespEncoder::bulkString(result.second, !result.first);
+            } catch (const std::exception &e) {
+                std::cerr << "Exception in GET: " << e.what() << std::endl;
+                completion.reply = RespEncoder::error("Internal server error");
+            }
+            bool wake;
+            {
+                std::lock_guard<std::mutex> lock(owner->completion_mtx);
+                wake = owner->completions.empty();
+                owner->completions.push_back(std::move(completion));
+            }
+            // A full pipe already holds a wake-up, so a failed write loses nothing
+            char byte = 0;
+            if (wake && write(owner->completion_write, &byte, 1) < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+                std::cerr << "Failed to wake reactor: " << strerror(errno) << std::endl;
+            }
+        });
+        if (!scheduled) {
+            return false;
+        }
+        client_data.waiting.emplace_back(false, std::string());
+        client_data.reads_in_flight++;
+        return true;
+    }
+
+    /**
+     * @brief Deliver the GETs the read pool finished for a reactor's clients
+     * @param reactor The reactor whose completion pipe is readable
+     * @details Each reply fills its slot in the waiting queue, and the ready replies at the front of
+     *          the queue move to the output queue. Once no read is in flight, the commands that
+     *          arrived meanwhile are processed.
+     */
+    void handleCompletions(Reactor &reactor) {
+        char drain[64];
+        while (read(reactor.completion_read, drain, sizeof(drain)) > 0) {
+        }
+        std::vector<ReadCompletion> completions;
+        {
+            std::lock_guard<std::mutex> lock(reactor.completion_mtx);
+            completions.swap(reactor.completions);
+        }
+
+        for (ReadCompletion &completion : completions) {
+            auto it = reactor.client_buffers.find(completion.client_fd);
+            if (it == reactor.client_buffers.end() || it->second.connection_id != completion.connection_id) {
                 continue;
             }
+            ClientData &client_data = it->second;
+            client_data.waiting[completion.reply_id - client_data.first_waiting_id] = {true, std::move(completion.reply)};
+            client_data.reads_in_flight--;
+            Metrics::recordCommand(GET, Metrics::microsSince(completion.start));
 
-            if (addToKqueue(client_socket, EVFILT_READ, EV_ADD)) {
-                client_buffers[client_socket] = ClientData();
-                client_buffers[client_socket].buffer.reserve(INITIAL_BUFFER_SIZE);
-            } else {
-                close(client_socket);
+            while (!client_data.waiting.empty() && client_data.waiting.front().first) {
+                client_data.output.push_back(std::move(client_data.waiting.front().second));
+                client_data.waiting.pop_front();
+                client_data.first_waiting_id++;
+            }
+            scheduleFlush(reactor, completion.client_fd, client_data);
+            if (client_data.reads_in_flight == 0 && client_data.total_bytes > 0) {
+                processInput(reactor, completion.client_fd, client_data);
+            }
+        }
+    }
+
+    /**
+     * @brief Encode a resume key as a SCAN cursor
+     * @param key The first key the next call should examine
+     * @return std::string "1" followed by each byte of the key as three decimal digits
+     * @details The cursor carries the position itself, so the server keeps no per-scan state
+     *          and a cursor stays usable across flushes, compactions and restarts. It is all
+     *          digits and never "0", so clients that parse cursors as integers accept it.
+     */
+    static std::string encodeCursor(std::string_view key) {
+        std::string cursor = "1";
+        cursor.reserve(1 + key.size() * 3);
+        for (unsigned char c : key) {
+            cursor.push_back(static_cast<char>('0' + c / 100));
+            cursor.push_back(static_cast<char>('0' + c / 10 % 10));
+            cursor.push_back(static_cast<char>('0' + c % 10));
+        }
+        return cursor;
+    }
+
+    /**
+     * @brief Decode a SCAN cursor back into the key to resume from
+     * @param cursor The cursor sent by the client, "0" to start a new scan
+     * @param start Set to the resume key, empty for a new scan
+     * @return bool False if the cursor was not produced by encodeCursor()
+     */
+    static bool decodeCursor(std::string_view cursor, std::string &start) {
+        start.clear();
+        if (cursor == "0") {
+            return true;
+        }
+        if (cursor.empty() || cursor[0] != '1' || cursor.size() % 3 != 1) {
+            return false;
+        }
+        for (size_t i = 1; i < cursor.size(); i += 3) {
+            int byte = 0;
+            for (size_t j = i; j < i + 3; ++j) {
+                if (cursor[j] < '0' || cursor[j] > '9') {
+                    return false;
+                }
+                byte = byte * 10 + (cursor[j] - '0');
+            }
+            if (byte > 255) {
+                return false;
             }
+            start.push_back(static_cast<char>(byte));
         }
+        return true;
+    }
+
+    /**
+     * @brief Match a key against a Redis-style glob pattern
+     * @param pattern The pattern: `*` matches any run of bytes, `?` any single byte, `[...]` a
+     *                set or range of bytes (`[^...]` its complement) and `\` escapes the next byte
+     * @param text The key to test
+     * @return bool True if the whole key matches the pattern
+     */
+    static bool globMatch(std::string_view pattern, std::string_view text) {
+        size_t p = 0, t = 0;
+        size_t star = std::string_view::npos, star_text = 0; // Last `*` seen, to backtrack to
+        while (t < text.size()) {
+            if (p < pattern.size() && pattern[p] == '*') {
+                star = p++;
+                star_text = t;
+                continue;
+            }
+            if (p < pattern.size()) {
+                size_t width = 1;
+                bool matched = false;
+                if (pattern[p] == '?') {
+                    matched = true;
+                } else if (pattern[p] == '[') {
+                    size_t q = p + 1;
+                    bool negate = q < pattern.size() && pattern[q] == '^';
+                    if (negate) {
+                        ++q;
+                    }
+                    bool in_set = false;
+                    while (q < pattern.size() && pattern[q] != ']') {
+                        if (pattern[q] == '\\' && q + 1 < pattern.size()) {
+                            ++q;
+                        }
+                        unsigned char low = static_cast<unsigned char>(pattern[q]);
+                        unsigned char high = low;
+                        if (q + 2 < pattern.size() && pattern[q + 1] == '-' && pattern[q + 2] != ']') {
+                            high = static_cast<unsigned char>(pattern[q + 2]);
+                            q += 2;
+                            if (low > high) {
+                                std::swap(low, high);
+                            }
+                        }
+                        unsigned char c = static_cast<unsigned char>(text[t]);
+                        in_set = in_set || (c >= low && c <= high);
+                        ++q;
+                    }
+                    width = (q < pattern.size() ? q + 1 : q) - p;
+                    matched = in_set != negate;
+                } else if (pattern[p] == '\\' && p + 1 < pattern.size()) {
+                    width = 2;
+                    matched = pattern[p + 1] == text[t];
+                } else {
+                    matched = pattern[p] == text[t];
+                }
+                if (matched) {
+                    p += width;
+                    ++t;
+                    continue;
+                }
+            }
+            if (star == std::string_view::npos) {
+                return false;
+            }
+            // Let the last `*` absorb one more byte and retry from there
+            p = star + 1;
+            t = ++star_text;
+        }
+        while (p < pattern.size() && pattern[p] == '*') {
+            ++p;
+        }
+        return p == pattern.size();
+    }
+
+    /**
+     * @brief Run one step of a SCAN over the key space
+     * @param resp The decoded SCAN command: cursor, MATCH pattern and COUNT
+     * @return std::string The encoded reply: the next cursor ("0" once done) and the matching keys
+     * @details Keys are visited in sorted order by a merging iterator over the whole tree, so one
+     *          call examines at most COUNT live keys and the reply size is bounded no matter how
+     *          large the range is; as in Redis, a call may return fewer keys than COUNT, or none,
+     *          before the scan ends. The literal prefix of the pattern (everything before its
+     *          first wildcard) bounds the range: the scan seeks straight to it and ends at the
+     *          first key without it, so `MATCH prefix*` examines only the keys under the prefix.
+     */
+    std::string scan(const Resp &resp) {
+        std::string start;
+        if (!decodeCursor(resp.key, start)) {
+            return RespEncoder::error("invalid cursor");
+        }
+        std::string_view prefix = resp.pattern.substr(0, resp.pattern.find_first_of("*?[\\"));
+        if (start < prefix) {
+            start.assign(prefix);
+        }
+        // `prefix*` matches every key under the prefix, so the pattern need not be tested
+        bool prefix_only = prefix.size() + 1 == resp.pattern.size() && resp.pattern.back() == '*';
+
+        std::vector<std::string> keys;
+        std::string cursor = "0";
+        {
+            ShardedLSMTree::Iterator it = lsm.iterator();
+            it.seek(start);
+            for (size_t examined = 0; it.isValid() && it.key().substr(0, prefix.size()) == prefix; it.next()) {
+                if (examined++ == resp.count) {
+                    cursor = encodeCursor(it.key());
+                    break;
+                }
+                if (prefix_only || globMatch(resp.pattern, it.key())) {
+                    keys.emplace_back(it.key());
+                }
+            }
+        }
+        return RespEncoder::arrayHeader(2) + RespEncoder::bulkString(cursor, false) + RespEncoder::array(keys);
+    }
+
+    /**
+     * @brief Check whether an operation changes data, and so is refused by a replica
+     */
+    static bool isWrite(Operation operation) {
+        return operation == SET || operation == DEL || operation == MSET || operation == EXPIRE || operation == DELRANGE ||
+               operation == DELPREFIX;
+    }
+
+    /**
+     * @brief Hand a connection that sent REPLICATE over to replication
+     * @param reactor The reactor serving the client
+     * @param client_fd The file descriptor of the client socket
+     * @param client_data The client's connection state
+     * @return bool True if the connection left the reactor, whose state for it is gone; false if
+     *         it stays a client and an error was queued
+     * @details Replies still queued are written first. The socket then leaves the event loop without
+     *          being closed, and from then on belongs to the replica's thread.
+     */
+    bool startReplication(Reactor &reactor, int client_fd, ClientData &client_data) {
+        if (replication == nullptr) {
+            queueReply(reactor, client_fd, client_data, RespEncoder::error("REPLICATE is not served by a replica"));
+            return false;
+        }
+        if (!flushOutput(reactor, client_fd, client_data) || !client_data.output.empty()) {
+            queueReply(reactor, client_fd, client_data, RespEncoder::error("REPLICATE must follow every earlier reply"));
+            return false;
+        }
+        reactor.loop->removeClient(client_fd);
+        if (reactor.client_buffers.erase(client_fd) > 0) {
+            connected_clients.fetch_sub(1, std::memory_order_relaxed);
+        }
+        replication->addReplica(client_fd);
+        return true;
     }
 
     /**
      * @brief Handle RESP operations
+     * @param reactor The reactor serving the client
      * @param resp The RESP object containing the operation to perform
      * @param client_fd The file descriptor of the client socket
-     * @details This function processes the RESP command and sends the appropriate response back to the client.
+     * @param client_data The client's connection state
+     * @details This function processes the RESP command and queues the appropriate response
+     *          on the client's output buffer. The time taken is recorded in the command's latency histogram.
      */
-    void handle_op(Resp &resp, int client_fd) {
+    void handle_op(Reactor &reactor, Resp &resp, int client_fd, ClientData &client_data) {
+        auto start = std::chrono::steady_clock::now();
+        if (replica_client != nullptr && isWrite(resp.operation)) {
+            queueReply(reactor, client_fd, client_data, RespEncoder::error("READONLY You can't write against a read only replica"));
+            return;
+        }
         try {
-            std::ostringstream response;
             switch (resp.operation) {
             case GET: {
-                std::pair<bool, std::string> result = lsm.get(resp.key);
-                response << RespEncoder::bulkString(result.second, !result.first);
+                std::pair<bool, std::string> result;
+                bool settled = read_pool != nullptr && lsm.getFromMemory(resp.key, result);
+                if (read_pool != nullptr && !settled && readAsync(reactor, client_fd, client_data, resp.key, start)) {
+                    // Timed when the reply comes back
+                    return;
+                }
+                if (!settled) {
+                    result = lsm.get(resp.key);
+                }
+                queueReply(reactor, client_fd, client_data, RespEncoder::bulkString(result.second, !result.first));
+                break;
+            }
+            case SET: {
+                bool applied;
+                if (resp.ttl_ms > 0) {
+                    applied = lsm.putWithExpiry(resp.key, resp.value, Expiry::nowMillis() + static_cast<uint64_t>(resp.ttl_ms), false);
+                } else {
+                    applied = lsm.put(resp.key, resp.value, false);
+                }
+                queueWriteReply(reactor, client_fd, client_data, applied, RespEncoder::simpleString("OK"));
                 break;
             }
-            case SET:
-                lsm.put(resp.key, resp.value);
-                response << RespEncoder::simpleString("OK");
+            case EXPIRE: {
+                // A time to live of zero or less expires the key at once; 1 is the earliest expiry time
+                uint64_t expire_at = resp.ttl_ms > 0 ? Expiry::nowMillis() + static_cast<uint64_t>(resp.ttl_ms) : 1;
+                bool found = false;
+                bool applied = lsm.expire(resp.key, expire_at, found, false);
+                if (applied && !found) {
+                    queueReply(reactor, client_fd, client_data, RespEncoder::integer(0));
+                } else {
+                    queueWriteReply(reactor, client_fd, client_data, applied, RespEncoder::integer(1));
+                }
                 break;
-            case DEL:
-                lsm.remove(resp.key);
-                response << RespEncoder::integer(1);
+            }
+            case TTL: {
+                std::pair<bool, uint64_t> expiry = lsm.getExpiry(resp.key);
+                long long ttl = -2;
+                if (expiry.first && expiry.second == Expiry::NEVER) {
+                    ttl = -1;
+                } else if (expiry.first) {
+                    uint64_t now = Expiry::nowMillis();
+                    ttl = expiry.second > now ? static_cast<long long>((expiry.second - now + 500) / 1000) : 0;
+                }
+                queueReply(reactor, client_fd, client_data, RespEncoder::integer(ttl));
+                break;
+            }
+            case DEL: {
+                // The reply counts the distinct keys that existed, looked up before they are deleted
+                std::vector<std::string_view> keys = resp.keys.empty() ? std::vector<std::string_view>{resp.key} : resp.keys;
+                std::sort(keys.begin(), keys.end());
+                keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+                std::vector<std::pair<bool, std::string>> existing = lsm.multiGet(keys, false);
+                int removed = static_cast<int>(std::count_if(existing.begin(), existing.end(),
+                                                             [](const std::pair<bool, std::string> &result) { return result.first; }));
+                bool applied;
+                if (keys.size() == 1) {
+                    applied = lsm.remove(keys[0], false);
+                } else {
+                    WriteBatch batch;
+                    for (std::string_view key : keys) {
+                        batch.remove(key);
+                    }
+                    applied = lsm.write(batch, false);
+                }
+                queueWriteReply(reactor, client_fd, client_data, applied, RespEncoder::integer(removed));
+                break;
+            }
+            case DELRANGE:
+                queueWriteReply(reactor, client_fd, client_data, lsm.removeRange(resp.key, resp.value, false),
+                                RespEncoder::simpleString("OK"));
+                break;
+            case DELPREFIX: {
+                std::string end = RangeDeletion::prefixEnd(resp.key);
+                if (end.empty()) {
+                    queueReply(reactor, client_fd, client_data, RespEncoder::error("DELPREFIX prefix matches every key"));
+                    break;
+                }
+                queueWriteReply(reactor, client_fd, client_data, lsm.removeRange(resp.key, end, false), RespEncoder::simpleString("OK"));
+                break;
+            }
+            case MGET: {
+                std::vector<std::pair<bool, std::string>> results = lsm.multiGet(resp.keys);
+                std::string reply = RespEncoder::arrayHeader(results.size());
+                for (const std::pair<bool, std::string> &result : results) {
+                    reply += RespEncoder::bulkString(result.second, !result.first);
+                }
+                queueReply(reactor, client_fd, client_data, std::move(reply));
+                break;
+            }
+            case MSET: {
+                WriteBatch batch;
+                for (size_t i = 0; i < resp.keys.size(); ++i) {
+                    batch.put(resp.keys[i], resp.values[i]);
+                }
+                queueWriteReply(reactor, client_fd, client_data, lsm.write(batch, false), RespEncoder::simpleString("OK"));
+                break;
+            }
+            case SCAN:
+                queueReply(reactor, client_fd, client_data, scan(resp));
+                break;
+            case INFO:
+                queueReply(reactor, client_fd, client_data, RespEncoder::bulkString(info(resp.key), false));
                 break;
             default:
-                response << RespEncoder::error("Unknown operation");
+                queueReply(reactor, client_fd, client_data, RespEncoder::error("Unknown operation"));
                 break;
             }
-            send(client_fd, response.str().c_str(), response.str().size(), 0);
         } catch (const std::exception &e) {
             std::cerr << "Exception in handle_op: " << e.what() << std::endl;
-            std::string message = RespEncoder::error("Internal server error");
-            send(client_fd, message.c_str(), message.size(), 0);
+            queueReply(reactor, client_fd, client_data, RespEncoder::error("Internal server error"));
         }
+        Metrics::recordCommand(resp.operation, Metrics::microsSince(start));
+    }
+
+    /**
+     * @brief Format a number with two decimals
+     */
+    static std::string formatDecimal(double value) {
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%.2f", value);
+        return buffer;
+    }
+
+    /**
+     * @brief Format the latency percentiles of a histogram as an INFO field value
+     */
+    static std::string formatPercentiles(const LatencyHistogram &histogram) {
+        return "p50=" + std::to_string(histogram.percentile(50)) + ",p99=" + std::to_string(histogram.percentile(99)) +
+               ",p99.9=" + std::to_string(histogram.percentile(99.9)) + ",max=" + std::to_string(histogram.max);
+    }
+
+    /**
+     * @brief Build the reply to INFO
+     * @param section "server", "replication", "commandstats", "latencystats" or "engine", case-insensitive; empty,
+     *                "all" or "everything" for every section
+     * @return std::string Redis-style `# Section` headers followed by `field:value` lines
+     * @details Commands and engine operations never run are left out of the statistics sections.
+     */
+    std::string info(std::string_view section) {
+        std::string wanted(section);
+        std::transform(wanted.begin(), wanted.end(), wanted.begin(), [](unsigned char c) { return std::tolower(c); });
+        bool all = wanted.empty() || wanted == "all" || wanted == "everything";
+        std::string out;
+        auto field = [&out](const std::string &name, const std::string &value) { out += name + ":" + value + "\r\n"; };
+        auto header = [&](const char *name, const char *id) {
+            if (!all && wanted != id) {
+                return false;
+            }
+            out += out.empty() ? "" : "\r\n";
+            out += std::string("# ") + name + "\r\n";
+            return true;
+        };
+
+        if (header("Server", "server")) {
+            auto uptime = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - started);
+            field("uptime_in_seconds", std::to_string(uptime.count()));
+            field("event_loops", std::to_string(reactors.size()));
+            field("event_loop_backend", reactors[0]->loop->name());
+            field("connected_clients", std::to_string(connected_clients.load(std::memory_order_relaxed)));
+            field("shards", std::to_string(lsm.shardCount()));
+        }
+        if (header("Replication", "replication")) {
+            if (replica_client != nullptr) {
+                static constexpr const char *STATES[] = {"connecting", "bootstrapping", "streaming"};
+                field("role", "replica");
+                field("primary_host", replica_client->getHost());
+                field("primary_port", std::to_string(replica_client->getPort()));
+                field("primary_link_status", STATES[static_cast<size_t>(replica_client->getState())]);
+                field("applied_bytes", std::to_string(replica_client->getAppliedBytes()));
+                field("bootstraps", std::to_string(replica_client->getBootstraps()));
+            } else {
+                std::vector<ReplicationPrimary::ReplicaStatus> replicas = replication->getReplicas();
+                field("role", "primary");
+                field("connected_replicas", std::to_string(replicas.size()));
+                for (size_t i = 0; i < replicas.size(); ++i) {
+                    const ReplicationPrimary::ReplicaStatus &replica = replicas[i];
+                    field("replica" + std::to_string(i),
+                          "id=" + std::to_string(replica.id) + ",state=" + (replica.online ? "online" : "bootstrapping") +
+                              ",sent_bytes=" + std::to_string(replica.sent_bytes) + ",acked_bytes=" +
+                              std::to_string(replica.acked_bytes) + ",lag_bytes=" +
+                              std::to_string(replica.sent_bytes - replica.acked_bytes + replica.pending_bytes));
+                }
+            }
+        }
+        if (header("Commandstats", "commandstats")) {
+            for (size_t command = 0; command < UNKNOWN; ++command) {
+                LatencyHistogram histogram = Metrics::getCommandHistogram(command);
+                if (histogram.count > 0) {
+                    field(std::string("cmdstat_") + COMMAND_NAMES[command],
+                          "calls=" + std::to_string(histogram.count) + ",usec=" + std::to_string(histogram.sum) +
+                              ",usec_per_call=" + formatDecimal(histogram.mean()));
+                }
+            }
+        }
+        if (header("Latencystats", "latencystats")) {
+            for (size_t command = 0; command < UNKNOWN; ++command) {
+                LatencyHistogram histogram = Metrics::getCommandHistogram(command);
+                if (histogram.count > 0) {
+                    field(std::string("latency_percentiles_usec_") + COMMAND_NAMES[command], formatPercentiles(histogram));
+                }
+            }
+            for (size_t timer = 0; timer < static_cast<size_t>(Timer::COUNT); ++timer) {
+                LatencyHistogram histogram = Metrics::getHistogram(static_cast<Timer>(timer));
+                if (histogram.count > 0) {
+                    field(std::string("latency_percentiles_usec_engine_") + TIMER_NAMES[timer], formatPercentiles(histogram));
+                }
+            }
+        }
+        if (header("Engine", "engine")) {
+            TreeStats tree = lsm.getTreeStats();
+            field("memtable_bytes", std::to_string(tree.memtable_bytes));
+            field("immutable_memtables", std::to_string(tree.immutable_memtables));
+            field("immutable_memtable_bytes", std::to_string(tree.immutable_bytes));
+            for (size_t level = 0; level < tree.tables_per_level.size(); ++level) {
+                field("level" + std::to_string(level),
+                      "tables=" + std::to_string(tree.tables_per_level[level]) + ",bytes=" + std::to_string(tree.bytes_per_level[level]));
+            }
+            field("flushes", std::to_string(Metrics::getHistogram(Timer::FLUSH).count));
+            field("flush_bytes", std::to_string(Metrics::getCounter(Counter::FLUSH_BYTES)));
+            field("compactions", std::to_string(Metrics::getHistogram(Timer::COMPACTION).count));
+            field("compaction_bytes_read", std::to_string(Metrics::getCounter(Counter::COMPACTION_BYTES_READ)));
+            field("compaction_bytes_written", std::to_string(Metrics::getCounter(Counter::COMPACTION_BYTES_WRITTEN)));
+            WriteStallStats stalls = lsm.getWriteStallStats();
+            field("write_stall_slowdowns", std::to_string(stalls.slowdowns));
+            field("write_stall_stops", std::to_string(stalls.stops));
+            field("write_stall_usec", std::to_string(stalls.stall_micros));
+            BlockCacheStats cache = lsm.getBlockCacheStats();
+            field("block_cache_hits", std::to_string(cache.hits));
+            field("block_cache_misses", std::to_string(cache.misses));
+            field("block_cache_usage_bytes", std::to_string(cache.usage));
+            FilterStats filter = lsm.getFilterStats();
+            field("bloom_filter_checked", std::to_string(filter.checked));
+            field("bloom_filter_useful", std::to_string(filter.useful));
+            field("bloom_filter_false_positives", std::to_string(filter.false_positive));
+        }
+        return out;
+    }
+
+    /**
+     * @brief Build the Prometheus text exposition of the server's metrics
+     * @details Latencies are exported as summaries with 0.5, 0.9, 0.99 and 0.999 quantiles.
+     */
+    std::string prometheus() {
+        std::string out;
+        auto metric = [&out](const char *name, const char *type, const char *help) {
+            out += std::string("# HELP ") + name + " " + help + "\n# TYPE " + name + " " + type + "\n";
+        };
+        auto sample = [&out](const std::string &name, const std::string &labels, uint64_t value) {
+            out += name + (labels.empty() ? "" : "{" + labels + "}") + " " + std::to_string(value) + "\n";
+        };
+        auto summary = [&](const char *name, const std::string &label, const LatencyHistogram &histogram) {
+            for (double quantile : {0.5, 0.9, 0.99, 0.999}) {
+                char text[16];
+                std::snprintf(text, sizeof(text), "%g", quantile);
+                sample(name, label + ",quantile=\"" + text + "\"", histogram.percentile(quantile * 100));
+            }
+            sample(std::string(name) + "_sum", label, histogram.sum);
+            sample(std::string(name) + "_count", label, histogram.count);
+        };
+
+        metric("blink_uptime_seconds", "gauge", "Seconds since the server started.");
+        sample("blink_uptime_seconds", "",
+               std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - started).count());
+        metric("blink_connected_clients", "gauge", "Open client connections.");
+        sample("blink_connected_clients", "", connected_clients.load(std::memory_order_relaxed));
+
+        metric("blink_command_latency_microseconds", "summary", "Time taken to execute RESP commands.");
+        for (size_t command = 0; command < UNKNOWN; ++command) {
+            summary("blink_command_latency_microseconds", std::string("command=\"") + COMMAND_NAMES[command] + "\"",
+                    Metrics::getCommandHistogram(command));
+        }
+        metric("blink_engine_latency_microseconds", "summary", "Time taken by engine reads, writes, flushes and compactions.");
+        for (size_t timer = 0; timer < static_cast<size_t>(Timer::COUNT); ++timer) {
+            summary("blink_engine_latency_microseconds", std::string("operation=\"") + TIMER_NAMES[timer] + "\"",
+                    Metrics::getHistogram(static_cast<Timer>(timer)));
+        }
+
+        TreeStats tree = lsm.getTreeStats();
+        metric("blink_memtable_bytes", "gauge", "Bytes held by the active MemTables.");
+        sample("blink_memtable_bytes", "", tree.memtable_bytes);
+        metric("blink_immutable_memtables", "gauge", "MemTables awaiting flush.");
+        sample("blink_immutable_memtables", "", tree.immutable_memtables);
+        metric("blink_level_tables", "gauge", "SSTables per level.");
+        for (size_t level = 0; level < tree.tables_per_level.size(); ++level) {
+            sample("blink_level_tables", "level=\"" + std::to_string(level) + "\"", tree.tables_per_level[level]);
+        }
+        metric("blink_level_bytes", "gauge", "Bytes of the SSTables per level.");
+        for (size_t level = 0; level < tree.bytes_per_level.size(); ++level) {
+            sample("blink_level_bytes", "level=\"" + std::to_string(level) + "\"", tree.bytes_per_level[level]);
+        }
+        metric("blink_flush_bytes_total", "counter", "Bytes of the SSTables written by flushes.");
+        sample("blink_flush_bytes_total", "", Metrics::getCounter(Counter::FLUSH_BYTES));
+        metric("blink_compaction_bytes_read_total", "counter", "Bytes of the input tables of finished compactions.");
+        sample("blink_compaction_bytes_read_total", "", Metrics::getCounter(Counter::COMPACTION_BYTES_READ));
+        metric("blink_compaction_bytes_written_total", "counter", "Bytes of the output tables of finished compactions.");
+        sample("blink_compaction_bytes_written_total", "", Metrics::getCounter(Counter::COMPACTION_BYTES_WRITTEN));
+
+        WriteStallStats stalls = lsm.getWriteStallStats();
+        metric("blink_write_stall_microseconds_total", "counter", "Time writers spent delayed or stopped.");
+        sample("blink_write_stall_microseconds_total", "", stalls.stall_micros);
+        BlockCacheStats cache = lsm.getBlockCacheStats();
+        metric("blink_block_cache_hits_total", "counter", "Block lookups served from the cache.");
+        sample("blink_block_cache_hits_total", "", cache.hits);
+        metric("blink_block_cache_misses_total", "counter", "Block lookups read from disk.");
+        sample("blink_block_cache_misses_total", "", cache.misses);
+        return out;
     }
 
     /**
      * @brief Handle client messages
+     * @param reactor The reactor serving the client
      * @param client_fd The file descriptor of the client socket
-     * @details This function reads data from the client socket, decodes the RESP command,
-     *          and processes it. It handles errors and disconnections appropriately.
+     * @details This function reads data from the client socket on a readiness-based backend
+     *          and processes the commands in the receive buffer. It handles errors and
+     *          disconnections appropriately.
      */
-    void handleClientMessage(int client_fd) {
-        ClientData &client_data = client_buffers[client_fd];
+    void handleClientMessage(Reactor &reactor, int client_fd) {
+        ClientData &client_data = reactor.client_buffers[client_fd];
 
         char temp_buffer[CHUNK_SIZE];
 
@@ -217,11 +1070,11 @@ private:
                     break;
                 } else {
                     std::cerr << "recv error for client " << client_fd << ": " << strerror(errno) << std::endl;
-                    closeConnection(client_fd);
+                    closeConnection(reactor, client_fd);
                     return;
                 }
             } else if (bytes_read == 0) {
-                closeConnection(client_fd);
+                closeConnection(reactor, client_fd);
                 return;
             }
 
@@ -242,103 +1095,326 @@ private:
             // }
         }
 
-        if (client_data.total_bytes > 0) {
-            client_data.buffer.push_back('\0');
-            Resp resp = RespDecoder::decode(client_data.buffer.data());
-            client_data.buffer.clear();
-            client_data.total_bytes = 0;
+        processInput(reactor, client_fd, client_data);
+    }
 
-            if (!resp.success) {
-                std::string message = RespEncoder::error(resp.error);
+    /**
+     * @brief Handle data received by a completion-based backend
+     * @param reactor The reactor serving the client
+     * @param client_fd The file descriptor of the client socket
+     * @param data The received bytes, owned by the event loop
+     * @param length The number of received bytes
+     */
+    void handleReceived(Reactor &reactor, int client_fd, const char *data, size_t length) {
+        ClientData &client_data = reactor.client_buffers[client_fd];
+        client_data.buffer.insert(client_data.buffer.end(), data, data + length);
+        client_data.total_bytes += length;
+        processInput(reactor, client_fd, client_data);
+    }
+
+    /**
+     * @brief Decode and execute the buffered commands of a client
+     * @param reactor The reactor serving the client
+     * @param client_fd The file descriptor of the client socket
+     * @param client_data The client's connection state
+     * @details This function decodes every complete RESP command in the receive buffer and
+     *          processes them in order. A partial command at the end of the buffer is kept for
+     *          the next read, and the replies are queued on the client's output buffer. While GETs
+     *          are in flight on the read pool, decoding stops at the first other command, which is
+     *          processed once they complete.
+     */
+    void processInput(Reactor &reactor, int client_fd, ClientData &client_data) {
+        size_t offset = 0;
+        while (offset < client_data.total_bytes) {
+            size_t consumed = 0;
+            Resp resp = RespDecoder::decode(client_data.buffer.data() + offset, client_data.total_bytes - offset, consumed);
+            if (resp.incomplete) {
+                break;
+            }
+
+            if (consumed == 0) {
                 std::cerr << "Error: " << resp.error << std::endl;
-                send(client_fd, message.c_str(), message.size(), 0);
+                queueReply(reactor, client_fd, client_data, RespEncoder::error(resp.error));
+                flushOutput(reactor, client_fd, client_data);
+                closeConnection(reactor, client_fd);
                 return;
             }
-            handle_op(resp, client_fd);
+            // Anything but a GET waits for the reads in flight, so a write cannot change what they see
+            if (client_data.reads_in_flight > 0 && resp.success && resp.operation != GET) {
+                break;
+            }
+            offset += consumed;
+
+            if (!resp.success) {
+                std::cerr << "Error: " << resp.error << std::endl;
+                queueReply(reactor, client_fd, client_data, RespEncoder::error(resp.error));
+                continue;
+            }
+            if (resp.operation == REPLICATE) {
+                Metrics::recordCommand(REPLICATE, 0);
+                if (startReplication(reactor, client_fd, client_data)) {
+                    return;
+                }
+                continue;
+            }
+            handle_op(reactor, resp, client_fd, client_data);
+        }
+
+        client_data.buffer.erase(client_data.buffer.begin(), client_data.buffer.begin() + offset);
+        client_data.total_bytes -= offset;
+    }
+
+    /**
+     * @brief Write as much of the client's queued output as the socket accepts
+     * @param reactor The reactor serving the client
+     * @param client_fd The file descriptor of the client socket
+     * @param client_data The client's connection state
+     * @return bool False if the connection failed and should be closed, true otherwise
+     * @details Queued replies are gathered into an iovec array and written with `writev`.
+     *          If the socket buffer fills up, the remainder stays queued and write interest is
+     *          registered so the loop resumes the flush once the client drains its socket;
+     *          the interest is dropped again as soon as the queue is empty.
+     */
+    bool flushOutput(Reactor &reactor, int client_fd, ClientData &client_data) {
+        client_data.flush_pending = false;
+
+        // Writes are acknowledged only once logged; one commit covers the whole iteration's batch
+        commitWrites(reactor);
+
+        while (!client_data.output.empty()) {
+            struct iovec iov[IOV_MAX];
+            int iov_count = 0;
+            for (auto it = client_data.output.begin(); it != client_data.output.end() && iov_count < IOV_MAX; ++it) {
+                size_t skip = iov_count == 0 ? client_data.output_offset : 0;
+                iov[iov_count].iov_base = const_cast<char *>(it->data() + skip);
+                iov[iov_count].iov_len = it->size() - skip;
+                iov_count++;
+            }
+
+            ssize_t written = writev(client_fd, iov, iov_count);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    break;
+                }
+                std::cerr << "writev error for client " << client_fd << ": " << strerror(errno) << std::endl;
+                return false;
+            }
+
+            size_t remaining = static_cast<size_t>(written);
+            while (remaining > 0) {
+                size_t front_left = client_data.output.front().size() - client_data.output_offset;
+                if (remaining < front_left) {
+                    client_data.output_offset += remaining;
+                    break;
+                }
+                remaining -= front_left;
+                client_data.output.pop_front();
+                client_data.output_offset = 0;
+            }
+        }
+
+        bool pending = !client_data.output.empty();
+        if (pending != client_data.write_registered) {
+            if (!reactor.loop->setWritable(client_fd, pending)) {
+                return false;
+            }
+            client_data.write_registered = pending;
         }
+        return true;
+    }
+
+    /**
+     * @brief Flush every client that had replies queued during this event-loop iteration
+     * @param reactor The reactor whose pending clients are flushed
+     */
+    void flushPendingOutput(Reactor &reactor) {
+        for (int client_fd : reactor.pending_flushes) {
+            auto it = reactor.client_buffers.find(client_fd);
+            if (it == reactor.client_buffers.end() || !it->second.flush_pending) {
+                continue;
+            }
+            if (!flushOutput(reactor, client_fd, it->second)) {
+                closeConnection(reactor, client_fd);
+            }
+        }
+        reactor.pending_flushes.clear();
     }
 
     /**
      * @brief Close the client connection
+     * @param reactor The reactor serving the client
      * @param client_fd The file descriptor of the client socket
-     * @details This function removes the client from the kqueue and closes the socket.
+     * @details This function removes the client from the event loop and closes the socket.
      */
-    void closeConnection(int client_fd) {
-        addToKqueue(client_fd, EVFILT_READ, EV_DELETE);
-        client_buffers.erase(client_fd);
+    void closeConnection(Reactor &reactor, int client_fd) {
+        reactor.loop->removeClient(client_fd);
+        if (reactor.client_buffers.erase(client_fd) > 0) {
+            connected_clients.fetch_sub(1, std::memory_order_relaxed);
+        }
         close(client_fd);
     }
 
+    /**
+     * @brief Run one reactor's event loop
+     * @param reactor The reactor to run
+     * @details This function enters the event loop, waiting for events on the reactor's
+     *          EventLoop and handling them accordingly.
+     */
+    void runReactor(Reactor &reactor) {
+        while (reactor.loop->wait(reactor.events, -1) != -1) {
+            for (const IoEvent &event : reactor.events) {
+                if (event.fd == server_socket) {
+                    if (event.type == IoEventType::ACCEPTED) {
+                        dispatchClient(reactor, event.result);
+                    } else if (event.type == IoEventType::READABLE) {
+                        handleNewConnection(reactor);
+                    }
+                    continue;
+                }
+                if (event.fd == reactor.handoff_read) {
+                    handleHandoff(reactor);
+                    continue;
+                }
+                if (event.fd == reactor.completion_read) {
+                    handleCompletions(reactor);
+                    continue;
+                }
+
+                auto it = reactor.client_buffers.find(event.fd);
+                if (it == reactor.client_buffers.end()) {
+                    continue;
+                }
+
+                switch (event.type) {
+                case IoEventType::READABLE:
+                    handleClientMessage(reactor, event.fd);
+                    break;
+                case IoEventType::RECEIVED:
+                    handleReceived(reactor, event.fd, event.data, event.length);
+                    break;
+                case IoEventType::WRITABLE:
+                    if (!flushOutput(reactor, event.fd, it->second)) {
+                        closeConnection(reactor, event.fd);
+                    }
+                    break;
+                default:
+                    closeConnection(reactor, event.fd);
+                    break;
+                }
+            }
+            flushPendingOutput(reactor);
+        }
+    }
+
 public:
     /**
      * @brief KqueueServer constructor
      * @param addr Address to bind the server socket to
      * @param port Port number to bind the server socket to
-     * @details This constructor initializes the server socket, kqueue, and event list.
+     * @param num_reactors Number of event-loop threads (at least 1)
+     * @param backend EventLoop backend: "kqueue", "epoll", "io_uring" or empty for the platform default
+     * @param metrics_port Port of the Prometheus endpoint, or 0 to serve metrics through INFO only
+     * @param read_threads Threads answering GETs that miss the MemTables, or 0 to answer every GET on its reactor
+     * @param primary "host:port" of the server to replicate as a read-only replica, or empty to run as a primary
+     * @details This constructor initializes the server socket and one reactor per event-loop
+     *          thread. The first reactor watches the listening socket.
      */
-    KqueueServer(const std::string &addr, int port) {
+    KqueueServer(const std::string &addr, int port, size_t num_reactors = 1, const std::string &backend = "", int metrics_port = 0,
+                 size_t read_threads = DEFAULT_READ_THREADS, const std::string &primary = "") {
+        size_t separator = primary.rfind(':');
+        int primary_port = 0;
+        if (!primary.empty()) {
+            try {
+                primary_port = separator == std::string::npos ? 0 : std::stoi(primary.substr(separator + 1));
+            } catch (const std::exception &) {
+            }
+            if (primary_port <= 0 || separator == 0) {
+                throw std::runtime_error("Invalid primary address, expected host:port: " + primary);
+            }
+        }
+
         server_socket = createServerSocket(addr, port);
         if (server_socket == -1) {
             throw std::runtime_error("Failed to create server socket");
         }
 
-        kq = createKqueue();
-        if (kq == -1) {
-            close(server_socket);
-            throw std::runtime_error("Failed to create kqueue");
+        for (size_t i = 0; i < std::max<size_t>(num_reactors, 1); i++) {
+            std::unique_ptr<Reactor> reactor = createReactor(backend);
+            if (!reactor) {
+                for (std::unique_ptr<Reactor> &created : reactors) {
+                    destroyReactor(*created);
+                }
+                close(server_socket);
+                throw std::runtime_error("Failed to create event loop");
+            }
+            reactors.push_back(std::move(reactor));
         }
 
-        event_list.resize(INITIAL_EVENT_LIST_SIZE);
-
-        if (!addToKqueue(server_socket, EVFILT_READ, EV_ADD)) {
+        if (!reactors[0]->loop->addListener(server_socket)) {
+            for (std::unique_ptr<Reactor> &reactor : reactors) {
+                destroyReactor(*reactor);
+            }
             close(server_socket);
-            close(kq);
-            throw std::runtime_error("Failed to add server socket to kqueue");
+            throw std::runtime_error("Failed to add server socket to event loop");
         }
 
-        std::cout << "Server is listening on " << addr << ":" << port << std::endl;
+        std::cout << "Server is listening on " << addr << ":" << port
+                  << " with " << reactors.size() << " " << reactors[0]->loop->name()
+                  << " event loop(s)" << std::endl;
+
+        if (metrics_port > 0) {
+            try {
+                metrics_endpoint = std::make_unique<MetricsEndpoint>(addr, metrics_port, [this]() { return prometheus(); });
+            } catch (...) {
+                for (std::unique_ptr<Reactor> &reactor : reactors) {
+                    destroyReactor(*reactor);
+                }
+                close(server_socket);
+                throw;
+            }
+            std::cout << "Serving metrics on http://" << addr << ":" << metrics_port << "/metrics" << std::endl;
+        }
+        if (read_threads > 0) {
+            read_pool = std::make_unique<ThreadPool>(read_threads);
+        }
+        if (primary.empty()) {
+            replication = std::make_unique<ReplicationPrimary>(lsm);
+        } else {
+            replica_client = std::make_unique<ReplicationClient>(lsm, primary.substr(0, separator), primary_port);
+            std::cout << "Replicating " << primary << " as a read-only replica" << std::endl;
+        }
     }
 
     /**
      * @brief Run the server loop
-     * @details This function enters the main event loop, waiting for events on the kqueue
-     *          and handling them accordingly.
+     * @details This function starts one thread per additional reactor and runs the accepting
+     *          reactor on the calling thread. It returns once every event loop has stopped.
      */
     void run() {
-        while (true) {
-            int new_events = kevent(kq, NULL, 0, event_list.data(), event_list.size(), NULL);
-            if (new_events == -1) {
-                if (errno == EINTR) {
-                    continue;
-                }
-                std::cerr << "kevent error: " << strerror(errno) << std::endl;
-                break;
-            }
-
-            if (new_events == static_cast<int>(event_list.size())) {
-                event_list.resize(event_list.size() * 2);
-            }
-
-            for (int i = 0; i < new_events; i++) {
-                int event_fd = event_list[i].ident;
-
-                if (event_list[i].flags & (EV_ERROR | EV_EOF)) {
-                    if (event_fd != server_socket) {
-                        closeConnection(event_fd);
-                    }
-                    continue;
-                }
-                event_fd == server_socket ? handleNewConnection() : handleClientMessage(event_fd);
-            }
+        std::vector<std::thread> threads;
+        for (size_t i = 1; i < reactors.size(); i++) {
+            threads.emplace_back(&KqueueServer::runReactor, this, std::ref(*reactors[i]));
+        }
+        runReactor(*reactors[0]);
+        for (std::thread &thread : threads) {
+            thread.join();
         }
     }
 
     ~KqueueServer() {
-        for (const auto &client : client_buffers) {
-            close(client.first);
+        // Replication threads write to and read from the tree, so they stop before anything else
+        replica_client.reset();
+        replication.reset();
+        // Reads still queued post their replies to the reactors, so the pool goes first
+        read_pool.reset();
+        metrics_endpoint.reset();
+        for (std::unique_ptr<Reactor> &reactor : reactors) {
+            destroyReactor(*reactor);
         }
         close(server_socket);
-        close(kq);
     }
 };
 #endif
\ No newline at end of file
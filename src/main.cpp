@@ -8,8 +8,8 @@
 
 #include "kqueue_server.hpp"
 #include <arpa/inet.h>
+#include <csignal>
 #include <fcntl.h>
-#include <sys/event.h>
 #include <unistd.h>
 
 /*
@@ -19,21 +19,50 @@
  * and starts the server loop to accept and handle client connections.
  *
  * @param argc The number of command-line arguments.
- * @param argv The command-line arguments.
+ * @param argv The command-line arguments. argv[1], if given, is the number of
+ *             event-loop threads (default 1), argv[2] the event-loop backend
+ *             ("kqueue", "epoll" or "io_uring"; empty or missing for the platform default)
+ *             argv[3] the port of the Prometheus metrics endpoint (default 0, disabled) and
+ *             argv[4] the number of threads reading SSTables for GETs (default 4, 0 to read on the event loops),
+ *             argv[5] the "host:port" of a primary to follow as a read-only replica (empty or missing to
+ *             run as a primary) and argv[6] the port to listen on (default 9001).
  * @return int Exit status of the program.
  */
 
 int main(int argc, char *argv[]) {
-    (void)argc;
-    (void)argv;
-
     constexpr const char *ADDR = "127.0.0.1";
-    constexpr int PORT = 9001;
+
+    int port = 9001;
+    size_t event_loops = 1;
+    int metrics_port = 0;
+    size_t read_threads = 4;
+    try {
+        if (argc > 1) {
+            event_loops = std::stoul(argv[1]);
+        }
+        if (argc > 3) {
+            metrics_port = std::stoi(argv[3]);
+        }
+        if (argc > 4) {
+            read_threads = std::stoul(argv[4]);
+        }
+        if (argc > 6) {
+            port = std::stoi(argv[6]);
+        }
+    } catch (const std::exception &) {
+        std::cerr << "Usage: " << argv[0] << " [event_loops] [backend] [metrics_port] [read_threads] [primary] [port]" << std::endl;
+        return 1;
+    }
+    std::string backend = argc > 2 ? argv[2] : "";
+    std::string primary = argc > 5 ? argv[5] : "";
 
     std::cout << "\033[2J\033[1;1H";
 
+    // Writes to a client that has gone away must fail with EPIPE instead of killing the server
+    signal(SIGPIPE, SIG_IGN);
+
     try {
-        KqueueServer server(ADDR, PORT);
+        KqueueServer server(ADDR, port, event_loops, backend, metrics_port, read_threads, primary);
         server.run();
     } catch (const std::exception &e) {
         std::cerr << "Error: " << e.what() << std::endl;
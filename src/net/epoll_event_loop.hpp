@@ -0,0 +1,133 @@
+/**
+ * @file epoll_event_loop.hpp
+ * @brief Epoll EventLoop backend
+ * @details Readiness-based, level-triggered event loop for Linux built on epoll.
+ * @author Gana Jayant Sigadam
+ * @version 1.0
+ * @date March 2025
+ */
+#ifndef EPOLL_EVENT_LOOP_HPP
+#define EPOLL_EVENT_LOOP_HPP
+
+#if defined(__linux__)
+#define BLINK_HAS_EPOLL 1
+
+#include "event_loop.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+/**
+ * @class EpollEventLoop
+ * @brief EventLoop backed by epoll
+ */
+class EpollEventLoop : public EventLoop {
+private:
+    static constexpr size_t INITIAL_EVENT_LIST_SIZE = 512;
+
+    int epfd;
+    std::vector<struct epoll_event> event_list;
+
+    /**
+     * @brief Add or modify the interest set of a file descriptor
+     * @param op EPOLL_CTL_ADD, EPOLL_CTL_MOD or EPOLL_CTL_DEL
+     * @param fd File descriptor to update
+     * @param events Epoll event mask
+     * @return bool True if successful, false otherwise
+     */
+    bool control(int op, int fd, uint32_t events) {
+        struct epoll_event event;
+        std::memset(&event, 0, sizeof(event));
+        event.events = events;
+        event.data.fd = fd;
+        if (epoll_ctl(epfd, op, fd, &event) == -1) {
+            std::cerr << "Failed to update epoll for fd " << fd << ": " << strerror(errno) << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+public:
+    EpollEventLoop() : epfd(epoll_create1(EPOLL_CLOEXEC)) {
+        if (epfd == -1) {
+            throw std::runtime_error("Failed to create epoll instance");
+        }
+        event_list.resize(INITIAL_EVENT_LIST_SIZE);
+    }
+
+    bool addListener(int fd) override {
+        return control(EPOLL_CTL_ADD, fd, EPOLLIN);
+    }
+
+    bool addReadable(int fd) override {
+        return control(EPOLL_CTL_ADD, fd, EPOLLIN);
+    }
+
+    bool addClient(int fd) override {
+        return control(EPOLL_CTL_ADD, fd, EPOLLIN | EPOLLRDHUP);
+    }
+
+    bool setWritable(int fd, bool enabled) override {
+        return control(EPOLL_CTL_MOD, fd, EPOLLIN | EPOLLRDHUP | (enabled ? static_cast<uint32_t>(EPOLLOUT) : 0u));
+    }
+
+    void removeClient(int fd) override {
+        epoll_ctl(epfd, EPOLL_CTL_DEL, fd, NULL);
+    }
+
+    int wait(std::vector<IoEvent> &events, int timeout_ms) override {
+        events.clear();
+
+        int new_events = epoll_wait(epfd, event_list.data(), event_list.size(), timeout_ms);
+        if (new_events == -1) {
+            if (errno == EINTR) {
+                return 0;
+            }
+            std::cerr << "epoll_wait error: " << strerror(errno) << std::endl;
+            return -1;
+        }
+
+        for (int i = 0; i < new_events; i++) {
+            const struct epoll_event &event = event_list[i];
+            IoEvent io_event;
+            io_event.fd = event.data.fd;
+            // Pending input is delivered first; the recv that follows reports the EOF
+            if (event.events & EPOLLIN) {
+                io_event.type = IoEventType::READABLE;
+                events.push_back(io_event);
+            } else if (event.events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP)) {
+                io_event.type = IoEventType::HANGUP;
+                events.push_back(io_event);
+                continue;
+            }
+            if (event.events & EPOLLOUT) {
+                io_event.type = IoEventType::WRITABLE;
+                events.push_back(io_event);
+            }
+        }
+
+        if (new_events == static_cast<int>(event_list.size())) {
+            event_list.resize(event_list.size() * 2);
+        }
+        return static_cast<int>(events.size());
+    }
+
+    bool completionBased() const override {
+        return false;
+    }
+
+    const char *name() const override {
+        return "epoll";
+    }
+
+    ~EpollEventLoop() override {
+        close(epfd);
+    }
+};
+
+#endif
+#endif
@@ -0,0 +1,115 @@
+/**
+ * @file event_loop.hpp
+ * @brief Event loop interface
+ * @details This file declares the primitives the server needs from an I/O event loop,
+ *          so the RESP server logic is independent of the OS facility behind it.
+ *          Readiness-based backends (kqueue, epoll) report READABLE / WRITABLE events and
+ *          let the server do the accept and recv calls itself. Completion-based backends
+ *          (io_uring) perform accept and recv in the kernel and report ACCEPTED / RECEIVED
+ *          events carrying the result instead.
+ * @author Gana Jayant Sigadam
+ * @version 1.0
+ * @date March 2025
+ */
+#ifndef EVENT_LOOP_HPP
+#define EVENT_LOOP_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Types of events reported by an EventLoop
+ * @details READABLE and WRITABLE are readiness notifications. ACCEPTED carries a new
+ *          client socket accepted on a listener, RECEIVED carries bytes already read from a
+ *          client socket, and HANGUP reports that the peer closed or the socket failed.
+ */
+enum class IoEventType {
+    READABLE,
+    WRITABLE,
+    ACCEPTED,
+    RECEIVED,
+    HANGUP,
+};
+
+/**
+ * @brief An event reported by EventLoop::wait
+ * @details For ACCEPTED, `result` holds the accepted client socket. For RECEIVED, `data`
+ *          and `length` describe the bytes read; they are owned by the event loop and stay
+ *          valid only until the next call to wait.
+ */
+struct IoEvent {
+    IoEventType type;
+    int fd;
+    int result = 0;
+    const char *data = nullptr;
+    size_t length = 0;
+};
+
+/**
+ * @class EventLoop
+ * @brief Abstract event loop used by the server
+ * @details One EventLoop is owned by exactly one reactor thread; implementations are not
+ *          required to be thread-safe.
+ */
+class EventLoop {
+public:
+    virtual ~EventLoop() = default;
+
+    /**
+     * @brief Watch a listening socket for new connections
+     * @param fd The non-blocking listening socket
+     * @return bool True if successful, false otherwise
+     */
+    virtual bool addListener(int fd) = 0;
+
+    /**
+     * @brief Watch a file descriptor for readability only (e.g. a wakeup pipe)
+     * @param fd File descriptor to watch
+     * @return bool True if successful, false otherwise
+     */
+    virtual bool addReadable(int fd) = 0;
+
+    /**
+     * @brief Start receiving data from a client socket
+     * @param fd The non-blocking client socket
+     * @return bool True if successful, false otherwise
+     */
+    virtual bool addClient(int fd) = 0;
+
+    /**
+     * @brief Ask for, or stop asking for, a WRITABLE event on a client socket
+     * @param fd The client socket
+     * @param enabled True while the server has output waiting for the socket
+     * @return bool True if successful, false otherwise
+     */
+    virtual bool setWritable(int fd, bool enabled) = 0;
+
+    /**
+     * @brief Stop watching a client socket
+     * @param fd The client socket; the caller closes it afterwards
+     */
+    virtual void removeClient(int fd) = 0;
+
+    /**
+     * @brief Wait for events
+     * @param events Cleared and filled with the events that occurred
+     * @param timeout_ms Maximum time to block in milliseconds, or -1 to wait indefinitely
+     * @return int Number of events, or -1 on an unrecoverable error
+     */
+    virtual int wait(std::vector<IoEvent> &events, int timeout_ms) = 0;
+
+    /**
+     * @brief Whether the backend performs accept/recv itself (ACCEPTED / RECEIVED events)
+     * @return bool True for completion-based backends
+     */
+    virtual bool completionBased() const = 0;
+
+    /**
+     * @brief Name of the backend, for logging
+     * @return const char* Backend name
+     */
+    virtual const char *name() const = 0;
+};
+
+#endif
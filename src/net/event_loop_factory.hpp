@@ -0,0 +1,47 @@
+/**
+ * @file event_loop_factory.hpp
+ * @brief EventLoop backend selection
+ * @details This file includes every EventLoop backend available on the target platform and
+ *          creates one by name. The default is kqueue where it exists and epoll on Linux.
+ * @author Gana Jayant Sigadam
+ * @version 1.0
+ * @date March 2025
+ */
+#ifndef EVENT_LOOP_FACTORY_HPP
+#define EVENT_LOOP_FACTORY_HPP
+
+#include "epoll_event_loop.hpp"
+#include "event_loop.hpp"
+#include "io_uring_event_loop.hpp"
+#include "kqueue_event_loop.hpp"
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+/**
+ * @brief Create an EventLoop backend by name
+ * @param backend "kqueue", "epoll", "io_uring", or empty for the platform default
+ * @return std::unique_ptr<EventLoop> The new event loop
+ * @throws std::invalid_argument if the backend is unknown or not available on this platform
+ */
+inline std::unique_ptr<EventLoop> createEventLoop(const std::string &backend) {
+#if defined(BLINK_HAS_KQUEUE)
+    if (backend.empty() || backend == "kqueue") {
+        return std::make_unique<KqueueEventLoop>();
+    }
+#endif
+#if defined(BLINK_HAS_EPOLL)
+    if (backend.empty() || backend == "epoll") {
+        return std::make_unique<EpollEventLoop>();
+    }
+#endif
+#if defined(BLINK_HAS_IO_URING)
+    if (backend == "io_uring") {
+        return std::make_unique<IoUringEventLoop>();
+    }
+#endif
+    throw std::invalid_argument("Event loop backend not available: " + (backend.empty() ? std::string("default") : backend));
+}
+
+#endif
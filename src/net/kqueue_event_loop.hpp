@@ -0,0 +1,146 @@
+/**
+ * @file kqueue_event_loop.hpp
+ * @brief Kqueue EventLoop backend
+ * @details Readiness-based event loop for macOS and the BSDs built on kqueue/kevent.
+ * @author Gana Jayant Sigadam
+ * @version 1.0
+ * @date March 2025
+ */
+#ifndef KQUEUE_EVENT_LOOP_HPP
+#define KQUEUE_EVENT_LOOP_HPP
+
+#if defined(__APPLE__) || defined(__FreeBSD__) || defined(__OpenBSD__) || defined(__NetBSD__)
+#define BLINK_HAS_KQUEUE 1
+
+#include "event_loop.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <sys/event.h>
+#include <unistd.h>
+
+/**
+ * @class KqueueEventLoop
+ * @brief EventLoop backed by kqueue
+ */
+class KqueueEventLoop : public EventLoop {
+private:
+    static constexpr size_t INITIAL_EVENT_LIST_SIZE = 512;
+
+    int kq;
+    std::vector<struct kevent> event_list;
+
+    /**
+     * @brief Create a Kqueue object
+     * @return int File descriptor for the kqueue
+     */
+    static int createKqueue() {
+        int kq = kqueue();
+        if (kq == -1) {
+            std::cerr << "Failed to create kqueue" << std::endl;
+            return -1;
+        }
+        return kq;
+    }
+
+    /**
+     * @brief Add a file descriptor to the kqueue
+     * @param fd File descriptor to add
+     * @param filter Event filter (e.g., EVFILT_READ)
+     * @param flags Event flags (e.g., EV_ADD)
+     * @return bool True if successful, false otherwise
+     */
+    bool addToKqueue(int fd, int filter, int flags) {
+        struct kevent change_event;
+        EV_SET(&change_event, fd, filter, flags, 0, 0, NULL);
+        if (kevent(kq, &change_event, 1, NULL, 0, NULL) == -1) {
+            std::cerr << "Failed to add to kqueue for fd " << fd << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+public:
+    KqueueEventLoop() : kq(createKqueue()) {
+        if (kq == -1) {
+            throw std::runtime_error("Failed to create kqueue");
+        }
+        event_list.resize(INITIAL_EVENT_LIST_SIZE);
+    }
+
+    bool addListener(int fd) override {
+        return addToKqueue(fd, EVFILT_READ, EV_ADD);
+    }
+
+    bool addReadable(int fd) override {
+        return addToKqueue(fd, EVFILT_READ, EV_ADD);
+    }
+
+    bool addClient(int fd) override {
+        return addToKqueue(fd, EVFILT_READ, EV_ADD);
+    }
+
+    bool setWritable(int fd, bool enabled) override {
+        return addToKqueue(fd, EVFILT_WRITE, enabled ? EV_ADD : EV_DELETE);
+    }
+
+    void removeClient(int fd) override {
+        // Closing the descriptor drops any remaining filters (including EVFILT_WRITE)
+        addToKqueue(fd, EVFILT_READ, EV_DELETE);
+    }
+
+    int wait(std::vector<IoEvent> &events, int timeout_ms) override {
+        events.clear();
+
+        struct timespec timeout;
+        if (timeout_ms >= 0) {
+            timeout.tv_sec = timeout_ms / 1000;
+            timeout.tv_nsec = (timeout_ms % 1000) * 1000000L;
+        }
+
+        int new_events = kevent(kq, NULL, 0, event_list.data(), event_list.size(), timeout_ms >= 0 ? &timeout : NULL);
+        if (new_events == -1) {
+            if (errno == EINTR) {
+                return 0;
+            }
+            std::cerr << "kevent error: " << strerror(errno) << std::endl;
+            return -1;
+        }
+
+        for (int i = 0; i < new_events; i++) {
+            const struct kevent &event = event_list[i];
+            IoEvent io_event;
+            io_event.fd = static_cast<int>(event.ident);
+            if (event.flags & (EV_ERROR | EV_EOF)) {
+                io_event.type = IoEventType::HANGUP;
+            } else if (event.filter == EVFILT_WRITE) {
+                io_event.type = IoEventType::WRITABLE;
+            } else {
+                io_event.type = IoEventType::READABLE;
+            }
+            events.push_back(io_event);
+        }
+
+        if (new_events == static_cast<int>(event_list.size())) {
+            event_list.resize(event_list.size() * 2);
+        }
+        return new_events;
+    }
+
+    bool completionBased() const override {
+        return false;
+    }
+
+    const char *name() const override {
+        return "kqueue";
+    }
+
+    ~KqueueEventLoop() override {
+        close(kq);
+    }
+};
+
+#endif
+#endif
@@ -0,0 +1,135 @@
+/**
+ * @file metrics_endpoint.hpp
+ * @brief Prometheus metrics endpoint
+ * @details This file contains a minimal HTTP listener that answers `GET /metrics` with the
+ *          server's metrics in the Prometheus text format. It runs on a thread of its own with
+ *          blocking sockets, one scrape at a time, so scrapes never run on an event loop.
+ * @author Gana Jayant Sigadam
+ * @version 1.0
+ * @date March 2025
+ */
+#ifndef METRICS_ENDPOINT_HPP
+#define METRICS_ENDPOINT_HPP
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <thread>
+#include <unistd.h>
+
+/**
+ * @class MetricsEndpoint
+ * @brief HTTP listener serving Prometheus scrapes
+ * @details The listener polls its socket with a short timeout so that stop() is noticed on every
+ *          platform. A request is read up to the end of its headers, within a one second timeout;
+ *          any path other than /metrics gets a 404.
+ */
+class MetricsEndpoint {
+private:
+    static constexpr int POLL_INTERVAL_MS = 200;
+    static constexpr size_t MAX_REQUEST_SIZE = 8192;
+
+    int listen_socket = -1;
+    std::function<std::string()> render;
+    std::atomic<bool> running{true};
+    std::thread thread;
+
+    void serve() {
+        while (running.load(std::memory_order_relaxed)) {
+            pollfd listener = {listen_socket, POLLIN, 0};
+            if (poll(&listener, 1, POLL_INTERVAL_MS) <= 0) {
+                continue;
+            }
+            int client = accept(listen_socket, nullptr, nullptr);
+            if (client == -1) {
+                continue;
+            }
+            timeval timeout = {1, 0};
+            setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+            setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+            handleRequest(client);
+            close(client);
+        }
+    }
+
+    void handleRequest(int client) {
+        std::string request;
+        char buffer[1024];
+        while (request.find("\r\n\r\n") == std::string::npos && request.size() < MAX_REQUEST_SIZE) {
+            ssize_t received = recv(client, buffer, sizeof(buffer), 0);
+            if (received <= 0) {
+                return;
+            }
+            request.append(buffer, static_cast<size_t>(received));
+        }
+
+        std::string status = "200 OK";
+        std::string body;
+        if (request.compare(0, 13, "GET /metrics ") == 0 || request.compare(0, 13, "GET /metrics?") == 0) {
+            body = render();
+        } else {
+            status = "404 Not Found";
+            body = "Not Found\n";
+        }
+        std::string response = "HTTP/1.1 " + status +
+                               "\r\nContent-Type: text/plain; version=0.0.4\r\nConnection: close\r\nContent-Length: " +
+                               std::to_string(body.size()) + "\r\n\r\n" + body;
+        size_t sent = 0;
+        while (sent < response.size()) {
+            ssize_t written = send(client, response.data() + sent, response.size() - sent, 0);
+            if (written <= 0) {
+                return;
+            }
+            sent += static_cast<size_t>(written);
+        }
+    }
+
+public:
+    /**
+     * @brief Start listening for scrapes
+     * @param addr Address to bind to
+     * @param port Port to bind to
+     * @param render Produces the response body; called on the endpoint's thread
+     * @throws std::runtime_error if the socket cannot be bound
+     */
+    MetricsEndpoint(const std::string &addr, int port, std::function<std::string()> render) : render(std::move(render)) {
+        sockaddr_in server_addr;
+        std::memset(&server_addr, 0, sizeof(server_addr));
+        server_addr.sin_family = AF_INET;
+        server_addr.sin_port = htons(port);
+        if (inet_pton(AF_INET, addr.c_str(), &server_addr.sin_addr) <= 0) {
+            throw std::runtime_error("Invalid metrics address: " + addr);
+        }
+
+        listen_socket = socket(AF_INET, SOCK_STREAM, 0);
+        int opt = 1;
+        if (listen_socket == -1 || setsockopt(listen_socket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0 ||
+            bind(listen_socket, reinterpret_cast<sockaddr *>(&server_addr), sizeof(server_addr)) < 0 ||
+            listen(listen_socket, SOMAXCONN) < 0) {
+            if (listen_socket != -1) {
+                close(listen_socket);
+            }
+            throw std::runtime_error("Failed to create metrics socket");
+        }
+        thread = std::thread(&MetricsEndpoint::serve, this);
+    }
+
+    MetricsEndpoint(const MetricsEndpoint &) = delete;
+    MetricsEndpoint &operator=(const MetricsEndpoint &) = delete;
+
+    ~MetricsEndpoint() {
+        running = false;
+        thread.join();
+        close(listen_socket);
+    }
+};
+
+#endif
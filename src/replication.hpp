@@ -0,0 +1,790 @@
+/**
+ * @file replication.hpp
+ * @brief Asynchronous primary-replica replication
+ * @details This file contains both ends of replication. A replica connects to the primary's client
+ *          port and sends `REPLICATE`; the primary takes the connection off its event loops and serves
+ *          it from a thread of its own with blocking I/O. The replica first receives a consistent
+ *          set of the primary's SSTables, hard-linked at a cut of each shard's write order, and
+ *          ingests them; it then tails each shard's write-ahead log, applying the records from the
+ *          cut on through its own log and MemTables and acknowledging them. Replication is
+ *          asynchronous: the primary acknowledges writes to its clients without waiting for replicas.
+ * @author Gana Jayant Sigadam
+ * @version 1.0
+ * @date March 2025
+ */
+#ifndef REPLICATION_HPP
+#define REPLICATION_HPP
+
+#include "engine/coding.hpp"
+#include "engine/sharded_lsm.hpp"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <string>
+#include <string_view>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * @class ReplicationFrame
+ * @brief Frames of the replication protocol and blocking socket helpers
+ * @details After `REPLICATE`, both directions carry frames of [type (1 byte)] [payload size (fixed64)]
+ *          [payload]. The primary sends HELLO with its shard count, one TABLE per SSTable followed by
+ *          the table's bytes, READY once every table is sent, then RECORDS frames holding encoded
+ *          write-ahead log records of one shard. The replica answers each RECORDS frame with an ACK
+ *          holding the total bytes of records it has applied to the shard.
+ */
+class ReplicationFrame {
+public:
+    static constexpr char HELLO = 'H';   ///< [shard count (fixed32)].
+    static constexpr char TABLE = 'T';   ///< [shard (fixed32)] [level (fixed32)] [name (length-prefixed)] [file size (fixed64)].
+    static constexpr char READY = 'R';   ///< Empty; every table has been sent.
+    static constexpr char RECORDS = 'W'; ///< [shard (fixed32)] [records].
+    static constexpr char ACK = 'A';     ///< [shard (fixed32)] [bytes of records applied to the shard (fixed64)].
+    static constexpr size_t HEADER_SIZE = 1 + sizeof(uint64_t);
+    static constexpr size_t MAX_CONTROL_PAYLOAD = 64 * 1024;       ///< Largest payload of a frame other than RECORDS.
+    static constexpr size_t MAX_RECORDS_SIZE = 256 * 1024 * 1024; ///< Most bytes of records queued for, or sent in one frame to, a replica.
+
+    /**
+     * @brief Gets the largest payload a frame of a type may announce, 0 for an unknown type.
+     */
+    static uint64_t maxPayload(char type) {
+        switch (type) {
+        case HELLO:
+        case TABLE:
+        case READY:
+        case ACK:
+            return MAX_CONTROL_PAYLOAD;
+        case RECORDS:
+            return sizeof(uint32_t) + MAX_RECORDS_SIZE;
+        default:
+            return 0;
+        }
+    }
+
+    /**
+     * @brief Encodes a frame header.
+     */
+    static std::string header(char type, uint64_t payload_size) {
+        std::string out(1, type);
+        Coding::putFixed64(out, payload_size);
+        return out;
+    }
+
+    /**
+     * @brief Sends every byte, retrying after partial writes.
+     * @return True if everything was sent, false if the connection failed.
+     */
+    static bool sendAll(int socket, const char *data, size_t size) {
+        while (size > 0) {
+            ssize_t written = ::send(socket, data, size, 0);
+            if (written < 0 && errno == EINTR) {
+                continue;
+            }
+            if (written <= 0) {
+                return false;
+            }
+            data += written;
+            size -= static_cast<size_t>(written);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Sends a frame whose payload is given in two parts, so large payloads need not be joined.
+     */
+    static bool write(int socket, char type, std::string_view head, std::string_view body = std::string_view()) {
+        std::string frame = header(type, head.size() + body.size());
+        frame.append(head.data(), head.size());
+        return sendAll(socket, frame.data(), frame.size()) && sendAll(socket, body.data(), body.size());
+    }
+};
+
+/**
+ * @class ReplicationPrimary
+ * @brief The primary's side: feeds every connected replica its own copy of the log
+ * @details Each replica gets a thread that checkpoints the tree, streams the checkpoint's tables and
+ *          then sends, in batches, the log records queued for it since its cut. Records reach the
+ *          queues through the tree's log listener, which is installed when the first replica
+ *          connects and costs writers one atomic load while no replica is attached. A replica whose
+ *          queue outgrows MAX_BACKLOG is disconnected, and bootstraps again when it reconnects.
+ */
+class ReplicationPrimary {
+public:
+    /**
+     * @brief What INFO reports about one replica
+     */
+    struct ReplicaStatus {
+        uint64_t id = 0;
+        bool online = false;        ///< True once the replica has every table of its checkpoint.
+        uint64_t sent_bytes = 0;    ///< Bytes of log records sent, over every shard.
+        uint64_t acked_bytes = 0;   ///< Bytes of log records the replica has applied.
+        size_t pending_bytes = 0;   ///< Bytes of log records queued and not yet sent.
+    };
+
+private:
+    static constexpr size_t MAX_BACKLOG = ReplicationFrame::MAX_RECORDS_SIZE;
+    static constexpr int BATCH_INTERVAL_MS = 100;
+    static constexpr size_t FILE_CHUNK_SIZE = 64 * 1024;
+
+    struct Replica {
+        uint64_t id = 0;
+        int socket = -1;
+        std::vector<bool> attached;       ///< Whether each shard's records are queued, set at the shard's cut.
+        std::vector<std::string> pending; ///< Records of each shard not yet sent.
+        size_t pending_bytes = 0;
+        std::vector<uint64_t> sent;       ///< Bytes of each shard's records sent.
+        std::vector<uint64_t> acked;      ///< Bytes of each shard's records acknowledged.
+        bool online = false;
+        bool closed = false;              ///< Set to make the thread stop.
+        bool finished = false;            ///< Set by the thread as it exits.
+        std::thread thread;
+    };
+
+    ShardedLSMTree &lsm;
+    std::mutex mtx; ///< Guards every replica's state and the fields below.
+    std::condition_variable cv;
+    std::vector<std::unique_ptr<Replica>> replicas;
+    std::atomic<size_t> attachments{0}; ///< Number of (replica, shard) pairs records are queued for.
+    bool listening = false;
+    bool stopping = false;
+    uint64_t next_id = 0;
+
+    /**
+     * @brief Queues a log record for every replica attached to its shard.
+     * @details Runs on the writing thread, under the shard's log lock.
+     */
+    void onRecord(size_t shard, std::string_view record) {
+        if (attachments.load(std::memory_order_relaxed) == 0) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mtx);
+        bool queued = false;
+        for (const std::unique_ptr<Replica> &replica : replicas) {
+            if (!replica->attached[shard]) {
+                continue;
+            }
+            if (replica->pending_bytes + record.size() > MAX_BACKLOG) {
+                std::cerr << "Replica " << replica->id << " fell " << replica->pending_bytes
+                          << " bytes behind, disconnecting it" << std::endl;
+                close_locked(*replica);
+                continue;
+            }
+            replica->pending[shard].append(record.data(), record.size());
+            replica->pending_bytes += record.size();
+            queued = true;
+        }
+        if (queued) {
+            cv.notify_all();
+        }
+    }
+
+    /**
+     * @brief Stops queueing records for a replica and wakes its thread. Must be called with mtx held.
+     */
+    void close_locked(Replica &replica) {
+        for (size_t shard = 0; shard < replica.attached.size(); ++shard) {
+            if (replica.attached[shard]) {
+                replica.attached[shard] = false;
+                attachments.fetch_sub(1, std::memory_order_relaxed);
+            }
+        }
+        replica.pending.assign(replica.pending.size(), std::string());
+        replica.pending_bytes = 0;
+        if (!replica.closed) {
+            replica.closed = true;
+            // Unblocks a send to a replica that stopped reading
+            shutdown(replica.socket, SHUT_RDWR);
+        }
+        cv.notify_all();
+    }
+
+    /**
+     * @brief Sends one table of a checkpoint, as a TABLE frame followed by the file's bytes.
+     */
+    static bool send_table(int socket, size_t shard, const TableMeta &meta, const std::string &path) {
+        std::ifstream file(path, std::ios::binary);
+        std::error_code error;
+        uint64_t size = std::filesystem::file_size(path, error);
+        if (!file.is_open() || error) {
+            std::cerr << "Failed to open checkpoint table " << path << std::endl;
+            return false;
+        }
+        std::string head;
+        Coding::putFixed32(head, static_cast<uint32_t>(shard));
+        Coding::putFixed32(head, meta.level);
+        Coding::putLengthPrefixed(head, meta.name);
+        Coding::putFixed64(head, size);
+        if (!ReplicationFrame::write(socket, ReplicationFrame::TABLE, head)) {
+            return false;
+        }
+        std::vector<char> chunk(FILE_CHUNK_SIZE);
+        while (size > 0) {
+            size_t length = static_cast<size_t>(std::min<uint64_t>(size, chunk.size()));
+            if (!file.read(chunk.data(), static_cast<std::streamsize>(length)) ||
+                !ReplicationFrame::sendAll(socket, chunk.data(), length)) {
+                return false;
+            }
+            size -= length;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Reads the acknowledgements the replica has sent, without blocking.
+     * @return False if the replica closed the connection or sent something malformed.
+     */
+    bool read_acks(Replica &replica, std::string &input) {
+        char buffer[4096];
+        while (true) {
+            ssize_t received = recv(replica.socket, buffer, sizeof(buffer), MSG_DONTWAIT);
+            if (received < 0 && errno == EINTR) {
+                continue;
+            }
+            if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                break;
+            }
+            if (received <= 0) {
+                return false;
+            }
+            input.append(buffer, static_cast<size_t>(received));
+        }
+        const size_t ack_size = sizeof(uint32_t) + sizeof(uint64_t);
+        size_t offset = 0;
+        while (input.size() - offset >= ReplicationFrame::HEADER_SIZE + ack_size) {
+            if (input[offset] != ReplicationFrame::ACK ||
+                Coding::decodeFixed64(input.data() + offset + 1) != ack_size) {
+                std::cerr << "Replica " << replica.id << " sent a malformed frame" << std::endl;
+                return false;
+            }
+            const char *payload = input.data() + offset + ReplicationFrame::HEADER_SIZE;
+            uint32_t shard = Coding::decodeFixed32(payload);
+            uint64_t applied = Coding::decodeFixed64(payload + sizeof(uint32_t));
+            if (shard >= replica.acked.size()) {
+                std::cerr << "Replica " << replica.id << " acknowledged an unknown shard" << std::endl;
+                return false;
+            }
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                replica.acked[shard] = applied;
+            }
+            offset += ReplicationFrame::HEADER_SIZE + ack_size;
+        }
+        input.erase(0, offset);
+        return true;
+    }
+
+    /**
+     * @brief Bootstraps one replica, then streams log records to it until it disconnects.
+     */
+    void serve(Replica &replica) {
+        fcntl(replica.socket, F_SETFL, fcntl(replica.socket, F_GETFL) & ~O_NONBLOCK);
+        int nodelay = 1;
+        setsockopt(replica.socket, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+
+        const size_t shards = lsm.shardCount();
+        std::string name = "checkpoint_" + std::to_string(replica.id);
+        std::vector<std::vector<TableMeta>> tables;
+        bool ok = lsm.checkpoint(
+            name,
+            [this, &replica](size_t shard) {
+                std::lock_guard<std::mutex> lock(mtx);
+                if (!replica.closed) {
+                    replica.attached[shard] = true;
+                    attachments.fetch_add(1, std::memory_order_relaxed);
+                }
+            },
+            tables);
+
+        std::string hello;
+        Coding::putFixed32(hello, static_cast<uint32_t>(shards));
+        ok = ok && ReplicationFrame::write(replica.socket, ReplicationFrame::HELLO, hello);
+        for (size_t shard = 0; ok && shard < shards; ++shard) {
+            for (const TableMeta &meta : tables[shard]) {
+                ok = ok && send_table(replica.socket, shard, meta, lsm.shardDirectory(shard) + name + "/" + meta.name + SST_EXTENSION);
+            }
+        }
+        for (size_t shard = 0; shard < shards; ++shard) {
+            std::error_code error;
+            std::filesystem::remove_all(lsm.shardDirectory(shard) + name, error);
+        }
+        ok = ok && ReplicationFrame::write(replica.socket, ReplicationFrame::READY, std::string_view());
+        if (ok) {
+            std::lock_guard<std::mutex> lock(mtx);
+            replica.online = true;
+            std::cout << "Replica " << replica.id << " is online" << std::endl;
+        }
+
+        std::vector<std::string> batches(shards);
+        std::string acks;
+        while (ok) {
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                cv.wait_for(lock, std::chrono::milliseconds(BATCH_INTERVAL_MS),
+                            [&] { return stopping || replica.closed || replica.pending_bytes > 0; });
+                if (stopping || replica.closed) {
+                    break;
+                }
+                for (size_t shard = 0; shard < shards; ++shard) {
+                    batches[shard].swap(replica.pending[shard]);
+                }
+                replica.pending_bytes = 0;
+            }
+            for (size_t shard = 0; ok && shard < shards; ++shard) {
+                if (batches[shard].empty()) {
+                    continue;
+                }
+                std::string head;
+                Coding::putFixed32(head, static_cast<uint32_t>(shard));
+                ok = ReplicationFrame::write(replica.socket, ReplicationFrame::RECORDS, head, batches[shard]);
+                std::lock_guard<std::mutex> lock(mtx);
+                replica.sent[shard] += batches[shard].size();
+                batches[shard].clear();
+            }
+            ok = ok && read_acks(replica, acks);
+        }
+
+        std::lock_guard<std::mutex> lock(mtx);
+        if (!stopping) {
+            std::cout << "Replica " << replica.id << " disconnected" << std::endl;
+        }
+        close_locked(replica);
+        close(replica.socket);
+        replica.finished = true;
+    }
+
+    /**
+     * @brief Joins the threads of replicas that have disconnected. Must be called with mtx held.
+     */
+    void reap_locked() {
+        for (auto it = replicas.begin(); it != replicas.end();) {
+            if ((*it)->finished) {
+                (*it)->thread.join();
+                it = replicas.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+public:
+    explicit ReplicationPrimary(ShardedLSMTree &lsm) : lsm(lsm) {
+    }
+
+    ReplicationPrimary(const ReplicationPrimary &) = delete;
+    ReplicationPrimary &operator=(const ReplicationPrimary &) = delete;
+
+    /**
+     * @brief Disconnects every replica and removes the log listener.
+     */
+    ~ReplicationPrimary() {
+        std::vector<std::unique_ptr<Replica>> stopped;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stopping = true;
+            for (const std::unique_ptr<Replica> &replica : replicas) {
+                close_locked(*replica);
+            }
+            stopped.swap(replicas);
+        }
+        for (const std::unique_ptr<Replica> &replica : stopped) {
+            replica->thread.join();
+        }
+        if (listening) {
+            lsm.setLogListener(nullptr);
+        }
+    }
+
+    /**
+     * @brief Starts replicating to a connection that sent REPLICATE.
+     * @param socket The connection, already removed from its event loop; closed by the replica's thread.
+     */
+    void addReplica(int socket) {
+        std::lock_guard<std::mutex> lock(mtx);
+        reap_locked();
+        if (!listening) {
+            lsm.setLogListener([this](size_t shard, std::string_view record) { onRecord(shard, record); });
+            listening = true;
+        }
+        const size_t shards = lsm.shardCount();
+        std::unique_ptr<Replica> replica = std::make_unique<Replica>();
+        replica->id = next_id++;
+        replica->socket = socket;
+        replica->attached.assign(shards, false);
+        replica->pending.assign(shards, std::string());
+        replica->sent.assign(shards, 0);
+        replica->acked.assign(shards, 0);
+        Replica &started = *replica;
+        replica->thread = std::thread([this, &started] { serve(started); });
+        replicas.push_back(std::move(replica));
+        std::cout << "Replica " << started.id << " connected, sending a checkpoint" << std::endl;
+    }
+
+    /**
+     * @brief Describes every connected replica.
+     */
+    std::vector<ReplicaStatus> getReplicas() {
+        std::lock_guard<std::mutex> lock(mtx);
+        std::vector<ReplicaStatus> statuses;
+        for (const std::unique_ptr<Replica> &replica : replicas) {
+            if (replica->closed) {
+                continue;
+            }
+            ReplicaStatus status;
+            status.id = replica->id;
+            status.online = replica->online;
+            for (size_t shard = 0; shard < replica->sent.size(); ++shard) {
+                status.sent_bytes += replica->sent[shard];
+                status.acked_bytes += replica->acked[shard];
+            }
+            status.pending_bytes = replica->pending_bytes;
+            statuses.push_back(status);
+        }
+        return statuses;
+    }
+};
+
+/**
+ * @class ReplicationClient
+ * @brief The replica's side: follows a primary from a thread of its own
+ * @details The client connects, receives the checkpoint's tables into a staging directory next to
+ *          each shard and, on READY, replaces the tree's contents with them: one range deletion
+ *          removes whatever the tree held, then each shard ingests the tables deepest level first and
+ *          L0 oldest first, so every table is newer than the ones below it, as on the primary. Log
+ *          records are then applied as they arrive. The tree must have as many shards as the
+ *          primary's, and at least as many levels. After a disconnect the client reconnects and
+ *          bootstraps from scratch.
+ */
+class ReplicationClient {
+public:
+    enum class State { CONNECTING, BOOTSTRAPPING, STREAMING };
+
+private:
+    static constexpr int RETRY_INTERVAL_MS = 1000;
+    static constexpr int POLL_INTERVAL_MS = 200;
+    static constexpr const char *STAGING_DIR = "replica_staging/";
+
+    ShardedLSMTree &lsm;
+    std::string host;
+    int port;
+    std::atomic<bool> running{true};
+    std::atomic<State> state{State::CONNECTING};
+    std::atomic<uint64_t> applied_bytes{0};
+    std::atomic<uint64_t> bootstraps{0};
+    std::thread thread;
+
+    int connect_to_primary() const {
+        addrinfo hints;
+        std::memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo *addresses = nullptr;
+        if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &addresses) != 0) {
+            return -1;
+        }
+        int sock = -1;
+        for (addrinfo *address = addresses; address != nullptr && sock == -1; address = address->ai_next) {
+            sock = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+            if (sock != -1 && connect(sock, address->ai_addr, address->ai_addrlen) != 0) {
+                close(sock);
+                sock = -1;
+            }
+        }
+        freeaddrinfo(addresses);
+        return sock;
+    }
+
+    /**
+     * @brief Receives exactly size bytes, giving up when the client stops.
+     */
+    bool receive_all(int sock, char *data, size_t size) {
+        while (size > 0) {
+            pollfd readable = {sock, POLLIN, 0};
+            int ready = poll(&readable, 1, POLL_INTERVAL_MS);
+            if (!running.load(std::memory_order_relaxed)) {
+                return false;
+            }
+            if (ready <= 0) {
+                continue;
+            }
+            ssize_t received = recv(sock, data, size, 0);
+            if (received < 0 && errno == EINTR) {
+                continue;
+            }
+            if (received <= 0) {
+                return false;
+            }
+            data += received;
+            size -= static_cast<size_t>(received);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Receives a frame's payload, growing the buffer only as bytes arrive.
+     * @details A damaged header, or a peer that does not speak the protocol, then costs no more
+     *          memory than it actually sends.
+     */
+    bool receive_payload(int sock, std::string &payload, uint64_t size) {
+        static constexpr size_t CHUNK_SIZE = 1024 * 1024;
+        payload.clear();
+        while (payload.size() < size) {
+            size_t offset = payload.size();
+            payload.resize(offset + static_cast<size_t>(std::min<uint64_t>(size - offset, CHUNK_SIZE)));
+            if (!receive_all(sock, payload.data() + offset, payload.size() - offset)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Receives one table's bytes into the shard's staging directory.
+     */
+    bool receive_table(int sock, const std::string &path, uint64_t size) {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        std::vector<char> chunk(64 * 1024);
+        while (size > 0) {
+            size_t length = static_cast<size_t>(std::min<uint64_t>(size, chunk.size()));
+            if (!receive_all(sock, chunk.data(), length) || !file.write(chunk.data(), static_cast<std::streamsize>(length))) {
+                return false;
+            }
+            size -= length;
+        }
+        return static_cast<bool>(file.flush());
+    }
+
+    /**
+     * @brief Replaces the tree's contents with the staged tables.
+     * @param staged Base filenames of the staged tables, per shard and per level.
+     */
+    bool install(const std::vector<std::vector<std::vector<std::string>>> &staged) {
+        // Finding the largest key takes a full scan, which only a restarted replica pays for
+        ShardedLSMTree::Iterator it = lsm.iterator();
+        it.seekToFirst();
+        if (it.isValid()) {
+            std::string smallest(it.key());
+            std::string largest;
+            for (; it.isValid(); it.next()) {
+                largest.assign(it.key());
+            }
+            if (!lsm.removeRange(smallest, largest + '\0')) {
+                return false;
+            }
+        }
+        for (size_t shard = 0; shard < staged.size(); ++shard) {
+            for (size_t level = staged[shard].size(); level-- > 1;) {
+                if (!lsm.ingestShardFiles(shard, staged[shard][level])) {
+                    return false;
+                }
+            }
+            for (const std::string &table : staged[shard].empty() ? std::vector<std::string>() : staged[shard][0]) {
+                if (!lsm.ingestShardFiles(shard, {table})) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Bootstraps from the primary and applies its log records until the connection ends.
+     */
+    void follow(int sock) {
+        static const std::string command = "*1\r\n$9\r\nREPLICATE\r\n";
+        if (!ReplicationFrame::sendAll(sock, command.data(), command.size())) {
+            return;
+        }
+        state = State::BOOTSTRAPPING;
+        const size_t shards = lsm.shardCount();
+        const size_t levels = lsm.levelCount();
+        std::vector<std::string> staging;
+        for (size_t shard = 0; shard < shards; ++shard) {
+            staging.push_back(lsm.shardDirectory(shard) + STAGING_DIR);
+            std::error_code error;
+            std::filesystem::remove_all(staging.back(), error);
+            std::filesystem::create_directories(staging.back(), error);
+        }
+        std::vector<std::vector<std::vector<std::string>>> staged(shards);
+        std::vector<uint64_t> applied(shards, 0);
+
+        char header[ReplicationFrame::HEADER_SIZE];
+        std::string payload;
+        bool ok = true;
+        while (ok && receive_all(sock, header, sizeof(header))) {
+            if (header[0] == '-') {
+                std::string line(header, sizeof(header));
+                char c;
+                while (line.back() != '\n' && receive_all(sock, &c, 1)) {
+                    line += c;
+                }
+                std::cerr << "Primary refused to replicate: " << line.substr(1, line.find('\r') - 1) << std::endl;
+                break;
+            }
+            uint64_t size = Coding::decodeFixed64(header + 1);
+            if (size > ReplicationFrame::maxPayload(header[0])) {
+                std::cerr << "Primary sent a malformed frame of " << size << " bytes" << std::endl;
+                break;
+            }
+            if (!receive_payload(sock, payload, size)) {
+                break;
+            }
+            std::string_view input(payload);
+            switch (header[0]) {
+            case ReplicationFrame::HELLO:
+                if (payload.size() != sizeof(uint32_t) || Coding::decodeFixed32(payload.data()) != shards) {
+                    std::cerr << "Primary has " << (payload.size() == sizeof(uint32_t) ? Coding::decodeFixed32(payload.data()) : 0)
+                              << " shards and this replica " << shards << "; start the replica with as many shards"
+                              << std::endl;
+                    ok = false;
+                }
+                break;
+            case ReplicationFrame::TABLE: {
+                std::string_view name;
+                if (input.size() < 2 * sizeof(uint32_t)) {
+                    ok = false;
+                    break;
+                }
+                uint32_t shard = Coding::decodeFixed32(input.data());
+                uint32_t level = Coding::decodeFixed32(input.data() + sizeof(uint32_t));
+                input.remove_prefix(2 * sizeof(uint32_t));
+                ok = shard < shards && level < levels && Coding::getLengthPrefixed(input, name) && input.size() == sizeof(uint64_t) &&
+                     name.find('/') == std::string_view::npos;
+                if (!ok) {
+                    break;
+                }
+                std::string base_name = staging[shard] + std::string(name);
+                ok = receive_table(sock, base_name + SST_EXTENSION, Coding::decodeFixed64(input.data()));
+                if (staged[shard].size() <= level) {
+                    staged[shard].resize(level + 1);
+                }
+                staged[shard][level].push_back(std::move(base_name));
+                break;
+            }
+            case ReplicationFrame::READY:
+                ok = install(staged);
+                if (ok) {
+                    bootstraps.fetch_add(1, std::memory_order_relaxed);
+                    state = State::STREAMING;
+                    std::cout << "Replica is in sync with " << host << ":" << port << std::endl;
+                } else {
+                    std::cerr << "Failed to load the primary's tables" << std::endl;
+                }
+                for (const std::string &directory : staging) {
+                    std::error_code error;
+                    std::filesystem::remove_all(directory, error);
+                }
+                break;
+            case ReplicationFrame::RECORDS: {
+                if (state != State::STREAMING || input.size() < sizeof(uint32_t)) {
+                    ok = false;
+                    break;
+                }
+                uint32_t shard = Coding::decodeFixed32(input.data());
+                input.remove_prefix(sizeof(uint32_t));
+                ok = shard < shards && lsm.applyLogRecords(shard, input);
+                if (!ok) {
+                    break;
+                }
+                applied[shard] += input.size();
+                applied_bytes.fetch_add(input.size(), std::memory_order_relaxed);
+                std::string ack;
+                Coding::putFixed32(ack, shard);
+                Coding::putFixed64(ack, applied[shard]);
+                ok = ReplicationFrame::write(sock, ReplicationFrame::ACK, ack);
+                break;
+            }
+            default:
+                std::cerr << "Primary sent an unknown frame" << std::endl;
+                ok = false;
+                break;
+            }
+        }
+        for (const std::string &directory : staging) {
+            std::error_code error;
+            std::filesystem::remove_all(directory, error);
+        }
+    }
+
+    void run() {
+        while (running.load(std::memory_order_relaxed)) {
+            int sock = connect_to_primary();
+            if (sock != -1) {
+                follow(sock);
+                close(sock);
+                if (running.load(std::memory_order_relaxed)) {
+                    std::cerr << "Lost the connection to primary " << host << ":" << port << ", reconnecting" << std::endl;
+                }
+            }
+            state = State::CONNECTING;
+            for (int waited = 0; waited < RETRY_INTERVAL_MS && running.load(std::memory_order_relaxed); waited += POLL_INTERVAL_MS) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(POLL_INTERVAL_MS));
+            }
+        }
+    }
+
+public:
+    /**
+     * @brief Starts following a primary.
+     * @param lsm The replica's tree, with as many shards as the primary's.
+     * @param host Host of the primary.
+     * @param port Client port of the primary.
+     */
+    ReplicationClient(ShardedLSMTree &lsm, const std::string &host, int port) : lsm(lsm), host(host), port(port) {
+        thread = std::thread(&ReplicationClient::run, this);
+    }
+
+    ReplicationClient(const ReplicationClient &) = delete;
+    ReplicationClient &operator=(const ReplicationClient &) = delete;
+
+    ~ReplicationClient() {
+        running = false;
+        thread.join();
+    }
+
+    const std::string &getHost() const {
+        return host;
+    }
+
+    int getPort() const {
+        return port;
+    }
+
+    State getState() const {
+        return state.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Gets the bytes of log records applied since the process started.
+     */
+    uint64_t getAppliedBytes() const {
+        return applied_bytes.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Gets the number of completed bootstraps since the process started.
+     */
+    uint64_t getBootstraps() const {
+        return bootstraps.load(std::memory_order_relaxed);
+    }
+};
+
+#endif
@@ -12,19 +12,33 @@
 #ifndef RESP_DECODER
 #define RESP_DECODER
 
+#include <charconv>
+#include <cstring>
 #include <string>
+#include <string_view>
+#include <vector>
 
 #define CRLF "\r\n"
 
 /**
  * @brief Enum for RESP operations
  * @details This enum defines the possible RESP operations that can be parsed
- *          from the input buffer. It includes SET, GET, DEL, and UNKNOWN.
+ *          from the input buffer. It includes SET, GET, DEL, SCAN, MGET, MSET, EXPIRE, TTL, DELRANGE, DELPREFIX,
+ *          INFO, REPLICATE, and UNKNOWN.
  */
 enum Operation {
     SET,
     GET,
     DEL,
+    SCAN,
+    MGET,
+    MSET,
+    EXPIRE,
+    TTL,
+    DELRANGE,
+    DELPREFIX,
+    INFO,
+    REPLICATE,
     UNKNOWN
 };
 
@@ -33,15 +47,32 @@ enum Operation {
  * @details This class encapsulates the parsed information from a RESP command,
  *          including the operation type, key, value, success status, and error message.
  *          It is used to represent the result of decoding a RESP command.
+ *          When the input buffer holds only part of a frame, `incomplete` is set and
+ *          the caller should wait for more data before decoding again.
+ *          `key`, `value` and `pattern` are views into the decoded buffer, not copies: they
+ *          stay valid only as long as the caller keeps those bytes in place (for the server,
+ *          until the connection's receive buffer is compacted).
+ *          For SCAN, `key` holds the cursor and `pattern` and `count` the MATCH and COUNT options.
+ *          For MGET, MSET and a DEL of several keys, `keys` holds every key (and for MSET `values`
+ *          the value of each) and `key` the first; they are left empty for single-key commands.
+ *          `ttl_ms` is the time to live in milliseconds given by SET EX/PX (0 without either) or EXPIRE.
+ *          For DELRANGE, `key` holds the start of the range and `value` its end; for DELPREFIX, `key` holds the prefix.
+ *          For INFO, `key` holds the section asked for, empty for every section. REPLICATE takes no arguments.
  */
 class Resp {
 public:
     Operation operation;
-    std::string key;
-    std::string value;
+    std::string_view key;
+    std::string_view value;
+    std::string_view pattern;
+    size_t count;
+    long long ttl_ms;
+    std::vector<std::string_view> keys;
+    std::vector<std::string_view> values;
     bool success;
+    bool incomplete;
     std::string error;
-    Resp() : operation(UNKNOWN), success(false) {}
+    Resp() : operation(UNKNOWN), count(0), ttl_ms(0), success(false), incomplete(false) {}
 };
 
 /**
@@ -50,73 +81,187 @@ public:
  *          It parses the input buffer to extract the operation, key, and value,
  *          and handles error cases. The decode method returns a Resp object
  *          containing the parsed information.
+ *
+ *          The incremental overload frames one command at a time and reports how many
+ *          bytes it consumed, so a receive buffer holding several pipelined commands
+ *          (or a command split across reads) can be processed in a loop.
  */
 class RespDecoder {
 public:
     /**
-     * @brief Decode a RESP command from a buffer
-     * @param buffer The input buffer containing the RESP command
-     * @param length The length of the input buffer
+     * @brief Upper bound accepted for a single bulk string or array length.
+     * @details Guards against a client announcing a huge frame and pinning the
+     *          connection buffer while we wait for bytes that will never arrive.
+     */
+    static constexpr long long MAX_BULK_LENGTH = 512 * 1024 * 1024;
+
+    /**
+     * @brief Arguments decoded without allocating, enough for every fixed-size command
+     *        (SCAN cursor MATCH pattern COUNT n); further arguments of multi-key commands go to a vector.
+     */
+    static constexpr long long MAX_ARGS = 6;
+
+    /**
+     * @brief Keys examined by one SCAN call without a COUNT option, as in Redis.
+     */
+    static constexpr size_t SCAN_DEFAULT_COUNT = 10;
+
+    /**
+     * @brief Largest time to live accepted, in milliseconds (about 285,000 years), so that adding
+     *        it to the current time cannot overflow.
+     */
+    static constexpr long long MAX_TTL_MS = 1LL << 53;
+
+    /**
+     * @brief Decode the first complete RESP command in a buffer
+     * @param buffer The input buffer, possibly holding several pipelined commands
+     * @param length The number of bytes available in the buffer
+     * @param consumed Set to the number of bytes taken by the decoded frame
      * @return Resp object containing the parsed information
+     * @details Three outcomes are possible:
+     *          - `incomplete` is set and `consumed` is 0: the frame is not fully buffered yet.
+     *          - `consumed` > 0: a whole frame was taken off the buffer; `success` tells
+     *            whether it was a valid command (if not, `error` explains why).
+     *          - `consumed` is 0 and `incomplete` is not set: the stream is not valid RESP
+     *            framing and cannot be resynchronised; the connection should be dropped.
      */
-    static Resp decode(const char *buffer, size_t length) {
+    static Resp decode(const char *buffer, size_t length, size_t &consumed) {
         Resp resp;
+        consumed = 0;
 
         std::string_view input(buffer, length);
-
-        if (input.empty() || input[0] != '*') {
-            resp.error = "Invalid request: missing array marker";
+        if (input.empty()) {
+            resp.incomplete = true;
             return resp;
         }
 
-        size_t pos = input.find(CRLF);
-        if (pos == std::string_view::npos) {
-            resp.error = "Invalid request: malformed array header";
+        if (input[0] != '*') {
+            resp.error = "Protocol error: missing array marker";
             return resp;
         }
 
-        int num_args;
-        try {
-            num_args = std::stoi(std::string(input.substr(1, pos - 1)));
-        } catch (std::exception &) {
-            resp.error = "Invalid request: invalid argument count";
+        long long num_args;
+        ParseStatus status = parseLength(input, num_args);
+        if (status == ParseStatus::INCOMPLETE) {
+            resp.incomplete = true;
+            return resp;
+        }
+        if (status == ParseStatus::INVALID || num_args < 0 || num_args > MAX_BULK_LENGTH) {
+            resp.error = "Protocol error: invalid argument count";
             return resp;
         }
 
-        if (num_args < 2 || num_args > 3) {
+        std::string_view args[MAX_ARGS];
+        std::vector<std::string_view> extra_args;
+        for (long long i = 0; i < num_args; i++) {
+            std::string_view arg;
+            status = parseBulkString(input, arg);
+            if (status == ParseStatus::INCOMPLETE) {
+                resp.incomplete = true;
+                return resp;
+            }
+            if (status == ParseStatus::INVALID) {
+                resp.error = "Protocol error: invalid bulk string";
+                return resp;
+            }
+            if (i < MAX_ARGS) {
+                args[i] = arg;
+            } else {
+                extra_args.push_back(arg);
+            }
+        }
+        consumed = length - input.size();
+
+        if (num_args < 1) {
             resp.error = "Invalid request: unexpected argument count";
             return resp;
         }
 
-        input.remove_prefix(pos + 2);
-        if (!parseOperation(input, resp)) {
+        if (!parseOperation(args[0], resp)) {
             return resp;
         }
-
-        if (!parseKey(input, resp)) {
+        if (num_args < 2 && resp.operation != INFO && resp.operation != REPLICATE) {
+            resp.error = "Invalid request: unexpected argument count";
             return resp;
         }
+        resp.key = num_args > 1 ? args[1] : std::string_view();
 
         if (resp.operation == SET) {
+            if (num_args != 3 && num_args != 5) {
+                resp.error = num_args < 3 ? "Invalid request: SET requires a value" : "Invalid request: syntax error";
+                return resp;
+            }
+            resp.value = args[2];
+            if (num_args == 5 && !parseSetExpiry(args[3], args[4], resp)) {
+                return resp;
+            }
+        } else if (resp.operation == EXPIRE) {
             if (num_args != 3) {
-                resp.error = "Invalid request: SET requires a value";
+                resp.error = "Invalid request: EXPIRE requires a number of seconds";
                 return resp;
             }
-
-            if (!parseValue(input, resp)) {
+            if (!parseSeconds(args[2], resp.ttl_ms)) {
+                resp.error = "Invalid request: invalid expire time";
                 return resp;
             }
-        } else if (num_args > 2) {
+        } else if (resp.operation == DELRANGE) {
+            if (num_args != 3) {
+                resp.error = "Invalid request: DELRANGE requires a start and an end key";
+                return resp;
+            }
+            resp.value = args[2];
+            if (resp.key >= resp.value) {
+                resp.error = "Invalid request: DELRANGE start must be less than end";
+                return resp;
+            }
+        } else if (resp.operation == SCAN) {
+            if (num_args > MAX_ARGS) {
+                resp.error = "Invalid request: syntax error";
+                return resp;
+            }
+            if (!parseScanOptions(args + 2, static_cast<size_t>(num_args - 2), resp)) {
+                return resp;
+            }
+        } else if (resp.operation == MSET) {
+            if (num_args % 2 == 0) {
+                resp.error = "Invalid request: MSET requires a value for every key";
+                return resp;
+            }
+            for (long long i = 1; i < num_args; i += 2) {
+                resp.keys.push_back(i < MAX_ARGS ? args[i] : extra_args[i - MAX_ARGS]);
+                resp.values.push_back(i + 1 < MAX_ARGS ? args[i + 1] : extra_args[i + 1 - MAX_ARGS]);
+            }
+        } else if (resp.operation == MGET || (resp.operation == DEL && num_args > 2)) {
+            for (long long i = 1; i < num_args; i++) {
+                resp.keys.push_back(i < MAX_ARGS ? args[i] : extra_args[i - MAX_ARGS]);
+            }
+        } else if (num_args > 2 || (resp.operation == REPLICATE && num_args > 1)) {
             resp.error = "Invalid request: too many arguments";
             return resp;
         }
 
-        if (!input.empty() && input != CRLF) {
-            resp.error = "Invalid request: extra data after command";
+        resp.success = true;
+        return resp;
+    }
+
+    /**
+     * @brief Decode a single RESP command from a buffer
+     * @param buffer The input buffer containing the RESP command
+     * @param length The length of the input buffer
+     * @return Resp object containing the parsed information
+     */
+    static Resp decode(const char *buffer, size_t length) {
+        size_t consumed = 0;
+        Resp resp = decode(buffer, length, consumed);
+        if (resp.incomplete) {
+            resp.incomplete = false;
+            resp.error = "Invalid request: truncated command";
             return resp;
         }
-
-        resp.success = true;
+        if (resp.success && consumed != length && std::string_view(buffer + consumed, length - consumed) != CRLF) {
+            resp.success = false;
+            resp.error = "Invalid request: extra data after command";
+        }
         return resp;
     }
 
@@ -131,127 +276,191 @@ public:
 
 private:
     /**
-     * @brief Parse the operation from the input buffer
-     * @param input The input buffer containing the RESP command
-     * @param resp The Resp object to store the parsed information
-     * @return true if parsing is successful, false otherwise
+     * @brief Outcome of parsing one RESP element
      */
-    static bool parseOperation(std::string_view &input, Resp &resp) {
-        if (input.empty() || input[0] != '$') {
-            resp.error = "Invalid request: missing operation string marker";
-            return false;
-        }
+    enum class ParseStatus {
+        OK,
+        INCOMPLETE,
+        INVALID
+    };
 
+    /**
+     * @brief Parse a `<marker><digits>CRLF` header such as `*3\r\n` or `$5\r\n`
+     * @param input The input buffer, advanced past the header on success
+     * @param length Set to the parsed length
+     * @return ParseStatus of the header
+     * @details The digits are parsed in place with std::from_chars, without allocating.
+     */
+    static ParseStatus parseLength(std::string_view &input, long long &length) {
         size_t pos = input.find(CRLF);
         if (pos == std::string_view::npos) {
-            resp.error = "Invalid request: malformed operation length";
-            return false;
+            return input.size() > 32 ? ParseStatus::INVALID : ParseStatus::INCOMPLETE;
         }
 
-        int op_len;
-        try {
-            op_len = std::stoi(std::string(input.substr(1, pos - 1)));
-        } catch (std::exception &) {
-            resp.error = "Invalid request: invalid operation length";
-            return false;
+        const char *first = input.data() + 1;
+        const char *last = input.data() + pos;
+        std::from_chars_result result = std::from_chars(first, last, length);
+        if (first == last || result.ec != std::errc() || result.ptr != last) {
+            return ParseStatus::INVALID;
         }
 
         input.remove_prefix(pos + 2);
-        if (input.size() < static_cast<size_t>(op_len) + 2) {
-            resp.error = "Invalid request: truncated operation";
-            return false;
+        return ParseStatus::OK;
+    }
+
+    /**
+     * @brief Parse a `$<len>CRLF<bytes>CRLF` bulk string
+     * @param input The input buffer, advanced past the bulk string on success
+     * @param out Set to the bytes of the bulk string
+     * @return ParseStatus of the bulk string
+     */
+    static ParseStatus parseBulkString(std::string_view &input, std::string_view &out) {
+        if (input.empty()) {
+            return ParseStatus::INCOMPLETE;
+        }
+        if (input[0] != '$') {
+            return ParseStatus::INVALID;
         }
 
-        std::string_view op = input.substr(0, op_len);
+        std::string_view rest = input;
+        long long len;
+        ParseStatus status = parseLength(rest, len);
+        if (status != ParseStatus::OK) {
+            return status;
+        }
+        if (len < 0 || len > MAX_BULK_LENGTH) {
+            return ParseStatus::INVALID;
+        }
 
-        if (op == "DEL") {
-            resp.operation = DEL;
-        } else if (op == "GET") {
-            resp.operation = GET;
-        } else if (op == "SET") {
-            resp.operation = SET;
-        } else {
-            resp.error = "Invalid request: unknown operation";
-            return false;
+        if (rest.size() < static_cast<size_t>(len) + 2) {
+            return ParseStatus::INCOMPLETE;
+        }
+        if (rest.substr(len, 2) != CRLF) {
+            return ParseStatus::INVALID;
         }
 
-        input.remove_prefix(op_len + 2);
-        return true;
+        out = rest.substr(0, len);
+        rest.remove_prefix(len + 2);
+        input = rest;
+        return ParseStatus::OK;
     }
 
     /**
-     * @brief Parse the key from the input buffer
-     * @param input The input buffer containing the RESP command
-     * @param resp The Resp object to store the parsed information
+     * @brief Parse the `MATCH pattern` and `COUNT n` options of SCAN
+     * @param options The arguments after the cursor
+     * @param num_options The number of those arguments
+     * @param resp The Resp object to store the parsed options in
      * @return true if parsing is successful, false otherwise
      */
-    static bool parseKey(std::string_view &input, Resp &resp) {
-        if (input.empty() || input[0] != '$') {
-            resp.error = "Invalid request: missing key string marker";
-            return false;
-        }
-
-        size_t pos = input.find(CRLF);
-        if (pos == std::string_view::npos) {
-            resp.error = "Invalid request: malformed key length";
-            return false;
-        }
-
-        int key_len;
-        try {
-            key_len = std::stoi(std::string(input.substr(1, pos - 1)));
-        } catch (std::exception &) {
-            resp.error = "Invalid request: invalid key length";
-            return false;
+    static bool parseScanOptions(const std::string_view *options, size_t num_options, Resp &resp) {
+        resp.pattern = "*";
+        resp.count = SCAN_DEFAULT_COUNT;
+        for (size_t i = 0; i < num_options; i += 2) {
+            if (i + 1 >= num_options) {
+                resp.error = "Invalid request: syntax error";
+                return false;
+            }
+            if (options[i] == "MATCH") {
+                resp.pattern = options[i + 1];
+            } else if (options[i] == "COUNT") {
+                const char *first = options[i + 1].data();
+                const char *last = first + options[i + 1].size();
+                std::from_chars_result result = std::from_chars(first, last, resp.count);
+                if (first == last || result.ec != std::errc() || result.ptr != last || resp.count == 0) {
+                    resp.error = "Invalid request: COUNT must be a positive integer";
+                    return false;
+                }
+            } else {
+                resp.error = "Invalid request: syntax error";
+                return false;
+            }
         }
+        return true;
+    }
 
-        input.remove_prefix(pos + 2);
+    /**
+     * @brief Parse a whole argument as a signed integer
+     * @return true if the argument is an integer that fits, false otherwise
+     */
+    static bool parseInteger(std::string_view arg, long long &value) {
+        const char *first = arg.data();
+        const char *last = first + arg.size();
+        std::from_chars_result result = std::from_chars(first, last, value);
+        return first != last && result.ec == std::errc() && result.ptr == last;
+    }
 
-        if (input.size() < static_cast<size_t>(key_len) + 2) {
-            resp.error = "Invalid request: truncated key";
+    /**
+     * @brief Parse a number of seconds into milliseconds
+     * @return true if the argument is an integer whose milliseconds fit, false otherwise
+     */
+    static bool parseSeconds(std::string_view arg, long long &ms) {
+        long long seconds;
+        if (!parseInteger(arg, seconds) || seconds > MAX_TTL_MS / 1000 || seconds < -MAX_TTL_MS / 1000) {
             return false;
         }
-
-        resp.key = std::string(input.substr(0, key_len));
-        input.remove_prefix(key_len + 2);
+        ms = seconds * 1000;
         return true;
     }
 
     /**
-     * @brief Parse the value from the input buffer
-     * @param input The input buffer containing the RESP command
-     * @param resp The Resp object to store the parsed information
+     * @brief Parse the `EX seconds` or `PX milliseconds` option of SET
+     * @param option The option name
+     * @param amount The time to live it gives
+     * @param resp The Resp object to store the time to live in
      * @return true if parsing is successful, false otherwise
      */
-    static bool parseValue(std::string_view &input, Resp &resp) {
-        if (input.empty() || input[0] != '$') {
-            resp.error = "Invalid request: missing value string marker";
-            return false;
-        }
-
-        size_t pos = input.find(CRLF);
-        if (pos == std::string_view::npos) {
-            resp.error = "Invalid request: malformed value length";
+    static bool parseSetExpiry(std::string_view option, std::string_view amount, Resp &resp) {
+        bool valid;
+        if (option == "EX") {
+            valid = parseSeconds(amount, resp.ttl_ms);
+        } else if (option == "PX") {
+            valid = parseInteger(amount, resp.ttl_ms) && resp.ttl_ms <= MAX_TTL_MS;
+        } else {
+            resp.error = "Invalid request: syntax error";
             return false;
         }
-
-        int value_len;
-        try {
-            value_len = std::stoi(std::string(input.substr(1, pos - 1)));
-        } catch (std::exception &) {
-            resp.error = "Invalid request: invalid value length";
+        if (!valid || resp.ttl_ms <= 0) {
+            resp.error = "Invalid request: invalid expire time";
             return false;
         }
+        return true;
+    }
 
-        input.remove_prefix(pos + 2);
-
-        if (input.size() < static_cast<size_t>(value_len) + 2) {
-            resp.error = "Invalid request: truncated value";
+    /**
+     * @brief Parse the operation name
+     * @param op The first element of the command array
+     * @param resp The Resp object to store the parsed information
+     * @return true if parsing is successful, false otherwise
+     */
+    static bool parseOperation(std::string_view op, Resp &resp) {
+        if (op == "DEL") {
+            resp.operation = DEL;
+        } else if (op == "GET") {
+            resp.operation = GET;
+        } else if (op == "SET") {
+            resp.operation = SET;
+        } else if (op == "SCAN") {
+            resp.operation = SCAN;
+        } else if (op == "MGET") {
+            resp.operation = MGET;
+        } else if (op == "MSET") {
+            resp.operation = MSET;
+        } else if (op == "EXPIRE") {
+            resp.operation = EXPIRE;
+        } else if (op == "TTL") {
+            resp.operation = TTL;
+        } else if (op == "DELRANGE") {
+            resp.operation = DELRANGE;
+        } else if (op == "DELPREFIX") {
+            resp.operation = DELPREFIX;
+        } else if (op == "INFO") {
+            resp.operation = INFO;
+        } else if (op == "REPLICATE") {
+            resp.operation = REPLICATE;
+        } else {
+            resp.error = "Invalid request: unknown operation";
             return false;
         }
-
-        resp.value = std::string(input.substr(0, value_len));
-        input.remove_prefix(value_len + 2);
         return true;
     }
 };
@@ -14,7 +14,9 @@
 #ifndef RESP_ENCODER_HPP
 #define RESP_ENCODER_HPP
 
+#include <cstddef>
 #include <string>
+#include <vector>
 
 class RespEncoder {
 public:
@@ -54,7 +56,7 @@ public:
      * a CRLF sequence. This is the standard format for integers in RESP.
      * For example, the integer 42 would be converted to ":42\r\n".
      */
-    static std::string integer(int value) {
+    static std::string integer(long long value) {
         return ":" + std::to_string(value) + "\r\n";
     }
 
@@ -81,6 +83,32 @@ public:
         }
         return "$" + std::to_string(str.length()) + "\r\n" + str + "\r\n";
     }
+
+    /**
+     * @brief Converts an array header to RESP format.
+     * @param count the number of elements that follow
+     * @return std::string respresentation of the header
+     * @details The elements themselves are encoded separately and appended after the
+     * header. For example, an array of 2 elements starts with "*2\r\n".
+     */
+    static std::string arrayHeader(size_t count) {
+        return "*" + std::to_string(count) + "\r\n";
+    }
+
+    /**
+     * @brief Converts a list of strings to a RESP array of bulk strings.
+     * @param elements the strings to be sent
+     * @return std::string respresentation of the array
+     * @details For example, {"a", "bc"} would be converted to
+     * "*2\r\n$1\r\na\r\n$2\r\nbc\r\n".
+     */
+    static std::string array(const std::vector<std::string> &elements) {
+        std::string encoded = arrayHeader(elements.size());
+        for (const std::string &element : elements) {
+            encoded += bulkString(element, false);
+        }
+        return encoded;
+    }
 };
 
 #endif